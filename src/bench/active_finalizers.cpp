@@ -0,0 +1,76 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <esperanza/adminparams.h>
+#include <esperanza/finalizationparams.h>
+#include <esperanza/finalizationstate.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <vector>
+
+// Measures the queries for the active finalizers of a state with
+// NUM_FINALIZERS active finalizers and as many pending deposits: copying them
+// out as getfinalizationstate did, counting them, and visiting them in place.
+
+namespace {
+
+constexpr size_t NUM_FINALIZERS = 2000;
+
+using State = esperanza::FinalizationState;
+
+uint160 FinalizerAddress(size_t i) {
+  uint160 address;
+  *reinterpret_cast<uint64_t *>(address.begin()) = i;
+  return address;
+}
+
+template <typename Query>
+void QueryActiveFinalizers(benchmark::State &bench_state, Query query) {
+  const esperanza::FinalizationParams params;
+  const esperanza::AdminParams admin_params;
+  State state(params, admin_params);
+
+  for (size_t i = 0; i < NUM_FINALIZERS; ++i) {
+    state.ProcessDeposit(FinalizerAddress(i), params.min_deposit_size);
+  }
+  // Deposits start voting three dynasties later, the epochs get justified
+  // automatically as long as nobody can vote.
+  for (uint32_t epoch = 0; epoch < 6; ++epoch) {
+    const esperanza::Result result = state.InitializeEpoch(1 + epoch * params.epoch_length);
+    assert(result == +esperanza::Result::SUCCESS);
+  }
+  for (size_t i = NUM_FINALIZERS; i < 2 * NUM_FINALIZERS; ++i) {
+    state.ProcessDeposit(FinalizerAddress(i), params.min_deposit_size);
+  }
+  assert(state.GetActiveFinalizersCount() == NUM_FINALIZERS);
+
+  while (bench_state.KeepRunning()) {
+    const size_t count = query(state);
+    assert(count == NUM_FINALIZERS);
+  }
+}
+
+void ActiveFinalizersCopy(benchmark::State &state) {
+  QueryActiveFinalizers(state, [](const State &s) { return s.GetActiveFinalizers().size(); });
+}
+
+void ActiveFinalizersCount(benchmark::State &state) {
+  QueryActiveFinalizers(state, [](const State &s) { return s.GetActiveFinalizersCount(); });
+}
+
+void ActiveFinalizersVisit(benchmark::State &state) {
+  QueryActiveFinalizers(state, [](const State &s) {
+    size_t count = 0;
+    s.ForEachActiveFinalizer([&count](const esperanza::Validator &) { ++count; });
+    return count;
+  });
+}
+
+}  // namespace
+
+BENCHMARK(ActiveFinalizersCopy, 100);
+BENCHMARK(ActiveFinalizersCount, 100000);
+BENCHMARK(ActiveFinalizersVisit, 100);
@@ -0,0 +1,172 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockchain/blockchain_behavior.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <finalization/state_repository.h>
+#include <fs.h>
+#include <injector.h>
+#include <miner.h>
+#include <random.h>
+#include <scheduler.h>
+#include <script/sigcache.h>
+#include <snapshot/messages.h>
+#include <staking/active_chain.h>
+#include <staking/transactionpicker.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <util.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <cassert>
+#include <vector>
+
+// Measures the time it takes the proposer to pick the transactions of a new
+// block when the mempool holds MEMPOOL_SIZE transactions: once by assembling
+// a template from the mempool as it is done for every proposal without a
+// maintained template, once by picking from the template which the
+// TransactionPicker maintains, and once after a transaction was added to the
+// mempool and appended to the maintained template.
+
+namespace {
+
+constexpr size_t MEMPOOL_SIZE = 100000;
+constexpr size_t ITERATIONS = 10;
+
+//! \brief A regtest chain consisting of the genesis block, set up like the
+//! TestingSetup of the unit tests.
+class Chain {
+ public:
+  Chain() {
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    const bool secp256k1_context = snapshot::InitSecp256k1Context();
+    assert(secp256k1_context);
+
+    blockchain::Behavior::SetGlobal(blockchain::Behavior::NewForNetwork(blockchain::Network::regtest));
+    UnitEInjectorConfiguration config;
+    config.use_in_memory_databases = true;
+    UnitEInjector::Init(config);
+    SelectParams(GetComponent<blockchain::Behavior>(), CBaseChainParams::REGTEST);
+    const CChainParams &chainparams = Params();
+
+    m_data_dir = fs::temp_directory_path() / strprintf("bench_unite_%lu_%i", (unsigned long)GetTime(), (int)GetRand(1 << 30));
+    fs::create_directories(m_data_dir);
+    gArgs.ForceSetArg("-datadir", m_data_dir.string());
+    ClearDatadirCache();
+
+    m_threads.create_thread(boost::bind(&CScheduler::serviceQueue, &m_scheduler));
+    GetMainSignals().RegisterBackgroundSignalScheduler(m_scheduler);
+
+    GetComponent<finalization::StateRepository>()->Reset(chainparams.GetFinalization(),
+                                                         chainparams.GetAdminParams());
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+    pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    bool loaded = LoadGenesisBlock(chainparams);
+    assert(loaded);
+    CValidationState state;
+    loaded = ActivateBestChain(state, chainparams);
+    assert(loaded);
+  }
+
+  ~Chain() {
+    mempool.clear();
+    m_threads.interrupt_all();
+    m_threads.join_all();
+    GetMainSignals().FlushBackgroundCallbacks();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    UnloadBlockIndex();
+    pcoinsTip.reset();
+    pcoinsdbview.reset();
+    pblocktree.reset();
+    UnitEInjector::Destroy();
+    snapshot::DestroySecp256k1Context();
+    fs::remove_all(m_data_dir);
+  }
+
+ private:
+  fs::path m_data_dir;
+  CScheduler m_scheduler;
+  boost::thread_group m_threads;
+};
+
+CTransactionRef CreateTransaction() {
+  CMutableTransaction mtx;
+  mtx.vin.emplace_back(GetRandHash(), 0, CScript() << std::vector<unsigned char>(72, 0));
+  mtx.vout.emplace_back(10000, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0) << OP_EQUALVERIFY << OP_CHECKSIG);
+  return MakeTransactionRef(mtx);
+}
+
+void AddToMempool(const CTransactionRef &tx) {
+  LOCK(mempool.cs);
+  const CAmount fee = 1000 + GetRand(100000);
+  mempool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, fee, GetTime(), 1, false, 4, LockPoints()));
+}
+
+void FillMempool() {
+  for (size_t i = 0; i < MEMPOOL_SIZE; ++i) {
+    AddToMempool(CreateTransaction());
+  }
+}
+
+std::unique_ptr<staking::TransactionPicker> NewTransactionPicker() {
+  return staking::TransactionPicker::New(GetComponent<staking::ActiveChain>(),
+                                         GetComponent<finalization::StateRepository>());
+}
+
+void ProposalLatencyAssembleTemplate(benchmark::State &state) {
+  Chain chain;
+  FillMempool();
+
+  while (state.KeepRunning()) {
+    std::unique_ptr<CBlockTemplate> block_template = BlockAssembler(Params()).CreateNewTemplate();
+    assert(block_template->block.vtx.size() > 1);
+  }
+}
+
+void ProposalLatencyPickTransactions(benchmark::State &state) {
+  Chain chain;
+  FillMempool();
+
+  const std::unique_ptr<staking::TransactionPicker> picker = NewTransactionPicker();
+  const staking::TransactionPicker::PickTransactionsParameters parameters;
+  picker->PickTransactions(parameters);
+
+  while (state.KeepRunning()) {
+    const staking::TransactionPicker::PickTransactionsResult result = picker->PickTransactions(parameters);
+    assert(!result.transactions.empty());
+  }
+}
+
+void ProposalLatencyAfterTransactionAdded(benchmark::State &state) {
+  Chain chain;
+  FillMempool();
+
+  const std::unique_ptr<staking::TransactionPicker> picker = NewTransactionPicker();
+  const staking::TransactionPicker::PickTransactionsParameters parameters;
+  picker->Start();
+  picker->PickTransactions(parameters);
+
+  while (state.KeepRunning()) {
+    const CTransactionRef tx = CreateTransaction();
+    AddToMempool(tx);
+    GetMainSignals().TransactionAddedToMempool(tx);
+    SyncWithValidationInterfaceQueue();
+    const staking::TransactionPicker::PickTransactionsResult result = picker->PickTransactions(parameters);
+    assert(!result.transactions.empty());
+  }
+  picker->Stop();
+}
+
+}  // namespace
+
+BENCHMARK(ProposalLatencyAssembleTemplate, ITERATIONS);
+BENCHMARK(ProposalLatencyPickTransactions, ITERATIONS);
+BENCHMARK(ProposalLatencyAfterTransactionAdded, ITERATIONS);
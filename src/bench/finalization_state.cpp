@@ -0,0 +1,84 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <esperanza/validator.h>
+#include <uint256.h>
+#include <util/persistent_map.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+// Compares the cost of keeping one finalization state per block (as
+// finalization::StateRepository does) with the former std::map based layout
+// and with util::PersistentMap. Every block derives its state from the parent
+// and records the votes of a fraction of the finalizers.
+
+namespace {
+
+constexpr size_t NUM_BLOCKS = 100;
+constexpr size_t NUM_VALIDATORS = 2000;
+constexpr size_t EPOCH_LENGTH = 5;
+
+template <typename K, typename V>
+using StdMap = std::map<K, V>;
+
+template <typename K, typename V>
+using PersistentMap = util::PersistentMap<K, V>;
+
+template <template <typename, typename> class Map, typename Set>
+struct StateLayout {
+  Map<uint160, esperanza::Validator> validators;
+  Map<uint32_t, Set> vote_sets;
+  Map<uint32_t, uint32_t> epoch_to_dynasty;
+};
+
+uint160 ValidatorAddress(size_t i) {
+  uint160 address;
+  *reinterpret_cast<uint64_t *>(address.begin()) = i;
+  return address;
+}
+
+template <typename State>
+void DeriveStatesPerBlock(benchmark::State &bench_state) {
+  State genesis;
+  for (size_t i = 0; i < NUM_VALIDATORS; ++i) {
+    const uint160 address = ValidatorAddress(i);
+    genesis.validators[address] = esperanza::Validator(10000, 0, address);
+  }
+
+  const size_t votes_per_block = NUM_VALIDATORS / EPOCH_LENGTH;
+
+  while (bench_state.KeepRunning()) {
+    std::vector<State> states;
+    states.reserve(NUM_BLOCKS + 1);
+    states.push_back(genesis);
+    for (size_t height = 1; height <= NUM_BLOCKS; ++height) {
+      states.push_back(states.back());
+      State &state = states.back();
+      const uint32_t epoch = height / EPOCH_LENGTH;
+      state.epoch_to_dynasty[epoch] = epoch;
+      const size_t first = (height % EPOCH_LENGTH) * votes_per_block;
+      for (size_t i = first; i < first + votes_per_block; ++i) {
+        const uint160 address = ValidatorAddress(i);
+        state.vote_sets[epoch].insert(address);
+        state.validators.at(address).m_last_transaction_hash = uint256S("aa");
+      }
+    }
+  }
+}
+
+void FinalizationStateStdMap(benchmark::State &state) {
+  DeriveStatesPerBlock<StateLayout<StdMap, std::set<uint160>>>(state);
+}
+
+void FinalizationStatePersistentMap(benchmark::State &state) {
+  DeriveStatesPerBlock<StateLayout<PersistentMap, util::PersistentSet<uint160>>>(state);
+}
+
+}  // namespace
+
+BENCHMARK(FinalizationStateStdMap, 4);
+BENCHMARK(FinalizationStatePersistentMap, 13);
@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <esperanza/adminparams.h>
+#include <esperanza/finalizationparams.h>
+#include <esperanza/finalizationstate.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+// Measures block connection while NUM_READERS threads poll the finalization
+// state of the tip every READ_INTERVAL_US, as RPC polling and getcommits
+// serving do.
+// Connecting a block derives the state of the new tip from its parent and
+// processes the deposits of the block while holding the repository lock.
+// The readers either take the same lock to read the tip state, or load the
+// immutable snapshot which is published once the block is connected.
+
+namespace {
+
+constexpr size_t NUM_BLOCKS = 100;
+constexpr size_t DEPOSITS_PER_BLOCK = 10;
+constexpr size_t NUM_READERS = 3;
+constexpr size_t LOOKUPS_PER_READ = 100;
+constexpr int READ_INTERVAL_US = 20;
+
+using State = esperanza::FinalizationState;
+
+uint160 ValidatorAddress(size_t i) {
+  uint160 address;
+  *reinterpret_cast<uint64_t *>(address.begin()) = i;
+  return address;
+}
+
+// What getfinalizationstate and getvalidatorinfo read from the tip state
+size_t Read(const State &state) {
+  size_t found = state.GetCurrentEpoch() + state.GetLastFinalizedEpoch();
+  for (size_t i = 0; i < LOOKUPS_PER_READ; ++i) {
+    found += state.GetValidator(ValidatorAddress(i)) != nullptr;
+  }
+  return found;
+}
+
+class Chain {
+ public:
+  Chain() {
+    m_states.emplace_back(m_params, m_admin_params);
+    Publish();
+  }
+
+  void ConnectBlock() {
+    LOCK(m_cs);
+    m_states.emplace_back(m_states.back(), State::COMPLETED);
+    State &state = m_states.back();
+    for (size_t i = 0; i < DEPOSITS_PER_BLOCK; ++i) {
+      state.ProcessDeposit(ValidatorAddress(m_deposits++), 10000);
+    }
+    Publish();
+  }
+
+  size_t ReadLocked() {
+    LOCK(m_cs);
+    return Read(m_states.back());
+  }
+
+  size_t ReadSnapshot() const {
+    const std::shared_ptr<const State> snapshot = std::atomic_load(&m_snapshot);
+    return Read(*snapshot);
+  }
+
+ private:
+  void Publish() {
+    AssertLockHeld(m_cs);
+    std::atomic_store(&m_snapshot, std::make_shared<const State>(m_states.back(), State::COMPLETED));
+  }
+
+  esperanza::FinalizationParams m_params;
+  esperanza::AdminParams m_admin_params;
+  CCriticalSection m_cs;
+  std::list<State> m_states;
+  std::shared_ptr<const State> m_snapshot;
+  size_t m_deposits = 0;
+};
+
+template <typename Reader>
+void ConnectBlocksWithReaders(benchmark::State &bench_state, Reader read) {
+  while (bench_state.KeepRunning()) {
+    Chain chain;
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> found{0};
+    boost::thread_group readers;
+    for (size_t i = 0; i < NUM_READERS; ++i) {
+      readers.create_thread([&chain, &stop, &found, &read] {
+        while (!stop) {
+          found += read(chain);
+          boost::this_thread::sleep_for(boost::chrono::microseconds(READ_INTERVAL_US));
+        }
+      });
+    }
+    for (size_t i = 0; i < NUM_BLOCKS; ++i) {
+      chain.ConnectBlock();
+    }
+    stop = true;
+    readers.join_all();
+  }
+}
+
+void FinalizationStateReadersLocked(benchmark::State &state) {
+  ConnectBlocksWithReaders(state, [](Chain &chain) { return chain.ReadLocked(); });
+}
+
+void FinalizationStateReadersSnapshot(benchmark::State &state) {
+  ConnectBlocksWithReaders(state, [](Chain &chain) { return chain.ReadSnapshot(); });
+}
+
+}  // namespace
+
+BENCHMARK(FinalizationStateReadersLocked, 10);
+BENCHMARK(FinalizationStateReadersSnapshot, 10);
@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <checkqueue.h>
+#include <esperanza/vote.h>
+#include <key.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <script/sigcache.h>
+#include <util.h>
+#include <validation.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <cassert>
+#include <vector>
+
+// Measures the stateless checks of the finalizer commits of a block with
+// VOTES_PER_BLOCK votes, once in the thread which connects the block and once
+// on the check queue workers as ConnectBlock runs them. The vote signature
+// cache would hide the verification after the first run, so every iteration
+// checks a different block. The blocks are generated upfront, NUM_BLOCKS
+// covers the default number of evaluations.
+
+namespace {
+
+constexpr size_t VOTES_PER_BLOCK = 1000;
+constexpr size_t ITERATIONS = 4;
+constexpr size_t NUM_BLOCKS = ITERATIONS * 5;
+constexpr unsigned int QUEUE_BATCH_SIZE = 128;
+constexpr int MIN_CORES = 2;
+
+CTransactionRef CreateVote(const CKey &key, const uint32_t target_epoch) {
+  const esperanza::Vote vote{key.GetPubKey().GetID(), GetRandHash(), target_epoch - 1, target_epoch};
+  std::vector<unsigned char> vote_sig;
+  const bool signed_vote = key.Sign(vote.GetHash(), vote_sig);
+  assert(signed_vote);
+
+  const CScript vote_script = CScript::EncodeVote(vote, vote_sig);
+  const std::vector<unsigned char> vote_data(vote_script.begin(), vote_script.end());
+
+  CMutableTransaction mtx;
+  mtx.SetType(TxType::VOTE);
+  mtx.vin.emplace_back(GetRandHash(), 0, CScript() << vote_sig << vote_data);
+  mtx.vout.emplace_back(10000, CScript::CreateFinalizerCommitScript(key.GetPubKey()));
+  return MakeTransactionRef(mtx);
+}
+
+std::vector<std::vector<CTransactionRef>> CreateBlocks() {
+  InitSignatureCache();
+
+  std::vector<CKey> keys(VOTES_PER_BLOCK);
+  for (CKey &key : keys) {
+    key.MakeNewKey(true);
+  }
+
+  std::vector<std::vector<CTransactionRef>> blocks(NUM_BLOCKS);
+  for (size_t i = 0; i < NUM_BLOCKS; ++i) {
+    for (const CKey &key : keys) {
+      blocks[i].emplace_back(CreateVote(key, i + 1));
+    }
+  }
+  return blocks;
+}
+
+void FinalizerCommitsSerial(benchmark::State &state) {
+  const std::vector<std::vector<CTransactionRef>> blocks = CreateBlocks();
+
+  size_t block = 0;
+  while (state.KeepRunning()) {
+    for (const CTransactionRef &tx : blocks[block % NUM_BLOCKS]) {
+      CFinalizerCommitCheck check(*tx);
+      const bool valid = check();
+      assert(valid);
+    }
+    ++block;
+  }
+}
+
+void FinalizerCommitsCheckQueue(benchmark::State &state) {
+  const std::vector<std::vector<CTransactionRef>> blocks = CreateBlocks();
+
+  CCheckQueue<CFinalizerCommitCheck> queue(QUEUE_BATCH_SIZE);
+  boost::thread_group tg;
+  for (int i = 0; i < std::max(MIN_CORES, GetNumCores()) - 1; ++i) {
+    tg.create_thread([&] { queue.Thread(); });
+  }
+
+  size_t block = 0;
+  while (state.KeepRunning()) {
+    CCheckQueueControl<CFinalizerCommitCheck> control(&queue);
+    std::vector<CFinalizerCommitCheck> checks;
+    for (const CTransactionRef &tx : blocks[block % NUM_BLOCKS]) {
+      checks.emplace_back(*tx);
+    }
+    control.Add(checks);
+    const bool valid = control.Wait();
+    assert(valid);
+    ++block;
+  }
+  tg.interrupt_all();
+  tg.join_all();
+}
+
+}  // namespace
+
+BENCHMARK(FinalizerCommitsSerial, ITERATIONS);
+BENCHMARK(FinalizerCommitsCheckQueue, ITERATIONS);
@@ -0,0 +1,110 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <consensus/ltor.h>
+#include <p2p/graphene.h>
+#include <random.h>
+
+#include <cassert>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Measures the encoding of a block with BLOCK_TXS transactions for NUM_PEERS
+// peers whose tx pools hold around TX_POOL_SIZE transactions: once by
+// encoding it and building the compact block for every peer, as the graphene
+// sender did, and once by sharing the encoding of the block between the peers
+// whose tx pools fall in the same size bucket.
+
+namespace {
+
+constexpr size_t BLOCK_TXS = 2000;
+constexpr size_t NUM_PEERS = 100;
+constexpr size_t TX_POOL_SIZE = 10000;
+
+CTransactionRef CreateTx(const uint32_t seed) {
+  CMutableTransaction tx;
+  tx.vin.resize(1);
+  tx.vin[0].prevout = COutPoint(uint256(), seed);
+  tx.vout.resize(1);
+  tx.vout[0].nValue = seed;
+  return MakeTransactionRef(std::move(tx));
+}
+
+CBlock CreateBlock() {
+  CMutableTransaction coinbase;
+  coinbase.vin.resize(1);
+  coinbase.SetType(TxType::COINBASE);
+
+  CBlock block;
+  block.vtx.emplace_back(MakeTransactionRef(std::move(coinbase)));
+  for (uint32_t i = 0; i < BLOCK_TXS; ++i) {
+    block.vtx.emplace_back(CreateTx(i));
+  }
+  ltor::SortTransactions(block.vtx);
+  return block;
+}
+
+// Tx pool sizes of the peers, within 5% of TX_POOL_SIZE
+std::vector<size_t> CreatePeers() {
+  FastRandomContext random(true);
+  std::vector<size_t> peers;
+  for (size_t i = 0; i < NUM_PEERS; ++i) {
+    peers.emplace_back(TX_POOL_SIZE - TX_POOL_SIZE / 20 + random.randrange(TX_POOL_SIZE / 10));
+  }
+  return peers;
+}
+
+void GrapheneEncodePerPeer(benchmark::State &state) {
+  const CBlock block = CreateBlock();
+  const std::vector<size_t> peers = CreatePeers();
+  FastRandomContext random(true);
+
+  while (state.KeepRunning()) {
+    size_t sent = 0;
+    for (const size_t receiver_tx_count : peers) {
+      const boost::optional<p2p::GrapheneBlock> graphene =
+          p2p::CreateGrapheneBlock(block, TX_POOL_SIZE, receiver_tx_count, random);
+      assert(graphene);
+      const CBlockHeaderAndShortTxIDs cmpct_block(block);
+      sent += GetSerializeSize(graphene.get(), SER_NETWORK, PROTOCOL_VERSION) <
+              GetSerializeSize(cmpct_block, SER_NETWORK, PROTOCOL_VERSION);
+    }
+    assert(sent == NUM_PEERS);
+  }
+}
+
+void GrapheneEncodeShared(benchmark::State &state) {
+  const CBlock block = CreateBlock();
+  const std::vector<size_t> peers = CreatePeers();
+  FastRandomContext random(true);
+
+  while (state.KeepRunning()) {
+    const p2p::GrapheneBlockEncoder encoder(block);
+    std::map<std::pair<uint64_t, uint64_t>, boost::optional<p2p::GrapheneBlock>> encodings;
+    size_t sent = 0;
+    for (const size_t receiver_tx_count : peers) {
+      const std::pair<uint64_t, uint64_t> key(p2p::GetTxPoolSizeBucket(TX_POOL_SIZE),
+                                              p2p::GetTxPoolSizeBucket(receiver_tx_count));
+      auto it = encodings.find(key);
+      if (it == encodings.end()) {
+        const p2p::GrapheneBlockParams params = encoder.GetParams(key.first, key.second);
+        boost::optional<p2p::GrapheneBlock> graphene;
+        if (encoder.EstimateGrapheneBlockSize(params) < encoder.GetCompactBlockSize()) {
+          graphene = encoder.Encode(params, random.rand64(), random.rand32());
+        }
+        it = encodings.emplace(key, std::move(graphene)).first;
+      }
+      sent += static_cast<bool>(it->second);
+    }
+    assert(sent == NUM_PEERS);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(GrapheneEncodePerPeer, 2);
+BENCHMARK(GrapheneEncodeShared, 2);
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <consensus/ltor.h>
+#include <p2p/graphene.h>
+#include <random.h>
+#include <txmempool.h>
+#include <txpool.h>
+#include <util.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+// Measures the reconstruction of a graphene block with BLOCK_TXS transactions
+// by a receiver whose mempool holds the block transactions and many others.
+
+namespace {
+
+constexpr size_t BLOCK_TXS = 2000;
+
+CTransactionRef CreateTx(const uint32_t seed) {
+  CMutableTransaction tx;
+  tx.vin.resize(1);
+  tx.vin[0].prevout = COutPoint(uint256(), seed);
+  tx.vin[0].scriptWitness.stack.emplace_back(32, static_cast<uint8_t>(seed));
+  tx.vout.resize(1);
+  tx.vout[0].nValue = seed;
+  return MakeTransactionRef(std::move(tx));
+}
+
+void FillMempool(const size_t mempool_size) {
+  LOCK(mempool.cs);
+  mempool.clear();
+  LockPoints lp;
+  for (uint32_t i = 0; i < mempool_size; ++i) {
+    const CTransactionRef tx = CreateTx(i);
+    mempool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, 0, 0, 1, false, 4, lp));
+  }
+}
+
+p2p::GrapheneBlock BuildGrapheneBlock(const size_t mempool_size) {
+  CMutableTransaction coinbase;
+  coinbase.vin.resize(1);
+  coinbase.SetType(TxType::COINBASE);
+
+  CBlock block;
+  block.vtx.emplace_back(MakeTransactionRef(std::move(coinbase)));
+  for (uint32_t i = 0; i < BLOCK_TXS; ++i) {
+    block.vtx.emplace_back(CreateTx(i * (mempool_size / BLOCK_TXS)));
+  }
+  ltor::SortTransactions(block.vtx);
+
+  FastRandomContext random(true);
+  const boost::optional<p2p::GrapheneBlock> graphene =
+      p2p::CreateGrapheneBlock(block, mempool_size - BLOCK_TXS, mempool_size, random);
+  assert(graphene);
+  return graphene.get();
+}
+
+void Reconstruct(benchmark::State &state, const size_t mempool_size, const size_t threads) {
+  FillMempool(mempool_size);
+  const p2p::GrapheneBlock graphene = BuildGrapheneBlock(mempool_size);
+  const std::unique_ptr<TxPool> tx_pool = TxPool::New();
+
+  while (state.KeepRunning()) {
+    p2p::GrapheneBlockReconstructor reconstructor(graphene, *tx_pool, threads);
+    assert(reconstructor.GetState() != +p2p::GrapheneDecodeState::NEED_MORE_TXS);
+  }
+
+  LOCK(mempool.cs);
+  mempool.clear();
+}
+
+// The enumeration pass as it was done before TxPool::ForEachTx: copy the
+// pool and compute the witness hash of every transaction.
+void EnumerateCopy(benchmark::State &state, const size_t mempool_size) {
+  FillMempool(mempool_size);
+  const p2p::GrapheneBlock graphene = BuildGrapheneBlock(mempool_size);
+  const p2p::GrapheneHasher hasher(graphene.header, graphene.nonce);
+  const std::unique_ptr<TxPool> tx_pool = TxPool::New();
+
+  while (state.KeepRunning()) {
+    std::vector<p2p::GrapheneShortHash> passed;
+    for (const CTransactionRef &tx : tx_pool->GetTxs()) {
+      const p2p::GrapheneFullHash full_hash = hasher.GetFullHash(*tx);
+      const p2p::GrapheneShortHash short_hash = hasher.GetShortHash(full_hash);
+      if (graphene.bloom_filter.contains(full_hash)) {
+        passed.emplace_back(short_hash);
+      }
+    }
+    assert(passed.size() >= BLOCK_TXS);
+  }
+
+  LOCK(mempool.cs);
+  mempool.clear();
+}
+
+size_t AllCores() {
+  return static_cast<size_t>(std::max(GetNumCores(), 1));
+}
+
+void GrapheneEnumerateCopy300k(benchmark::State &state) { EnumerateCopy(state, 300000); }
+void GrapheneReconstruct10k(benchmark::State &state) { Reconstruct(state, 10000, 1); }
+void GrapheneReconstruct100k(benchmark::State &state) { Reconstruct(state, 100000, 1); }
+void GrapheneReconstruct100kAllCores(benchmark::State &state) { Reconstruct(state, 100000, AllCores()); }
+void GrapheneReconstruct300k(benchmark::State &state) { Reconstruct(state, 300000, 1); }
+void GrapheneReconstruct300kAllCores(benchmark::State &state) { Reconstruct(state, 300000, AllCores()); }
+
+}  // namespace
+
+BENCHMARK(GrapheneEnumerateCopy300k, 2);
+BENCHMARK(GrapheneReconstruct10k, 40);
+BENCHMARK(GrapheneReconstruct100k, 4);
+BENCHMARK(GrapheneReconstruct100kAllCores, 4);
+BENCHMARK(GrapheneReconstruct300k, 2);
+BENCHMARK(GrapheneReconstruct300kAllCores, 2);
@@ -0,0 +1,75 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <iblt.h>
+
+#include <cassert>
+#include <vector>
+
+// Measures the IBLT operations done by graphene: the sender encodes the block
+// transactions, the receiver subtracts its own IBLT and decodes the
+// difference. The numbers of items are covered by iblt_params.table.
+
+namespace {
+
+using GrapheneLikeIBLT = IBLT<uint64_t, 0>;
+
+GrapheneLikeIBLT Encode(const size_t items, const uint64_t first_key) {
+  GrapheneLikeIBLT iblt(items);
+  for (uint64_t key = first_key; key < first_key + items; ++key) {
+    iblt.Insert(key * 0x9e3779b97f4a7c15, {});
+  }
+  return iblt;
+}
+
+void IBLTEncode(benchmark::State &state, const size_t items) {
+  while (state.KeepRunning()) {
+    const GrapheneLikeIBLT iblt = Encode(items, 1);
+    assert(iblt.IsValid());
+  }
+}
+
+void IBLTSubtract(benchmark::State &state, const size_t items) {
+  const GrapheneLikeIBLT sender = Encode(items, 1);
+  const GrapheneLikeIBLT receiver = Encode(items, 1 + items / 2);
+  while (state.KeepRunning()) {
+    const GrapheneLikeIBLT diff = sender - receiver;
+    assert(diff.IsValid());
+  }
+}
+
+void IBLTDecode(benchmark::State &state, const size_t items) {
+  // Half of the items of each side are unique, so the difference has as
+  // many entries as the tables were sized for.
+  const GrapheneLikeIBLT sender = Encode(items, 1);
+  const GrapheneLikeIBLT receiver = Encode(items, 1 + items / 2);
+  const GrapheneLikeIBLT diff = sender - receiver;
+  while (state.KeepRunning()) {
+    GrapheneLikeIBLT::TEntriesMap positive;
+    GrapheneLikeIBLT::TEntriesMap negative;
+    const bool decoded = diff.ListEntries(positive, negative);
+    assert(!decoded || positive.size() == items / 2);
+  }
+}
+
+void IBLTEncode10(benchmark::State &state) { IBLTEncode(state, 10); }
+void IBLTEncode100(benchmark::State &state) { IBLTEncode(state, 100); }
+void IBLTEncode1000(benchmark::State &state) { IBLTEncode(state, 1000); }
+void IBLTSubtract100(benchmark::State &state) { IBLTSubtract(state, 100); }
+void IBLTSubtract1000(benchmark::State &state) { IBLTSubtract(state, 1000); }
+void IBLTDecode10(benchmark::State &state) { IBLTDecode(state, 10); }
+void IBLTDecode100(benchmark::State &state) { IBLTDecode(state, 100); }
+void IBLTDecode1000(benchmark::State &state) { IBLTDecode(state, 1000); }
+
+}  // namespace
+
+BENCHMARK(IBLTEncode10, 20000);
+BENCHMARK(IBLTEncode100, 2000);
+BENCHMARK(IBLTEncode1000, 200);
+BENCHMARK(IBLTSubtract100, 20000);
+BENCHMARK(IBLTSubtract1000, 2000);
+BENCHMARK(IBLTDecode10, 20000);
+BENCHMARK(IBLTDecode100, 2000);
+BENCHMARK(IBLTDecode1000, 200);
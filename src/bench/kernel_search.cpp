@@ -0,0 +1,77 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockchain/blockchain_behavior.h>
+#include <chain.h>
+#include <staking/coin.h>
+#include <staking/kernel_search.h>
+#include <staking/stake_validator.h>
+#include <util.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+// Measures one proposing attempt (as proposer::Logic::TryPropose does it) of
+// a wallet with many small coins. The difficulty is such that no coin is
+// eligible, which means every coin has to be checked.
+
+namespace {
+
+void SearchKernel(benchmark::State &state, const std::uint32_t num_coins, const std::size_t threads) {
+  const std::unique_ptr<blockchain::Behavior> behavior =
+      blockchain::Behavior::NewFromParameters(blockchain::Parameters::TestNet());
+  // The active chain is not needed to compute and check kernels.
+  const std::unique_ptr<staking::StakeValidator> stake_validator =
+      staking::StakeValidator::New(behavior.get(), nullptr);
+
+  CBlockIndex tip;
+  tip.nHeight = 100000;
+  tip.stake_modifier = uint256S("5e4c3b2a1");
+
+  CBlockIndex block;
+  block.nHeight = 1000;
+  block.nTime = 1550000000;
+
+  staking::CoinSet coins;
+  for (std::uint32_t i = 0; i < num_coins; ++i) {
+    uint256 txid;
+    *reinterpret_cast<std::uint32_t *>(txid.begin()) = i;
+    coins.emplace(&block, COutPoint(txid, i % 3), CTxOut(10000 + i, CScript()));
+  }
+
+  const blockchain::Difficulty difficulty = 0x03000001;
+  blockchain::Time target_time = 1560000000;
+
+  while (state.KeepRunning()) {
+    const auto found = staking::FindKernel(
+        coins,
+        stake_validator->GetKernelHasher(&tip, target_time),
+        [&](const staking::Coin &coin, const uint256 &kernel_hash) {
+          return stake_validator->CheckKernel(coin.GetAmount(), kernel_hash, difficulty);
+        },
+        threads);
+    assert(!found);
+    target_time += 4;
+  }
+}
+
+std::size_t AllCores() {
+  return static_cast<std::size_t>(std::max(GetNumCores(), 1));
+}
+
+void KernelSearch1000Coins(benchmark::State &state) { SearchKernel(state, 1000, 1); }
+void KernelSearch10000Coins(benchmark::State &state) { SearchKernel(state, 10000, 1); }
+void KernelSearch10000CoinsAllCores(benchmark::State &state) { SearchKernel(state, 10000, AllCores()); }
+void KernelSearch50000Coins(benchmark::State &state) { SearchKernel(state, 50000, 1); }
+void KernelSearch50000CoinsAllCores(benchmark::State &state) { SearchKernel(state, 50000, AllCores()); }
+
+}  // namespace
+
+BENCHMARK(KernelSearch1000Coins, 400);
+BENCHMARK(KernelSearch10000Coins, 40);
+BENCHMARK(KernelSearch10000CoinsAllCores, 40);
+BENCHMARK(KernelSearch50000Coins, 8);
+BENCHMARK(KernelSearch50000CoinsAllCores, 8);
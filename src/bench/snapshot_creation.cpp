@@ -0,0 +1,170 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparamsbase.h>
+#include <coins.h>
+#include <fs.h>
+#include <random.h>
+#include <snapshot/creator.h>
+#include <snapshot/messages.h>
+#include <txdb.h>
+#include <util.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// Measures the wall time of creating a snapshot of a chainstate which holds
+// NUM_TXS transactions with OUTPUTS_PER_TX unspent outputs each. With one
+// worker the snapshot is written on the calling thread. SnapshotCreateFromDelta
+// replaces CHURN_TXS transactions and creates the next snapshot from the
+// previous one and the changed coins.
+
+namespace {
+
+constexpr uint32_t NUM_TXS = 1000000;
+constexpr uint32_t OUTPUTS_PER_TX = 2;
+constexpr uint32_t CHURN_TXS = 10000;
+
+class Chainstate {
+ public:
+  Chainstate() : m_data_dir(fs::temp_directory_path() / fs::unique_path("bench_unite_snapshot_%%%%%%%%")) {
+    const bool initialized = snapshot::InitSecp256k1Context();
+    assert(initialized);
+
+    SelectBaseParams(CBaseChainParams::REGTEST);
+    fs::create_directories(m_data_dir);
+    gArgs.ForceSetArg("-datadir", m_data_dir.string());
+    ClearDatadirCache();
+
+    m_block_index.nTime = 1269211443;
+    m_block_index.nBits = 246;
+    {
+      LOCK(cs_main);
+      m_block_index.phashBlock = &mapBlockIndex.emplace(m_best_block, &m_block_index).first->first;
+    }
+
+    m_view = MakeUnique<CCoinsViewDB>(0, true, true);
+
+    // write the coins directly to skip maintaining the snapshot hash
+    CCoinsMap coins;
+    for (uint32_t tx = 0; tx < NUM_TXS; ++tx) {
+      m_txids.emplace_back(m_random.rand256());
+      AddCoins(m_txids.back(), tx, coins);
+      if (coins.size() >= 100000 || tx + 1 == NUM_TXS) {
+        const bool written = m_view->BatchWrite(coins, m_best_block, snapshot::SnapshotHash());
+        assert(written);
+      }
+    }
+  }
+
+  ~Chainstate() {
+    {
+      LOCK(cs_main);
+      mapBlockIndex.erase(m_best_block);
+    }
+    m_view.reset();
+    fs::remove_all(m_data_dir);
+  }
+
+  CCoinsViewDB *GetView() { return m_view.get(); }
+
+  //! Changes the snapshot hash so every snapshot gets its own directory
+  void NextSnapshot() {
+    m_block_index.stake_modifier = ArithToUint256(UintToArith256(m_block_index.stake_modifier) + 1);
+  }
+
+  //! Spends every output of the next CHURN_TXS transactions and adds as many
+  //! new ones
+  void Churn() {
+    CCoinsMap coins;
+    for (uint32_t i = 0; i < CHURN_TXS; ++i) {
+      uint256 &txid = m_txids[m_churned++ % m_txids.size()];
+      for (uint32_t n = 0; n < OUTPUTS_PER_TX; ++n) {
+        CCoinsCacheEntry &entry = coins[COutPoint(txid, n)];
+        entry.coin.Clear();
+        entry.flags = CCoinsCacheEntry::DIRTY;
+      }
+      txid = m_random.rand256();
+      AddCoins(txid, i, coins);
+    }
+    const bool written = m_view->BatchWrite(coins, m_best_block, snapshot::SnapshotHash());
+    assert(written);
+  }
+
+ private:
+  const fs::path m_data_dir;
+  const uint256 m_best_block = uint256S("aa");
+  CBlockIndex m_block_index;
+  std::unique_ptr<CCoinsViewDB> m_view;
+  FastRandomContext m_random{true};
+  std::vector<uint256> m_txids;
+  size_t m_churned = 0;
+
+  void AddCoins(const uint256 &txid, const uint32_t tx, CCoinsMap &coins) {
+    for (uint32_t n = 0; n < OUTPUTS_PER_TX; ++n) {
+      const CScript script = CScript() << OP_0 << m_random.randbytes(20);
+      CCoinsCacheEntry &entry = coins[COutPoint(txid, n)];
+      entry.coin = Coin(CTxOut(tx, script), tx / 1000, TxType::REGULAR);
+      entry.flags = CCoinsCacheEntry::DIRTY;
+    }
+  }
+};
+
+Chainstate &GetChainstate() {
+  static Chainstate chainstate;
+  return chainstate;
+}
+
+void Create(benchmark::State &state, const size_t workers) {
+  Chainstate &chainstate = GetChainstate();
+  while (state.KeepRunning()) {
+    chainstate.NextSnapshot();
+    snapshot::Creator creator(chainstate.GetView());
+    creator.m_workers = workers;
+    const snapshot::CreationInfo info = creator.Create();
+    assert(info.status == +snapshot::Status::OK);
+    assert(info.snapshot_header.total_utxo_subsets == NUM_TXS);
+  }
+}
+
+void SnapshotCreateFromDelta(benchmark::State &state) {
+  Chainstate &chainstate = GetChainstate();
+
+  // the base snapshot, the chainstate records the changes from now on
+  chainstate.NextSnapshot();
+  snapshot::Creator base(chainstate.GetView());
+  base.m_workers = 1;
+  const snapshot::CreationInfo base_info = base.Create();
+  assert(base_info.status == +snapshot::Status::OK);
+  chainstate.GetView()->TakeDelta();
+
+  while (state.KeepRunning()) {
+    chainstate.Churn();
+    chainstate.NextSnapshot();
+    snapshot::Creator creator(chainstate.GetView());
+    creator.m_workers = 1;
+    creator.m_delta = chainstate.GetView()->TakeDelta();
+    assert(creator.m_delta->GetCoins().size() == CHURN_TXS * OUTPUTS_PER_TX * 2);
+    const snapshot::CreationInfo info = creator.Create();
+    assert(info.status == +snapshot::Status::OK);
+    assert(info.snapshot_header.total_utxo_subsets == NUM_TXS);
+  }
+}
+
+void SnapshotCreate(benchmark::State &state) { Create(state, 1); }
+void SnapshotCreate4Workers(benchmark::State &state) { Create(state, 4); }
+void SnapshotCreateAllCores(benchmark::State &state) { Create(state, static_cast<size_t>(std::max(GetNumCores(), 1))); }
+
+}  // namespace
+
+BENCHMARK(SnapshotCreate, 1);
+BENCHMARK(SnapshotCreate4Workers, 1);
+BENCHMARK(SnapshotCreateAllCores, 1);
+BENCHMARK(SnapshotCreateFromDelta, 1);
@@ -0,0 +1,92 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <snapshot/messages.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <vector>
+
+// Measures the snapshot hash part of connecting a block which spends
+// NUM_INPUTS coins and creates as many new ones. A tenth of the new coins is
+// spent within the same block.
+
+namespace {
+
+constexpr uint32_t NUM_INPUTS = 4000;
+
+void InitContext() {
+  static const bool initialized = snapshot::InitSecp256k1Context();
+  assert(initialized);
+}
+
+COutPoint OutPoint(const uint32_t i, const uint32_t salt) {
+  uint256 txid;
+  *reinterpret_cast<uint32_t *>(txid.begin()) = i;
+  *reinterpret_cast<uint32_t *>(txid.begin() + 4) = salt;
+  return COutPoint(txid, i % 4);
+}
+
+Coin NewCoin(const uint32_t i) {
+  return Coin(CTxOut(i + 1, CScript() << OP_DUP << OP_HASH160 << i << OP_EQUALVERIFY << OP_CHECKSIG), i, TxType::REGULAR);
+}
+
+void ConnectBlock(benchmark::State &state, const size_t threads, const bool fold_every_coin) {
+  InitContext();
+  snapshot::SnapshotHash::SetFoldThreads(threads);
+
+  CCoinsView dummy;
+  CCoinsViewCache tip(&dummy);
+  for (uint32_t i = 0; i < NUM_INPUTS; ++i) {
+    tip.AddCoin(OutPoint(i, 0), NewCoin(i), false);
+  }
+  tip.GetSnapshotHash();
+
+  while (state.KeepRunning()) {
+    CCoinsViewCache view(&tip);
+    for (uint32_t i = 0; i < NUM_INPUTS; ++i) {
+      view.SpendCoin(OutPoint(i, 0));
+      if (fold_every_coin) {
+        view.GetSnapshotHash();
+      }
+      view.AddCoin(OutPoint(i, 1), NewCoin(i), false);
+      if (fold_every_coin) {
+        view.GetSnapshotHash();
+      }
+      if (i % 10 == 0) {
+        view.SpendCoin(OutPoint(i, 1));
+        if (fold_every_coin) {
+          view.GetSnapshotHash();
+        }
+      }
+    }
+    view.GetSnapshotHash().GetHash(uint256(), uint256());
+  }
+
+  snapshot::SnapshotHash::SetFoldThreads(1);
+}
+
+// Applies every coin to the multiset as soon as it changes, which is what
+// CCoinsViewCache did before the UTXOs were folded in batches.
+void SnapshotHashConnectBlockPerCoin(benchmark::State &state) {
+  ConnectBlock(state, 1, true);
+}
+
+void SnapshotHashConnectBlockBatched(benchmark::State &state) {
+  ConnectBlock(state, 1, false);
+}
+
+void SnapshotHashConnectBlockBatchedParallel(benchmark::State &state) {
+  ConnectBlock(state, 4, false);
+}
+
+}  // namespace
+
+BENCHMARK(SnapshotHashConnectBlockPerCoin, 2);
+BENCHMARK(SnapshotHashConnectBlockBatched, 2);
+BENCHMARK(SnapshotHashConnectBlockBatchedParallel, 4);
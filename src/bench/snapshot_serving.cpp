@@ -0,0 +1,172 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <amount.h>
+#include <bench/bench.h>
+#include <chainparamsbase.h>
+#include <fs.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <random.h>
+#include <snapshot/chunk_reader.h>
+#include <snapshot/compression.h>
+#include <snapshot/indexer.h>
+#include <snapshot/iterator.h>
+#include <snapshot/messages.h>
+#include <util.h>
+#include <version.h>
+
+#include <cassert>
+#include <memory>
+
+// Measures how fast a node serves the snapshot to peers. Every iteration
+// replies to one getsnapshot request of CHUNK_SIZE subsets, so the subsets
+// served per second are CHUNK_SIZE / the time of one iteration. The requests
+// walk through the whole snapshot of NUM_SUBSETS subsets with OUTPUTS_PER_TX
+// P2WPKH outputs each. Half of the outputs pay to one of STAKING_ADDRESSES
+// addresses. SnapshotReceive* measure how fast the node that downloads the
+// snapshot decodes such a chunk.
+
+namespace {
+
+constexpr uint32_t NUM_SUBSETS = 300000;
+constexpr uint32_t OUTPUTS_PER_TX = 2;
+constexpr uint16_t CHUNK_SIZE = 10000;
+constexpr uint32_t STAKING_ADDRESSES = 100;
+
+class SnapshotFiles {
+ public:
+  SnapshotFiles() : m_data_dir(fs::temp_directory_path() / fs::unique_path("bench_unite_serving_%%%%%%%%")) {
+    SelectBaseParams(CBaseChainParams::REGTEST);
+    fs::create_directories(m_data_dir);
+    gArgs.ForceSetArg("-datadir", m_data_dir.string());
+    ClearDatadirCache();
+
+    m_header.snapshot_hash = uint256S("aa");
+    m_header.block_hash = uint256S("bb");
+
+    FastRandomContext random(true);
+    std::vector<CScript> staking_scripts;
+    for (uint32_t i = 0; i < STAKING_ADDRESSES; ++i) {
+      staking_scripts.emplace_back(CScript() << OP_0 << random.randbytes(20));
+    }
+
+    snapshot::Indexer indexer(m_header, snapshot::DEFAULT_INDEX_STEP,
+                              snapshot::DEFAULT_INDEX_STEP_PER_FILE);
+    for (uint32_t i = 0; i < NUM_SUBSETS; ++i) {
+      snapshot::UTXOSubset subset;
+      subset.tx_id = random.rand256();
+      subset.height = i / 1000;
+      for (uint32_t n = 0; n < OUTPUTS_PER_TX; ++n) {
+        const CScript script = random.randbool() ? staking_scripts[random.randrange(STAKING_ADDRESSES)]
+                                                 : CScript() << OP_0 << random.randbytes(20);
+        subset.outputs[n] = CTxOut(random.randrange(1000) * UNIT / 10, script);
+      }
+      const bool written = indexer.WriteUTXOSubset(subset);
+      assert(written);
+    }
+    const bool flushed = indexer.Flush();
+    assert(flushed);
+  }
+
+  ~SnapshotFiles() { fs::remove_all(m_data_dir); }
+
+  std::unique_ptr<snapshot::Indexer> Open() const {
+    LOCK(snapshot::cs_snapshot);
+    std::unique_ptr<snapshot::Indexer> indexer = snapshot::Indexer::Open(m_header.snapshot_hash);
+    assert(indexer);
+    return indexer;
+  }
+
+ private:
+  const fs::path m_data_dir;
+  snapshot::SnapshotHeader m_header;
+};
+
+const SnapshotFiles &GetSnapshotFiles() {
+  static const SnapshotFiles files;
+  return files;
+}
+
+//! The way the chunks were served before: deserialize and serialize again
+void SnapshotServeIterator(benchmark::State &state) {
+  snapshot::Iterator iter(GetSnapshotFiles().Open());
+  const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+
+  uint64_t index = 0;
+  while (state.KeepRunning()) {
+    snapshot::Snapshot snapshot;
+    snapshot.snapshot_hash = iter.GetSnapshotHeader().snapshot_hash;
+    snapshot.utxo_subset_index = index;
+    const bool read = iter.GetUTXOSubsets(index, CHUNK_SIZE, snapshot.utxo_subsets);
+    assert(read);
+    const CSerializedNetMsg msg = msg_maker.Make(NetMsgType::SNAPSHOT, snapshot);
+    assert(!msg.data.empty());
+    index = (index + CHUNK_SIZE) % NUM_SUBSETS;
+  }
+}
+
+void ServeMapped(benchmark::State &state, const uint8_t format, const char *command) {
+  snapshot::ChunkReader reader(GetSnapshotFiles().Open());
+  const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+
+  uint64_t index = 0;
+  while (state.KeepRunning()) {
+    snapshot::SerializedSnapshot snapshot;
+    const bool read = reader.ReadChunk(index, CHUNK_SIZE, format, snapshot);
+    assert(read);
+    const CSerializedNetMsg msg = msg_maker.Make(command, snapshot);
+    assert(!msg.data.empty());
+    index = (index + CHUNK_SIZE) % NUM_SUBSETS;
+  }
+}
+
+//! Serving the peers which don't support the compressed format
+void SnapshotServePlain(benchmark::State &state) {
+  ServeMapped(state, snapshot::SNAPSHOT_FORMAT_PLAIN, NetMsgType::SNAPSHOT);
+}
+
+void SnapshotServeCompressed(benchmark::State &state) {
+  ServeMapped(state, snapshot::SNAPSHOT_FORMAT_COMPRESSED, NetMsgType::COMPRESSED_SNAPSHOT);
+}
+
+CDataStream ReadChunk(const uint8_t format) {
+  snapshot::ChunkReader reader(GetSnapshotFiles().Open());
+  snapshot::SerializedSnapshot snapshot;
+  const bool read = reader.ReadChunk(0, CHUNK_SIZE, format, snapshot);
+  assert(read);
+
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  stream << snapshot;
+  return stream;
+}
+
+void SnapshotReceivePlain(benchmark::State &state) {
+  const CDataStream chunk = ReadChunk(snapshot::SNAPSHOT_FORMAT_PLAIN);
+  while (state.KeepRunning()) {
+    CDataStream stream(chunk);
+    snapshot::Snapshot snapshot;
+    stream >> snapshot;
+    assert(snapshot.utxo_subsets.size() == CHUNK_SIZE);
+  }
+}
+
+void SnapshotReceiveCompressed(benchmark::State &state) {
+  const CDataStream chunk = ReadChunk(snapshot::SNAPSHOT_FORMAT_COMPRESSED);
+  while (state.KeepRunning()) {
+    CDataStream stream(chunk);
+    snapshot::Snapshot snapshot;
+    snapshot::SnapshotCompressor compressor(snapshot);
+    stream >> compressor;
+    assert(snapshot.utxo_subsets.size() == CHUNK_SIZE);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(SnapshotServeIterator, 10);
+BENCHMARK(SnapshotServePlain, 10);
+BENCHMARK(SnapshotServeCompressed, 100);
+BENCHMARK(SnapshotReceivePlain, 10);
+BENCHMARK(SnapshotReceiveCompressed, 10);
@@ -153,6 +153,7 @@ public:
         snapshotParams.create_snapshot_per_epoch = static_cast<uint16_t>(gArgs.GetArg("-createsnapshot", 1));
         snapshotParams.snapshot_chunk_timeout_sec = static_cast<uint16_t>(gArgs.GetArg("-snapshotchunktimeout", 5));
         snapshotParams.discovery_timeout_sec = static_cast<uint16_t>(gArgs.GetArg("-snapshotdiscoverytimeout", 5));
+        snapshotParams.snapshot_chunk_size = static_cast<uint16_t>(gArgs.GetArg("-snapshotchunksize", snapshotParams.snapshot_chunk_size));
 
         // Initialize with default values for regTest
         finalization = esperanza::FinalizationParams();
@@ -6,15 +6,20 @@
 
 #include <consensus/consensus.h>
 #include <random.h>
-#include <snapshot/iterator.h>
 #include <utilstrencodings.h>
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 snapshot::SnapshotHash CCoinsView::GetSnapshotHash() const { return {}; }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const snapshot::SnapshotHash &snapshot) { return false; }
 CCoinsViewCursor *CCoinsView::Cursor() const { return nullptr; }
+bool CCoinsView::ImportCoins(const std::vector<std::pair<COutPoint, Coin>> &coins) { return false; }
 void CCoinsView::ClearCoins() {}
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 {
@@ -31,6 +36,7 @@ std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetH
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const snapshot::SnapshotHash &snapshotHash) { return base->BatchWrite(mapCoins, hashBlock, snapshotHash); }
 void CCoinsViewBacked::ClearCoins() { base->ClearCoins(); }
+bool CCoinsViewBacked::ImportCoins(const std::vector<std::pair<COutPoint, Coin>> &coins) { return base->ImportCoins(coins); }
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
@@ -153,6 +159,8 @@ uint256 CCoinsViewCache::GetBestBlock() const {
 }
 
 snapshot::SnapshotHash CCoinsViewCache::GetSnapshotHash() const {
+    // fold the pending UTXOs once here instead of in every copy
+    snapshotHash.Fold();
     return snapshotHash;
 }
 
@@ -220,6 +228,9 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 }
 
 bool CCoinsViewCache::Flush() {
+    // the UTXOs changed by the block (or since the last flush) are applied
+    // to the hash in one batch
+    snapshotHash.Fold();
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, snapshotHash);
     cacheCoins.clear();
     cachedCoinsUsage = 0;
@@ -242,48 +253,132 @@ void CCoinsViewCache::ClearCoins() {
     cachedCoinsUsage = 0;
 }
 
+namespace {
+
+//! Coins of one utxo???.dat file in the key order
+struct SnapshotFile {
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    uint64_t subsets = 0;
+};
+
+} // namespace
+
 bool CCoinsViewCache::ApplySnapshot(std::unique_ptr<snapshot::Indexer> &&indexer) {
+    const snapshot::SnapshotHeader snapshot_header = indexer->GetSnapshotHeader();
     LogPrint(BCLog::COINDB, "%s: Apply snapshot hash=%s.\n",
-             __func__, indexer->GetSnapshotHeader().snapshot_hash.GetHex());
+             __func__, snapshot_header.snapshot_hash.GetHex());
 
     ClearCoins();
 
-    snapshot::Iterator iter(std::move(indexer));
-    const snapshot::SnapshotHeader &snapshot_header = iter.GetSnapshotHeader();
-    LogPrint(BCLog::COINDB, "%s: 0/%i messages processed\n",
-             __func__, snapshot_header.total_utxo_subsets);
-
     hashBlock = snapshot_header.block_hash;
 
-    uint64_t writtenSubsets = 0;
-    constexpr uint64_t batchSize = 100000;
-    while (iter.Valid()) {
-        snapshot::UTXOSubset &subset = iter.GetUTXOSubset();
-        for (auto const &p : subset.outputs) {
-            COutPoint out(subset.tx_id, p.first);
-            Coin coin(p.second, subset.height, subset.tx_type);
-            AddCoin(out, std::move(coin), true);
-        }
+    // the hash was already checked while the snapshot was downloaded
+    const bool hashVerified = indexer->ReadPartialHash(snapshotHash);
+
+    // Files are deserialized by the workers and imported by this thread in
+    // their order. The snapshot is created from the chainstate cursor, so
+    // every batch arrives at the DB in the key order.
+    const uint32_t files = indexer->GetFileCount();
+    const size_t workers = std::max<size_t>(1, std::min<size_t>(std::max(GetNumCores(), 1), files));
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<uint32_t, SnapshotFile> loaded;
+    uint32_t nextFile = 0;
+    uint32_t importedFiles = 0;
+    bool failed = false;
+    std::vector<snapshot::SnapshotHash> hashes(workers);
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&, i] {
+            std::vector<snapshot::UTXOSubset> subsets;
+            while (true) {
+                uint32_t fileId;
+                {
+                    // don't read too far ahead to keep the memory bounded
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return failed || nextFile >= files || nextFile < importedFiles + 2 * workers; });
+                    if (failed || nextFile >= files) {
+                        return;
+                    }
+                    fileId = nextFile++;
+                }
 
-        ++writtenSubsets;
+                SnapshotFile file;
+                const bool read = indexer->ReadFile(fileId, subsets);
+                if (read) {
+                    for (snapshot::UTXOSubset &subset : subsets) {
+                        if (!hashVerified) {
+                            hashes[i].AddUTXOSubset(subset);
+                        }
+                        for (auto &p : subset.outputs) {
+                            file.coins.emplace_back(COutPoint(subset.tx_id, p.first),
+                                                    Coin(std::move(p.second), subset.height, subset.tx_type));
+                        }
+                    }
+                    file.subsets = subsets.size();
+                }
 
-        if (writtenSubsets % batchSize == 0) { // ~12 MB/batch
-            if (!Flush()) {
-                LogPrint(BCLog::COINDB, "%s: can't write batch\n", __func__);
-                return false;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (read) {
+                    loaded.emplace(fileId, std::move(file));
+                } else {
+                    LogPrint(BCLog::COINDB, "%s: can't read file %i\n", __func__, fileId);
+                    failed = true;
+                }
+                cv.notify_all();
             }
+        });
+    }
+
+    uint64_t writtenSubsets = 0;
+    while (importedFiles < files) {
+        SnapshotFile file;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return failed || loaded.count(importedFiles) > 0; });
+            if (failed) {
+                break;
+            }
+            auto it = loaded.find(importedFiles);
+            file = std::move(it->second);
+            loaded.erase(it);
         }
 
-        // log every 5% of processed messages
-        uint64_t chunk = snapshot_header.total_utxo_subsets / 20;
-        if (chunk > 0 && writtenSubsets % chunk == 0) {
-            LogPrint(BCLog::COINDB, "%s: %i/%i messages processed\n", __func__,
-                     writtenSubsets, snapshot_header.total_utxo_subsets);
+        const bool imported = base->ImportCoins(file.coins);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!imported) {
+            LogPrint(BCLog::COINDB, "%s: can't write batch\n", __func__);
+            failed = true;
+            cv.notify_all();
+            break;
         }
+        ++importedFiles;
+        writtenSubsets += file.subsets;
+        cv.notify_all();
 
-        iter.Next();
+        LogPrint(BCLog::COINDB, "%s: %i/%i messages processed\n", __func__,
+                 writtenSubsets, snapshot_header.total_utxo_subsets);
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    if (failed) {
+        return false;
+    }
+
+    if (!hashVerified) {
+        for (const snapshot::SnapshotHash &hash : hashes) {
+            snapshotHash.Combine(hash);
+        }
     }
 
+    // the cache is empty, so it only stores the best block and the snapshot hash
     if (!Flush()) {
         LogPrint(BCLog::COINDB, "%s: can't write batch\n", __func__);
         return false;
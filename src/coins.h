@@ -212,6 +212,11 @@ public:
     //! Removes all coins from the DB. Is invoked only once before applying the snapshot
     virtual void ClearCoins();
 
+    //! Writes the coins straight to the storage, bypassing any cache. Is used
+    //! to load the snapshot into the empty view, so the coins are expected in
+    //! the key order and must not exist yet. Returns false if not supported.
+    virtual bool ImportCoins(const std::vector<std::pair<COutPoint, Coin>> &coins);
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 
@@ -236,6 +241,7 @@ public:
     void SetBackend(CCoinsView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const snapshot::SnapshotHash &snapshotHash) override;
     void ClearCoins() override;
+    bool ImportCoins(const std::vector<std::pair<COutPoint, Coin>> &coins) override;
     CCoinsViewCursor *Cursor() const override;
     size_t EstimateSize() const override;
 };
@@ -323,8 +329,11 @@ public:
      */
     bool Flush();
 
-    //! ApplySnapshot adds all UTXOs from the snapshot to the cache and then invokes Flush().
-    //! If false is returned, the state of this cache (and its backing view) will be undefined.
+    //! ApplySnapshot replaces the coins of the base view with the UTXOs from the snapshot.
+    //! The files of the snapshot are read in parallel and imported to the base in the
+    //! key order, see ImportCoins(). The snapshot hash is taken from the download if
+    //! it was verified there. If false is returned, the state of this cache (and its
+    //! backing view) will be undefined.
     bool ApplySnapshot(std::unique_ptr<snapshot::Indexer> &&indexer);
 
     //! Removes coins from the cache and from the base DB
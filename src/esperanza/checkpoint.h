@@ -7,9 +7,9 @@
 
 #include <serialize.h>
 #include <uint256.h>
+#include <util/persistent_map.h>
 
 #include <map>
-#include <set>
 #include <vector>
 
 namespace esperanza {
@@ -28,7 +28,7 @@ class Checkpoint {
   std::map<uint32_t, uint64_t> m_prev_dynasty_votes;
 
   // Set of validatorAddresses for validators that voted that checkpoint
-  std::set<uint160> m_vote_set;
+  util::PersistentSet<uint160> m_vote_set;
 
   uint64_t GetCurDynastyVotes(uint32_t epoch);
   uint64_t GetPrevDynastyVotes(uint32_t epoch);
@@ -7,6 +7,7 @@
 #include <esperanza/checks.h>
 #include <esperanza/finalizationstate.h>
 #include <script/interpreter.h>
+#include <script/sigcache.h>
 #include <script/sign.h>
 #include <script/standard.h>
 #include <txmempool.h>
@@ -332,7 +333,7 @@ bool CheckVoteTx(const CTransaction &tx, CValidationState &err_state,
                          "bad-scriptpubkey-pubkey-format");
   }
 
-  if (!CheckVoteSignature(pubkey, *vote_out, *vote_sig_out)) {
+  if (!CachingCheckVoteSignature(pubkey, *vote_out, *vote_sig_out)) {
     return err_state.DoS(100, false, REJECT_INVALID, "bad-vote-signature");
   }
 
@@ -56,11 +56,17 @@ FinalizationState::FinalizationState(
 
 FinalizationState::FinalizationState(const FinalizationState &parent, InitStatus status)
     : FinalizationStateData(parent),
+      m_active_finalizers(parent.m_active_finalizers),
+      m_starting_finalizers(parent.m_starting_finalizers),
+      m_ending_finalizers(parent.m_ending_finalizers),
       m_settings(parent.m_settings),
       m_status(status) {}
 
 FinalizationState::FinalizationState(FinalizationState &&parent)
     : FinalizationStateData(std::move(parent)),
+      m_active_finalizers(std::move(parent.m_active_finalizers)),
+      m_starting_finalizers(std::move(parent.m_starting_finalizers)),
+      m_ending_finalizers(std::move(parent.m_ending_finalizers)),
       m_settings(parent.m_settings),
       m_status(parent.m_status) {}
 
@@ -173,6 +179,26 @@ void FinalizationState::IncrementDynasty() {
     m_cur_dyn_deposits += GetDynastyDelta(m_current_dynasty);
     m_dynasty_start_epoch[m_current_dynasty] = m_current_epoch;
 
+    std::vector<uint160> changed;
+    while (!m_starting_finalizers.empty() && m_starting_finalizers.begin()->first <= m_current_dynasty) {
+      const std::pair<uint32_t, uint160> entry = *m_starting_finalizers.begin();
+      changed.push_back(entry.second);
+      m_starting_finalizers.erase(entry);
+    }
+    while (!m_ending_finalizers.empty() && m_ending_finalizers.begin()->first < m_current_dynasty) {
+      const std::pair<uint32_t, uint160> entry = *m_ending_finalizers.begin();
+      changed.push_back(entry.second);
+      m_ending_finalizers.erase(entry);
+    }
+    for (const uint160 &address : changed) {
+      const Validator *finalizer = GetValidator(address);
+      if (finalizer != nullptr && IsFinalizerVoting(*finalizer)) {
+        m_active_finalizers.insert(address);
+      } else {
+        m_active_finalizers.erase(address);
+      }
+    }
+
     LogPrint(BCLog::FINALIZATION, "%s: New current dynasty=%d\n", __func__,
              m_current_dynasty);
     // UNIT-E: we can clear old checkpoints (up to m_last_finalized_epoch - 1)
@@ -219,7 +245,40 @@ uint32_t FinalizationState::GetEpochsSinceFinalization() const {
 void FinalizationState::DeleteValidator(const uint160 &validatorAddress) {
   LOCK(cs_esperanza);
 
-  m_validators.erase(validatorAddress);
+  const auto it = m_validators.find(validatorAddress);
+  if (it != m_validators.end()) {
+    UnindexFinalizer(it->second);
+    m_validators.erase(validatorAddress);
+  }
+}
+
+void FinalizationState::IndexFinalizer(const Validator &finalizer) {
+  const uint160 &address = finalizer.m_validator_address;
+  if (finalizer.m_start_dynasty > m_current_dynasty) {
+    m_starting_finalizers.emplace(finalizer.m_start_dynasty, address);
+  }
+  if (finalizer.m_end_dynasty != DEFAULT_END_DYNASTY && finalizer.m_end_dynasty >= m_current_dynasty) {
+    m_ending_finalizers.emplace(finalizer.m_end_dynasty, address);
+  }
+  if (IsFinalizerVoting(finalizer)) {
+    m_active_finalizers.insert(address);
+  }
+}
+
+void FinalizationState::UnindexFinalizer(const Validator &finalizer) {
+  const uint160 &address = finalizer.m_validator_address;
+  m_starting_finalizers.erase(std::make_pair(finalizer.m_start_dynasty, address));
+  m_ending_finalizers.erase(std::make_pair(finalizer.m_end_dynasty, address));
+  m_active_finalizers.erase(address);
+}
+
+void FinalizationState::IndexFinalizers() {
+  m_active_finalizers.clear();
+  m_starting_finalizers.clear();
+  m_ending_finalizers.clear();
+  for (const auto &it : m_validators) {
+    IndexFinalizer(it.second);
+  }
 }
 
 uint64_t FinalizationState::GetDepositSize(const uint160 &validatorAddress) const {
@@ -416,9 +475,10 @@ void FinalizationState::ProcessDeposit(const uint160 &validatorAddress,
   uint64_t scaledDeposit = ufp64::div_to_uint(static_cast<uint64_t>(depositValue),
                                               GetDepositScaleFactor(m_current_epoch));
 
-  m_validators.insert(std::pair<uint160, Validator>(
+  const auto res = m_validators.insert(std::pair<uint160, Validator>(
       validatorAddress,
       Validator(scaledDeposit, startDynasty, validatorAddress)));
+  IndexFinalizer(res.first->second);
 
   m_dynasty_deltas[startDynasty] = GetDynastyDelta(startDynasty) + scaledDeposit;
 
@@ -582,10 +642,12 @@ void FinalizationState::ProcessLogout(const uint160 &validatorAddress) {
   LOCK(cs_esperanza);
 
   Validator &validator = m_validators.at(validatorAddress);
+  UnindexFinalizer(validator);
 
   uint32_t endDyn = GetEndDynasty();
   validator.m_end_dynasty = endDyn;
   validator.m_deposits_at_logout = m_cur_dyn_deposits;
+  IndexFinalizer(validator);
   m_dynasty_deltas[endDyn] = GetDynastyDelta(endDyn) - validator.m_deposit;
 
   LogPrint(BCLog::FINALIZATION,
@@ -839,7 +901,9 @@ void FinalizationState::ProcessSlash(const Vote &vote1, const Vote &vote2) {
     const CAmount deposit = m_validators.at(validatorAddress).m_deposit;
     m_dynasty_deltas[m_current_dynasty + 1] =
         GetDynastyDelta(m_current_dynasty + 1) - deposit;
+    UnindexFinalizer(m_validators.at(validatorAddress));
     m_validators.at(validatorAddress).m_end_dynasty = m_current_dynasty + 1;
+    IndexFinalizer(m_validators.at(validatorAddress));
 
     // if validator was already staged for logout at end_dynasty,
     // ensure that we don't doubly remove from total
@@ -882,6 +946,10 @@ uint32_t FinalizationState::GetEpochLength() const {
   return m_settings.epoch_length;
 }
 
+uint32_t FinalizationState::GetWithdrawalEpochDelay() const {
+  return static_cast<uint32_t>(m_settings.withdrawal_epoch_delay);
+}
+
 uint32_t FinalizationState::GetEpoch(const CBlockIndex &blockIndex) const {
   return GetEpoch(blockIndex.nHeight);
 }
@@ -904,14 +972,15 @@ blockchain::Height FinalizationState::GetEpochCheckpointHeight(const uint32_t ep
 
 std::vector<Validator> FinalizationState::GetActiveFinalizers() const {
   std::vector<Validator> res;
-  for (const auto &it : m_validators) {
-    if (IsFinalizerVoting(it.second)) {
-      res.push_back(it.second);
-    }
-  }
+  res.reserve(m_active_finalizers.size());
+  ForEachActiveFinalizer([&res](const Validator &finalizer) { res.push_back(finalizer); });
   return res;
 }
 
+size_t FinalizationState::GetActiveFinalizersCount() const {
+  return m_active_finalizers.size();
+}
+
 const Validator *FinalizationState::GetValidator(const uint160 &validatorAddress) const {
 
   auto it = m_validators.find(validatorAddress);
@@ -1059,9 +1128,8 @@ CAmount FinalizationState::GetDynastyDelta(uint32_t dynasty) {
 }
 
 Checkpoint &FinalizationState::GetCheckpoint(uint32_t epoch) {
-  const auto it = m_checkpoints.find(epoch);
-  assert(it != m_checkpoints.end());
-  return it->second;
+  assert(m_checkpoints.count(epoch) != 0);
+  return m_checkpoints.at(epoch);
 }
 
 const Checkpoint &FinalizationState::GetCheckpoint(const uint32_t epoch) const {
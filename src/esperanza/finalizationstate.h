@@ -9,6 +9,9 @@
 #include <esperanza/admincommand.h>
 #include <esperanza/finalizationparams.h>
 #include <esperanza/finalizationstate_data.h>
+#include <util/persistent_map.h>
+
+#include <utility>
 
 class CChainParams;
 
@@ -51,8 +54,14 @@ BETTER_ENUM(
 /**
  * This class is thread safe, any public method that is actually changing
  * the internal state is guarded against concurrent access.
+ *
+ * The state of the active chain tip is also published as an immutable
+ * snapshot (see finalization::StateRepository::GetTipSnapshot) which
+ * readers can hold without locking the repository.
  */
 class FinalizationState : public FinalizationStateData {
+  friend class FinalizationStateDelta;
+
  public:
   //! \brief A status that represents the current stage in the finalization state initialization process.
   enum InitStatus {
@@ -141,9 +150,36 @@ class FinalizationState : public FinalizationStateData {
   Vote GetRecommendedVote(const uint160 &validatorAddress) const;
 
   std::vector<Validator> GetActiveFinalizers() const;
+
+  //! \brief Returns the number of finalizers that can vote in the current dynasty.
+  size_t GetActiveFinalizersCount() const;
+
+  //! \brief Calls f(const Validator &) for every finalizer that can vote in
+  //! the current dynasty, without copying them.
+  template <typename F>
+  void ForEachActiveFinalizer(F f) const {
+    // Both are ordered by address, walk them side by side instead of looking
+    // up every active finalizer.
+    auto validator = m_validators.begin();
+    for (const uint160 &address : m_active_finalizers) {
+      while (validator != m_validators.end() && validator->first < address) {
+        ++validator;
+      }
+      if (validator == m_validators.end()) {
+        break;
+      }
+      if (validator->first == address) {
+        f(validator->second);
+      }
+    }
+  }
+
   const Validator *GetValidator(const uint160 &validatorAddress) const;
 
   uint32_t GetEpochLength() const;
+
+  //! \brief Returns the number of epochs a logged out finalizer has to wait before it can withdraw.
+  uint32_t GetWithdrawalEpochDelay() const;
   uint32_t GetEpoch(const CBlockIndex &blockIndex) const;
   uint32_t GetEpoch(blockchain::Height block_height) const;
 
@@ -215,6 +251,16 @@ class FinalizationState : public FinalizationStateData {
   //! Removes a validator from the validator map.
   void DeleteValidator(const uint160 &validatorAddress);
 
+  //! \brief Adds the finalizer to the active finalizers index.
+  //!
+  //! Must be called after any change of its start or end dynasty, which
+  //! must be preceded by UnindexFinalizer.
+  void IndexFinalizer(const Validator &finalizer);
+  void UnindexFinalizer(const Validator &finalizer);
+
+  //! Rebuilds the active finalizers index from m_validators.
+  void IndexFinalizers();
+
   uint64_t GetTotalCurDynDeposits() const;
   uint64_t GetTotalPrevDynDeposits() const;
   uint32_t GetEndDynasty() const;
@@ -229,6 +275,18 @@ class FinalizationState : public FinalizationStateData {
 
   mutable CCriticalSection cs_esperanza;
 
+  //! \brief Index of the finalizers by the dynasties in which they can vote.
+  //!
+  //! It is derived from m_validators and m_current_dynasty and is not
+  //! serialized. A finalizer can start or stop voting only when the dynasty
+  //! changes, so IncrementDynasty updates m_active_finalizers from the
+  //! finalizers which start at the new dynasty or ended at the previous one.
+  util::PersistentSet<uint160> m_active_finalizers;
+  // (start dynasty, address) of the finalizers which start in a later dynasty
+  util::PersistentSet<std::pair<uint32_t, uint160>> m_starting_finalizers;
+  // (end dynasty, address) of the logged out finalizers which still can vote
+  util::PersistentSet<std::pair<uint32_t, uint160>> m_ending_finalizers;
+
  protected:
   const FinalizationParams &m_settings;
   InitStatus m_status = NEW;
@@ -243,6 +301,7 @@ class FinalizationState : public FinalizationStateData {
     READWRITE(status);
     if (ser_action.ForRead()) {
       m_status = static_cast<InitStatus>(status);
+      IndexFinalizers();
     }
   }
 };
@@ -11,15 +11,19 @@
 #include <serialize.h>
 #include <ufp64.h>
 #include <uint256.h>
+#include <util/persistent_map.h>
 
 namespace esperanza {
 
 /**
  * This class is the base data-class with all the data required by
  * FinalizationState. If you need to add new data member to FinalizationState
- * you probably would add it here.
+ * you probably would add it here (and to FinalizationStateDelta, which
+ * persists the changes between the states of consecutive blocks).
  */
 class FinalizationStateData {
+  friend class FinalizationStateDelta;
+
  public:
   bool operator==(const FinalizationStateData &other) const;
 
@@ -40,28 +44,32 @@ class FinalizationStateData {
    * ufp64t and uint64_t are safe since for the intermediate step a bigger int
    * type is used, but if the result is not representable by 32 bits then the
    * final value will overflow.
+   *
+   * The maps are persistent (see util::PersistentMap): a state derived from
+   * its parent shares all the entries that did not change, so keeping a state
+   * per block costs memory proportional to the per-block changes only.
    */
 
   // Map of epoch number to checkpoint
-  std::map<uint32_t, Checkpoint> m_checkpoints;
+  util::PersistentMap<uint32_t, Checkpoint> m_checkpoints;
 
   // Map of epoch number to dynasty number
-  std::map<uint32_t, uint32_t> m_epoch_to_dynasty;
+  util::PersistentMap<uint32_t, uint32_t> m_epoch_to_dynasty;
 
   // Map of dynasty number to the starting epoch number
-  std::map<uint32_t, uint32_t> m_dynasty_start_epoch;
+  util::PersistentMap<uint32_t, uint32_t> m_dynasty_start_epoch;
 
   // List of validators
-  std::map<uint160, Validator> m_validators;
+  util::PersistentMap<uint160, Validator> m_validators;
 
   // Map of the dynasty number with the delta in deposits with the previous one
-  std::map<uint32_t, CAmount> m_dynasty_deltas;
+  util::PersistentMap<uint32_t, CAmount> m_dynasty_deltas;
 
   // Map of the epoch number with the deposit scale factor
-  std::map<uint32_t, ufp64::ufp64_t> m_deposit_scale_factor;
+  util::PersistentMap<uint32_t, ufp64::ufp64_t> m_deposit_scale_factor;
 
   // Map of the epoch number with the running total of deposits slashed
-  std::map<uint32_t, CAmount> m_total_slashed;
+  util::PersistentMap<uint32_t, CAmount> m_total_slashed;
 
   // The current epoch number
   uint32_t m_current_epoch = 0;
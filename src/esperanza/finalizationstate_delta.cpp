@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <esperanza/finalizationstate_delta.h>
+
+#include <esperanza/finalizationstate.h>
+
+namespace esperanza {
+
+CheckpointsDelta CheckpointsDelta::Compute(const util::PersistentMap<uint32_t, Checkpoint> &from,
+                                           const util::PersistentMap<uint32_t, Checkpoint> &to) {
+  CheckpointsDelta delta;
+  to.ForEachDifference(from, [&delta](const uint32_t epoch, const Checkpoint *cp, const Checkpoint *prev_cp) {
+    if (cp == nullptr) {
+      delta.m_erased.emplace_back(epoch);
+      return;
+    }
+    Entry entry;
+    entry.epoch = epoch;
+    entry.checkpoint = *cp;
+    entry.checkpoint.m_vote_set.clear();
+    const util::PersistentSet<uint160> empty;
+    const util::PersistentSet<uint160> &prev_votes = prev_cp != nullptr ? prev_cp->m_vote_set : empty;
+    cp->m_vote_set.ForEachDifference(prev_votes, [&entry](const uint160 &voter, const bool added) {
+      if (added) {
+        entry.added_votes.emplace_back(voter);
+      } else {
+        entry.removed_votes.emplace_back(voter);
+      }
+    });
+    delta.m_updated.emplace_back(std::move(entry));
+  });
+  return delta;
+}
+
+void CheckpointsDelta::Apply(util::PersistentMap<uint32_t, Checkpoint> &checkpoints) const {
+  for (const uint32_t epoch : m_erased) {
+    checkpoints.erase(epoch);
+  }
+  for (const Entry &entry : m_updated) {
+    Checkpoint &cp = checkpoints[entry.epoch];
+    util::PersistentSet<uint160> votes = std::move(cp.m_vote_set);
+    cp = entry.checkpoint;
+    for (const uint160 &voter : entry.removed_votes) {
+      votes.erase(voter);
+    }
+    for (const uint160 &voter : entry.added_votes) {
+      votes.insert(voter);
+    }
+    cp.m_vote_set = std::move(votes);
+  }
+}
+
+FinalizationStateDelta::FinalizationStateDelta() : m_admin_state(AdminParams()) {}
+
+FinalizationStateDelta FinalizationStateDelta::Compute(const FinalizationState &parent,
+                                                       const FinalizationState &child) {
+  FinalizationStateDelta delta;
+  delta.m_checkpoints = CheckpointsDelta::Compute(parent.m_checkpoints, child.m_checkpoints);
+  delta.m_epoch_to_dynasty = MapDelta<uint32_t, uint32_t>::Compute(parent.m_epoch_to_dynasty, child.m_epoch_to_dynasty);
+  delta.m_dynasty_start_epoch = MapDelta<uint32_t, uint32_t>::Compute(parent.m_dynasty_start_epoch, child.m_dynasty_start_epoch);
+  delta.m_validators = MapDelta<uint160, Validator>::Compute(parent.m_validators, child.m_validators);
+  delta.m_dynasty_deltas = MapDelta<uint32_t, CAmount>::Compute(parent.m_dynasty_deltas, child.m_dynasty_deltas);
+  delta.m_deposit_scale_factor = MapDelta<uint32_t, ufp64::ufp64_t>::Compute(parent.m_deposit_scale_factor, child.m_deposit_scale_factor);
+  delta.m_total_slashed = MapDelta<uint32_t, CAmount>::Compute(parent.m_total_slashed, child.m_total_slashed);
+
+  delta.m_current_epoch = child.m_current_epoch;
+  delta.m_current_dynasty = child.m_current_dynasty;
+  delta.m_cur_dyn_deposits = child.m_cur_dyn_deposits;
+  delta.m_prev_dyn_deposits = child.m_prev_dyn_deposits;
+  delta.m_expected_source_epoch = child.m_expected_source_epoch;
+  delta.m_last_finalized_epoch = child.m_last_finalized_epoch;
+  delta.m_last_justified_epoch = child.m_last_justified_epoch;
+  delta.m_recommended_target_hash = child.m_recommended_target_hash;
+  delta.m_recommended_target_epoch = child.m_recommended_target_epoch;
+  delta.m_last_voter_rescale = child.m_last_voter_rescale;
+  delta.m_last_non_voter_rescale = child.m_last_non_voter_rescale;
+  delta.m_reward_factor = child.m_reward_factor;
+
+  if (!(parent.m_admin_state == child.m_admin_state)) {
+    delta.m_admin_state_changed = true;
+    delta.m_admin_state = child.m_admin_state;
+  }
+
+  delta.m_status = static_cast<int>(child.m_status);
+  return delta;
+}
+
+void FinalizationStateDelta::Apply(FinalizationState &state) const {
+  const bool finalizers_changed = !m_validators.IsEmpty() ||
+                                  state.m_current_dynasty != m_current_dynasty;
+
+  m_checkpoints.Apply(state.m_checkpoints);
+  m_epoch_to_dynasty.Apply(state.m_epoch_to_dynasty);
+  m_dynasty_start_epoch.Apply(state.m_dynasty_start_epoch);
+  m_validators.Apply(state.m_validators);
+  m_dynasty_deltas.Apply(state.m_dynasty_deltas);
+  m_deposit_scale_factor.Apply(state.m_deposit_scale_factor);
+  m_total_slashed.Apply(state.m_total_slashed);
+
+  state.m_current_epoch = m_current_epoch;
+  state.m_current_dynasty = m_current_dynasty;
+  state.m_cur_dyn_deposits = m_cur_dyn_deposits;
+  state.m_prev_dyn_deposits = m_prev_dyn_deposits;
+  state.m_expected_source_epoch = m_expected_source_epoch;
+  state.m_last_finalized_epoch = m_last_finalized_epoch;
+  state.m_last_justified_epoch = m_last_justified_epoch;
+  state.m_recommended_target_hash = m_recommended_target_hash;
+  state.m_recommended_target_epoch = m_recommended_target_epoch;
+  state.m_last_voter_rescale = m_last_voter_rescale;
+  state.m_last_non_voter_rescale = m_last_non_voter_rescale;
+  state.m_reward_factor = m_reward_factor;
+
+  if (m_admin_state_changed) {
+    state.m_admin_state = m_admin_state;
+  }
+
+  state.m_status = static_cast<FinalizationState::InitStatus>(m_status);
+
+  if (finalizers_changed) {
+    state.IndexFinalizers();
+  }
+}
+
+}  // namespace esperanza
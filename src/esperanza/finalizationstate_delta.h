@@ -0,0 +1,180 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_ESPERANZA_FINALIZATIONSTATE_DELTA_H
+#define UNITE_ESPERANZA_FINALIZATIONSTATE_DELTA_H
+
+#include <esperanza/adminstate.h>
+#include <esperanza/checkpoint.h>
+#include <esperanza/validator.h>
+#include <serialize.h>
+#include <ufp64.h>
+#include <uint256.h>
+#include <util/persistent_map.h>
+
+#include <utility>
+#include <vector>
+
+namespace esperanza {
+
+class FinalizationState;
+
+//! \brief Changes of a util::PersistentMap between two versions of it.
+template <typename K, typename V>
+class MapDelta {
+ public:
+  static MapDelta Compute(const util::PersistentMap<K, V> &from, const util::PersistentMap<K, V> &to) {
+    MapDelta delta;
+    to.ForEachDifference(from, [&delta](const K &key, const V *value, const V *) {
+      if (value != nullptr) {
+        delta.m_updated.emplace_back(key, *value);
+      } else {
+        delta.m_erased.emplace_back(key);
+      }
+    });
+    return delta;
+  }
+
+  void Apply(util::PersistentMap<K, V> &map) const {
+    for (const K &key : m_erased) {
+      map.erase(key);
+    }
+    for (const auto &entry : m_updated) {
+      map[entry.first] = entry.second;
+    }
+  }
+
+  bool IsEmpty() const { return m_updated.empty() && m_erased.empty(); }
+
+  ADD_SERIALIZE_METHODS
+
+  template <typename Stream, typename Operation>
+  void SerializationOp(Stream &s, Operation ser_action) {
+    READWRITE(m_updated);
+    READWRITE(m_erased);
+  }
+
+ private:
+  std::vector<std::pair<K, V>> m_updated;
+  std::vector<K> m_erased;
+};
+
+//! \brief Changes of the checkpoints between two versions of the state.
+//!
+//! A changed checkpoint is stored without its vote set, only the voters that
+//! were added or removed are recorded.
+class CheckpointsDelta {
+ public:
+  static CheckpointsDelta Compute(const util::PersistentMap<uint32_t, Checkpoint> &from,
+                                  const util::PersistentMap<uint32_t, Checkpoint> &to);
+
+  void Apply(util::PersistentMap<uint32_t, Checkpoint> &checkpoints) const;
+
+  ADD_SERIALIZE_METHODS
+
+  template <typename Stream, typename Operation>
+  void SerializationOp(Stream &s, Operation ser_action) {
+    READWRITE(m_updated);
+    READWRITE(m_erased);
+  }
+
+ private:
+  struct Entry {
+    uint32_t epoch = 0;
+    // The checkpoint with an empty vote set
+    Checkpoint checkpoint;
+    std::vector<uint160> added_votes;
+    std::vector<uint160> removed_votes;
+
+    ADD_SERIALIZE_METHODS
+
+    template <typename Stream, typename Operation>
+    void SerializationOp(Stream &s, Operation ser_action) {
+      READWRITE(epoch);
+      READWRITE(checkpoint);
+      READWRITE(added_votes);
+      READWRITE(removed_votes);
+    }
+  };
+
+  std::vector<Entry> m_updated;
+  std::vector<uint32_t> m_erased;
+};
+
+//! \brief The difference between a finalization state and the state of its
+//! parent block.
+//!
+//! Applying the delta to a copy of the parent state results in the child
+//! state. This is the unit of incremental persistence in finalization::StateDB.
+class FinalizationStateDelta {
+ public:
+  FinalizationStateDelta();
+
+  static FinalizationStateDelta Compute(const FinalizationState &parent, const FinalizationState &child);
+
+  //! \brief Turns the parent state into the child one.
+  void Apply(FinalizationState &state) const;
+
+  ADD_SERIALIZE_METHODS
+
+  template <typename Stream, typename Operation>
+  void SerializationOp(Stream &s, Operation ser_action) {
+    READWRITE(m_checkpoints);
+    READWRITE(m_epoch_to_dynasty);
+    READWRITE(m_dynasty_start_epoch);
+    READWRITE(m_validators);
+    READWRITE(m_dynasty_deltas);
+    READWRITE(m_deposit_scale_factor);
+    READWRITE(m_total_slashed);
+    READWRITE(m_current_epoch);
+    READWRITE(m_current_dynasty);
+    READWRITE(m_cur_dyn_deposits);
+    READWRITE(m_prev_dyn_deposits);
+    READWRITE(m_expected_source_epoch);
+    READWRITE(m_last_finalized_epoch);
+    READWRITE(m_last_justified_epoch);
+    READWRITE(m_recommended_target_hash);
+    READWRITE(m_recommended_target_epoch);
+    READWRITE(m_last_voter_rescale);
+    READWRITE(m_last_non_voter_rescale);
+    READWRITE(m_reward_factor);
+    READWRITE(m_admin_state_changed);
+    if (m_admin_state_changed) {
+      READWRITE(m_admin_state);
+    }
+    READWRITE(m_status);
+  }
+
+ private:
+  CheckpointsDelta m_checkpoints;
+  MapDelta<uint32_t, uint32_t> m_epoch_to_dynasty;
+  MapDelta<uint32_t, uint32_t> m_dynasty_start_epoch;
+  MapDelta<uint160, Validator> m_validators;
+  MapDelta<uint32_t, CAmount> m_dynasty_deltas;
+  MapDelta<uint32_t, ufp64::ufp64_t> m_deposit_scale_factor;
+  MapDelta<uint32_t, CAmount> m_total_slashed;
+
+  // Scalar members are small and stored as they are in the child state
+  uint32_t m_current_epoch = 0;
+  uint32_t m_current_dynasty = 0;
+  CAmount m_cur_dyn_deposits = 0;
+  CAmount m_prev_dyn_deposits = 0;
+  uint32_t m_expected_source_epoch = 0;
+  uint32_t m_last_finalized_epoch = 0;
+  uint32_t m_last_justified_epoch = 0;
+  uint256 m_recommended_target_hash;
+  uint32_t m_recommended_target_epoch = 0;
+  ufp64::ufp64_t m_last_voter_rescale = 0;
+  ufp64::ufp64_t m_last_non_voter_rescale = 0;
+  ufp64::ufp64_t m_reward_factor = 0;
+
+  bool m_admin_state_changed = false;
+  AdminState m_admin_state;
+
+  int m_status = 0;
+};
+
+}  // namespace esperanza
+
+#endif  // UNITE_ESPERANZA_FINALIZATIONSTATE_DELTA_H
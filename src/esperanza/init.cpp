@@ -13,6 +13,7 @@ std::string GetHelpString(bool showDebug) {
   std::string strUsage = HelpMessageGroup(_("Staking options:"));
   strUsage += HelpMessageOpt("-proposing", "Whether to participate in proposing new blocks or not. Default: true");
   strUsage += HelpMessageOpt("-permissioning", "Whether to start with permissioning enabled (works only on regtest). Default: false");
+  strUsage += HelpMessageOpt("-proposerthreads=<n>", "Number of threads to search for an eligible stake when proposing, 0 = number of cores. Default: 0");
   strUsage += HelpMessageOpt("-stakecombinemaximum", "Maximum amount to combine when proposing. Default: unlimited (0)");
   strUsage += HelpMessageOpt("-stakesplitthreshold", "Maximum amount a single coinbase output should have. Default: unlimited (0)");
   strUsage += HelpMessageOpt("-validating", "Stake your coins to become a validator (default: false)");
@@ -0,0 +1,70 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <esperanza/stakeable_coin_index.h>
+
+namespace esperanza {
+
+void StakeableCoinIndex::MarkDirty(const uint256 &txid) {
+  if (!m_all_dirty) {
+    m_dirty.insert(txid);
+  }
+}
+
+void StakeableCoinIndex::MarkAllDirty() {
+  m_all_dirty = true;
+  m_dirty.clear();
+}
+
+bool StakeableCoinIndex::TakeDirty(std::set<uint256> &txids_out) {
+  if (m_all_dirty) {
+    m_all_dirty = false;
+    m_dirty.clear();
+    return true;
+  }
+  txids_out.swap(m_dirty);
+  m_dirty.clear();
+  return false;
+}
+
+void StakeableCoinIndex::RemoveTransaction(const uint256 &txid) {
+  auto it = m_stakeable.lower_bound(COutPoint(txid, 0));
+  while (it != m_stakeable.end() && it->first.hash == txid) {
+    const auto bucket = m_by_height.find(it->second);
+    bucket->second.erase(it->first);
+    if (bucket->second.empty()) {
+      m_by_height.erase(bucket);
+    }
+    it = m_stakeable.erase(it);
+  }
+
+  auto remote_it = m_staked_remotely.lower_bound(COutPoint(txid, 0));
+  while (remote_it != m_staked_remotely.end() && remote_it->first.hash == txid) {
+    m_remote_staking_balance -= remote_it->second;
+    remote_it = m_staked_remotely.erase(remote_it);
+  }
+}
+
+void StakeableCoinIndex::Clear() {
+  m_stakeable.clear();
+  m_by_height.clear();
+  m_staked_remotely.clear();
+  m_remote_staking_balance = 0;
+}
+
+void StakeableCoinIndex::AddStakeable(const COutPoint &out_point, const blockchain::Height height) {
+  if (!m_stakeable.emplace(out_point, height).second) {
+    return;
+  }
+  m_by_height[height].insert(out_point);
+}
+
+void StakeableCoinIndex::AddStakedRemotely(const COutPoint &out_point, const CAmount amount) {
+  if (!m_staked_remotely.emplace(out_point, amount).second) {
+    return;
+  }
+  m_remote_staking_balance += amount;
+}
+
+}  // namespace esperanza
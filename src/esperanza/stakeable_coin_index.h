@@ -0,0 +1,85 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_ESPERANZA_STAKEABLE_COIN_INDEX_H
+#define UNITE_ESPERANZA_STAKEABLE_COIN_INDEX_H
+
+#include <amount.h>
+#include <blockchain/blockchain_types.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <cstddef>
+#include <map>
+#include <set>
+
+namespace esperanza {
+
+//! \brief Index of the wallet outputs which can be used for staking.
+//!
+//! Keeps the unspent and confirmed outputs which are stakeable by the wallet
+//! in buckets by the height of the block that contains them. As lower heights
+//! mature first, the coins which are mature enough to be staked can be visited
+//! without looking at the rest of the wallet history. It also keeps the total
+//! of the outputs which are staked remotely.
+//!
+//! The index is updated lazily: the wallet marks the transactions whose outputs
+//! may have changed as dirty and esperanza::WalletExtension re-evaluates them
+//! before the index is read.
+class StakeableCoinIndex {
+ public:
+  //! \brief Marks the outputs of the given transaction to be re-evaluated.
+  void MarkDirty(const uint256 &txid);
+
+  //! \brief Marks every output to be re-evaluated.
+  void MarkAllDirty();
+
+  //! \brief Hands out the transactions to re-evaluate and resets the dirty state.
+  //!
+  //! \return true if the whole index has to be rebuilt, txids_out is left
+  //! untouched in that case.
+  bool TakeDirty(std::set<uint256> &txids_out);
+
+  //! \brief Forgets all outputs of the given transaction.
+  void RemoveTransaction(const uint256 &txid);
+
+  void Clear();
+
+  void AddStakeable(const COutPoint &out_point, blockchain::Height height);
+
+  void AddStakedRemotely(const COutPoint &out_point, CAmount amount);
+
+  CAmount GetRemoteStakingBalance() const { return m_remote_staking_balance; }
+
+  std::size_t GetStakeableCount() const { return m_stakeable.size(); }
+
+  //! \brief Invokes f(out_point) for the stakeable outputs in the order of
+  //! their height, as long as include_height(height) holds.
+  template <typename Predicate, typename Callable>
+  void ForEachStakeable(Predicate include_height, Callable f) const {
+    for (const auto &bucket : m_by_height) {
+      if (!include_height(bucket.first)) {
+        return;
+      }
+      for (const COutPoint &out_point : bucket.second) {
+        f(out_point);
+      }
+    }
+  }
+
+ private:
+  bool m_all_dirty = true;
+  std::set<uint256> m_dirty;
+
+  //! The height of the containing block of every stakeable output
+  std::map<COutPoint, blockchain::Height> m_stakeable;
+  std::map<blockchain::Height, std::set<COutPoint>> m_by_height;
+
+  std::map<COutPoint, CAmount> m_staked_remotely;
+  CAmount m_remote_staking_balance = 0;
+};
+
+}  // namespace esperanza
+
+#endif  // UNITE_ESPERANZA_STAKEABLE_COIN_INDEX_H
@@ -47,48 +47,113 @@ WalletExtension::WalletExtension(const WalletExtensionDeps &dependencies,
   }
 }
 
-template <typename Callable>
-void WalletExtension::ForEachStakeableCoin(Callable f) const {
-  AssertLockHeld(cs_main);
-  AssertLockHeld(m_enclosing_wallet.cs_wallet);  // access to mapWallet
+void WalletExtension::StakeableCoinsChanged(const CWalletTx &tx) {
+  AssertLockHeld(m_enclosing_wallet.cs_wallet);
 
-  CCoinsViewCache view(pcoinsTip.get());  // requires cs_main
-  for (const auto &it : m_enclosing_wallet.mapWallet) {
-    const CWalletTx *const tx = &it.second;
-    const uint256 &txId = tx->GetHash();
-    const std::vector<::CTxOut> &coins = tx->tx->vout;
-    const CBlockIndex *containing_block = nullptr;
-    const int depth = tx->GetDepthInMainChain(containing_block);  // requires cs_main
+  m_stakeable_coin_index.MarkDirty(tx.GetHash());
+  // whether the spent outputs count as spent depends on the state of this
+  // transaction (for example it could have been abandoned or conflicted)
+  for (const CTxIn &txin : tx.tx->vin) {
+    m_stakeable_coin_index.MarkDirty(txin.prevout.hash);
+  }
+}
+
+void WalletExtension::AllStakeableCoinsChanged() {
+  AssertLockHeld(m_enclosing_wallet.cs_wallet);
+  m_stakeable_coin_index.MarkAllDirty();
+}
+
+void WalletExtension::IndexTransaction(const CWalletTx &tx) const {
+  const uint256 &tx_hash = tx.GetHash();
+  const CBlockIndex *containing_block = nullptr;
+  const int depth = tx.GetDepthInMainChain(containing_block);  // requires cs_main
+
+  for (std::size_t out_index = 0; out_index < tx.tx->vout.size(); ++out_index) {
+    const CTxOut &tx_out = tx.tx->vout[out_index];
+    if (m_enclosing_wallet.IsSpent(tx_hash, static_cast<unsigned int>(out_index))) {
+      continue;
+    }
+    const COutPoint out_point(tx_hash, static_cast<std::uint32_t>(out_index));
+    if (::IsStakedRemotely(m_enclosing_wallet, tx_out.scriptPubKey)) {
+      m_stakeable_coin_index.AddStakedRemotely(out_point, tx_out.nValue);
+    }
     if (depth <= 0 || !containing_block) {
       // transaction is not included in a block
       continue;
     }
-
-    blockchain::Height height = static_cast<blockchain::Height>(containing_block->nHeight);
-    if (!m_dependencies.GetStakeValidator().IsStakeMature(height)) {
+    if (tx_out.nValue <= 0 || !IsStakeableByMe(m_enclosing_wallet, tx_out.scriptPubKey)) {
       continue;
     }
+    m_stakeable_coin_index.AddStakeable(out_point, static_cast<blockchain::Height>(containing_block->nHeight));
+  }
+}
 
-    const bool skip_reward = tx->IsCoinBase() && tx->GetBlocksToRewardMaturity() > 0;
-    for (std::size_t out_index = skip_reward ? 1 : 0; out_index < coins.size(); ++out_index) {
-      if (m_enclosing_wallet.IsSpent(txId, static_cast<unsigned int>(out_index))) {
-        continue;
-      }
-      if (!view.HaveCoin(COutPoint(txId, static_cast<uint32_t>(out_index)))) {
-        continue;
-      }
-      if (m_enclosing_wallet.IsLockedCoin(txId, out_index)) {
-        continue;
-      }
-      const CTxOut &coin = coins[out_index];
-      if (coin.nValue <= 0 || !IsStakeableByMe(m_enclosing_wallet, coin.scriptPubKey)) {
-        continue;
-      }
-      f(tx, std::uint32_t(out_index), containing_block);
+void WalletExtension::UpdateStakeableCoinIndex() const {
+  AssertLockHeld(cs_main);
+  AssertLockHeld(m_enclosing_wallet.cs_wallet);  // access to mapWallet
+
+  std::set<uint256> dirty;
+  if (m_stakeable_coin_index.TakeDirty(dirty)) {
+    m_stakeable_coin_index.Clear();
+    for (const auto &it : m_enclosing_wallet.mapWallet) {
+      IndexTransaction(it.second);
+    }
+    LogPrint(BCLog::PROPOSING, "Indexed %d stakeable coins (wallet=%s)\n",
+             m_stakeable_coin_index.GetStakeableCount(), m_enclosing_wallet.GetName());
+    return;
+  }
+  for (const uint256 &tx_hash : dirty) {
+    m_stakeable_coin_index.RemoveTransaction(tx_hash);
+    const auto it = m_enclosing_wallet.mapWallet.find(tx_hash);
+    if (it != m_enclosing_wallet.mapWallet.end()) {
+      IndexTransaction(it->second);
     }
   }
 }
 
+template <typename Callable>
+void WalletExtension::ForEachStakeableCoin(Callable f) const {
+  AssertLockHeld(cs_main);
+  AssertLockHeld(m_enclosing_wallet.cs_wallet);  // access to mapWallet
+
+  UpdateStakeableCoinIndex();
+
+  // The index only contains unspent outputs which are stakeable by this
+  // wallet. Whether they are mature depends on the current tip. Coins are
+  // visited from the lowest height, so the first immature one ends the walk.
+  const staking::StakeValidator &stake_validator = m_dependencies.GetStakeValidator();
+  CCoinsViewCache view(pcoinsTip.get());  // requires cs_main
+  m_stakeable_coin_index.ForEachStakeable(
+      [&stake_validator](const blockchain::Height height) {
+        return stake_validator.IsStakeMature(height);
+      },
+      [&](const COutPoint &out_point) {
+        const auto it = m_enclosing_wallet.mapWallet.find(out_point.hash);
+        if (it == m_enclosing_wallet.mapWallet.end()) {
+          return;
+        }
+        const CWalletTx *const tx = &it->second;
+        const CBlockIndex *containing_block = nullptr;
+        const int depth = tx->GetDepthInMainChain(containing_block);  // requires cs_main
+        if (depth <= 0 || !containing_block) {
+          return;
+        }
+        if (out_point.n == 0 && tx->IsCoinBase() && tx->GetBlocksToRewardMaturity() > 0) {
+          return;
+        }
+        if (m_enclosing_wallet.IsSpent(out_point.hash, out_point.n)) {
+          return;
+        }
+        if (!view.HaveCoin(out_point)) {
+          return;
+        }
+        if (m_enclosing_wallet.IsLockedCoin(out_point.hash, out_point.n)) {
+          return;
+        }
+        f(tx, out_point.n, containing_block);
+      });
+}
+
 CCriticalSection &WalletExtension::GetLock() const {
   return m_enclosing_wallet.cs_wallet;
 }
@@ -118,24 +183,8 @@ CAmount WalletExtension::GetRemoteStakingBalance() const {
   AssertLockHeld(cs_main);
   AssertLockHeld(m_enclosing_wallet.cs_wallet);  // access to mapWallet
 
-  CAmount balance = 0;
-
-  for (const auto &it : m_enclosing_wallet.mapWallet) {
-    const CWalletTx &tx = it.second;
-    const uint256 &tx_hash = tx.GetHash();
-
-    for (size_t i = 0; i < tx.tx->vout.size(); ++i) {
-      const CTxOut &tx_out = tx.tx->vout[i];
-      if (m_enclosing_wallet.IsSpent(tx_hash, i)) {
-        continue;
-      }
-      if (::IsStakedRemotely(m_enclosing_wallet, tx_out.scriptPubKey)) {
-        balance += tx_out.nValue;
-      }
-    }
-  }
-
-  return balance;
+  UpdateStakeableCoinIndex();
+  return m_stakeable_coin_index.GetRemoteStakingBalance();
 }
 
 proposer::State &WalletExtension::GetProposerState() {
@@ -7,6 +7,7 @@
 
 #include <amount.h>
 #include <dependency.h>
+#include <esperanza/stakeable_coin_index.h>
 #include <esperanza/validatorstate.h>
 #include <esperanza/walletextension_deps.h>
 #include <esperanza/walletstate.h>
@@ -68,6 +69,15 @@ class WalletExtension : public staking::StakingWallet {
 
   void ManagePendingSlashings();
 
+  //! The outputs of the enclosing wallet which can be used for staking,
+  //! guarded by the wallet lock.
+  mutable StakeableCoinIndex m_stakeable_coin_index;
+
+  //! Re-evaluates the transactions which were marked dirty in the index.
+  void UpdateStakeableCoinIndex() const;
+
+  void IndexTransaction(const CWalletTx &tx) const;
+
   template <typename Callable>
   void ForEachStakeableCoin(Callable) const;
 
@@ -181,6 +191,14 @@ class WalletExtension : public staking::StakingWallet {
   bool AddToWalletIfInvolvingMe(const CTransactionRef &tx,
                                 const CBlockIndex *pIndex);
 
+  //! \brief Notifies that the outputs of the transaction or the outputs it
+  //! spends might have changed whether they can be staked.
+  void StakeableCoinsChanged(const CWalletTx &tx);
+
+  //! \brief Notifies that any output of the wallet might have changed whether
+  //! it can be staked, for example because keys were imported.
+  void AllStakeableCoinsChanged();
+
   void ReadValidatorStateFromFile();
   void WriteValidatorStateToFile();
 
@@ -6,15 +6,30 @@
 
 #include <dbwrapper.h>
 #include <esperanza/finalizationstate.h>
+#include <esperanza/finalizationstate_delta.h>
 #include <injector_config.h>
 #include <staking/active_chain.h>
 #include <staking/block_index_map.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <set>
+#include <vector>
+
 namespace finalization {
 
 namespace {
 
+//! Full state of a block (a base to replay deltas onto)
+const char DB_BASE = 'b';
+//! Difference between the state of a block and the state of its parent
+const char DB_DELTA = 'd';
+//! Version of the on-disk format
+const char DB_VERSION = 'V';
+
+//! Version 1 keyed full states by block hash, without any prefix.
+const int CURRENT_VERSION = 2;
+
 class StateDBImpl : public StateDB, public CDBWrapper {
  public:
   StateDBImpl(const StateDBParams &p,
@@ -23,7 +38,9 @@ class StateDBImpl : public StateDB, public CDBWrapper {
               Dependency<staking::ActiveChain> active_chain)
       : CDBWrapper(settings->data_dir / "finalization", p.cache_size, p.inmemory, p.wipe, p.obfuscate),
         m_block_index_map(block_index_map),
-        m_active_chain(active_chain) {}
+        m_active_chain(active_chain) {
+    Upgrade();
+  }
 
   bool Save(const std::map<const CBlockIndex *, FinalizationState> &states) override;
 
@@ -55,17 +72,165 @@ class StateDBImpl : public StateDB, public CDBWrapper {
       std::map<const CBlockIndex *, FinalizationState> *states) const override;
 
  private:
+  //! \brief A state as it has been written to disk the last time.
+  struct SavedState {
+    FinalizationState state;
+    bool is_delta;
+  };
+
+  //! \brief Wipes states stored in an outdated format.
+  //!
+  //! States are a cache of what can be computed from the blocks, the
+  //! repository recovers the missing ones when it restores from disk.
+  void Upgrade();
+
+  //! \brief Reads the state of the block, replaying deltas on top of the
+  //! nearest base (or of the nearest state found in `known`).
+  boost::optional<FinalizationState> ReadState(
+      const CBlockIndex &index,
+      const esperanza::FinalizationParams &fin_params,
+      const esperanza::AdminParams &admin_params,
+      const std::map<const CBlockIndex *, FinalizationState> *known) const;
+
+  //! \brief Remembers a state which matches its on-disk representation.
+  void MarkSaved(const CBlockIndex &index, const FinalizationState &state, bool is_delta) const;
+
   Dependency<staking::BlockIndexMap> m_block_index_map;
   Dependency<staking::ActiveChain> m_active_chain;
+
+  mutable CCriticalSection m_cs;
+
+  //! Copies of the states that are on disk. They share all their data with
+  //! the live states until these change, so comparing against them is cheap.
+  mutable std::map<const CBlockIndex *, SavedState> m_saved;
 };
 
+void StateDBImpl::Upgrade() {
+  int version = 0;
+  if (Read(DB_VERSION, version) && version == CURRENT_VERSION) {
+    return;
+  }
+  if (!IsEmpty()) {
+    LogPrintf("Finalization state database has outdated version=%d, wiping it\n", version);
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> cursor(NewIterator());
+    for (cursor->SeekToFirst(); cursor->Valid(); cursor->Next()) {
+      // Version 1 keys are plain block hashes.
+      uint256 key;
+      if (cursor->GetKey(key)) {
+        batch.Erase(key);
+      }
+    }
+    WriteBatch(batch, true);
+  }
+  Write(DB_VERSION, CURRENT_VERSION, true);
+}
+
+void StateDBImpl::MarkSaved(const CBlockIndex &index, const FinalizationState &state, const bool is_delta) const {
+  AssertLockHeld(m_cs);
+  m_saved.erase(&index);
+  // The copy constructor of FinalizationState resets the status by default.
+  m_saved.emplace(&index, SavedState{FinalizationState(state, state.GetInitStatus()), is_delta});
+}
+
+boost::optional<FinalizationState> StateDBImpl::ReadState(
+    const CBlockIndex &index,
+    const esperanza::FinalizationParams &fin_params,
+    const esperanza::AdminParams &admin_params,
+    const std::map<const CBlockIndex *, FinalizationState> *known) const {
+
+  std::vector<esperanza::FinalizationStateDelta> deltas;
+  boost::optional<FinalizationState> state;
+  for (const CBlockIndex *walk = &index; walk != nullptr; walk = walk->pprev) {
+    if (known != nullptr && walk != &index) {
+      const auto it = known->find(walk);
+      if (it != known->end()) {
+        state.emplace(it->second);
+        break;
+      }
+    }
+    FinalizationState base(fin_params, admin_params);
+    if (Read(std::make_pair(DB_BASE, walk->GetBlockHash()), base)) {
+      state.emplace(std::move(base));
+      break;
+    }
+    esperanza::FinalizationStateDelta delta;
+    if (!Read(std::make_pair(DB_DELTA, walk->GetBlockHash()), delta)) {
+      return boost::none;
+    }
+    deltas.emplace_back(std::move(delta));
+  }
+  if (!state) {
+    return boost::none;
+  }
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    it->Apply(*state);
+  }
+  return state;
+}
+
 bool StateDBImpl::Save(const std::map<const CBlockIndex *, FinalizationState> &states) {
-  CDBBatch batch(*this);
+  LOCK(m_cs);
+
+  // Forget the states which are not kept in memory anymore, they stay on disk.
+  for (auto it = m_saved.begin(); it != m_saved.end();) {
+    if (states.count(it->first) == 0) {
+      it = m_saved.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Process parents before children, so that a rewritten parent invalidates
+  // the deltas of its children.
+  std::vector<std::pair<const CBlockIndex *, const FinalizationState *>> sorted;
+  sorted.reserve(states.size());
   for (const auto &i : states) {
-    const uint256 &block_hash = i.first->GetBlockHash();
-    const FinalizationState &state = i.second;
-    batch.Write(block_hash, state);
+    sorted.emplace_back(i.first, &i.second);
   }
+  std::sort(sorted.begin(), sorted.end(), [](const std::pair<const CBlockIndex *, const FinalizationState *> &a,
+                                             const std::pair<const CBlockIndex *, const FinalizationState *> &b) {
+    return a.first->nHeight < b.first->nHeight;
+  });
+
+  CDBBatch batch(*this);
+  std::set<const CBlockIndex *> written;
+  size_t bases = 0;
+  size_t deltas = 0;
+  for (const auto &i : sorted) {
+    const CBlockIndex &index = *i.first;
+    const FinalizationState &state = *i.second;
+
+    const auto parent_it = index.pprev != nullptr ? states.find(index.pprev) : states.end();
+    const bool as_delta = parent_it != states.end() && !state.IsCheckpoint(index.nHeight);
+
+    const auto saved_it = m_saved.find(&index);
+    const bool dirty = saved_it == m_saved.end() ||
+                       saved_it->second.state != state ||
+                       saved_it->second.state.GetInitStatus() != state.GetInitStatus() ||
+                       (saved_it->second.is_delta && written.count(index.pprev) != 0);
+    if (!dirty) {
+      continue;
+    }
+
+    const uint256 &block_hash = index.GetBlockHash();
+    if (as_delta) {
+      batch.Write(std::make_pair(DB_DELTA, block_hash),
+                  esperanza::FinalizationStateDelta::Compute(parent_it->second, state));
+      batch.Erase(std::make_pair(DB_BASE, block_hash));
+      ++deltas;
+    } else {
+      batch.Write(std::make_pair(DB_BASE, block_hash), state);
+      batch.Erase(std::make_pair(DB_DELTA, block_hash));
+      ++bases;
+    }
+    written.emplace(&index);
+    MarkSaved(index, state, as_delta);
+  }
+
+  LogPrint(BCLog::FINALIZATION, "%s: %d states are clean, writing %d bases and %d deltas\n",
+           __func__, states.size() - written.size(), bases, deltas);
+
   return WriteBatch(batch, true);
 }
 
@@ -78,25 +243,38 @@ bool StateDBImpl::Load(const esperanza::FinalizationParams &fin_params,
 
   states->clear();
 
+  std::vector<const CBlockIndex *> indexes;
   std::unique_ptr<CDBIterator> cursor(NewIterator());
-  uint256 key;
-  cursor->Seek(key);
-
-  while (cursor->Valid()) {
-    if (!cursor->GetKey(key)) {
-      return error("%s: failed to get key", __func__);
-    }
-    const CBlockIndex *block_index = m_block_index_map->Lookup(key);
-    if (block_index == nullptr) {
-      return error("%s: failed to find block index %s", __func__, util::to_string(key));
+  for (const char prefix : {DB_BASE, DB_DELTA}) {
+    cursor->Seek(std::make_pair(prefix, uint256()));
+    while (cursor->Valid()) {
+      std::pair<char, uint256> key;
+      if (!cursor->GetKey(key) || key.first != prefix) {
+        break;
+      }
+      const CBlockIndex *block_index = m_block_index_map->Lookup(key.second);
+      if (block_index == nullptr) {
+        return error("%s: failed to find block index %s", __func__, util::to_string(key.second));
+      }
+      indexes.emplace_back(block_index);
+      cursor->Next();
     }
-    FinalizationState state(fin_params, admin_params);
-    if (!cursor->GetValue(state)) {
-      return error("%s: failed to get value for key %s", __func__, util::to_string(key));
+  }
+
+  // Restore parents first, so that children replay a single delta on top of them.
+  std::sort(indexes.begin(), indexes.end(), [](const CBlockIndex *a, const CBlockIndex *b) {
+    return a->nHeight < b->nHeight;
+  });
+
+  LOCK(m_cs);
+  for (const CBlockIndex *block_index : indexes) {
+    boost::optional<FinalizationState> state = ReadState(*block_index, fin_params, admin_params, states);
+    if (!state) {
+      return error("%s: failed to restore state for block %s", __func__, util::to_string(block_index->GetBlockHash()));
     }
-    const auto res = states->emplace(block_index, std::move(state));
+    const auto res = states->emplace(block_index, std::move(*state));
     assert(res.second);
-    cursor->Next();
+    MarkSaved(*block_index, res.first->second, /*is_delta=*/!Exists(std::make_pair(DB_BASE, block_index->GetBlockHash())));
   }
   return true;
 }
@@ -108,9 +286,11 @@ bool StateDBImpl::Load(const CBlockIndex &index,
 
   assert(states != nullptr);
 
-  FinalizationState state(fin_params, admin_params);
-  if (Read(index.GetBlockHash(), state)) {
-    states->emplace(&index, std::move(state));
+  boost::optional<FinalizationState> state = ReadState(index, fin_params, admin_params, states);
+  if (state) {
+    const auto res = states->emplace(&index, std::move(*state));
+    LOCK(m_cs);
+    MarkSaved(index, res.first->second, /*is_delta=*/!Exists(std::make_pair(DB_BASE, index.GetBlockHash())));
     return true;
   }
 
@@ -126,9 +306,9 @@ boost::optional<uint32_t> StateDBImpl::FindLastFinalizedEpoch(
   const CBlockIndex *walk = m_active_chain->GetTip();
 
   while (walk != nullptr) {
-    FinalizationState state(fin_params, admin_params);
-    if (Read(walk->GetBlockHash(), state)) {
-      return state.GetLastFinalizedEpoch();
+    const boost::optional<FinalizationState> state = ReadState(*walk, fin_params, admin_params, nullptr);
+    if (state) {
+      return state->GetLastFinalizedEpoch();
     }
     walk = walk->pprev;
   }
@@ -148,16 +328,28 @@ void StateDBImpl::LoadStatesHigherThan(
 
   states->clear();
 
-  m_block_index_map->ForEach([states, height, &fin_params, &admin_params, this](const uint256 &block_hash, const CBlockIndex &block_index) {
+  std::vector<const CBlockIndex *> indexes;
+  m_block_index_map->ForEach([&indexes, height, this](const uint256 &, const CBlockIndex &block_index) {
     const CBlockIndex *origin = m_active_chain->FindForkOrigin(block_index);
     if (origin != nullptr && static_cast<blockchain::Height>(origin->nHeight) > height) {
-      FinalizationState state(fin_params, admin_params);
-      if (Read(block_hash, state)) {
-        states->emplace(&block_index, std::move(state));
-      }
+      indexes.emplace_back(&block_index);
     }
     return true;
   });
+
+  // Restore parents first, so that children replay a single delta on top of them.
+  std::sort(indexes.begin(), indexes.end(), [](const CBlockIndex *a, const CBlockIndex *b) {
+    return a->nHeight < b->nHeight;
+  });
+
+  LOCK(m_cs);
+  for (const CBlockIndex *block_index : indexes) {
+    boost::optional<FinalizationState> state = ReadState(*block_index, fin_params, admin_params, states);
+    if (state) {
+      const auto res = states->emplace(block_index, std::move(*state));
+      MarkSaved(*block_index, res.first->second, /*is_delta=*/!Exists(std::make_pair(DB_BASE, block_index->GetBlockHash())));
+    }
+  }
 }
 
 }  // namespace
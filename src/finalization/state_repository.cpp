@@ -29,6 +29,8 @@ class RepositoryImpl final : public StateRepository {
 
   CCriticalSection &GetLock() override { return m_cs; }
   FinalizationState *GetTipState() override;
+  std::shared_ptr<const FinalizationState> GetTipSnapshot() const override;
+  void PublishTipSnapshot() override;
   FinalizationState *Find(const CBlockIndex &block_index) override;
   FinalizationState *FindOrCreate(const CBlockIndex &block_index,
                                   FinalizationState::InitStatus required_parent_status) override;
@@ -72,6 +74,8 @@ class RepositoryImpl final : public StateRepository {
   mutable CCriticalSection m_cs;
   std::map<const CBlockIndex *, FinalizationState> m_states;
   std::unique_ptr<FinalizationState> m_genesis_state;
+  //! Replaced as a whole and never modified, readers load it without m_cs.
+  std::shared_ptr<const FinalizationState> m_tip_snapshot;
   std::atomic<bool> m_restoring{false};
 
   struct RestoringRAII {
@@ -90,6 +94,20 @@ FinalizationState *RepositoryImpl::GetTipState() {
   return Find(*block_index);
 }
 
+std::shared_ptr<const FinalizationState> RepositoryImpl::GetTipSnapshot() const {
+  return std::atomic_load(&m_tip_snapshot);
+}
+
+void RepositoryImpl::PublishTipSnapshot() {
+  AssertLockHeld(m_cs);
+  std::shared_ptr<const FinalizationState> snapshot;
+  if (const FinalizationState *state = GetTipState()) {
+    // The maps of the state are persistent, copying it shares their nodes
+    snapshot = std::make_shared<const FinalizationState>(*state, state->GetInitStatus());
+  }
+  std::atomic_store(&m_tip_snapshot, std::move(snapshot));
+}
+
 FinalizationState *RepositoryImpl::Find(const CBlockIndex &block_index) {
   AssertLockHeld(m_cs);
   if (block_index.nHeight == 0) {
@@ -136,6 +154,7 @@ void RepositoryImpl::Reset(const esperanza::FinalizationParams &params,
   m_genesis_state.reset(new FinalizationState(params, admin_params));
   m_finalization_params = &params;
   m_admin_params = &admin_params;
+  std::atomic_store(&m_tip_snapshot, std::shared_ptr<const FinalizationState>());
 }
 
 void RepositoryImpl::ResetToTip(const CBlockIndex &block_index) {
@@ -143,7 +162,8 @@ void RepositoryImpl::ResetToTip(const CBlockIndex &block_index) {
   LogPrint(BCLog::FINALIZATION, "Reset state repository to the tip=%s height=%d\n",
            block_index.GetBlockHash().GetHex(), block_index.nHeight);
   m_states.clear();
-  m_states.emplace(&block_index, FinalizationState(*GetGenesisState(), FinalizationState::COMPLETED));
+  const auto res = m_states.emplace(&block_index, FinalizationState(*GetGenesisState(), FinalizationState::COMPLETED));
+  std::atomic_store(&m_tip_snapshot, std::make_shared<const FinalizationState>(res.first->second, FinalizationState::COMPLETED));
 }
 
 void RepositoryImpl::TrimUntilHeight(blockchain::Height height) {
@@ -208,6 +228,7 @@ bool RepositoryImpl::RestoreFromDisk(Dependency<finalization::StateProcessor> pr
   LogPrint(BCLog::FINALIZATION, "Loaded %d states\n", m_states.size());
   CheckAndRecover(proc);
   LogPrint(BCLog::FINALIZATION, "States after recovering: %d\n", m_states.size());
+  PublishTipSnapshot();
   return true;
 }
 
@@ -57,6 +57,20 @@ class StateRepository {
   //! Return the finalization state of the current active chain tip.
   virtual FinalizationState *GetTipState() = 0;
 
+  //! \brief Returns an immutable snapshot of the finalization state of the active chain tip.
+  //!
+  //! Doesn't require the lock. The snapshot is published whenever the active chain tip
+  //! changes and stays valid for as long as the caller holds it, so readers which only
+  //! need the tip state do not contend with block connection. While holding cs_main,
+  //! the snapshot equals the state returned by GetTipState. Returns nullptr until a tip
+  //! state has been published.
+  virtual std::shared_ptr<const FinalizationState> GetTipSnapshot() const = 0;
+
+  //! \brief Publishes the finalization state of the active chain tip as the tip snapshot.
+  //!
+  //! Requires cs_main and the lock obtained from GetLock to be held.
+  virtual void PublishTipSnapshot() = 0;
+
   //! Return the finalization state of the given block_index.
   virtual FinalizationState *Find(const CBlockIndex &block_index) = 0;
 
@@ -21,37 +21,150 @@ using DBKey = std::pair<uint160, uint32_t>;
 CCriticalSection VoteRecorder::cs_recorder;
 std::shared_ptr<VoteRecorder> VoteRecorder::g_voteRecorder;
 
-VoteRecorder::VoteRecorder(const DBParams &p)
-    : m_db(GetDataDir() / "votes", p.cache_size, p.inmemory, p.wipe, p.obfuscate) {
-  if (!p.wipe && !p.inmemory) {
-    LoadFromDB();
+bool ValidatorVotes::Add(const VoteRecord &record) {
+  if (!m_records.emplace(record.vote.m_target_epoch, record).second) {
+    return false;
   }
+  Index(record.vote.m_target_epoch, record.vote.m_source_epoch);
+  return true;
 }
 
-void VoteRecorder::LoadFromDB() {
-  LOCK(cs_recorder);
-  LogPrint(BCLog::FINALIZATION, "Restoring vote recorder from disk\n");
-  uint32_t count = 0;
-  voteRecords.clear();
-  voteCache.clear();
+void ValidatorVotes::Index(const uint32_t target_epoch, const uint32_t source_epoch) {
+  {
+    auto it = m_max_sources.upper_bound(target_epoch);
+    if (it == m_max_sources.begin() || std::prev(it)->second < source_epoch) {
+      while (it != m_max_sources.end() && it->second <= source_epoch) {
+        it = m_max_sources.erase(it);
+      }
+      m_max_sources.emplace_hint(it, target_epoch, source_epoch);
+    }
+  }
+  {
+    auto it = m_min_sources.lower_bound(target_epoch);
+    if (it == m_min_sources.end() || it->second > source_epoch) {
+      while (it != m_min_sources.begin() && std::prev(it)->second >= source_epoch) {
+        m_min_sources.erase(std::prev(it));
+      }
+      m_min_sources.emplace_hint(it, target_epoch, source_epoch);
+    }
+  }
+}
+
+const VoteRecord *ValidatorVotes::Get(const uint32_t target_epoch) const {
+  const auto it = m_records.find(target_epoch);
+  if (it == m_records.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+const VoteRecord *ValidatorVotes::FindOffendingVote(const esperanza::Vote &vote) const {
+
+  // Check for double votes
+  const VoteRecord *record = Get(vote.m_target_epoch);
+  if (record != nullptr && record->vote.m_target_hash != vote.m_target_hash) {
+    return record;
+  }
+
+  // Check for a vote surrounded by the given one
+  auto it = m_max_sources.lower_bound(vote.m_target_epoch);
+  if (it != m_max_sources.begin() && std::prev(it)->second > vote.m_source_epoch) {
+    return Get(std::prev(it)->first);
+  }
+
+  // Check for a vote surrounding the given one
+  it = m_min_sources.upper_bound(vote.m_target_epoch);
+  if (it != m_min_sources.end() && it->second < vote.m_source_epoch) {
+    return Get(it->first);
+  }
+
+  return nullptr;
+}
+
+void ValidatorVotes::PruneBelow(const uint32_t target_epoch) {
+  const auto end = m_records.lower_bound(target_epoch);
+  if (end == m_records.begin()) {
+    return;
+  }
+  m_records.erase(m_records.begin(), end);
+
+  m_max_sources.clear();
+  m_min_sources.clear();
+  for (const auto &entry : m_records) {
+    Index(entry.first, entry.second.vote.m_source_epoch);
+  }
+}
+
+VoteRecorder::VoteRecorder(const DBParams &p)
+    : m_db(GetDataDir() / "votes", p.cache_size, p.inmemory, p.wipe, p.obfuscate) {}
+
+ValidatorVotes &VoteRecorder::LoadValidatorVotes(const uint160 &validatorAddress) {
+  AssertLockHeld(cs_recorder);
+
+  const auto it = voteRecords.find(validatorAddress);
+  if (it != voteRecords.end()) {
+    return it->second;
+  }
+
+  ValidatorVotes &votes = voteRecords[validatorAddress];
   std::unique_ptr<CDBIterator> cursor(m_db.NewIterator());
-  cursor->SeekToFirst();
-  while (cursor->Valid()) {
+  for (cursor->Seek(DBKey(validatorAddress, 0)); cursor->Valid(); cursor->Next()) {
     DBKey key;
     if (!cursor->GetKey(key)) {
-      LogPrintf("WARN: cannot read next key from votes DB");
-      return;
+      LogPrintf("WARN: cannot read next key from votes DB\n");
+      break;
+    }
+    if (key.first != validatorAddress) {
+      break;
     }
     VoteRecord record;
     if (!cursor->GetValue(record)) {
-      LogPrintf("WARN: cannot fetch data from votes DB, key=%s", util::to_string(key));
-      return;
+      LogPrintf("WARN: cannot fetch data from votes DB, key=%s\n", util::to_string(key));
+      break;
+    }
+    if (key.second >= m_pruned_epoch) {
+      votes.Add(record);
     }
-    voteRecords[key.first].emplace(key.second, record);
-    cursor->Next();
-    ++count;
   }
-  LogPrint(BCLog::FINALIZATION, "Loaded %d vote records\n", count);
+  return votes;
+}
+
+void VoteRecorder::Prune(const FinalizationState &fin_state) {
+  AssertLockHeld(cs_recorder);
+
+  const uint32_t last_finalized_epoch = fin_state.GetLastFinalizedEpoch();
+  const uint32_t window = fin_state.GetWithdrawalEpochDelay();
+  const uint32_t prune_epoch = last_finalized_epoch > window ? last_finalized_epoch - window : 0;
+  if (prune_epoch <= m_pruned_epoch) {
+    return;
+  }
+  m_pruned_epoch = prune_epoch;
+
+  for (auto it = voteRecords.begin(); it != voteRecords.end();) {
+    it->second.PruneBelow(prune_epoch);
+    if (it->second.IsEmpty()) {
+      it = voteRecords.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  CDBBatch batch(m_db);
+  size_t count = 0;
+  std::unique_ptr<CDBIterator> cursor(m_db.NewIterator());
+  for (cursor->SeekToFirst(); cursor->Valid(); cursor->Next()) {
+    DBKey key;
+    if (!cursor->GetKey(key)) {
+      LogPrintf("WARN: cannot read next key from votes DB\n");
+      break;
+    }
+    if (key.second < prune_epoch) {
+      batch.Erase(key);
+      ++count;
+    }
+  }
+  m_db.WriteBatch(batch);
+  LogPrint(BCLog::FINALIZATION, "Pruned %d vote records with target epoch below %d\n", count, prune_epoch);
 }
 
 void VoteRecorder::SaveVoteToDB(const VoteRecord &record) {
@@ -72,20 +185,15 @@ void VoteRecorder::RecordVote(const esperanza::Vote &vote,
     return;
   }
 
+  Prune(fin_state);
+
   boost::optional<VoteRecord> offendingVote = FindOffendingVote(vote);
 
   VoteRecord voteRecord{vote, voteSig};
 
   // Record the vote
-  bool saved_in_memory = false;
-  const auto validatorIt = voteRecords.find(vote.m_validator_address);
-  if (validatorIt != voteRecords.end()) {
-    saved_in_memory = validatorIt->second.emplace(vote.m_target_epoch, voteRecord).second;
-  } else {
-    std::map<uint32_t, VoteRecord> newMap;
-    newMap.emplace(vote.m_target_epoch, voteRecord);
-    saved_in_memory = voteRecords.emplace(vote.m_validator_address, std::move(newMap)).second;
-  }
+  const bool saved_in_memory = vote.m_target_epoch >= m_pruned_epoch &&
+                               LoadValidatorVotes(vote.m_validator_address).Add(voteRecord);
 
   if (saved_in_memory) {
     SaveVoteToDB(voteRecord);
@@ -120,45 +228,19 @@ boost::optional<VoteRecord> VoteRecorder::FindOffendingVote(const esperanza::Vot
     }
   }
 
-  esperanza::Vote slashCandidate;
-  const auto validatorIt = voteRecords.find(vote.m_validator_address);
-  if (validatorIt != voteRecords.end()) {
-
-    const auto &voteMap = validatorIt->second;
-
-    // Check for double votes
-    const auto recordIt = voteMap.find(vote.m_target_epoch);
-    if (recordIt != voteMap.end()) {
-      if (recordIt->second.vote.m_target_hash != vote.m_target_hash) {
-        return recordIt->second;
-      }
-    }
-
-    // Check for a surrounding vote
-    for (auto it = voteMap.lower_bound(vote.m_source_epoch); it != voteMap.end(); ++it) {
-      const VoteRecord &record = it->second;
-      if (record.vote.m_source_epoch < vote.m_target_epoch) {
-        if ((record.vote.m_source_epoch > vote.m_source_epoch &&
-             record.vote.m_target_epoch < vote.m_target_epoch) ||
-            (record.vote.m_source_epoch < vote.m_source_epoch &&
-             record.vote.m_target_epoch > vote.m_target_epoch)) {
-          return record;
-        }
-      }
-    }
+  const VoteRecord *record = LoadValidatorVotes(vote.m_validator_address).FindOffendingVote(vote);
+  if (record != nullptr) {
+    return *record;
   }
   return boost::none;
 }
 
-boost::optional<VoteRecord> VoteRecorder::GetVote(const uint160 &validatorAddress, uint32_t epoch) const {
+boost::optional<VoteRecord> VoteRecorder::GetVote(const uint160 &validatorAddress, uint32_t epoch) {
 
   LOCK(cs_recorder);
-  const auto validatorIt = voteRecords.find(validatorAddress);
-  if (validatorIt != voteRecords.end()) {
-    const auto recordIt = validatorIt->second.find(epoch);
-    if (recordIt != validatorIt->second.end()) {
-      return recordIt->second;
-    }
+  const VoteRecord *record = LoadValidatorVotes(validatorAddress).Get(epoch);
+  if (record != nullptr) {
+    return *record;
   }
   return boost::none;
 }
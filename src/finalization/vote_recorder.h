@@ -46,6 +46,42 @@ struct VoteRecord {
   }
 };
 
+//! \brief The votes of a single validator indexed for slashing detection.
+//!
+//! Besides the votes by target epoch, two staircases of (target, source)
+//! pairs are kept, both ascending in target and in source:
+//! - the votes with the greatest source among all votes with a lower target,
+//!   the predecessor of a target answers whether a new vote surrounds any vote;
+//! - the votes with the least source among all votes with a greater target,
+//!   the successor of a target answers whether any vote surrounds a new vote.
+//! This way double and surround votes are found in O(log n).
+class ValidatorVotes {
+ public:
+  //! \brief Adds the record unless there is a vote for the same target already.
+  bool Add(const VoteRecord &record);
+
+  const VoteRecord *Get(uint32_t target_epoch) const;
+
+  //! \brief Returns a vote which together with the given one is a double or a surround vote.
+  const VoteRecord *FindOffendingVote(const esperanza::Vote &vote) const;
+
+  //! \brief Removes the votes with target epoch below the given one.
+  void PruneBelow(uint32_t target_epoch);
+
+  bool IsEmpty() const { return m_records.empty(); }
+
+ private:
+  void Index(uint32_t target_epoch, uint32_t source_epoch);
+
+  std::map<uint32_t, VoteRecord> m_records;
+
+  //! target -> source, the greatest source among the votes with target up to this one
+  std::map<uint32_t, uint32_t> m_max_sources;
+
+  //! target -> source, the least source among the votes with target from this one
+  std::map<uint32_t, uint32_t> m_min_sources;
+};
+
 class VoteRecorder : private boost::noncopyable {
  public:
   struct DBParams {
@@ -58,9 +94,12 @@ class VoteRecorder : private boost::noncopyable {
  private:
   VoteRecorder(const DBParams &p);
 
-  // Contains a map by validatorAddress. Each entry contains a map of the target
-  // epoch height with the actual vote
-  std::map<uint160, std::map<uint32_t, VoteRecord>> voteRecords;
+  // Contains the votes by validatorAddress. Validators are loaded from the
+  // database when their votes are accessed for the first time.
+  std::map<uint160, ValidatorVotes> voteRecords;
+
+  // Votes with target epoch below this one were removed
+  uint32_t m_pruned_epoch = 0;
 
   // Contains the most recent vote casted by any validator
   std::map<uint160, VoteRecord> voteCache;
@@ -71,9 +110,15 @@ class VoteRecorder : private boost::noncopyable {
   static std::shared_ptr<VoteRecorder> g_voteRecorder;
 
   boost::optional<VoteRecord> FindOffendingVote(const esperanza::Vote &vote);
-  void LoadFromDB();
+  ValidatorVotes &LoadValidatorVotes(const uint160 &validatorAddress);
   void SaveVoteToDB(const VoteRecord &record);
 
+  //! \brief Removes votes which can't be used to slash anymore.
+  //!
+  //! These are the votes with target epoch older than the last finalized
+  //! epoch minus the withdrawal delay.
+  void Prune(const FinalizationState &fin_state);
+
  public:
   void RecordVote(const esperanza::Vote &vote,
                   const std::vector<unsigned char> &voteSig,
@@ -81,7 +126,7 @@ class VoteRecorder : private boost::noncopyable {
                   bool log_errors = true);
 
   boost::optional<VoteRecord> GetVote(const uint160 &validatorAddress,
-                                      uint32_t epoch) const;
+                                      uint32_t epoch);
 
   static void Init(const DBParams &params);
   static void Reset(const DBParams &params);
@@ -7,8 +7,9 @@
 #define UNITE_IBLT_H
 
 #include <stdlib.h>
+#include <array>
 #include <cinttypes>
-#include <set>
+#include <map>
 #include <vector>
 
 #include <hash.h>
@@ -17,6 +18,9 @@
 
 //! \brief Invertible Bloom Lookup Table implementation
 //!
+//! Values have a fixed size of ValueSize bytes (which might be zero) and are
+//! stored inline, so the table is a single flat array of cells.
+//!
 //! References:
 //!
 //! "What's the Difference? Efficient Set Reconciliation
@@ -29,6 +33,7 @@ template <typename TKey, size_t ValueSize>
 class IBLT {
  public:
   using TEntriesMap = std::map<TKey, std::vector<uint8_t>>;
+  using TValue = std::array<uint8_t, ValueSize>;
 
   explicit IBLT(size_t expected_items_count) {
     const IBLTParams optimal_params = IBLTParams::FindOptimal(expected_items_count);
@@ -48,11 +53,11 @@ class IBLT {
   }
 
   void Insert(const TKey key, const std::vector<uint8_t> &value) {
-    Update(1, key, value);
+    Update(1, key, ToValue(value), [](size_t) {});
   }
 
   void Erase(const TKey key, const std::vector<uint8_t> &value) {
-    Update(-1, key, value);
+    Update(-1, key, ToValue(value), [](size_t) {});
   }
 
   //! \brief Tries to get a value from the IBLT
@@ -64,58 +69,24 @@ class IBLT {
   bool Get(const TKey key, std::vector<uint8_t> &value_out) const {
     value_out.clear();
 
-    const size_t buckets_per_hash = m_hash_table.size() / m_num_hashes;
-    for (size_t i = 0; i < m_num_hashes; i++) {
-      const size_t start_entry = i * buckets_per_hash;
-
-      // Although in theory seed might overflow here - we don't care.
-      // It is seed after all
-      const auto seed = static_cast<unsigned int>(i);
-      const unsigned int h = ComputeHash(seed, key);
-      const size_t bucket = start_entry + (h % buckets_per_hash);
-      const IBLTEntry &entry = m_hash_table.at(bucket);
-
-      if (entry.IsEmpty()) {
-        // Definitely not in the table. Leave result empty, return true.
-        return true;
-      }
-
-      if (entry.IsPure()) {
-        if (entry.key_sum == key) {
-          // Found!
-          value_out = entry.value_sum;
-        }
-        // Otherwise - definitely not in the table.
-        // In any case - we are confident about result, so return true
-        return true;
-      }
+    if (GetWithoutPeeling(key, value_out)) {
+      return true;
     }
 
     // Don't know if key is in table or not; "peel" the IBLT to try to find it
     IBLT<TKey, ValueSize> peeled = *this;
-    bool erased = false;
-    for (size_t i = 0; i < peeled.m_hash_table.size(); ++i) {
-      const IBLTEntry &entry = peeled.m_hash_table[i];
-      if (entry.IsPure()) {
-        if (entry.key_sum == key) {
-          // Found!
-          value_out = entry.value_sum;
-          return true;
-        }
-        erased = true;
-
-        // Need a copy because `Update` will reiterate table and might change
-        // our entry because it is a reference
-        const std::vector<uint8_t> value_sum_copy = entry.value_sum;
-        peeled.Update(-entry.count, entry.key_sum, value_sum_copy);
+    bool found = false;
+    peeled.Peel([&](const IBLTEntry &entry) {
+      if (!found && entry.key_sum == key) {
+        found = true;
+        value_out.assign(entry.value_sum.begin(), entry.value_sum.end());
       }
+    });
+    if (found) {
+      return true;
     }
 
-    if (erased) {
-      // Recurse with smaller IBLT
-      return peeled.Get(key, value_out);
-    }
-    return false;
+    return peeled.GetWithoutPeeling(key, value_out);
   }
 
   //! \brief Decodes IBLT entries
@@ -129,25 +100,10 @@ class IBLT {
                    TEntriesMap &negative_out) const {
     IBLT<TKey, ValueSize> peeled = *this;
 
-    bool erased;
-    do {
-      erased = false;
-      for (size_t i = 0; i < peeled.m_hash_table.size(); ++i) {
-        const IBLTEntry &entry = peeled.m_hash_table[i];
-        if (entry.IsPure()) {
-          if (entry.count == 1) {
-            positive_out.emplace(entry.key_sum, entry.value_sum);
-          } else {
-            negative_out.emplace(entry.key_sum, entry.value_sum);
-          }
-          // Update will reiterate table and might change our entry because it
-          // is a reference
-          const std::vector<uint8_t> copy = entry.value_sum;
-          peeled.Update(-entry.count, entry.key_sum, copy);
-          erased = true;
-        }
-      }
-    } while (erased);
+    peeled.Peel([&](const IBLTEntry &entry) {
+      TEntriesMap &out = entry.count == 1 ? positive_out : negative_out;
+      out.emplace(entry.key_sum, std::vector<uint8_t>(entry.value_sum.begin(), entry.value_sum.end()));
+    });
 
     // If any buckets for one of the hash functions is not empty,
     // then we didn't peel them all:
@@ -172,11 +128,7 @@ class IBLT {
       e1.count -= e2.count;
       e1.key_sum ^= e2.key_sum;
       e1.key_check ^= e2.key_check;
-      if (e1.IsEmpty()) {
-        e1.value_sum.clear();
-      } else {
-        e1.AddValue(e2.value_sum);
-      }
+      e1.AddValue(e2.value_sum);
     }
 
     return result;
@@ -241,7 +193,7 @@ class IBLT {
     int64_t count = 0;
     TKey key_sum = 0;
     uint32_t key_check = 0;
-    std::vector<uint8_t> value_sum;
+    TValue value_sum{};
 
     bool IsPure() const {
       if (count == 1 || count == -1) {
@@ -255,22 +207,16 @@ class IBLT {
       return count == 0 && key_sum == 0 && key_check == 0;
     }
 
-    void AddValue(const std::vector<uint8_t> &value) {
-      if (value.empty()) {
-        return;
-      }
-
-      if (value_sum.size() < value.size()) {
-        value_sum.resize(value.size());
-      }
-
-      for (size_t i = 0; i < value.size(); i++) {
+    void AddValue(const TValue &value) {
+      for (size_t i = 0; i < ValueSize; i++) {
         value_sum[i] ^= value[i];
       }
     }
 
     ADD_SERIALIZE_METHODS;
 
+    //! The value is serialized as a vector which is either empty or has
+    //! exactly ValueSize bytes. Nothing is serialized when ValueSize is zero.
     template <typename Stream, typename Operation>
     void SerializationOp(Stream &s, Operation ser_action) {
       assert(count >= 0 && "Current IBLT implementation does not support negative values serialization");
@@ -283,7 +229,18 @@ class IBLT {
       READWRITE(key_sum);
       READWRITE(key_check);
       if (ValueSize != 0) {
-        READWRITE(value_sum);
+        std::vector<uint8_t> value;
+        if (!ser_action.ForRead() && !(IsEmpty() && value_sum == TValue{})) {
+          value.assign(value_sum.begin(), value_sum.end());
+        }
+        READWRITE(value);
+        if (ser_action.ForRead()) {
+          if (!value.empty() && value.size() != ValueSize) {
+            throw std::ios_base::failure("Invalid IBLT value size");
+          }
+          value_sum = TValue{};
+          std::copy(value.begin(), value.end(), value_sum.begin());
+        }
       }
     }
   };
@@ -298,11 +255,85 @@ class IBLT {
 
   static constexpr size_t N_HASHCHECK = 11;
 
+  static TValue ToValue(const std::vector<uint8_t> &value) {
+    assert(value.size() == ValueSize);
+    TValue result{};
+    std::copy(value.begin(), value.end(), result.begin());
+    return result;
+  }
+
+  //! \brief Looks the key up in the cells it hashes to.
+  //!
+  //! Returns false when none of the cells is empty or pure.
+  bool GetWithoutPeeling(const TKey key, std::vector<uint8_t> &value_out) const {
+    const size_t buckets_per_hash = m_hash_table.size() / m_num_hashes;
+    for (size_t i = 0; i < m_num_hashes; i++) {
+      const size_t start_entry = i * buckets_per_hash;
+
+      // Although in theory seed might overflow here - we don't care.
+      // It is seed after all
+      const auto seed = static_cast<unsigned int>(i);
+      const unsigned int h = ComputeHash(seed, key);
+      const size_t bucket = start_entry + (h % buckets_per_hash);
+      const IBLTEntry &entry = m_hash_table.at(bucket);
+
+      if (entry.IsEmpty()) {
+        // Definitely not in the table. Leave result empty, return true.
+        return true;
+      }
+
+      if (entry.IsPure()) {
+        if (entry.key_sum == key) {
+          // Found!
+          value_out.assign(entry.value_sum.begin(), entry.value_sum.end());
+        }
+        // Otherwise - definitely not in the table.
+        // In any case - we are confident about result, so return true
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! \brief Removes pure cells until there are none left.
+  //!
+  //! Calls on_peeled with every removed entry. Only the cells touched by a
+  //! removal can become pure, so they are put into a work queue instead of
+  //! scanning the whole table again.
+  template <typename Callback>
+  void Peel(Callback on_peeled) {
+    std::vector<size_t> queue;
+    for (size_t i = 0; i < m_hash_table.size(); ++i) {
+      if (m_hash_table[i].IsPure()) {
+        queue.emplace_back(i);
+      }
+    }
+
+    while (!queue.empty()) {
+      const size_t i = queue.back();
+      queue.pop_back();
+
+      // The cell might have changed since it was queued
+      if (!m_hash_table[i].IsPure()) {
+        continue;
+      }
+
+      // Update changes the cell, so it needs a copy
+      const IBLTEntry entry = m_hash_table[i];
+      on_peeled(entry);
+      Update(-entry.count, entry.key_sum, entry.value_sum, [this, &queue](const size_t bucket) {
+        if (m_hash_table[bucket].IsPure()) {
+          queue.emplace_back(bucket);
+        }
+      });
+    }
+  }
+
+  template <typename Callback>
   void Update(const int64_t count_delta,
               const TKey key,
-              const std::vector<uint8_t> &value) {
-
-    assert(value.size() == ValueSize);
+              const TValue &value,
+              Callback on_updated) {
 
     const unsigned int key_check = ComputeHash(N_HASHCHECK, key);
 
@@ -319,11 +350,8 @@ class IBLT {
       entry.count += count_delta;
       entry.key_sum ^= key;
       entry.key_check ^= key_check;
-      if (entry.IsEmpty()) {
-        entry.value_sum.clear();
-      } else {
-        entry.AddValue(value);
-      }
+      entry.AddValue(value);
+      on_updated(bucket);
     }
   }
 
@@ -1375,6 +1375,7 @@ bool AppInitMain()
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadFinalizerCommitCheck);
         }
     }
 
@@ -1929,6 +1930,7 @@ bool AppInitMain()
     // ********************************************************* Step 13: start proposer
 
 #ifdef ENABLE_WALLET
+    GetComponent<staking::TransactionPicker>()->Start();
     GetComponent<proposer::Proposer>()->Start();
 #endif
 
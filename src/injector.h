@@ -111,7 +111,9 @@ class UnitEInjector : public Injector<UnitEInjector> {
 
 #ifdef ENABLE_WALLET
 
-  COMPONENT(TransactionPicker, staking::TransactionPicker, staking::TransactionPicker::New)
+  COMPONENT(TransactionPicker, staking::TransactionPicker, staking::TransactionPicker::New,
+            staking::ActiveChain,
+            finalization::StateRepository)
 
   COMPONENT(MultiWallet, proposer::MultiWallet, proposer::MultiWallet::New)
 
@@ -125,6 +127,7 @@ class UnitEInjector : public Injector<UnitEInjector> {
             proposer::Proposer)
 
   COMPONENT(ProposerLogic, proposer::Logic, proposer::Logic::New,
+            Settings,
             blockchain::Behavior,
             staking::Network,
             staking::ActiveChain,
@@ -34,6 +34,7 @@
 #include <wallet/wallet.h>
 
 #include <algorithm>
+#include <limits>
 #include <memory>
 #include <queue>
 #include <utility>
@@ -103,25 +104,14 @@ void BlockAssembler::resetBlock()
     nFees = 0;
 }
 
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, CWallet *wallet)
+void BlockAssembler::AssembleTransactions()
 {
-    //TODO UNIT-E: Remove this as soon as we move to the new proposing logic
-    // Get the wallet that is used to retrieve the stakable coins.
-    // If a wallet is not explicitly provided, stake on the first one available.
-    if (!wallet) {
-        auto wallets = GetComponent<proposer::MultiWallet>()->GetWallets();
-        assert(!wallets.empty());
-        wallet = wallets[0];
-    }
-
-    int64_t nTimeStart = GetTimeMicros();
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
 
     resetBlock();
 
     pblocktemplate.reset(new CBlockTemplate());
-
-    if(!pblocktemplate.get())
-        return nullptr;
     pblock = &pblocktemplate->block; // pointer for convenience
 
     // Add dummy coinbase tx as first transaction
@@ -129,10 +119,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
 
-    LOCK(cs_main);
-    LOCK(wallet->cs_wallet);
-    LOCK(GetComponent<finalization::StateRepository>()->GetLock());
-    LOCK(mempool.cs);
     CBlockIndex* pindexPrev = chainActive.Tip();
     assert(pindexPrev != nullptr);
     nHeight = pindexPrev->nHeight + 1;
@@ -158,63 +144,98 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     ltor::SortTransactions(pblock->vtx);
 
+    LogPrint(BCLog::BENCH, "%s: %d packages, %d updated descendants\n", __func__, nPackagesSelected, nDescendantsUpdated);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewTemplate()
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    LOCK(cs_main);
+    LOCK(GetComponent<finalization::StateRepository>()->GetLock());
+    LOCK(mempool.cs);
+    AssembleTransactions();
+
+    LogPrint(BCLog::BENCH, "CreateNewTemplate() packages: %.2fms\n", 0.001 * (GetTimeMicros() - nTimeStart));
+
+    return std::move(pblocktemplate);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, CWallet *wallet)
+{
+    //TODO UNIT-E: Remove this as soon as we move to the new proposing logic
+    // Get the wallet that is used to retrieve the stakable coins.
+    // If a wallet is not explicitly provided, stake on the first one available.
+    if (!wallet) {
+        auto wallets = GetComponent<proposer::MultiWallet>()->GetWallets();
+        assert(!wallets.empty());
+        wallet = wallets[0];
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+
+    LOCK(cs_main);
+    LOCK(wallet->cs_wallet);
+    LOCK(GetComponent<finalization::StateRepository>()->GetLock());
+    LOCK(mempool.cs);
+    AssembleTransactions();
+    CBlockIndex* pindexPrev = chainActive.Tip();
+
     int64_t nTime1 = GetTimeMicros();
 
     std::vector<uint8_t> snapshot_hash = pcoinsTip->GetSnapshotHash().GetHashVector(*chainActive.Tip());
 
-    // Create coinbase transaction.
+    // Create coinbase transaction. The stake is the first coin which is
+    // unspent at the tip and not spent by a transaction in the mempool, so
+    // it can't conflict with the transactions of the block and the block
+    // is validated only once.
     const staking::CoinSet &stakeable_coins = wallet->GetWalletExtension().GetStakeableCoins();
-    if (stakeable_coins.empty()) {
+    const auto stake = std::find_if(stakeable_coins.begin(), stakeable_coins.end(),
+                                    [](const staking::Coin &coin) {
+                                        return pcoinsTip->HaveCoin(coin.GetOutPoint()) && !mempool.isSpent(coin.GetOutPoint());
+                                    });
+    if (stake == stakeable_coins.end()) {
       throw std::runtime_error(strprintf("%s: no stakeable coins.", __func__));
     }
 
-    bool success = false;
-    CValidationState state;
     const staking::ActiveChain *active_chain = GetComponent<staking::ActiveChain>();
-    for (const staking::Coin &coin : stakeable_coins) {
-      proposer::EligibleCoin eligible_coin = {
-          staking::Coin(active_chain->GetBlockIndex(coin.GetTransactionId()),
-              COutPoint(coin.GetTransactionId(), coin.GetOutputIndex()),
-              CTxOut(coin.GetAmount(), scriptPubKeyIn)),
-          GetRandHash(), //TODO UNIT-E: At the moment is not used, since we still have PoW here
-          GetComponent<blockchain::Behavior>()->CalculateBlockReward(nHeight),
-          0, //TODO UNIT-E: At the moment is not used, since we still have PoW here
-          0, //TODO UNIT-E: At the moment is not used, since we still have PoW here
-          0 //TODO UNIT-E: At the moment is not used, since we still have PoW here
-      };
-
-      const CTransactionRef coinbase = GetComponent<proposer::BlockBuilder>()->BuildCoinbaseTransaction(uint256(snapshot_hash), eligible_coin, staking::CoinSet(), nFees, wallet->GetWalletExtension());
-      pblocktemplate->block.vtx[0] = coinbase;
-
-      LogPrintf("%s: block weight=%u txs=%u fees=%ld sigops=%d\n", __func__, GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
-
-      // Fill in header
-      pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-      UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
-      pblock->nBits          = GetComponent<blockchain::Behavior>()->GetGenesisBlock().nBits;
-      pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
-
-      state = CValidationState();
-      // The Block created here is not a proper block and will be fully checked later
-      // when invoking ProcessNewBlock. Here we do not have a proper coinbase, no
-      // stake, and the merkle tree is not computed yet - thus these checks are
-      // skipped. The merkle tree computation was bypassed in bitcoin using a
-      // boolean flag fCheckMerkleTree too.
-      const TestBlockValidityFlags::Type flags =
-          TestBlockValidityFlags::SKIP_MERKLE_TREE_CHECK |
-          TestBlockValidityFlags::SKIP_ELIGIBILITY_CHECK;
-      if (TestBlockValidity(state, chainparams, *pblock, pindexPrev, flags)) {
-        success = true;
-        break;
-      }
-    }
+    proposer::EligibleCoin eligible_coin = {
+        staking::Coin(active_chain->GetBlockIndex(stake->GetTransactionId()),
+            stake->GetOutPoint(),
+            CTxOut(stake->GetAmount(), scriptPubKeyIn)),
+        GetRandHash(), //TODO UNIT-E: At the moment is not used, since we still have PoW here
+        GetComponent<blockchain::Behavior>()->CalculateBlockReward(nHeight),
+        0, //TODO UNIT-E: At the moment is not used, since we still have PoW here
+        0, //TODO UNIT-E: At the moment is not used, since we still have PoW here
+        0 //TODO UNIT-E: At the moment is not used, since we still have PoW here
+    };
+
+    const CTransactionRef coinbase = GetComponent<proposer::BlockBuilder>()->BuildCoinbaseTransaction(uint256(snapshot_hash), eligible_coin, staking::CoinSet(), nFees, wallet->GetWalletExtension());
+    pblocktemplate->block.vtx[0] = coinbase;
+
+    LogPrintf("%s: block weight=%u txs=%u fees=%ld sigops=%d\n", __func__, GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
+
+    // Fill in header
+    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
+    UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+    pblock->nBits          = GetComponent<blockchain::Behavior>()->GetGenesisBlock().nBits;
+    pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
-    if (!success) {
+    CValidationState state;
+    // The Block created here is not a proper block and will be fully checked later
+    // when invoking ProcessNewBlock. Here we do not have a proper coinbase, no
+    // stake, and the merkle tree is not computed yet - thus these checks are
+    // skipped. The merkle tree computation was bypassed in bitcoin using a
+    // boolean flag fCheckMerkleTree too.
+    const TestBlockValidityFlags::Type flags =
+        TestBlockValidityFlags::SKIP_MERKLE_TREE_CHECK |
+        TestBlockValidityFlags::SKIP_ELIGIBILITY_CHECK;
+    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, flags)) {
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms, validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -225,30 +246,32 @@ void BlockAssembler::AddMandatoryTxs()
         GetComponent<finalization::StateRepository>()->GetTipState();
     assert(fin_state !=nullptr);
 
-    auto mi = mempool.mapTx.get<ancestor_score>().begin();
-    for (;mi != mempool.mapTx.get<ancestor_score>().end(); ++mi) {
-
-        if (mi->GetTx().IsVote()) {
-            CValidationState state;
-            //Check again in case the vote became invalid in the meanwhile (different target now)
-            if (esperanza::ContextualCheckVoteTx(mi->GetTx(), state, *fin_state, *pcoinsTip)) {
-                AddToBlock(mempool.mapTx.project<0>(mi));
-                LogPrint(BCLog::FINALIZATION,
-                         "%s: Add vote with id %s to a new block.\n",
-                         __func__,
-                         mi->GetTx().GetHash().GetHex());
-            }
-            continue;
-        }
-        if (mi->GetTx().IsSlash()) {
-
+    // The finalizer commits are sorted by type, so only the votes and slashes
+    // are visited. Votes which target an expired epoch are removed from the
+    // mempool by CTxMemPool::ExpireVotes.
+    const auto &commits = mempool.mapTx.get<finalizer_commit>();
+    const uint16_t vote = (+TxType::VOTE)._to_integral();
+    const auto votes_end = commits.upper_bound(std::make_pair(vote, std::numeric_limits<uint32_t>::max()));
+    for (auto mi = commits.lower_bound(std::make_pair(vote, uint32_t(0))); mi != votes_end; ++mi) {
+        CValidationState state;
+        //Check again in case the vote became invalid in the meanwhile (different target now)
+        if (esperanza::ContextualCheckVoteTx(mi->GetTx(), state, *fin_state, *pcoinsTip)) {
             AddToBlock(mempool.mapTx.project<0>(mi));
-            LogPrint(BCLog::FINALIZATION, "%s: Add slash with id %s to a new block.\n",
+            LogPrint(BCLog::FINALIZATION,
+                     "%s: Add vote with id %s to a new block.\n",
                      __func__,
                      mi->GetTx().GetHash().GetHex());
-            continue;
         }
     }
+
+    const uint16_t slash = (+TxType::SLASH)._to_integral();
+    const auto slashes_end = commits.upper_bound(std::make_pair(slash, std::numeric_limits<uint32_t>::max()));
+    for (auto mi = commits.lower_bound(std::make_pair(slash, uint32_t(0))); mi != slashes_end; ++mi) {
+        AddToBlock(mempool.mapTx.project<0>(mi));
+        LogPrint(BCLog::FINALIZATION, "%s: Add slash with id %s to a new block.\n",
+                 __func__,
+                 mi->GetTx().GetHash().GetHex());
+    }
 }
 
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
@@ -159,8 +159,18 @@ public:
       const CScript& scriptPubKeyIn, CWallet *pwallet=nullptr
     );
 
+    /** Construct a new block template without a coinbase. The first entries of
+     *  block.vtx, vTxFees and vTxSigOpsCost are placeholders for the coinbase
+     *  which the caller attaches. The template is not validated: the mempool only
+     *  holds transactions which are valid on top of the tip, and the block the
+     *  caller builds from it is validated by ProcessNewBlock. */
+    std::unique_ptr<CBlockTemplate> CreateNewTemplate();
+
 private:
     // utility functions
+    /** Select the transactions of a new block on top of the tip into pblocktemplate.
+      * cs_main, the lock of the finalization state repository and mempool.cs must be held. */
+    void AssembleTransactions();
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
     /** Add a tx to the block */
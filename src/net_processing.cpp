@@ -1784,7 +1784,19 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
     else if (strCommand == NetMsgType::SNAPSHOT) {
-        return snapshot::ProcessSnapshot(*pfrom, vRecv, msgMaker);
+        return snapshot::ProcessSnapshot(*pfrom, vRecv, msgMaker, snapshot::SNAPSHOT_FORMAT_PLAIN);
+    }
+
+    else if (strCommand == NetMsgType::COMPRESSED_SNAPSHOT) {
+        return snapshot::ProcessSnapshot(*pfrom, vRecv, msgMaker, snapshot::SNAPSHOT_FORMAT_COMPRESSED);
+    }
+
+    else if (strCommand == NetMsgType::GETCHUNKHASHES) {
+        return snapshot::ProcessGetChunkHashes(*pfrom, vRecv, msgMaker);
+    }
+
+    else if (strCommand == NetMsgType::CHUNKHASHES) {
+        return snapshot::ProcessChunkHashes(*pfrom, vRecv);
     }
 
     else if (strCommand == NetMsgType::ADDR)
@@ -3310,8 +3322,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, size_t node_index, size_t tot
         const CBlockIndex *last_finalized_checkpoint =
             GetComponent<p2p::FinalizerCommitsHandler>()->GetLastFinalizedCheckpoint();
         {
-            LOCK(GetComponent<finalization::StateRepository>()->GetLock());
-            const auto *fin_state = GetComponent<finalization::StateRepository>()->GetTipState();
+            const auto fin_state = GetComponent<finalization::StateRepository>()->GetTipSnapshot();
             assert(fin_state != nullptr);
             const uint32_t epoch = fin_state->GetLastFinalizedEpoch();
             if (last_finalized_checkpoint == nullptr ||
@@ -3331,8 +3342,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, size_t node_index, size_t tot
             pindexBestHeader = chainActive.Tip();
         bool fFetch = state.fPreferredDownload || (nPreferredDownload == 0 && !pto->fClient && !pto->fOneShot); // Download if this is a nice peer, or we have no nice peers and this one might do.
         if (!state.fSyncStarted && !pto->fClient && !fImporting && !fReindex) {
-            LOCK(GetComponent<finalization::StateRepository>()->GetLock());
-            const auto *fin_state = GetComponent<finalization::StateRepository>()->GetTipState();
+            const auto fin_state = GetComponent<finalization::StateRepository>()->GetTipSnapshot();
             assert(fin_state != nullptr);
             // Only actively request headers from a single peer, unless we're close to today.
             if (((nSyncStarted == 0 && fFetch) || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 24 * 60 * 60) &&
@@ -72,7 +72,6 @@ FinalizerCommitsLocator FinalizerCommitsHandlerImpl::GetFinalizerCommitsLocator(
     const CBlockIndex &start, const CBlockIndex *const stop) const {
 
   LOCK(m_active_chain->GetLock());
-  LOCK(m_repo->GetLock());
 
   FinalizerCommitsLocator locator;
 
@@ -80,7 +79,7 @@ FinalizerCommitsLocator FinalizerCommitsHandlerImpl::GetFinalizerCommitsLocator(
     locator.stop = stop->GetBlockHash();
   }
 
-  const finalization::FinalizationState *const fin_state = m_repo->GetTipState();
+  const std::shared_ptr<const finalization::FinalizationState> fin_state = m_repo->GetTipSnapshot();
   assert(fin_state != nullptr);
 
   const CBlockIndex *const fork_origin = m_active_chain->FindForkOrigin(start);
@@ -128,9 +127,8 @@ const CBlockIndex *FinalizerCommitsHandlerImpl::FindMostRecentStart(
     const FinalizerCommitsLocator &locator) const {
 
   AssertLockHeld(m_active_chain->GetLock());
-  LOCK(m_repo->GetLock());
 
-  const finalization::FinalizationState *const fin_state = m_repo->GetTipState();
+  const std::shared_ptr<const finalization::FinalizationState> fin_state = m_repo->GetTipSnapshot();
   assert(fin_state != nullptr);
 
   const CBlockIndex *best_index = nullptr;
@@ -206,25 +204,87 @@ boost::optional<HeaderAndFinalizerCommits> FinalizerCommitsHandlerImpl::FindHead
   return hc;
 }
 
-void FinalizerCommitsHandlerImpl::OnGetCommits(
-    CNode &node, const FinalizerCommitsLocator &locator, const Consensus::Params &params) const {
+//! Upper bound for the serialized size of the cached "commits" responses.
+constexpr size_t MAX_RESPONSES_CACHE_SIZE = 8 * MAX_PROTOCOL_MESSAGE_LENGTH;
+
+std::shared_ptr<const FinalizerCommitsHandlerImpl::CommitsResponses> FinalizerCommitsHandlerImpl::FindCachedResponses(
+    const CommitsRange &range) const {
+
+  LOCK(m_responses_cs);
+
+  const auto it = m_responses.find(range);
+  if (it == m_responses.end()) {
+    return nullptr;
+  }
+  m_responses_order.splice(m_responses_order.end(), m_responses_order, it->second.order_it);
+  return it->second.responses;
+}
+
+void FinalizerCommitsHandlerImpl::CacheResponses(
+    const CommitsRange &range, std::shared_ptr<const CommitsResponses> responses) const {
+
+  size_t size = 0;
+  for (const FinalizerCommitsResponse &response : *responses) {
+    size += GetSerializeSize(response, SER_NETWORK, PROTOCOL_VERSION);
+  }
+
+  LOCK(m_responses_cs);
+
+  if (m_responses.count(range) != 0) {
+    return;
+  }
+
+  while (!m_responses_order.empty() && m_responses_size + size > MAX_RESPONSES_CACHE_SIZE) {
+    const auto it = m_responses.find(m_responses_order.front());
+    assert(it != m_responses.end());
+    m_responses_size -= it->second.size;
+    m_responses.erase(it);
+    m_responses_order.pop_front();
+  }
+
+  if (size > MAX_RESPONSES_CACHE_SIZE) {
+    return;
+  }
+
+  const auto order_it = m_responses_order.insert(m_responses_order.end(), range);
+  m_responses.emplace(range, CachedResponses{std::move(responses), size, order_it});
+  m_responses_size += size;
+}
+
+std::shared_ptr<const FinalizerCommitsHandlerImpl::CommitsResponses> FinalizerCommitsHandlerImpl::GetCommits(
+    const FinalizerCommitsLocator &locator, const Consensus::Params &params) const {
 
   LOCK(m_active_chain->GetLock());
-  LOCK(m_repo->GetLock());
 
   const CBlockIndex *const start = FindMostRecentStart(locator);
   if (start == nullptr) {
-    return;
+    return nullptr;
   }
   const CBlockIndex *const stop = FindStop(locator);
 
-  const finalization::FinalizationState *fin_state = m_repo->GetTipState();
+  const CommitsRange range(start->GetBlockHash(), stop != nullptr ? stop->GetBlockHash() : uint256());
+  if (std::shared_ptr<const CommitsResponses> cached = FindCachedResponses(range)) {
+    return cached;
+  }
+
+  const std::shared_ptr<const finalization::FinalizationState> fin_state = m_repo->GetTipSnapshot();
   assert(fin_state != nullptr);
 
   const CBlockIndex *walk = start;
   assert(m_active_chain->Contains(*walk));
 
+  // The serialized size of the response is tracked as entries are appended:
+  // the status, the length of the data vector and the size of every entry.
+  const size_t empty_response_size = GetSerializeSize(FinalizerCommitsResponse(), SER_NETWORK, PROTOCOL_VERSION);
+  const auto size_with_entry = [](const size_t size, const size_t count, const size_t entry_size) {
+    return size + entry_size + GetSizeOfCompactSize(count + 1) - GetSizeOfCompactSize(count);
+  };
+
+  auto responses = std::make_shared<CommitsResponses>();
   FinalizerCommitsResponse response;
+  size_t response_size = empty_response_size;
+  // Whether every block of the range was added to the responses.
+  bool complete = true;
   do {
     walk = m_active_chain->GetNext(*walk);
     if (walk == nullptr) {
@@ -232,39 +292,56 @@ void FinalizerCommitsHandlerImpl::OnGetCommits(
       break;
     }
 
-    const boost::optional<HeaderAndFinalizerCommits> header_and_commits =
+    boost::optional<HeaderAndFinalizerCommits> header_and_commits =
         FindHeaderAndFinalizerCommits(*walk, params);
     if (!header_and_commits) {
+      complete = false;
       continue;
     }
 
     // In case of long unjustified dynasty we can reach the message length limit.
-    // To prevent this, compute message length on every iteration and set status=
-    // LengthExceeded once limit reached.
-    FinalizerCommitsResponse response_copy = response;
-
-    response_copy.data.emplace_back(*header_and_commits);
-
-    const size_t response_size = GetSerializeSize(response_copy, SER_NETWORK, PROTOCOL_VERSION);
-    if (response_size >= MAX_PROTOCOL_MESSAGE_LENGTH) {
+    // To prevent this, the entry goes to the next message with status=LengthExceeded
+    // set on the current one once limit reached.
+    const size_t entry_size = GetSerializeSize(*header_and_commits, SER_NETWORK, PROTOCOL_VERSION);
+    if (!response.data.empty() &&
+        size_with_entry(response_size, response.data.size(), entry_size) >= MAX_PROTOCOL_MESSAGE_LENGTH) {
       response.status = FinalizerCommitsResponse::Status::LengthExceeded;
-      LogPrint(BCLog::NET, "Send %d headers+commits, status=%d\n",
-               response.data.size(), static_cast<uint8_t>(response.status));
-      PushMessage(node, NetMsgType::COMMITS, std::move(response));
+      responses->emplace_back(std::move(response));
       response = FinalizerCommitsResponse();
-    } else {
-      response = std::move(response_copy);
+      response_size = empty_response_size;
     }
+    response_size = size_with_entry(response_size, response.data.size(), entry_size);
+    response.data.emplace_back(std::move(*header_and_commits));
 
   } while (walk != stop && !fin_state->IsFinalizedCheckpoint(walk->nHeight));
 
-  if (response.data.empty()) {
+  if (!response.data.empty()) {
+    responses->emplace_back(std::move(response));
+  }
+
+  // Blocks up to the last finalized checkpoint can't be reverted, so the
+  // responses for such a range stay the same.
+  if (complete && walk != nullptr &&
+      walk->nHeight <= FindLastFinalizedCheckpoint(*fin_state).nHeight) {
+    CacheResponses(range, responses);
+  }
+
+  return responses;
+}
+
+void FinalizerCommitsHandlerImpl::OnGetCommits(
+    CNode &node, const FinalizerCommitsLocator &locator, const Consensus::Params &params) const {
+
+  const std::shared_ptr<const CommitsResponses> responses = GetCommits(locator, params);
+  if (responses == nullptr) {
     return;
   }
 
-  LogPrint(BCLog::NET, "Send %d headers+commits, status=%d\n",
-           response.data.size(), static_cast<uint8_t>(response.status));
-  PushMessage(node, NetMsgType::COMMITS, std::move(response));
+  for (const FinalizerCommitsResponse &response : *responses) {
+    LogPrint(BCLog::NET, "Send %d headers+commits, status=%d\n",
+             response.data.size(), static_cast<uint8_t>(response.status));
+    PushMessage(node, NetMsgType::COMMITS, response);
+  }
 }
 
 bool FinalizerCommitsHandlerImpl::IsSameFork(
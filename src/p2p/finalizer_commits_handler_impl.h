@@ -9,6 +9,9 @@
 
 #include <chain.h>
 
+#include <list>
+#include <memory>
+
 namespace esperanza {
 class FinalizationState;
 }
@@ -53,6 +56,16 @@ class FinalizerCommitsHandlerImpl : public FinalizerCommitsHandler {
 
   const CBlockIndex *FindStop(const FinalizerCommitsLocator &locator) const;
 
+  using CommitsResponses = std::vector<FinalizerCommitsResponse>;
+
+  //! \brief Builds the "commits" messages which answer the locator.
+  //!
+  //! The range is split into several messages when it doesn't fit into
+  //! MAX_PROTOCOL_MESSAGE_LENGTH. Responses for finalized ranges never change
+  //! and are served from a cache keyed by the resolved start and stop blocks.
+  std::shared_ptr<const CommitsResponses> GetCommits(
+      const FinalizerCommitsLocator &locator, const Consensus::Params &params) const;
+
   //! \brief Returns whether test is an ancestor of the head.
   //!
   //! Pseudo code:
@@ -105,6 +118,26 @@ class FinalizerCommitsHandlerImpl : public FinalizerCommitsHandler {
   //! e1 e2 e3
   //! It's one of the index from epoch e3.
   const CBlockIndex *m_last_finalization_point = nullptr;
+
+  //! (start, stop) block hashes, stop is 0x0 when the locator has no stop.
+  using CommitsRange = std::pair<uint256, uint256>;
+
+  struct CachedResponses {
+    std::shared_ptr<const CommitsResponses> responses;
+    size_t size;
+    std::list<CommitsRange>::iterator order_it;
+  };
+
+  mutable CCriticalSection m_responses_cs;
+  mutable std::map<CommitsRange, CachedResponses> m_responses;
+  //! Cached ranges from the least to the most recently used.
+  mutable std::list<CommitsRange> m_responses_order;
+  //! Serialized size of all cached responses.
+  mutable size_t m_responses_size = 0;
+
+  std::shared_ptr<const CommitsResponses> FindCachedResponses(const CommitsRange &range) const;
+
+  void CacheResponses(const CommitsRange &range, std::shared_ptr<const CommitsResponses> responses) const;
 };
 
 }  // namespace p2p
@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include <blockencodings.h>
 #include <consensus/ltor.h>
 #include <p2p/graphene_hasher.h>
 #include <tinyformat.h>
@@ -15,54 +16,84 @@
 
 namespace p2p {
 
-boost::optional<GrapheneBlock> CreateGrapheneBlock(const CBlock &block,
-                                                   size_t sender_tx_count_wo_block,
-                                                   size_t receiver_tx_count,
-                                                   FastRandomContext &random) {
+namespace {
+
+// Default bloom filter implementation limits maximum size of a filter
+// and maximum hash functions. This is undesirable with graphene because it
+// ruins FPR guarantees. We accept bloom filters of any size/complexity unless
+// they allow us to create relatively small graphene blocks
+constexpr size_t GRAPHENE_MAX_FILTER_SIZE_BYTES = std::numeric_limits<size_t>::max();
+constexpr size_t GRAPHENE_MAX_HASH_FUNCS = std::numeric_limits<size_t>::max();
+
+// Size of the short transaction ids of compact blocks, see BIP 152
+constexpr size_t COMPACT_BLOCK_SHORT_ID_SIZE = 6;
+
+size_t GetIbltEntrySize() {
+  static const size_t iblt_entry_size =
+      GetSerializeSize(GrapheneIblt::IBLTEntry(), SER_NETWORK, PROTOCOL_VERSION);
+  return iblt_entry_size;
+}
+
+}  // namespace
+
+GrapheneBlockEncoder::GrapheneBlockEncoder(const CBlock &block)
+    : m_header(block.GetBlockHeader()),
+      m_block_hash(block.GetHash()) {
   assert(!block.vtx.empty());
 
   const CTransactionRef &coinbase = block.vtx[0];
   assert(coinbase->IsCoinBase());
 
-  FUNCTION_STOPWATCH();
-
-  std::vector<CTransactionRef> prefilled_transactions;
   // For now we prefill only coinbase. But in the future more sophisticated
   // prefill strategies are possible
-  prefilled_transactions.emplace_back(coinbase);
+  m_prefilled_transactions.emplace_back(coinbase);
+
+  m_full_hashes.reserve(block.vtx.size() - 1);
+  for (size_t i = 1; i < block.vtx.size(); ++i) {
+    m_full_hashes.emplace_back(block.vtx[i]->GetWitnessHash());
+  }
 
-  const size_t non_prefilled_count = block.vtx.size() - prefilled_transactions.size();
+  const size_t header_size = GetSerializeSize(m_header, SER_NETWORK, PROTOCOL_VERSION);
+  const size_t nonce_size = sizeof(uint64_t);
 
-  const GrapheneBlockParams params =
-      OptimizeGrapheneBlockParams(non_prefilled_count,
-                                  sender_tx_count_wo_block + non_prefilled_count,
-                                  receiver_tx_count);
+  m_fixed_size = header_size + nonce_size +
+                 GetSerializeSize(m_prefilled_transactions, SER_NETWORK, PROTOCOL_VERSION);
 
-  // Default bloom filter implementation limits maximum size of a filter
-  // and maximum hash functions. This is undesirable with graphene because it
-  // ruins FPR guarantees. We accept bloom filters of any size/complexity unless
-  // they allow us to create relatively small graphene blocks
-  const size_t max_filter_size_bytes = std::numeric_limits<size_t>::max();
-  const size_t max_hash_funcs = std::numeric_limits<size_t>::max();
+  const std::vector<PrefilledTransaction> cmpct_prefilled{{0, coinbase}};
+  m_compact_block_size = header_size + nonce_size +
+                         GetSizeOfCompactSize(m_full_hashes.size()) +
+                         m_full_hashes.size() * COMPACT_BLOCK_SHORT_ID_SIZE +
+                         GetSerializeSize(cmpct_prefilled, SER_NETWORK, PROTOCOL_VERSION);
+}
+
+GrapheneBlockParams GrapheneBlockEncoder::GetParams(const size_t sender_tx_count_wo_block,
+                                                    const size_t receiver_tx_count) const {
+  const size_t non_prefilled_count = m_full_hashes.size();
+  return OptimizeGrapheneBlockParams(non_prefilled_count,
+                                     sender_tx_count_wo_block + non_prefilled_count,
+                                     receiver_tx_count);
+}
+
+boost::optional<GrapheneBlock> GrapheneBlockEncoder::Encode(const GrapheneBlockParams &params,
+                                                            const uint64_t nonce,
+                                                            const uint32_t bloom_filter_tweak) const {
+  FUNCTION_STOPWATCH();
 
   CBloomFilter bloom_filter(params.bloom_entries_num, params.bloom_filter_fpr,
-                            random.rand32(), BLOOM_UPDATE_ALL, max_filter_size_bytes,
-                            max_hash_funcs);
+                            bloom_filter_tweak, BLOOM_UPDATE_ALL, GRAPHENE_MAX_FILTER_SIZE_BYTES,
+                            GRAPHENE_MAX_HASH_FUNCS);
 
   GrapheneIblt iblt(params.expected_symmetric_difference);
 
   std::unordered_set<GrapheneShortHash> short_hash_cache;
 
-  uint64_t nonce = random.rand64();
-  GrapheneHasher hasher(block, nonce);
+  const GrapheneHasher hasher(m_header, nonce);
 
-  for (size_t i = 1; i < block.vtx.size(); ++i) {
-    const CTransactionRef &tx = block.vtx[i];
-    const GrapheneFullHash full_hash = hasher.GetFullHash(*tx);
+  for (const GrapheneFullHash &full_hash : m_full_hashes) {
     const GrapheneShortHash short_hash = hasher.GetShortHash(full_hash);
 
     if (!short_hash_cache.emplace(short_hash).second) {
-      LogPrint(BCLog::NET, "Short hash collision in graphene block %s\n", block.GetHash().GetHex());
+      LogPrint(BCLog::NET, "Short hash collision in graphene block %s\n", m_block_hash.GetHex());
       return boost::none;
     }
 
@@ -70,11 +101,54 @@ boost::optional<GrapheneBlock> CreateGrapheneBlock(const CBlock &block,
     iblt.Insert(short_hash, {});
   }
 
-  return GrapheneBlock(block, nonce, std::move(bloom_filter), std::move(iblt), std::move(prefilled_transactions));
+  return GrapheneBlock(m_header, nonce, std::move(bloom_filter), std::move(iblt), m_prefilled_transactions);
+}
+
+size_t GrapheneBlockEncoder::EstimateGrapheneBlockSize(const GrapheneBlockParams &params) const {
+  // vData, nHashFuncs, nTweak and nFlags of CBloomFilter
+  const size_t bloom_data_size = std::min(CBloomFilter::ComputeEntriesSize(params.bloom_entries_num,
+                                                                           params.bloom_filter_fpr),
+                                          GRAPHENE_MAX_FILTER_SIZE_BYTES);
+  const size_t bloom_size = GetSizeOfCompactSize(bloom_data_size) + bloom_data_size +
+                            sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+  // Hash table and number of hashes of the IBLT. Every transaction is counted
+  // in num_hashes entries, the counts are compact sizes. They are estimated by
+  // the mean count, which is why the result is an estimate and not exact.
+  const IBLTParams iblt_params = IBLTParams::FindOptimal(params.expected_symmetric_difference);
+  const size_t iblt_entries = GrapheneIblt::ComputeNumberOfEntries(params.expected_symmetric_difference,
+                                                                   iblt_params);
+  const uint64_t mean_count = m_full_hashes.size() * iblt_params.num_hashes / iblt_entries;
+  const size_t iblt_entry_size = GetIbltEntrySize() - GetSizeOfCompactSize(0) +
+                                 GetSizeOfCompactSize(mean_count);
+  const size_t iblt_size = GetSizeOfCompactSize(iblt_entries) + iblt_entries * iblt_entry_size +
+                           sizeof(uint8_t);
+
+  return m_fixed_size + bloom_size + iblt_size;
+}
+
+size_t GrapheneBlockEncoder::GetCompactBlockSize() const {
+  return m_compact_block_size;
+}
+
+const uint256 &GrapheneBlockEncoder::GetBlockHash() const {
+  return m_block_hash;
+}
+
+boost::optional<GrapheneBlock> CreateGrapheneBlock(const CBlock &block,
+                                                   size_t sender_tx_count_wo_block,
+                                                   size_t receiver_tx_count,
+                                                   FastRandomContext &random) {
+  const GrapheneBlockEncoder encoder(block);
+  const uint32_t bloom_filter_tweak = random.rand32();
+  const uint64_t nonce = random.rand64();
+  return encoder.Encode(encoder.GetParams(sender_tx_count_wo_block, receiver_tx_count),
+                        nonce, bloom_filter_tweak);
 }
 
 GrapheneBlockReconstructor::GrapheneBlockReconstructor(const GrapheneBlock &graphene_block,
-                                                       const TxPool &tx_pool)
+                                                       const TxPool &tx_pool,
+                                                       const size_t max_threads)
     : m_header(graphene_block.header),
       m_prefilled_txs(graphene_block.prefilled_transactions),
       m_hasher(graphene_block.header, graphene_block.nonce) {
@@ -89,27 +163,39 @@ GrapheneBlockReconstructor::GrapheneBlockReconstructor(const GrapheneBlock &grap
   {
     SCOPE_STOPWATCH("Graphene tx pool enumeration");
 
-    const std::vector<CTransactionRef> txs = tx_pool.GetTxs();
-    for (const CTransactionRef &tx : txs) {
-      const GrapheneFullHash full_hash = m_hasher.GetFullHash(*tx);
-      const GrapheneShortHash short_hash = m_hasher.GetShortHash(full_hash);
-
+    // Hashing and bloom filter checks are done by every worker separately,
+    // only the transactions which pass the filter are collected.
+    const size_t workers = std::max<size_t>(1, max_threads);
+    std::vector<std::vector<std::pair<GrapheneShortHash, CTransactionRef>>> passed(workers);
+    tx_pool.ForEachTx(workers, [&](const size_t worker, const CTransactionRef &tx, const uint256 &witness_hash) {
+      const GrapheneFullHash full_hash(witness_hash);
       if (!graphene_block.bloom_filter.contains(full_hash)) {
-        continue;
+        return;
       }
+      passed[worker].emplace_back(m_hasher.GetShortHash(full_hash), tx);
+    });
 
-      const auto emplace_result = candidates.emplace(short_hash, tx);
-      if (!emplace_result.second) {
+    for (const auto &worker_passed : passed) {
+      for (const auto &entry : worker_passed) {
+        const GrapheneShortHash short_hash = entry.first;
+        const CTransactionRef &tx = entry.second;
 
-        const auto already_stored_hash = emplace_result.first->second->GetHash();
-        LogPrint(BCLog::NET, "Hash collision while reconstructing graphene block %s: %s and %s map to %d\n",
-                 graphene_block.header.GetHash().GetHex(), tx->GetHash().GetHex(), already_stored_hash.GetHex(), short_hash);
+        const auto emplace_result = candidates.emplace(short_hash, tx);
+        if (!emplace_result.second) {
 
-        hash_collision = true;
+          const auto already_stored_hash = emplace_result.first->second->GetHash();
+          LogPrint(BCLog::NET, "Hash collision while reconstructing graphene block %s: %s and %s map to %d\n",
+                   graphene_block.header.GetHash().GetHex(), tx->GetHash().GetHex(), already_stored_hash.GetHex(), short_hash);
+
+          hash_collision = true;
+          break;
+        }
+        receiver_iblt.Insert(short_hash, {});
+      }
+      if (hash_collision) {
         break;
       }
-      receiver_iblt.Insert(short_hash, {});
-    };
+    }
   }
 
   if (hash_collision) {
@@ -231,8 +317,7 @@ static size_t BruteForceSymDif(const size_t all_receiver_txs,
   size_t min_achieved_size = std::numeric_limits<size_t>::max();
   size_t best_sym_diff = 2;
 
-  static const size_t iblt_entry_size =
-      GetSerializeSize(GrapheneIblt::IBLTEntry(), SER_NETWORK, PROTOCOL_VERSION);
+  const size_t iblt_entry_size = GetIbltEntrySize();
 
   for (size_t sym_diff = best_sym_diff; sym_diff <= all_receiver_txs; ++sym_diff) {
     const double fpr = ComputeFpr(sym_diff, receiver_excess);
@@ -291,6 +376,14 @@ GrapheneBlockParams OptimizeGrapheneBlockParams(const size_t block_txs,
   return GrapheneBlockParams(sym_diff, bloom_entries, fpr);
 }
 
+uint64_t GetTxPoolSizeBucket(const uint64_t tx_pool_count) {
+  uint64_t step = 1;
+  while (step * 32 <= tx_pool_count) {
+    step *= 2;
+  }
+  return (tx_pool_count + step - 1) / step * step;
+}
+
 GrapheneBlockParams::GrapheneBlockParams(
     const size_t expected_symmetric_difference,
     const size_t bloom_entries_num,
@@ -35,7 +35,11 @@ BETTER_ENUM(
 
 class GrapheneBlockReconstructor {
  public:
-  GrapheneBlockReconstructor(const GrapheneBlock &graphene_block, const TxPool &tx_pool);
+  //! \brief Reconstructs the block from the transactions in tx_pool.
+  //!
+  //! The pool is scanned by up to max_threads threads.
+  GrapheneBlockReconstructor(const GrapheneBlock &graphene_block, const TxPool &tx_pool,
+                             size_t max_threads = 1);
 
   void AddMissingTxs(const std::vector<CTransactionRef> &txs);
 
@@ -70,6 +74,54 @@ GrapheneBlockParams OptimizeGrapheneBlockParams(size_t block_txs,
                                                 size_t all_sender_txs,
                                                 size_t all_receiver_txs);
 
+//! \brief Rounds the size of a tx pool up to one of 16 buckets per power of two.
+//!
+//! Encodings of a block are shared by the peers whose tx pool sizes fall in
+//! the same bucket. Graphene block parameters are optimized for the upper
+//! bound of the bucket, which overestimates a tx pool by at most 1/16.
+uint64_t GetTxPoolSizeBucket(uint64_t tx_pool_count);
+
+//! \brief The part of the graphene encoding of a block which doesn't depend
+//! on the receiver.
+//!
+//! It is computed once per block and shared by the encodings for all the
+//! peers the block is sent to. All the methods are const and can be called
+//! from several threads at once.
+class GrapheneBlockEncoder {
+ public:
+  explicit GrapheneBlockEncoder(const CBlock &block);
+
+  GrapheneBlockParams GetParams(size_t sender_tx_count_wo_block,
+                                size_t receiver_tx_count) const;
+
+  //! \brief Encodes the block, returns none on a short hash collision.
+  boost::optional<GrapheneBlock> Encode(const GrapheneBlockParams &params,
+                                        uint64_t nonce,
+                                        uint32_t bloom_filter_tweak) const;
+
+  //! \brief Estimates the serialized size of the graphene block which Encode
+  //! creates with the given params, without creating it.
+  //!
+  //! The estimate is off by at most two bytes per IBLT entry.
+  size_t EstimateGrapheneBlockSize(const GrapheneBlockParams &params) const;
+
+  //! \brief Returns the serialized size of the compact block (BIP 152) of the
+  //! block, as CBlockHeaderAndShortTxIDs prefills the coinbase only.
+  size_t GetCompactBlockSize() const;
+
+  const uint256 &GetBlockHash() const;
+
+ private:
+  CBlockHeader m_header;
+  uint256 m_block_hash;
+  std::vector<CTransactionRef> m_prefilled_transactions;
+  // Full hashes of the transactions which are not prefilled
+  std::vector<GrapheneFullHash> m_full_hashes;
+  // Size of the header, the nonce and the prefilled transactions
+  size_t m_fixed_size = 0;
+  size_t m_compact_block_size = 0;
+};
+
 }  // namespace p2p
 
 #endif  //UNITE_P2P_GRAPHENE_H
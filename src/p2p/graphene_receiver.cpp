@@ -165,7 +165,7 @@ void GrapheneReceiverImpl::OnGrapheneBlockReceived(CNode &from,
     LogPrint(BCLog::NET, "Received graphene block %s from peer %d\n",
              block_hash.GetHex(), from.GetId());
 
-    reconstructor = MakeUnique<GrapheneBlockReconstructor>(graphene_block, *m_txpool);
+    reconstructor = MakeUnique<GrapheneBlockReconstructor>(graphene_block, *m_txpool, GetNumCores());
 
     const GrapheneDecodeState reconstructor_state = reconstructor->GetState();
 
@@ -4,7 +4,6 @@
 
 #include <p2p/graphene_sender.h>
 
-#include <blockencodings.h>
 #include <chainparams.h>
 #include <net_processing.h>
 #include <p2p/graphene.h>
@@ -12,6 +11,11 @@
 #include <util/scope_stopwatch.h>
 #include <validation.h>
 
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+
 namespace p2p {
 namespace {
 
@@ -30,6 +34,9 @@ class DisabledGrapheneSender : public GrapheneSender {
   void OnDisconnected(NodeId node) override {}
 };
 
+//! How many recently sent blocks keep their encodings
+constexpr size_t MAX_ENCODED_BLOCKS = 4;
+
 class GrapheneSenderImpl : public GrapheneSender {
  public:
   explicit GrapheneSenderImpl(Dependency<::TxPool> tx_pool);
@@ -48,12 +55,81 @@ class GrapheneSenderImpl : public GrapheneSender {
     uint64_t last_nonce = 0;
   };
 
+  //! \brief The graphene encodings of a block, shared by all the peers it
+  //! is sent to.
+  class BlockEncodings {
+   public:
+    explicit BlockEncodings(const CBlock &block) : m_encoder(block) {}
+
+    const uint256 &GetBlockHash() const { return m_encoder.GetBlockHash(); }
+
+    //! \brief Returns the encoding for the given tx pool sizes, it is none if
+    //! the graphene block can't be created or is not smaller than the compact
+    //! block. The encoding is created with nonce and bloom_filter_tweak unless
+    //! it exists already.
+    const boost::optional<GrapheneBlock> &Get(uint64_t sender_tx_count_wo_block,
+                                              uint64_t receiver_tx_count,
+                                              uint64_t nonce,
+                                              uint32_t bloom_filter_tweak);
+
+   private:
+    const GrapheneBlockEncoder m_encoder;
+
+    CCriticalSection m_cs;
+    // By the buckets of the sender and the receiver tx pool sizes. Entries are
+    // never erased, so references to them stay valid without the lock.
+    std::map<std::pair<uint64_t, uint64_t>, boost::optional<GrapheneBlock>> m_encodings;
+  };
+
+  std::shared_ptr<BlockEncodings> GetBlockEncodings(const CBlock &block);
+
   CCriticalSection m_cs;
   std::unordered_map<NodeId, ReceiverInfo> m_receiver_infos;
+  // The most recently sent blocks, the newest one is the last
+  std::deque<std::shared_ptr<BlockEncodings>> m_block_encodings;
   Dependency<TxPool> m_sender_tx_pool;
   FastRandomContext m_random;
 };
 
+const boost::optional<GrapheneBlock> &GrapheneSenderImpl::BlockEncodings::Get(
+    const uint64_t sender_tx_count_wo_block,
+    const uint64_t receiver_tx_count,
+    const uint64_t nonce,
+    const uint32_t bloom_filter_tweak) {
+
+  const std::pair<uint64_t, uint64_t> key(GetTxPoolSizeBucket(sender_tx_count_wo_block),
+                                          GetTxPoolSizeBucket(receiver_tx_count));
+  {
+    LOCK(m_cs);
+    const auto it = m_encodings.find(key);
+    if (it != m_encodings.end()) {
+      return it->second;
+    }
+  }
+
+  // Encode without holding the lock, so that peers in other buckets don't
+  // wait. If two peers race for the same bucket, the first encoding wins.
+  boost::optional<GrapheneBlock> graphene_block;
+
+  const GrapheneBlockParams params = m_encoder.GetParams(key.first, key.second);
+  const size_t graphene_block_size = m_encoder.EstimateGrapheneBlockSize(params);
+  const size_t cmpct_block_size = m_encoder.GetCompactBlockSize();
+
+  // We assume that ALL unit-e nodes support compact blocks and all compact
+  // blocks are smaller than legacy blocks
+  if (graphene_block_size < cmpct_block_size) {
+    // Graphene block might not be constructed if we think it is improbable for
+    // receiver to decode it, for example
+    graphene_block = m_encoder.Encode(params, nonce, bloom_filter_tweak);
+  } else {
+    LogPrint(BCLog::NET, "Graphene block %s is bigger than compact block (%d vs %d bytes)\n",
+             GetBlockHash().GetHex(), graphene_block_size, cmpct_block_size);
+  }
+
+  LOCK(m_cs);
+  return m_encodings.emplace(key, std::move(graphene_block)).first->second;
+}
+
 GrapheneSenderImpl::GrapheneSenderImpl(Dependency<::TxPool> tx_pool)
     : m_sender_tx_pool(tx_pool),
       m_random(false) {
@@ -65,73 +141,102 @@ void GrapheneSenderImpl::UpdateRequesterTxPoolCount(const CNode &requester,
   m_receiver_infos[requester.GetId()].tx_pool_count = new_count;
 }
 
-bool GrapheneSenderImpl::SendBlock(CNode &to, const CBlock &block, const CBlockIndex &index) {
-  if (block.vtx.size() < MIN_TRANSACTIONS_IN_GRAPHENE_BLOCK) {
-    return false;
+std::shared_ptr<GrapheneSenderImpl::BlockEncodings> GrapheneSenderImpl::GetBlockEncodings(const CBlock &block) {
+  const uint256 block_hash = block.GetHash();
+  const auto find = [this, &block_hash]() -> std::shared_ptr<BlockEncodings> {
+    AssertLockHeld(m_cs);
+    for (const std::shared_ptr<BlockEncodings> &encodings : m_block_encodings) {
+      if (encodings->GetBlockHash() == block_hash) {
+        return encodings;
+      }
+    }
+    return nullptr;
+  };
+
+  {
+    LOCK(m_cs);
+    std::shared_ptr<BlockEncodings> encodings = find();
+    if (encodings) {
+      return encodings;
+    }
   }
 
-  LOCK(m_cs);
+  // Hashing the transactions of the block is done once, without the lock
+  auto encodings = std::make_shared<BlockEncodings>(block);
 
-  const auto it = m_receiver_infos.find(to.GetId());
+  LOCK(m_cs);
+  std::shared_ptr<BlockEncodings> existing = find();
+  if (existing) {
+    return existing;
+  }
+  m_block_encodings.emplace_back(encodings);
+  if (m_block_encodings.size() > MAX_ENCODED_BLOCKS) {
+    m_block_encodings.pop_front();
+  }
+  return encodings;
+}
 
-  assert(it != m_receiver_infos.end());
+bool GrapheneSenderImpl::SendBlock(CNode &to, const CBlock &block, const CBlockIndex &index) {
+  if (block.vtx.size() < MIN_TRANSACTIONS_IN_GRAPHENE_BLOCK) {
+    return false;
+  }
 
-  ReceiverInfo &receiver_info = it->second;
+  uint64_t receiver_tx_pool_count;
+  uint64_t nonce;
+  uint32_t bloom_filter_tweak;
 
-  if (index.nHeight <= receiver_info.last_requested_height) {
-    // Graphene block is more expensive to construct than usual block or
-    // compact block, and unlike compact blocks - you can not cache graphene
-    // blocks effectively
+  {
+    LOCK(m_cs);
 
-    LogPrint(BCLog::NET, "Peer %d requested too old graphene block\n", to.GetId());
-    return false;
-  }
+    const auto it = m_receiver_infos.find(to.GetId());
 
-  receiver_info.last_requested_height = index.nHeight;
-  receiver_info.last_requested_hash = block.GetHash();
-  receiver_info.requested_tx = false;
+    assert(it != m_receiver_infos.end());
 
-  LogPrint(BCLog::NET, "Constructing graphene block %s for peer %d, txpool size %d\n",
-           block.GetHash().GetHex(), to.GetId(), receiver_info.tx_pool_count);
-
-  // Graphene block might not be constructed if we think it is improbable for
-  // receiver to decode it, for example
-  auto maybe_graphene_block = CreateGrapheneBlock(block,
-                                                  m_sender_tx_pool->GetTxCount(),
-                                                  receiver_info.tx_pool_count,
-                                                  m_random);
-  if (!maybe_graphene_block) {
-    return false;
-  }
+    ReceiverInfo &receiver_info = it->second;
 
-  GrapheneBlock &graphene_block = maybe_graphene_block.get();
+    if (index.nHeight <= receiver_info.last_requested_height) {
+      // Graphene block is more expensive to construct than usual block or
+      // compact block, so we don't send the same or older blocks again
 
-  receiver_info.last_nonce = graphene_block.nonce;
+      LogPrint(BCLog::NET, "Peer %d requested too old graphene block\n", to.GetId());
+      return false;
+    }
 
-  {
-    SCOPE_STOPWATCH("Compare graphene and compact block sizes");
+    receiver_info.last_requested_height = index.nHeight;
+    receiver_info.last_requested_hash = block.GetHash();
+    receiver_info.requested_tx = false;
+    receiver_tx_pool_count = receiver_info.tx_pool_count;
 
-    const size_t graphene_block_size = GetSerializeSize(graphene_block, SER_NETWORK, PROTOCOL_VERSION);
+    // Only used if the block was not encoded for a peer with a similar tx pool
+    nonce = m_random.rand64();
+    bloom_filter_tweak = m_random.rand32();
+  }
 
-    // This can be optimized if one day we notice performance problems here
+  LogPrint(BCLog::NET, "Constructing graphene block %s for peer %d, txpool size %d\n",
+           block.GetHash().GetHex(), to.GetId(), receiver_tx_pool_count);
 
-    // We assume that ALL unit-e nodes support compact blocks and all compact
-    // blocks are smaller than legacy blocks
-    CBlockHeaderAndShortTxIDs cmpct_block(block);
-    const size_t cmpct_block_size = GetSerializeSize(cmpct_block, SER_NETWORK, PROTOCOL_VERSION);
+  const std::shared_ptr<BlockEncodings> encodings = GetBlockEncodings(block);
+  const boost::optional<GrapheneBlock> &graphene_block =
+      encodings->Get(m_sender_tx_pool->GetTxCount(), receiver_tx_pool_count, nonce, bloom_filter_tweak);
 
-    if (graphene_block_size >= cmpct_block_size) {
-      LogPrint(BCLog::NET, "Graphene block %s is bigger than compact block (%d vs %d bytes)\n",
-               block.GetHash().GetHex(), graphene_block_size, cmpct_block_size);
+  if (!graphene_block) {
+    return false;
+  }
 
+  {
+    LOCK(m_cs);
+    const auto it = m_receiver_infos.find(to.GetId());
+    if (it == m_receiver_infos.end() || it->second.last_requested_hash != block.GetHash()) {
+      // The peer disconnected or requested another block meanwhile
       return false;
     }
+    it->second.last_nonce = graphene_block->nonce;
   }
 
   LogPrint(BCLog::NET, "Sending graphene block %s to peer %d\n",
            block.GetHash().GetHex(), to.GetId());
 
-  PushMessage(to, NetMsgType::GRAPHENEBLOCK, std::move(graphene_block));
+  PushMessage(to, NetMsgType::GRAPHENEBLOCK, *graphene_block);
   return true;
 }
 
@@ -4,23 +4,40 @@
 
 #include <proposer/proposer_logic.h>
 
+#include <settings.h>
+#include <staking/kernel_search.h>
+#include <util.h>
+
+#include <algorithm>
+
 namespace proposer {
 
 class LogicImpl final : public Logic {
 
  private:
+  const Dependency<Settings> m_settings;
   const Dependency<blockchain::Behavior> m_blockchain_behavior;
   const Dependency<staking::Network> m_network;
   const Dependency<staking::ActiveChain> m_active_chain;
   const Dependency<staking::StakeValidator> m_stake_validator;
 
+ private:
+  std::size_t GetSearchThreads() const {
+    if (m_settings->proposer_threads > 0) {
+      return m_settings->proposer_threads;
+    }
+    return static_cast<std::size_t>(std::max(GetNumCores(), 1));
+  }
+
  public:
   LogicImpl(
+      const Dependency<Settings> settings,
       const Dependency<blockchain::Behavior> blockchain_behavior,
       const Dependency<staking::Network> network,
       const Dependency<staking::ActiveChain> active_chain,
       const Dependency<staking::StakeValidator> stake_validator)
-      : m_blockchain_behavior(blockchain_behavior),
+      : m_settings(settings),
+        m_blockchain_behavior(blockchain_behavior),
         m_network(network),
         m_active_chain(active_chain),
         m_stake_validator(stake_validator) {}
@@ -58,29 +75,36 @@ class LogicImpl final : public Logic {
     const blockchain::Difficulty target_difficulty =
         m_blockchain_behavior->CalculateDifficulty(target_height, *m_active_chain);
 
-    for (const staking::Coin &coin : eligible_coins) {
-      const uint256 kernel_hash = m_stake_validator->ComputeKernelHash(current_tip, coin, target_time);
-      if (m_stake_validator->CheckKernel(coin.GetAmount(), kernel_hash, target_difficulty)) {
-        const CAmount reward = m_blockchain_behavior->CalculateBlockReward(
-            target_height);
-        return {{coin,
-                 kernel_hash,
-                 reward,
-                 target_height,
-                 target_time,
-                 target_difficulty}};
-      }
+    // The coins are evaluated concurrently but the winner is always the first
+    // eligible coin in the order of the coin set, like in the sketch above.
+    const boost::optional<staking::KernelSearchResult> found = staking::FindKernel(
+        eligible_coins,
+        m_stake_validator->GetKernelHasher(current_tip, target_time),
+        [this, target_difficulty](const staking::Coin &coin, const uint256 &kernel_hash) {
+          return m_stake_validator->CheckKernel(coin.GetAmount(), kernel_hash, target_difficulty);
+        },
+        GetSearchThreads());
+    if (found) {
+      const CAmount reward = m_blockchain_behavior->CalculateBlockReward(
+          target_height);
+      return {{*found->coin,
+               found->kernel_hash,
+               reward,
+               target_height,
+               target_time,
+               target_difficulty}};
     }
     return boost::none;
   }
 };
 
 std::unique_ptr<Logic> Logic::New(
+    const Dependency<Settings> settings,
     const Dependency<blockchain::Behavior> blockchain_behavior,
     const Dependency<staking::Network> network,
     const Dependency<staking::ActiveChain> active_chain,
     const Dependency<staking::StakeValidator> stake_validator) {
-  return std::unique_ptr<Logic>(new LogicImpl(blockchain_behavior, network, active_chain, stake_validator));
+  return std::unique_ptr<Logic>(new LogicImpl(settings, blockchain_behavior, network, active_chain, stake_validator));
 }
 
 }  // namespace proposer
@@ -18,6 +18,8 @@
 
 #include <memory>
 
+struct Settings;
+
 namespace proposer {
 
 class Logic {
@@ -35,6 +37,7 @@ class Logic {
   virtual ~Logic() = default;
 
   static std::unique_ptr<Logic> New(
+      Dependency<Settings>,
       Dependency<blockchain::Behavior>,
       Dependency<staking::Network>,
       Dependency<staking::ActiveChain>,
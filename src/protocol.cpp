@@ -43,6 +43,9 @@ const char *GETSNAPSHOTHEADER="getsnaphead";
 const char *SNAPSHOTHEADER="snaphead";
 const char *GETSNAPSHOT="getsnapshot";
 const char *SNAPSHOT="snapshot";
+const char *COMPRESSED_SNAPSHOT="cmpsnapshot";
+const char *GETCHUNKHASHES="getchunkhash"; // Message lengths are limited to 12 chars
+const char *CHUNKHASHES="chunkhashes";
 const char *GETCOMMITS="getcommits";
 const char *COMMITS="commits";
 const char *GETGRAPHENE="getgraphene";
@@ -85,6 +88,9 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::SNAPSHOTHEADER,
     NetMsgType::GETSNAPSHOT,
     NetMsgType::SNAPSHOT,
+    NetMsgType::COMPRESSED_SNAPSHOT,
+    NetMsgType::GETCHUNKHASHES,
+    NetMsgType::CHUNKHASHES,
     NetMsgType::GETCOMMITS,
     NetMsgType::COMMITS,
     NetMsgType::GETGRAPHENE,
@@ -252,7 +252,7 @@ extern const char *SNAPSHOTHEADER;
 
 /**
  * Contains the snapshot::GetSnapshot message.
- * Peer should respond with the "snapshot" message.
+ * Peer should respond with the "snapshot" or "cmpsnapshot" message.
  */
 extern const char *GETSNAPSHOT;
 
@@ -261,6 +261,25 @@ extern const char *GETSNAPSHOT;
  * Sent in response to a "getsnapshot" message.
  */
 extern const char *SNAPSHOT;
+
+/**
+ * Contains the snapshot::Snapshot object in snapshot::SnapshotCompressor
+ * Sent in response to a "getsnapshot" message which asks for
+ * snapshot::SNAPSHOT_FORMAT_COMPRESSED.
+ */
+extern const char *COMPRESSED_SNAPSHOT;
+
+/**
+ * Contains the snapshot::GetChunkHashes message.
+ * Peer should respond with the "chunkhashes" message.
+ */
+extern const char *GETCHUNKHASHES;
+
+/**
+ * Contains the snapshot::ChunkHashes message.
+ * Sent in response to a "getchunkhash" message.
+ */
+extern const char *CHUNKHASHES;
 /**
  * Contains a getcommits request as described in UIP-21.
  * Peer should respond with the "commits" message.
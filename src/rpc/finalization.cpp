@@ -8,6 +8,7 @@
 #include <rpc/safemode.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <script/sigcache.h>
 #include <ufp64.h>
 #include <util.h>
 #include <utilstrencodings.h>
@@ -33,9 +34,8 @@ UniValue getfinalizationstate(const JSONRPCRequest &request) {
 
   ObserveSafeMode();
 
-  LOCK(GetComponent<finalization::StateRepository>()->GetLock());
-  const finalization::FinalizationState *fin_state =
-      GetComponent<finalization::StateRepository>()->GetTipState();
+  const std::shared_ptr<const finalization::FinalizationState> fin_state =
+      GetComponent<finalization::StateRepository>()->GetTipSnapshot();
   assert(fin_state != nullptr);
 
   UniValue obj(UniValue::VOBJ);
@@ -44,7 +44,7 @@ UniValue getfinalizationstate(const JSONRPCRequest &request) {
   obj.pushKV("currentEpoch", ToUniValue(fin_state->GetCurrentEpoch()));
   obj.pushKV("lastJustifiedEpoch", ToUniValue(fin_state->GetLastJustifiedEpoch()));
   obj.pushKV("lastFinalizedEpoch", ToUniValue(fin_state->GetLastFinalizedEpoch()));
-  obj.pushKV("validators", static_cast<std::uint64_t>(fin_state->GetActiveFinalizers().size()));
+  obj.pushKV("validators", static_cast<std::uint64_t>(fin_state->GetActiveFinalizersCount()));
 
   return obj;
 }
@@ -86,12 +86,37 @@ UniValue getfinalizationconfig(const JSONRPCRequest &request) {
   return obj;
 }
 
+UniValue getvotesignaturecacheinfo(const JSONRPCRequest &request) {
+  if (request.fHelp || !request.params.empty()) {
+    throw std::runtime_error(
+        "getvotesignaturecacheinfo\n"
+        "Returns the counters of the cache of the verified vote signatures."
+        "\nResult:\n"
+        "{\n"
+        "  \"hits\": xxxxxxx        (numeric) checks of votes whose signature was verified before\n"
+        "  \"misses\": xxxxxxx      (numeric) checks which verified the signature\n"
+        "}\n"
+        "\nExamples:\n" +
+        HelpExampleCli("getvotesignaturecacheinfo", "") +
+        HelpExampleRpc("getvotesignaturecacheinfo", ""));
+  }
+
+  const VoteSignatureCacheStats stats = GetVoteSignatureCacheStats();
+  UniValue obj(UniValue::VOBJ);
+
+  obj.pushKV("hits", stats.hits);
+  obj.pushKV("misses", stats.misses);
+
+  return obj;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category        name                      actor (function)            argNames
   //  --------        -------------------       ----------------            ----------
     { "finalization",  "getfinalizationstate",   &getfinalizationstate,       {}          },
     { "finalization",  "getfinalizationconfig",  &getfinalizationconfig,      {}          },
+    { "finalization",  "getvotesignaturecacheinfo", &getvotesignaturecacheinfo, {}          },
 };
 // clang-format on
 
@@ -451,7 +451,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 
                             // Check vote signature
                             CPubKey pubkey(vchPubKey);
-                            if (!pubkey.Verify(vote.GetHash(), voteSig)) {
+                            if (!checker.CheckVoteSig(voteSig, pubkey, vote)) {
                                 return set_error(serror, SCRIPT_ERR_INVALID_VOTE_SIG);
                             }
 
@@ -541,12 +541,12 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 
                             // Check vote1 signature
                             CPubKey pubkey(vchPubKey);
-                            if (!pubkey.Verify(vote1.GetHash(), voteSig1)) {
+                            if (!checker.CheckVoteSig(voteSig1, pubkey, vote1)) {
                                 return set_error(serror, SCRIPT_ERR_INVALID_VOTE_SIG);
                             }
 
                             // Check vote2 signature
-                            if (!pubkey.Verify(vote2.GetHash(), voteSig2)) {
+                            if (!checker.CheckVoteSig(voteSig2, pubkey, vote2)) {
                                 return set_error(serror, SCRIPT_ERR_INVALID_VOTE_SIG);
                             }
 
@@ -1430,6 +1430,11 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     return ss.GetHash();
 }
 
+bool BaseSignatureChecker::CheckVoteSig(const std::vector<unsigned char>& vchVoteSig, const CPubKey& pubkey, const esperanza::Vote& vote) const
+{
+    return pubkey.Verify(vote.GetHash(), vchVoteSig);
+}
+
 bool TransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     return pubkey.Verify(sighash, vchSig);
@@ -18,6 +18,10 @@ class CScript;
 class CTransaction;
 class uint256;
 
+namespace esperanza {
+class Vote;
+}
+
 /** Signature hash types/flags */
 enum
 {
@@ -157,6 +161,9 @@ public:
         return TxType::REGULAR;
     }
 
+    /** Checks the signature of the vote which is committed by OP_CHECKCOMMIT */
+    virtual bool CheckVoteSig(const std::vector<unsigned char>& vchVoteSig, const CPubKey& pubkey, const esperanza::Vote& vote) const;
+
     virtual ~BaseSignatureChecker() {}
 };
 
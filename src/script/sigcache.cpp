@@ -12,8 +12,11 @@
 #include <util.h>
 
 #include <cuckoocache.h>
+#include <esperanza/vote.h>
 #include <boost/thread.hpp>
 
+#include <atomic>
+
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
@@ -66,6 +69,14 @@ public:
  * signatureCache could be made local to VerifySignature.
 */
 static CSignatureCache signatureCache;
+
+/**
+ * Valid vote signatures. Entries are computed as by signatureCache with the
+ * vote hash as the signature hash.
+ */
+static CSignatureCache voteSignatureCache;
+static std::atomic<uint64_t> voteSignatureCacheHits(0);
+static std::atomic<uint64_t> voteSignatureCacheMisses(0);
 } // namespace
 
 // To be called once in AppInitMain/BasicTestingSetup to initialize the
@@ -78,6 +89,10 @@ void InitSignatureCache()
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
     LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+
+    const size_t nVoteElems = voteSignatureCache.setup_bytes(VOTE_SIG_CACHE_BYTES);
+    LogPrintf("Using %zu MiB for vote signature cache, able to store %zu elements\n",
+            (nVoteElems*sizeof(uint256)) >>20, nVoteElems);
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -92,3 +107,38 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
         signatureCache.Set(entry);
     return true;
 }
+
+bool CachingTransactionSignatureChecker::CheckVoteSig(const std::vector<unsigned char>& vchVoteSig, const CPubKey& pubkey, const esperanza::Vote& vote) const
+{
+    return CachingCheckVoteSignature(pubkey, vote, vchVoteSig);
+}
+
+bool CachingCheckVoteSignature(const CPubKey& pubkey, const esperanza::Vote& vote, const std::vector<unsigned char>& vote_sig)
+{
+    // An empty signature can't be hashed into the entry and is never valid
+    if (vote_sig.empty() || !pubkey.IsValid()) {
+        return false;
+    }
+
+    const uint256 vote_hash = vote.GetHash();
+    uint256 entry;
+    voteSignatureCache.ComputeEntry(entry, vote_hash, vote_sig, pubkey);
+    if (voteSignatureCache.Get(entry, /* erase= */ false)) {
+        ++voteSignatureCacheHits;
+        return true;
+    }
+    ++voteSignatureCacheMisses;
+    if (!pubkey.Verify(vote_hash, vote_sig)) {
+        return false;
+    }
+    voteSignatureCache.Set(entry);
+    return true;
+}
+
+VoteSignatureCacheStats GetVoteSignatureCacheStats()
+{
+    VoteSignatureCacheStats stats;
+    stats.hits = voteSignatureCacheHits;
+    stats.misses = voteSignatureCacheMisses;
+    return stats;
+}
@@ -16,9 +16,15 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Size of the vote signature cache in bytes, it keeps 32768 votes
+static const size_t VOTE_SIG_CACHE_BYTES = 1 << 20;
 
 class CPubKey;
 
+namespace esperanza {
+class Vote;
+}
+
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
  * blinding in the set hash computation.
@@ -49,8 +55,27 @@ public:
     CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+    bool CheckVoteSig(const std::vector<unsigned char>& vchVoteSig, const CPubKey& pubkey, const esperanza::Vote& vote) const override;
 };
 
 void InitSignatureCache();
 
+/**
+ * Checks the signature of the vote and caches it if it's valid. The same vote
+ * is checked when it enters the mempool, when it's included into a block and
+ * when the block is connected or its commits are synced, only the first check
+ * verifies the signature.
+ */
+bool CachingCheckVoteSignature(const CPubKey& pubkey, const esperanza::Vote& vote, const std::vector<unsigned char>& vote_sig);
+
+struct VoteSignatureCacheStats
+{
+    //! checks of the signatures which were in the cache
+    uint64_t hits = 0;
+    //! checks which had to verify the signature
+    uint64_t misses = 0;
+};
+
+VoteSignatureCacheStats GetVoteSignatureCacheStats();
+
 #endif // UNITE_SCRIPT_SIGCACHE_H
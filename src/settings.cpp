@@ -7,6 +7,8 @@
 #include <base58.h>
 #include <dependency.h>
 
+#include <algorithm>
+
 std::unique_ptr<Settings> Settings::New(
     Dependency<::ArgsManager> args,
     Dependency<blockchain::Behavior> blockchain_behavior) {
@@ -25,6 +27,9 @@ std::unique_ptr<Settings> Settings::New(
   settings->stake_split_threshold =
       args->GetArg("-stakesplitthreshold", settings->stake_split_threshold);
 
+  settings->proposer_threads = static_cast<std::uint32_t>(std::max<int64_t>(
+      args->GetArg("-proposerthreads", settings->proposer_threads), 0));
+
   const std::string reward_address = args->GetArg("-rewardaddress", "");
   if (!reward_address.empty()) {
     CTxDestination reward_dest = DecodeDestination(reward_address);
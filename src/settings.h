@@ -40,6 +40,12 @@ struct Settings {
   //! require solving the Knapsack problem otherwise).
   CAmount stake_combine_maximum = 0;
 
+  //! \brief Number of threads to search the stakeable coins for an eligible one.
+  //!
+  //! 0 means to use as many threads as there are cores. Small wallets are
+  //! always searched on the proposer thread alone.
+  std::uint32_t proposer_threads = 0;
+
   std::uint16_t p2p_port = 7182;
 
   //! \brief Path to the base data dir (e.g. ~user/.unit-e).
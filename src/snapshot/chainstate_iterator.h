@@ -22,6 +22,7 @@ class ChainstateIterator {
   bool Valid();
   void Next();
   const UTXOSubset &GetUTXOSubset() const { return m_utxo_subset; }
+  UTXOSubset &GetUTXOSubset() { return m_utxo_subset; }
   const uint256 &GetBestBlock() const { return m_cursor->GetBestBlock(); }
   const SnapshotHash &GetSnapshotHash() const {
     return m_cursor->GetSnapshotHash();
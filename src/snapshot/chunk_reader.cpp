@@ -0,0 +1,247 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/chunk_reader.h>
+
+#include <serialize.h>
+#include <snapshot/compression.h>
+#include <util.h>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+#include <algorithm>
+#include <ios>
+#include <iterator>
+
+namespace snapshot {
+
+namespace {
+
+//! Minimal stream over the mapped file
+class MemoryReader {
+ public:
+  MemoryReader(const char *data, const size_t size) : m_data(data), m_size(size) {}
+
+  template <typename T>
+  MemoryReader &operator>>(T &obj) {
+    ::Unserialize(*this, obj);
+    return *this;
+  }
+
+  void read(char *pch, const size_t size) {
+    ignore(size);
+    std::copy(m_data + m_pos - size, m_data + m_pos, pch);
+  }
+
+  void ignore(const size_t size) {
+    if (size > m_size - m_pos) {
+      throw std::ios_base::failure("MemoryReader::ignore(): end of data");
+    }
+    m_pos += size;
+  }
+
+  size_t GetPos() const { return m_pos; }
+
+ private:
+  const char *const m_data;
+  const size_t m_size;
+  size_t m_pos = 0;
+};
+
+//! \brief Finds where the serialized subsets start without deserializing them
+//!
+//! See UTXOSubset for the serialization.
+void ScanSubsets(MemoryReader &reader, const uint64_t count, std::vector<uint32_t> &offsets_out,
+                 std::vector<uint32_t> &subsets_out) {
+  offsets_out.clear();
+  offsets_out.reserve(count + 1);
+  offsets_out.emplace_back(0);
+  for (uint64_t i = 0; i < count; ++i) {
+    reader.ignore(32 + 4 + 1);  // tx_id, height, tx_type
+    const uint64_t outputs = ReadCompactSize(reader);
+    for (uint64_t n = 0; n < outputs; ++n) {
+      reader.ignore(4 + 8);  // index, nValue
+      reader.ignore(ReadCompactSize(reader));
+    }
+    offsets_out.emplace_back(static_cast<uint32_t>(reader.GetPos()));
+  }
+
+  subsets_out.resize(count + 1);
+  for (uint32_t i = 0; i <= count; ++i) {
+    subsets_out[i] = i;
+  }
+}
+
+//! \brief Finds where the compressed blocks start without decoding them
+void ScanBlocks(MemoryReader &reader, const uint64_t count, std::vector<uint32_t> &offsets_out,
+                std::vector<uint32_t> &subsets_out) {
+  offsets_out.assign(1, 0);
+  subsets_out.assign(1, 0);
+  while (subsets_out.back() < count) {
+    const uint64_t subsets = subsets_out.back() + SkipCompressedBlock(reader);
+    if (subsets > count) {
+      throw std::ios_base::failure("ScanBlocks(): more subsets than expected");
+    }
+    offsets_out.emplace_back(static_cast<uint32_t>(reader.GetPos()));
+    subsets_out.emplace_back(static_cast<uint32_t>(subsets));
+  }
+}
+
+}  // namespace
+
+ChunkReader::ChunkReader(std::unique_ptr<Indexer> indexer)
+    : m_indexer(std::move(indexer)),
+      m_buffer(SER_NETWORK, PROTOCOL_VERSION) {}
+
+bool ChunkReader::ReadChunk(const uint64_t index, const uint16_t count,
+                            const uint8_t format, SerializedSnapshot &msg_out) {
+  const uint64_t total = m_indexer->GetSnapshotHeader().total_utxo_subsets;
+  if (index >= total) {
+    return false;
+  }
+
+  // the message of the previous call doesn't point to the files anymore
+  if (m_files.size() > MAX_MAPPED_FILES) {
+    m_files.clear();
+  }
+
+  msg_out.snapshot_hash = m_indexer->GetSnapshotHeader().snapshot_hash;
+  msg_out.utxo_subset_index = index;
+  msg_out.utxo_subset_count = 0;
+  msg_out.utxo_subsets.clear();
+  m_buffer.clear();
+
+  std::vector<Span> spans;
+  std::vector<UTXOSubset> decoded;
+
+  const uint64_t subsets_per_file = m_indexer->GetSubsetsPerFile();
+  const uint64_t end = std::min(total, index + count);
+  uint64_t next = index;
+  while (next < end) {
+    const auto file_id = static_cast<uint32_t>(next / subsets_per_file);
+    const MappedFile *file = MapFile(file_id);
+    if (!file) {
+      return false;
+    }
+
+    const uint64_t first = file_id * subsets_per_file;
+    const auto from = static_cast<uint32_t>(next - first);
+    const auto to = static_cast<uint32_t>(std::min<uint64_t>(end - first, file->subsets.back()));
+
+    size_t i = std::upper_bound(file->subsets.begin(), file->subsets.end(), from) -
+               file->subsets.begin() - 1;
+    for (; file->subsets[i] < to; ++i) {
+      const uint32_t begin = file->subsets[i];
+      const uint32_t stop = file->subsets[i + 1];
+      if (format != m_indexer->GetFormat() || begin < from || stop > to) {
+        try {
+          DecodeSubsets(*file, i, std::max(from, begin), std::min(to, stop), decoded);
+        } catch (const std::exception &e) {
+          LogPrint(BCLog::SNAPSHOT, "%s: can't decode %s. error: %s\n", __func__,
+                   m_indexer->GetFilePath(file_id).string(), e.what());
+          return false;
+        }
+        continue;
+      }
+
+      EncodeSubsets(decoded, format, spans);
+      const char *data = file->Data(file->offsets[i]);
+      const size_t size = file->offsets[i + 1] - file->offsets[i];
+      if (!spans.empty() && spans.back().data && spans.back().data + spans.back().size == data) {
+        spans.back().size += size;
+      } else {
+        spans.push_back(Span{data, 0, size});
+      }
+    }
+
+    msg_out.utxo_subset_count += to - from;
+    next = first + to;
+  }
+  EncodeSubsets(decoded, format, spans);
+
+  // m_buffer doesn't change anymore
+  for (const Span &span : spans) {
+    msg_out.utxo_subsets.emplace_back(span.data ? span.data : m_buffer.data() + span.offset,
+                                      span.size);
+  }
+
+  return true;
+}
+
+void ChunkReader::DecodeSubsets(const MappedFile &file, const size_t i,
+                                const uint32_t from, const uint32_t to,
+                                std::vector<UTXOSubset> &subsets_out) const {
+  MemoryReader reader(file.Data(file.offsets[i]), file.offsets[i + 1] - file.offsets[i]);
+  if (m_indexer->GetFormat() == SNAPSHOT_FORMAT_PLAIN) {
+    subsets_out.emplace_back();
+    reader >> subsets_out.back();
+    return;
+  }
+
+  std::vector<UTXOSubset> block;
+  ReadCompressedBlock(reader, block);
+  const uint32_t begin = file.subsets[i];
+  std::move(block.begin() + (from - begin), block.begin() + (to - begin),
+            std::back_inserter(subsets_out));
+}
+
+void ChunkReader::EncodeSubsets(std::vector<UTXOSubset> &subsets, const uint8_t format,
+                                std::vector<Span> &spans_out) {
+  if (subsets.empty()) {
+    return;
+  }
+
+  const size_t offset = m_buffer.size();
+  if (format == SNAPSHOT_FORMAT_COMPRESSED) {
+    for (size_t i = 0; i < subsets.size(); i += SUBSETS_PER_COMPRESSED_BLOCK) {
+      const size_t end = std::min(i + SUBSETS_PER_COMPRESSED_BLOCK, subsets.size());
+      WriteCompressedBlock(subsets.begin() + i, subsets.begin() + end, m_buffer);
+    }
+  } else {
+    for (const UTXOSubset &subset : subsets) {
+      m_buffer << subset;
+    }
+  }
+  subsets.clear();
+
+  spans_out.push_back(Span{nullptr, offset, m_buffer.size() - offset});
+}
+
+const ChunkReader::MappedFile *ChunkReader::MapFile(const uint32_t file_id) {
+  const auto it = m_files.find(file_id);
+  if (it != m_files.end()) {
+    return &it->second;
+  }
+
+  const fs::path path = m_indexer->GetFilePath(file_id);
+  const uint64_t subsets_per_file = m_indexer->GetSubsetsPerFile();
+  const uint64_t count = std::min(subsets_per_file,
+                                  m_indexer->GetSnapshotHeader().total_utxo_subsets -
+                                      file_id * subsets_per_file);
+
+  MappedFile file;
+  try {
+    const boost::interprocess::file_mapping mapping(path.string().c_str(),
+                                                    boost::interprocess::read_only);
+    file.region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+
+    MemoryReader reader(file.Data(0), file.region.get_size());
+    if (m_indexer->GetFormat() == SNAPSHOT_FORMAT_PLAIN) {
+      ScanSubsets(reader, count, file.offsets, file.subsets);
+    } else {
+      ScanBlocks(reader, count, file.offsets, file.subsets);
+    }
+  } catch (const boost::interprocess::interprocess_exception &e) {
+    LogPrint(BCLog::SNAPSHOT, "%s: can't map %s. error: %s\n", __func__, path.string(), e.what());
+    return nullptr;
+  } catch (const std::ios_base::failure &e) {
+    LogPrint(BCLog::SNAPSHOT, "%s: can't read %s. error: %s\n", __func__, path.string(), e.what());
+    return nullptr;
+  }
+
+  return &m_files.emplace(file_id, std::move(file)).first->second;
+}
+
+}  // namespace snapshot
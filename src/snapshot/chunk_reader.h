@@ -0,0 +1,89 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_SNAPSHOT_CHUNK_READER_H
+#define UNITE_SNAPSHOT_CHUNK_READER_H
+
+#include <snapshot/indexer.h>
+#include <snapshot/messages.h>
+#include <streams.h>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace snapshot {
+
+//! \brief Serves UTXO subsets straight from the memory-mapped utxo???.dat files
+//!
+//! The files store the subsets in the same serialization as they are sent to
+//! peers, so a requested range is copied from the mapping into the message
+//! without deserializing it. Only the subsets which are requested in another
+//! format or only a part of whose compressed block is requested are
+//! decoded and encoded again. The offset of every subset (block in
+//! SNAPSHOT_FORMAT_COMPRESSED) is found once, when its file is mapped for
+//! the first time.
+//!
+//! ChunkReader is not thread-safe. The snapshot must be complete.
+class ChunkReader {
+ public:
+  //! Files which stay mapped between the requests
+  static constexpr size_t MAX_MAPPED_FILES = 16;
+
+  explicit ChunkReader(std::unique_ptr<Indexer> indexer);
+
+  const SnapshotHeader &GetSnapshotHeader() const { return m_indexer->GetSnapshotHeader(); }
+
+  //! \brief ReadChunk returns at most count subsets starting at index
+  //!
+  //! The subsets are serialized in the given SNAPSHOT_FORMAT_*. The message
+  //! points to the mapped files and must be serialized before the next call.
+  bool ReadChunk(uint64_t index, uint16_t count, uint8_t format,
+                 SerializedSnapshot &msg_out);
+
+ private:
+  struct MappedFile {
+    boost::interprocess::mapped_region region;
+
+    //! offsets[i] is where the i-th subset (block) of the file starts. The
+    //! last element is where the last one ends.
+    std::vector<uint32_t> offsets;
+
+    //! subsets[i] is the number of subsets before offsets[i]
+    std::vector<uint32_t> subsets;
+
+    const char *Data(const uint32_t offset) const {
+      return static_cast<const char *>(region.get_address()) + offset;
+    }
+  };
+
+  //! Part of the message, data is nullptr if it points to m_buffer
+  struct Span {
+    const char *data;
+    size_t offset;
+    size_t size;
+  };
+
+  std::unique_ptr<Indexer> m_indexer;
+  std::map<uint32_t, MappedFile> m_files;
+
+  //! subsets which were encoded again for the last message
+  CDataStream m_buffer;
+
+  const MappedFile *MapFile(uint32_t file_id);
+
+  //! Decodes the subsets [from, to) of the i-th subset (block) of the file
+  void DecodeSubsets(const MappedFile &file, size_t i, uint32_t from, uint32_t to,
+                     std::vector<UTXOSubset> &subsets_out) const;
+
+  //! Encodes subsets into m_buffer in the given format and clears them
+  void EncodeSubsets(std::vector<UTXOSubset> &subsets, uint8_t format,
+                     std::vector<Span> &spans_out);
+};
+
+}  // namespace snapshot
+
+#endif  // UNITE_SNAPSHOT_CHUNK_READER_H
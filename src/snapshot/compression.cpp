@@ -0,0 +1,195 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/compression.h>
+
+#include <amount.h>
+#include <compressor.h>
+#include <script/script.h>
+
+#include <cassert>
+#include <limits>
+#include <map>
+
+namespace snapshot {
+
+namespace {
+
+constexpr uint64_t SCRIPT_INLINE = 0;
+constexpr uint64_t SCRIPT_P2WPKH = 1;
+constexpr uint64_t SCRIPT_P2WSH = 2;
+constexpr uint64_t SCRIPT_DICTIONARY = 3;
+
+constexpr size_t P2WPKH_HASH_SIZE = 20;
+constexpr size_t P2WSH_HASH_SIZE = 32;
+
+//! Size of the witness version and the push opcode of P2WPKH and P2WSH
+constexpr size_t WITNESS_PREFIX_SIZE = 2;
+
+void WriteScript(const CScript &script, CDataStream &stream_out) {
+  CScriptCompressor compressor(REF(script));
+  stream_out << compressor;
+}
+
+void WriteWitnessHash(const CScript &script, CDataStream &stream_out) {
+  stream_out.write(reinterpret_cast<const char *>(script.data()) + WITNESS_PREFIX_SIZE,
+                   script.size() - WITNESS_PREFIX_SIZE);
+}
+
+void ReadWitnessScript(CDataStream &block, const uint8_t push, CScript &script_out) {
+  script_out.resize(WITNESS_PREFIX_SIZE + push);
+  script_out[0] = OP_0;
+  script_out[1] = push;
+  block.read(reinterpret_cast<char *>(script_out.data()) + WITNESS_PREFIX_SIZE, push);
+}
+
+}  // namespace
+
+void WriteCompressedBlock(const std::vector<UTXOSubset>::const_iterator begin,
+                          const std::vector<UTXOSubset>::const_iterator end,
+                          CDataStream &stream_out) {
+  assert(begin != end);
+
+  // scripts which are used more than once are written only once
+  std::map<CScript, uint64_t> uses;
+  for (auto it = begin; it != end; ++it) {
+    for (const auto &output : it->outputs) {
+      ++uses[output.second.scriptPubKey];
+    }
+  }
+
+  std::map<CScript, uint64_t> dictionary;
+  std::vector<const CScript *> scripts;
+  for (auto it = begin; it != end; ++it) {
+    for (const auto &output : it->outputs) {
+      const CScript &script = output.second.scriptPubKey;
+      if (uses[script] > 1 && dictionary.emplace(script, scripts.size()).second) {
+        scripts.emplace_back(&script);
+      }
+    }
+  }
+
+  CDataStream block(SER_DISK, PROTOCOL_VERSION);
+  WriteCompactSize(block, scripts.size());
+  for (const CScript *script : scripts) {
+    WriteScript(*script, block);
+  }
+
+  for (auto it = begin; it != end; ++it) {
+    block << it->tx_id;
+    uint32_t height = it->height;
+    block << VARINT(height);
+    block << static_cast<uint8_t>(+it->tx_type);
+    WriteCompactSize(block, it->outputs.size());
+
+    uint64_t next_index = 0;
+    for (const auto &output : it->outputs) {
+      uint64_t index_delta = output.first - next_index;
+      block << VARINT(index_delta);
+      next_index = static_cast<uint64_t>(output.first) + 1;
+
+      const CAmount value = output.second.nValue;
+      uint64_t amount = MoneyRange(value) ? CTxOutCompressor::CompressAmount(value) + 1 : 0;
+      block << VARINT(amount);
+      if (amount == 0) {
+        block << value;
+      }
+
+      const CScript &script = output.second.scriptPubKey;
+      const auto entry = dictionary.find(script);
+      uint64_t script_code = SCRIPT_INLINE;
+      if (entry != dictionary.end()) {
+        script_code = SCRIPT_DICTIONARY + entry->second;
+      } else if (script.IsPayToWitnessPublicKeyHash()) {
+        script_code = SCRIPT_P2WPKH;
+      } else if (script.IsPayToWitnessScriptHash()) {
+        script_code = SCRIPT_P2WSH;
+      }
+      block << VARINT(script_code);
+
+      if (script_code == SCRIPT_INLINE) {
+        WriteScript(script, block);
+      } else if (script_code == SCRIPT_P2WPKH || script_code == SCRIPT_P2WSH) {
+        WriteWitnessHash(script, block);
+      }
+    }
+  }
+
+  WriteCompactSize(stream_out, static_cast<uint64_t>(end - begin));
+  WriteCompactSize(stream_out, block.size());
+  stream_out.write(block.data(), block.size());
+}
+
+void DecodeCompressedBlock(CDataStream &block, const uint64_t count,
+                           std::vector<UTXOSubset> &subsets_out) {
+  // every script and subset takes at least one byte, it bounds the memory
+  // a malformed block can allocate
+  const uint64_t scripts = ReadCompactSize(block);
+  if (scripts > block.size() || count > block.size()) {
+    throw std::ios_base::failure("DecodeCompressedBlock(): size too large");
+  }
+
+  std::vector<CScript> dictionary(scripts);
+  for (CScript &script : dictionary) {
+    CScriptCompressor compressor(script);
+    block >> compressor;
+  }
+
+  subsets_out.reserve(subsets_out.size() + count);
+  for (uint64_t i = 0; i < count; ++i) {
+    UTXOSubset subset;
+    block >> subset.tx_id;
+    block >> VARINT(subset.height);
+    uint8_t type = 0;
+    block >> type;
+    subset.tx_type = TxType::_from_integral(type);
+
+    const uint64_t outputs = ReadCompactSize(block);
+    uint64_t next_index = 0;
+    for (uint64_t n = 0; n < outputs; ++n) {
+      uint64_t index_delta = 0;
+      block >> VARINT(index_delta);
+      const uint64_t index = next_index + index_delta;
+      if (index_delta > std::numeric_limits<uint32_t>::max() ||
+          index > std::numeric_limits<uint32_t>::max()) {
+        throw std::ios_base::failure("DecodeCompressedBlock(): invalid output index");
+      }
+      next_index = index + 1;
+
+      CTxOut out;
+      uint64_t amount = 0;
+      block >> VARINT(amount);
+      if (amount == 0) {
+        block >> out.nValue;
+      } else {
+        out.nValue = CTxOutCompressor::DecompressAmount(amount - 1);
+      }
+
+      uint64_t script_code = 0;
+      block >> VARINT(script_code);
+      if (script_code == SCRIPT_INLINE) {
+        CScriptCompressor compressor(out.scriptPubKey);
+        block >> compressor;
+      } else if (script_code == SCRIPT_P2WPKH) {
+        ReadWitnessScript(block, P2WPKH_HASH_SIZE, out.scriptPubKey);
+      } else if (script_code == SCRIPT_P2WSH) {
+        ReadWitnessScript(block, P2WSH_HASH_SIZE, out.scriptPubKey);
+      } else if (script_code - SCRIPT_DICTIONARY < dictionary.size()) {
+        out.scriptPubKey = dictionary[script_code - SCRIPT_DICTIONARY];
+      } else {
+        throw std::ios_base::failure("DecodeCompressedBlock(): invalid script reference");
+      }
+
+      subset.outputs.emplace_hint(subset.outputs.end(), static_cast<uint32_t>(index), std::move(out));
+    }
+
+    subsets_out.emplace_back(std::move(subset));
+  }
+
+  if (!block.empty()) {
+    throw std::ios_base::failure("DecodeCompressedBlock(): unexpected data after the subsets");
+  }
+}
+
+}  // namespace snapshot
@@ -0,0 +1,154 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_SNAPSHOT_COMPRESSION_H
+#define UNITE_SNAPSHOT_COMPRESSION_H
+
+#include <serialize.h>
+#include <snapshot/messages.h>
+#include <streams.h>
+#include <version.h>
+
+#include <algorithm>
+#include <ios>
+#include <vector>
+
+namespace snapshot {
+
+//! How many subsets SNAPSHOT_FORMAT_COMPRESSED messages put into one block
+//! when the subsets are not taken from the blocks of the snapshot files.
+//! It's the same as DEFAULT_INDEX_STEP.
+constexpr size_t SUBSETS_PER_COMPRESSED_BLOCK = 1000;
+
+//! SNAPSHOT_FORMAT_COMPRESSED groups consecutive UTXO subsets into blocks.
+//! In utxo???.dat files every index step starts with a new block, so a step
+//! is stored in one block unless the indexer was flushed in the middle of it.
+//!
+//! block
+//! | size | type        | field      | description
+//! | N    | compactSize | count      | number of subsets, at least 1
+//! | N    | compactSize | size       | bytes of the rest of the block
+//! | N    | compactSize | scripts    | size of the dictionary
+//! | N    | script      | dictionary | scripts used more than once in the block
+//! | N    | subset      | subsets    | count subsets
+//!
+//! subset
+//! | size | type        | field      | description
+//! | 32   | uint256     | tx_id      |
+//! | N    | varInt      | height     |
+//! | 1    | uint8       | tx_type    |
+//! | N    | compactSize | outputs    | size of the map
+//! | N    | output      | output     |
+//!
+//! output
+//! | size | type        | field      | description
+//! | N    | varInt      | index      | difference to the previous index + 1
+//! | N    | varInt      | amount     | 0: int64 follows, otherwise
+//! |      |             |            | CTxOutCompressor::CompressAmount() + 1
+//! | N    | varInt      | script     | 0: script follows, 1: 20-byte P2WPKH
+//! |      |             |            | hash follows, 2: 32-byte P2WSH hash
+//! |      |             |            | follows, otherwise dictionary[script - 3]
+//!
+//! script is serialized by CScriptCompressor.
+
+//! \brief Appends the compressed block of the subsets [begin, end) to stream_out
+void WriteCompressedBlock(std::vector<UTXOSubset>::const_iterator begin,
+                          std::vector<UTXOSubset>::const_iterator end,
+                          CDataStream &stream_out);
+
+//! \brief Decodes the rest of the block after its count and size
+//!
+//! Throws std::ios_base::failure if the block is malformed.
+void DecodeCompressedBlock(CDataStream &block, uint64_t count,
+                           std::vector<UTXOSubset> &subsets_out);
+
+//! \brief Reads the block and appends its subsets to subsets_out
+template <typename Stream>
+void ReadCompressedBlock(Stream &s, std::vector<UTXOSubset> &subsets_out) {
+  const uint64_t count = ReadCompactSize(s);
+  const uint64_t size = ReadCompactSize(s);
+  if (count == 0) {
+    throw std::ios_base::failure("ReadCompressedBlock(): empty block");
+  }
+
+  CDataStream block(SER_DISK, PROTOCOL_VERSION);
+  block.resize(size);
+  s.read(block.data(), size);
+  DecodeCompressedBlock(block, count, subsets_out);
+}
+
+//! \brief Skips the block and returns how many subsets it has
+template <typename Stream>
+uint64_t SkipCompressedBlock(Stream &s) {
+  const uint64_t count = ReadCompactSize(s);
+  const uint64_t size = ReadCompactSize(s);
+  if (count == 0) {
+    throw std::ios_base::failure("SkipCompressedBlock(): empty block");
+  }
+
+  s.ignore(size);
+  return count;
+}
+
+//! \brief Wrapper for the UTXO subsets in SNAPSHOT_FORMAT_COMPRESSED
+//!
+//! It's serialized as the number of subsets followed by the blocks of
+//! SUBSETS_PER_COMPRESSED_BLOCK subsets.
+class CompressedSubsets {
+ public:
+  explicit CompressedSubsets(std::vector<UTXOSubset> &subsets) : m_subsets(subsets) {}
+
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    WriteCompactSize(s, m_subsets.size());
+
+    CDataStream block(SER_DISK, PROTOCOL_VERSION);
+    for (size_t i = 0; i < m_subsets.size(); i += SUBSETS_PER_COMPRESSED_BLOCK) {
+      const size_t end = std::min(i + SUBSETS_PER_COMPRESSED_BLOCK, m_subsets.size());
+      WriteCompressedBlock(m_subsets.begin() + i, m_subsets.begin() + end, block);
+      s.write(block.data(), block.size());
+      block.clear();
+    }
+  }
+
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    const uint64_t count = ReadCompactSize(s);
+    m_subsets.clear();
+    while (m_subsets.size() < count) {
+      ReadCompressedBlock(s, m_subsets);
+    }
+    if (m_subsets.size() != count) {
+      throw std::ios_base::failure("CompressedSubsets: blocks don't match the count");
+    }
+  }
+
+ private:
+  std::vector<UTXOSubset> &m_subsets;
+};
+
+//! \brief Wrapper for the Snapshot message in SNAPSHOT_FORMAT_COMPRESSED
+//!
+//! It's sent as the "cmpsnapshot" message.
+class SnapshotCompressor {
+ public:
+  explicit SnapshotCompressor(Snapshot &snapshot) : m_snapshot(snapshot) {}
+
+  ADD_SERIALIZE_METHODS;
+
+  template <typename Stream, typename Operation>
+  inline void SerializationOp(Stream &s, Operation ser_action) {
+    READWRITE(m_snapshot.snapshot_hash);
+    READWRITE(m_snapshot.utxo_subset_index);
+    CompressedSubsets subsets(REF(m_snapshot.utxo_subsets));
+    READWRITE(subsets);
+  }
+
+ private:
+  Snapshot &m_snapshot;
+};
+
+}  // namespace snapshot
+
+#endif  // UNITE_SNAPSHOT_COMPRESSION_H
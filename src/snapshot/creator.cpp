@@ -13,7 +13,9 @@
 #include <util.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <atomic>
+#include <ios>
 #include <queue>
 #include <thread>
 
@@ -40,6 +42,64 @@ std::mutex mutex;
 std::condition_variable cv;
 std::queue<std::unique_ptr<SnapshotJob>> jobs;
 std::atomic_bool interrupt(false);
+
+//! UTXO subsets of one utxo???.dat file
+struct FileJob {
+  uint32_t file_id = 0;
+  std::vector<UTXOSubset> subsets;
+};
+
+//! \brief Hands files from the chainstate reader to the file writers
+//!
+//! The queue is bounded so the reader can't get too far ahead of the writers
+//! and the memory stays proportional to the number of workers.
+class FileQueue {
+ public:
+  explicit FileQueue(const size_t capacity) : m_capacity(capacity) {}
+
+  //! Blocks while the queue is full. Returns false if the queue is closed.
+  bool Push(FileJob &&job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_closed || m_jobs.size() < m_capacity; });
+    if (m_closed) {
+      return false;
+    }
+    m_jobs.emplace(std::move(job));
+    m_cv.notify_all();
+    return true;
+  }
+
+  //! Blocks until there is a job. Returns false once the queue is closed
+  //! and drained.
+  bool Pop(FileJob &job_out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_closed || !m_jobs.empty(); });
+    if (m_jobs.empty()) {
+      return false;
+    }
+    job_out = std::move(m_jobs.front());
+    m_jobs.pop();
+    m_cv.notify_all();
+    return true;
+  }
+
+  //! Wakes everyone up. Jobs which are already queued are still popped.
+  void Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_cv.notify_all();
+  }
+
+ private:
+  const size_t m_capacity;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::queue<FileJob> m_jobs;
+  bool m_closed = false;
+};
+
+//! Index of the written file and the number of subsets it contains
+using WrittenFile = std::pair<Indexer::IdxMap, uint32_t>;
 }  // namespace
 
 void ProcessCreatorQueue() {
@@ -99,7 +159,9 @@ void Creator::Deinit() {
   }
 }
 
-Creator::Creator(CCoinsViewDB *view) : m_iter(view) {}
+Creator::Creator(CCoinsViewDB *view)
+    : m_workers(static_cast<size_t>(std::max(GetNumCores(), 1))),
+      m_iter(view) {}
 
 void Creator::GenerateOrSkip(const uint32_t current_epoch) {
   if (g_create_snapshot_per_epoch == 0) {
@@ -116,11 +178,22 @@ void Creator::GenerateOrSkip(const uint32_t current_epoch) {
     return;
   }
 
-  // ensure that pcoinsTip flushes its data to disk as creator
-  // uses disk data to create the snapshot
-  FlushStateToDisk();
+  std::unique_ptr<Creator> creator;
+  {
+    LOCK(cs_main);
+
+    // ensure that pcoinsTip flushes its data to disk as creator
+    // uses disk data to create the snapshot
+    FlushStateToDisk();
+
+    creator = MakeUnique<Creator>(pcoinsdbview.get());
 
-  std::unique_ptr<SnapshotJob> job(new SnapshotJob(MakeUnique<Creator>(pcoinsdbview.get())));
+    // the changes since the previous snapshot, the chainstate records
+    // the ones for the next snapshot from now on
+    creator->m_delta = pcoinsdbview->TakeDelta();
+  }
+
+  std::unique_ptr<SnapshotJob> job(new SnapshotJob(std::move(creator)));
   std::lock_guard<std::mutex> lock(mutex);
   jobs.push(std::move(job));
   cv.notify_one();
@@ -169,35 +242,34 @@ CreationInfo Creator::Create() {
     }
   }
 
-  Indexer indexer(snapshot_header, m_step, m_steps_per_file);
-
-  while (m_iter.Valid()) {
-    boost::this_thread::interruption_point();
-
-    UTXOSubset subset = m_iter.GetUTXOSubset();
-    info.total_outputs += subset.outputs.size();
-
-    if (!indexer.WriteUTXOSubset(subset)) {
-      info.status = Status::WRITE_ERROR;
-      return info;
+  bool written = false;
+  if (std::unique_ptr<Indexer> base = OpenDeltaBase()) {
+    const uint256 base_hash = base->GetSnapshotHeader().snapshot_hash;
+    LogPrint(BCLog::SNAPSHOT, "apply %d changed coins to snapshot_hash=%s\n",
+             m_delta->GetCoins().size(), base_hash.GetHex());
+
+    try {
+      DeltaIterator iter(std::move(base), *m_delta);
+      written = WriteSnapshot(iter, snapshot_header, info) && iter.IsBaseRead();
+    } catch (const std::ios_base::failure &e) {
+      LogPrint(BCLog::SNAPSHOT, "%s: can't read snapshot_hash=%s: %s\n",
+               __func__, base_hash.GetHex(), e.what());
     }
 
-    if (indexer.GetSnapshotHeader().total_utxo_subsets == m_max_utxo_subsets) {
-      break;
+    if (!written) {
+      LogPrint(BCLog::SNAPSHOT, "can't apply the changes to snapshot_hash=%s, read the chainstate\n",
+               base_hash.GetHex());
+      LOCK(cs_snapshot);
+      Indexer::Delete(snapshot_header.snapshot_hash);
+      info = CreationInfo();
     }
-
-    m_iter.Next();
   }
 
-  if (!indexer.Flush()) {
-    LOCK(cs_snapshot);
-    Indexer::Delete(snapshot_header.snapshot_hash);
+  if (!written && !WriteSnapshot(m_iter, snapshot_header, info)) {
     info.status = Status::WRITE_ERROR;
     return info;
   }
 
-  info.snapshot_header = indexer.GetSnapshotHeader();
-
   LogPrint(BCLog::SNAPSHOT, "snapshot_hash=%s is created\n",
            info.snapshot_header.snapshot_hash.GetHex());
 
@@ -213,6 +285,144 @@ CreationInfo Creator::Create() {
   return info;
 }
 
+std::unique_ptr<Indexer> Creator::OpenDeltaBase() const {
+  if (!m_delta || !m_delta->IsValid()) {
+    return nullptr;
+  }
+
+  for (const Checkpoint &p : GetSnapshotCheckpoints()) {
+    if (p.block_hash == m_delta->GetBaseBlockHash()) {
+      LOCK(cs_snapshot);
+      return Indexer::Open(p.snapshot_hash);
+    }
+  }
+
+  return nullptr;
+}
+
+template <typename SubsetIterator>
+bool Creator::WriteSnapshot(SubsetIterator &iter, const SnapshotHeader &snapshot_header,
+                            CreationInfo &info) {
+  Indexer indexer(snapshot_header, m_step, m_steps_per_file);
+
+  const bool written = m_workers > 1 ? WriteFilesInParallel(iter, indexer, info)
+                                      : WriteSubsets(iter, indexer, info);
+  if (!written || !indexer.Flush()) {
+    LOCK(cs_snapshot);
+    Indexer::Delete(snapshot_header.snapshot_hash);
+    return false;
+  }
+
+  info.snapshot_header = indexer.GetSnapshotHeader();
+  return true;
+}
+
+template <typename SubsetIterator>
+bool Creator::WriteSubsets(SubsetIterator &iter, Indexer &indexer, CreationInfo &info) {
+  while (iter.Valid()) {
+    boost::this_thread::interruption_point();
+
+    const UTXOSubset &subset = iter.GetUTXOSubset();
+    info.total_outputs += subset.outputs.size();
+
+    if (!indexer.WriteUTXOSubset(subset)) {
+      return false;
+    }
+
+    if (indexer.GetSnapshotHeader().total_utxo_subsets == m_max_utxo_subsets) {
+      break;
+    }
+
+    iter.Next();
+  }
+
+  return true;
+}
+
+template <typename SubsetIterator>
+bool Creator::WriteFilesInParallel(SubsetIterator &iter, Indexer &indexer, CreationInfo &info) {
+  const uint64_t subsets_per_file = m_step * m_steps_per_file;
+
+  FileQueue queue(m_workers);
+  std::atomic_bool write_error(false);
+  std::vector<std::map<uint32_t, WrittenFile>> written(m_workers);
+  std::vector<std::thread> threads;
+  threads.reserve(m_workers);
+  for (size_t i = 0; i < m_workers; ++i) {
+    threads.emplace_back([&queue, &write_error, &indexer, &written, i] {
+      FileJob job;
+      while (queue.Pop(job)) {
+        Indexer::IdxMap idx;
+        if (!indexer.WriteFile(job.file_id, job.subsets, idx)) {
+          write_error = true;
+          queue.Close();
+          return;
+        }
+        const auto subsets = static_cast<uint32_t>(job.subsets.size());
+        written[i].emplace(job.file_id, WrittenFile(std::move(idx), subsets));
+      }
+    });
+  }
+
+  const auto join = [&queue, &threads] {
+    queue.Close();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  };
+
+  try {
+    FileJob job;
+    uint64_t total_subsets = 0;
+    while (iter.Valid()) {
+      boost::this_thread::interruption_point();
+
+      // Next() replaces the subset, so it can be moved out
+      job.subsets.emplace_back(std::move(iter.GetUTXOSubset()));
+      info.total_outputs += job.subsets.back().outputs.size();
+      ++total_subsets;
+
+      if (total_subsets == m_max_utxo_subsets) {
+        break;
+      }
+
+      if (job.subsets.size() == subsets_per_file) {
+        const uint32_t next_file_id = job.file_id + 1;
+        if (!queue.Push(std::move(job))) {
+          break;
+        }
+        job = FileJob();
+        job.file_id = next_file_id;
+      }
+
+      iter.Next();
+    }
+
+    if (!job.subsets.empty()) {
+      queue.Push(std::move(job));
+    }
+  } catch (...) {
+    join();
+    throw;
+  }
+  join();
+
+  if (write_error) {
+    return false;
+  }
+
+  std::map<uint32_t, WrittenFile> files;
+  for (std::map<uint32_t, WrittenFile> &worker_files : written) {
+    files.insert(std::make_move_iterator(worker_files.begin()),
+                 std::make_move_iterator(worker_files.end()));
+  }
+  for (auto &file : files) {
+    indexer.AddFile(file.first, std::move(file.second.first), file.second.second);
+  }
+
+  return true;
+}
+
 bool IsRecurrentCreation() {
   return g_create_snapshot_per_epoch > 0;
 }
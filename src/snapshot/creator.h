@@ -8,6 +8,7 @@
 #include <better-enums/enum.h>
 #include <scheduler.h>
 #include <snapshot/chainstate_iterator.h>
+#include <snapshot/delta.h>
 #include <snapshot/indexer.h>
 #include <snapshot/params.h>
 #include <streams.h>
@@ -38,6 +39,12 @@ struct CreationInfo {
 //! Creator class accepts the CCoinsViewDB and takes the cursor of it
 //! at the point of object construction. Once the Create() function is called,
 //! creator object should be thrown way. It's not designed to be re-used.
+//!
+//! The chainstate is read on the calling thread. With more than one worker
+//! it groups UTXO subsets by utxo???.dat file. Every file covers a contiguous
+//! key range and is serialized and written by one of m_workers threads. The
+//! indexes of the files are merged in order, so the snapshot doesn't depend
+//! on m_workers.
 class Creator {
  public:
   //! aggregate messages per index
@@ -51,6 +58,17 @@ class Creator {
   //! non 0 value is used only for testing.
   uint64_t m_max_utxo_subsets = 0;
 
+  //! how many threads write utxo???.dat files while the chainstate is read.
+  //! Defaults to the number of cores. 0 or 1 - the snapshot is written on
+  //! the calling thread.
+  size_t m_workers;
+
+  //! coins changed since the chainstate was at m_delta->GetBaseBlockHash().
+  //! If the snapshot of that block exists, the delta is applied to it instead
+  //! of reading the whole chainstate, so the time it takes depends on the
+  //! churn rather than on the size of the UTXO set.
+  std::unique_ptr<UTXODelta> m_delta;
+
   //! \brief Init Initializes the instance of Creator
   //!
   //! Must be invoked before calling any other snapshot::Snapshot* functions
@@ -77,6 +95,23 @@ class Creator {
 
  private:
   ChainstateIterator m_iter;
+
+  //! Returns the snapshot m_delta can be applied to, nullptr if there is none
+  std::unique_ptr<Indexer> OpenDeltaBase() const;
+
+  //! Writes the snapshot of the subsets of iter, deletes it if it fails
+  template <typename SubsetIterator>
+  bool WriteSnapshot(SubsetIterator &iter, const SnapshotHeader &snapshot_header,
+                     CreationInfo &info);
+
+  //! Reads and writes every subset on the calling thread
+  template <typename SubsetIterator>
+  bool WriteSubsets(SubsetIterator &iter, Indexer &indexer, CreationInfo &info);
+
+  //! Reads the subsets on the calling thread and writes the files on m_workers
+  //! threads
+  template <typename SubsetIterator>
+  bool WriteFilesInParallel(SubsetIterator &iter, Indexer &indexer, CreationInfo &info);
 };
 
 bool IsRecurrentCreation();
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/delta.h>
+
+namespace snapshot {
+
+void UTXODelta::Add(const COutPoint &out_point, const Coin &coin) {
+  if (!m_valid) {
+    return;
+  }
+
+  if (m_coins.size() >= MAX_COINS && m_coins.count(out_point) == 0) {
+    Invalidate();
+    return;
+  }
+
+  m_coins[out_point] = coin;
+}
+
+void UTXODelta::Invalidate() {
+  m_valid = false;
+  m_coins.clear();
+}
+
+DeltaIterator::DeltaIterator(std::unique_ptr<Indexer> base, const UTXODelta &delta)
+    : m_base(std::move(base)),
+      m_base_total(m_base.GetSnapshotHeader().total_utxo_subsets),
+      m_change(delta.GetCoins().begin()),
+      m_change_end(delta.GetCoins().end()) {
+  Next();
+}
+
+void DeltaIterator::Next() {
+  while (true) {
+    const bool has_base = m_base.Valid();
+    const bool has_change = m_change != m_change_end;
+    if (!has_base && !has_change) {
+      m_valid = false;
+      return;
+    }
+
+    if (has_base && (!has_change || m_base.GetUTXOSubset().tx_id < m_change->first.hash)) {
+      TakeBaseSubset();
+      return;
+    }
+
+    const uint256 tx_id = m_change->first.hash;
+    if (has_base && m_base.GetUTXOSubset().tx_id == tx_id) {
+      TakeBaseSubset();
+    } else {
+      m_utxo_subset = UTXOSubset();
+      m_utxo_subset.tx_id = tx_id;
+    }
+
+    for (; m_change != m_change_end && m_change->first.hash == tx_id; ++m_change) {
+      const Coin &coin = m_change->second;
+      if (coin.IsSpent()) {
+        m_utxo_subset.outputs.erase(m_change->first.n);
+        continue;
+      }
+
+      m_utxo_subset.height = coin.nHeight;
+      m_utxo_subset.tx_type = coin.tx_type;
+      m_utxo_subset.outputs[m_change->first.n] = coin.out;
+    }
+
+    // all outputs of the TX are spent
+    if (!m_utxo_subset.outputs.empty()) {
+      return;
+    }
+  }
+}
+
+void DeltaIterator::TakeBaseSubset() {
+  // Next() replaces the subset, so it can be moved out
+  m_utxo_subset = std::move(m_base.GetUTXOSubset());
+  ++m_base_read;
+  m_base.Next();
+}
+
+}  // namespace snapshot
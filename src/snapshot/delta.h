@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_SNAPSHOT_DELTA_H
+#define UNITE_SNAPSHOT_DELTA_H
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <snapshot/indexer.h>
+#include <snapshot/iterator.h>
+#include <snapshot/messages.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+
+namespace snapshot {
+
+//! \brief Changes of the chainstate DB since it was at base_block_hash
+//!
+//! CCoinsViewDB records every coin it writes or erases, so the next snapshot
+//! can be created by applying the changes to the snapshot of base_block_hash
+//! instead of reading the whole chainstate. The UTXO set at the block is
+//! always the same, so any snapshot of this block can be used as the base.
+class UTXODelta {
+ public:
+  //! Above this number of changed coins the delta is dropped to keep the
+  //! memory bounded and the next snapshot is created from the chainstate.
+  static constexpr size_t MAX_COINS = 1000000;
+
+  explicit UTXODelta(const uint256 &base_block_hash)
+      : m_base_block_hash(base_block_hash) {}
+
+  const uint256 &GetBaseBlockHash() const { return m_base_block_hash; }
+
+  //! Records the coin of the outpoint after the change, it's spent if the
+  //! coin was erased
+  void Add(const COutPoint &out_point, const Coin &coin);
+
+  //! Drops the changes, e.g. after the chainstate was replaced
+  void Invalidate();
+
+  //! Returns false if the changes were dropped
+  bool IsValid() const { return m_valid; }
+
+  //! key - changed outpoint, they are sorted the same way as the chainstate
+  const std::map<COutPoint, Coin> &GetCoins() const { return m_coins; }
+
+ private:
+  uint256 m_base_block_hash;
+  bool m_valid = true;
+  std::map<COutPoint, Coin> m_coins;
+};
+
+//! \brief Iterates the UTXO subsets of the base snapshot with the delta applied
+//!
+//! The subsets come in the same order as from ChainstateIterator, so the
+//! snapshot written from them is the same as the one created from the
+//! chainstate the delta leads to.
+class DeltaIterator {
+ public:
+  DeltaIterator(std::unique_ptr<Indexer> base, const UTXODelta &delta);
+
+  bool Valid() const { return m_valid; }
+  void Next();
+  UTXOSubset &GetUTXOSubset() { return m_utxo_subset; }
+
+  //! Returns true if every subset of the base snapshot was read. It's false
+  //! when the base snapshot can't be read, then the subsets are incomplete.
+  bool IsBaseRead() const { return m_base_read == m_base_total; }
+
+ private:
+  Iterator m_base;
+  const uint64_t m_base_total;
+  uint64_t m_base_read = 0;
+
+  std::map<COutPoint, Coin>::const_iterator m_change;
+  const std::map<COutPoint, Coin>::const_iterator m_change_end;
+
+  bool m_valid = true;
+  UTXOSubset m_utxo_subset;
+
+  //! Moves the current base subset to m_utxo_subset
+  void TakeBaseSubset();
+};
+
+}  // namespace snapshot
+
+#endif  // UNITE_SNAPSHOT_DELTA_H
@@ -0,0 +1,137 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/download_scheduler.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace snapshot {
+
+DownloadScheduler::DownloadScheduler(const SnapshotHeader &snapshot_header,
+                                     const uint64_t written,
+                                     const uint16_t chunk_size,
+                                     const size_t window,
+                                     const size_t max_requests_per_peer)
+    : m_snapshot_header(snapshot_header),
+      m_chunk_size(chunk_size),
+      m_window(window),
+      m_max_requests_per_peer(max_requests_per_peer),
+      m_written(written),
+      m_next(written) {
+  assert(chunk_size > 0);
+  assert(window > 0);
+  assert(written <= snapshot_header.total_utxo_subsets);
+}
+
+bool DownloadScheduler::NextRequest(const NodeId node,
+                                    uint64_t &index_out, uint16_t &count_out) {
+  const auto requests = std::count_if(
+      m_in_flight.begin(), m_in_flight.end(),
+      [node](const std::pair<const uint64_t, Request> &r) { return r.second.node == node; });
+  if (static_cast<size_t>(requests) >= m_max_requests_per_peer) {
+    return false;
+  }
+
+  const uint64_t total = m_snapshot_header.total_utxo_subsets;
+  const uint64_t window_end = std::min(total, m_written + m_window * m_chunk_size);
+
+  // ranges which were requested before come first as the written subsets
+  // can't move forward without them
+  if (!m_pending.empty() && m_pending.begin()->first < window_end) {
+    index_out = m_pending.begin()->first;
+    count_out = m_pending.begin()->second;
+    m_pending.erase(m_pending.begin());
+  } else if (m_next < window_end) {
+    // stick to chunk boundaries so the replies can be checked chunk by chunk
+    const uint64_t chunk_end = (m_next / m_chunk_size + 1) * m_chunk_size;
+    index_out = m_next;
+    count_out = static_cast<uint16_t>(std::min(chunk_end, total) - m_next);
+    m_next += count_out;
+  } else {
+    return false;
+  }
+
+  m_in_flight.emplace(index_out, Request{node, count_out});
+  return true;
+}
+
+bool DownloadScheduler::IsExpected(const NodeId node, const uint64_t index,
+                                   const size_t count) const {
+  const auto it = m_in_flight.find(index);
+  if (it == m_in_flight.end() || it->second.node != node) {
+    return false;
+  }
+  return count > 0 && count <= it->second.count;
+}
+
+bool DownloadScheduler::Received(const NodeId node, const uint64_t index,
+                                 std::vector<UTXOSubset> &&subsets) {
+  if (!IsExpected(node, index, subsets.size())) {
+    return false;
+  }
+
+  const auto it = m_in_flight.find(index);
+  const uint16_t count = it->second.count;
+  m_in_flight.erase(it);
+
+  if (subsets.size() < count) {
+    const auto left = static_cast<uint16_t>(count - subsets.size());
+    m_pending.emplace(index + subsets.size(), left);
+  }
+
+  m_received.emplace(index, std::move(subsets));
+  return true;
+}
+
+void DownloadScheduler::TakeReady(std::vector<UTXOSubset> &subsets_out) {
+  subsets_out.clear();
+
+  auto it = m_received.begin();
+  while (it != m_received.end() && it->first == m_written) {
+    m_written += it->second.size();
+    subsets_out.insert(subsets_out.end(),
+                       std::make_move_iterator(it->second.begin()),
+                       std::make_move_iterator(it->second.end()));
+    it = m_received.erase(it);
+  }
+}
+
+void DownloadScheduler::RemovePeer(const NodeId node) {
+  for (auto it = m_in_flight.begin(); it != m_in_flight.end();) {
+    if (it->second.node == node) {
+      m_pending.emplace(it->first, it->second.count);
+      it = m_in_flight.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void DownloadScheduler::RetainPeers(const std::set<NodeId> &nodes) {
+  for (auto it = m_in_flight.begin(); it != m_in_flight.end();) {
+    if (nodes.count(it->second.node) == 0) {
+      m_pending.emplace(it->first, it->second.count);
+      it = m_in_flight.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool DownloadScheduler::HasRequestsInFlight(const NodeId node) const {
+  return std::any_of(
+      m_in_flight.begin(), m_in_flight.end(),
+      [node](const std::pair<const uint64_t, Request> &r) { return r.second.node == node; });
+}
+
+bool DownloadScheduler::IsChunk(const uint64_t index, const size_t count) const {
+  if (index % m_chunk_size != 0 || index >= m_snapshot_header.total_utxo_subsets) {
+    return false;
+  }
+  return count == std::min<uint64_t>(m_chunk_size, m_snapshot_header.total_utxo_subsets - index);
+}
+
+}  // namespace snapshot
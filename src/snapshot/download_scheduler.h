@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_SNAPSHOT_DOWNLOAD_SCHEDULER_H
+#define UNITE_SNAPSHOT_DOWNLOAD_SCHEDULER_H
+
+#include <net.h>
+#include <snapshot/messages.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace snapshot {
+
+//! \brief Decides which UTXO subsets of the snapshot to request from which peer
+//!
+//! The snapshot is split into chunks of chunk_size subsets which are requested
+//! from all the peers that serve the snapshot at the same time. Every peer has
+//! at most max_requests_per_peer requests in flight. Chunks which are more than
+//! window chunks ahead of the first missing subset are not requested, so the
+//! chunks that arrived out of order and wait to be written stay bounded.
+//!
+//! A peer can reply with fewer subsets than requested, the rest is requested
+//! again from any peer. The scheduler is not thread-safe.
+class DownloadScheduler {
+ public:
+  DownloadScheduler(const SnapshotHeader &snapshot_header, uint64_t written,
+                    uint16_t chunk_size, size_t window,
+                    size_t max_requests_per_peer);
+
+  const SnapshotHeader &GetSnapshotHeader() const { return m_snapshot_header; }
+
+  //! \brief Picks the next range to request from the peer
+  //!
+  //! Returns false if the peer has enough requests in flight or there is
+  //! nothing to request within the window.
+  bool NextRequest(NodeId node, uint64_t &index_out, uint16_t &count_out);
+
+  //! Returns whether count subsets starting at index were requested from
+  //! the peer.
+  bool IsExpected(NodeId node, uint64_t index, size_t count) const;
+
+  //! \brief Accepts the subsets requested from the peer
+  //!
+  //! Returns false if the subsets are not expected, see IsExpected().
+  bool Received(NodeId node, uint64_t index, std::vector<UTXOSubset> &&subsets);
+
+  //! \brief Moves the subsets which directly follow the written ones
+  //!
+  //! The caller is expected to write them right away.
+  void TakeReady(std::vector<UTXOSubset> &subsets_out);
+
+  //! Returns the requests in flight to the peer so they are requested from
+  //! other peers.
+  void RemovePeer(NodeId node);
+
+  //! Removes the peers which are not in nodes, see RemovePeer().
+  void RetainPeers(const std::set<NodeId> &nodes);
+
+  bool HasRequestsInFlight(NodeId node) const;
+
+  //! Returns whether [index, index + count) is a complete chunk
+  bool IsChunk(uint64_t index, size_t count) const;
+
+  uint64_t GetWritten() const { return m_written; }
+
+  bool IsComplete() const { return m_written == m_snapshot_header.total_utxo_subsets; }
+
+ private:
+  struct Request {
+    NodeId node;
+    uint16_t count;
+  };
+
+  const SnapshotHeader m_snapshot_header;
+  const uint16_t m_chunk_size;
+  const size_t m_window;
+  const size_t m_max_requests_per_peer;
+
+  //! subsets which are written
+  uint64_t m_written;
+
+  //! subsets from this index on were never requested
+  uint64_t m_next;
+
+  //! ranges which have to be requested again. key: index, value: count
+  std::map<uint64_t, uint16_t> m_pending;
+
+  //! key: index of the first requested subset
+  std::map<uint64_t, Request> m_in_flight;
+
+  //! chunks which are received but can't be written yet. key: index
+  std::map<uint64_t, std::vector<UTXOSubset>> m_received;
+};
+
+}  // namespace snapshot
+
+#endif  // UNITE_SNAPSHOT_DOWNLOAD_SCHEDULER_H
@@ -5,8 +5,11 @@
 #include <snapshot/indexer.h>
 
 #include <crypto/sha256.h>
+#include <snapshot/compression.h>
 #include <util.h>
 
+#include <algorithm>
+
 namespace snapshot {
 
 CCriticalSection cs_snapshot;
@@ -24,7 +27,17 @@ std::unique_ptr<Indexer> Indexer::Open(const uint256 &snapshot_hash) EXCLUSIVE_L
       return nullptr;
     }
 
-    file >> meta;
+    // meta.dat is read at once as the format at its end is optional
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream.resize(fs::file_size(dir_path / "meta.dat"));
+    file.read(stream.data(), stream.size());
+    stream >> meta;
+  }
+
+  if (meta.format > SNAPSHOT_FORMAT_LATEST) {
+    LogPrintf("%s: unknown format %d of snapshot %s\n", __func__, meta.format,
+              snapshot_hash.GetHex());
+    return nullptr;
   }
 
   std::map<uint32_t, IdxMap> dir_idx;
@@ -56,7 +69,8 @@ bool Indexer::Delete(const uint256 &snapshot_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_s
 }
 
 Indexer::Indexer(const SnapshotHeader &snapshot_header,
-                 const uint32_t step, const uint32_t steps_per_file)
+                 const uint32_t step, const uint32_t steps_per_file,
+                 const uint8_t format)
     : m_meta(snapshot_header),
       m_stream(SER_DISK, PROTOCOL_VERSION),
       m_dir_path(GetDataDir() / SNAPSHOT_FOLDER / m_meta.snapshot_header.snapshot_hash.GetHex()) {
@@ -65,6 +79,7 @@ Indexer::Indexer(const SnapshotHeader &snapshot_header,
   m_meta.snapshot_header.total_utxo_subsets = 0;  // it's incremented after each write
   m_meta.step = step;
   m_meta.steps_per_file = steps_per_file;
+  m_meta.format = format;
 
   TryCreateDirectories(m_dir_path);
 }
@@ -116,6 +131,18 @@ bool Indexer::WriteUTXOSubset(const UTXOSubset &utxo_subset) {
     m_file_bytes = 0;
     m_file_id = file_id;
   }
+
+  if (m_meta.format == SNAPSHOT_FORMAT_COMPRESSED) {
+    m_block.emplace_back(utxo_subset);
+    ++m_meta.snapshot_header.total_utxo_subsets;
+    ++m_file_msgs;
+
+    if (m_file_msgs % m_meta.step == 0) {
+      FlushBlock();
+    }
+    return true;
+  }
+
   m_stream << utxo_subset;
   uint32_t idx = m_file_msgs / m_meta.step;
   m_file_idx[idx] = static_cast<uint32_t>(m_stream.size()) + m_file_bytes;
@@ -126,6 +153,120 @@ bool Indexer::WriteUTXOSubset(const UTXOSubset &utxo_subset) {
   return true;
 }
 
+void Indexer::FlushBlock() {
+  if (m_block.empty()) {
+    return;
+  }
+
+  WriteCompressedBlock(m_block.begin(), m_block.end(), m_stream);
+  m_block.clear();
+
+  uint32_t idx = (m_file_msgs - 1) / m_meta.step;
+  m_file_idx[idx] = static_cast<uint32_t>(m_stream.size()) + m_file_bytes;
+}
+
+bool Indexer::WriteFile(const uint32_t file_id,
+                        const std::vector<UTXOSubset> &subsets,
+                        IdxMap &idx_out) const {
+  assert(subsets.size() <= m_meta.step * m_meta.steps_per_file);
+
+  CAutoFile file(fsbridge::fopen(m_dir_path / FileName(file_id), "wb"),
+                 SER_DISK, CLIENT_VERSION);
+  if (file.IsNull()) {
+    return false;
+  }
+
+  // flush every index to keep the memory bounded by one step
+  CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+  uint32_t file_bytes = 0;
+  idx_out.clear();
+  for (size_t i = 0; i < subsets.size(); ++i) {
+    const auto idx = static_cast<uint32_t>(i / m_meta.step);
+    const bool step_end = (i + 1) % m_meta.step == 0 || i + 1 == subsets.size();
+    if (m_meta.format == SNAPSHOT_FORMAT_COMPRESSED) {
+      if (step_end) {
+        const size_t begin = idx * m_meta.step;
+        WriteCompressedBlock(subsets.begin() + begin, subsets.begin() + i + 1, stream);
+      }
+    } else {
+      stream << subsets[i];
+    }
+
+    if (step_end) {
+      file_bytes += stream.size();
+      idx_out[idx] = file_bytes;
+      file << stream;
+      stream.clear();
+    }
+  }
+
+  return true;
+}
+
+bool Indexer::ReadFile(const uint32_t file_id,
+                       std::vector<UTXOSubset> &subsets_out) const {
+  const uint64_t subsets_per_file = m_meta.step * m_meta.steps_per_file;
+  const uint64_t first = file_id * subsets_per_file;
+  if (first >= m_meta.snapshot_header.total_utxo_subsets) {
+    return false;
+  }
+  const uint64_t count = std::min(subsets_per_file,
+                                  m_meta.snapshot_header.total_utxo_subsets - first);
+
+  CAutoFile file(fsbridge::fopen(m_dir_path / FileName(file_id), "rb"),
+                 SER_DISK, PROTOCOL_VERSION);
+  if (file.IsNull()) {
+    return false;
+  }
+
+  subsets_out.clear();
+  subsets_out.reserve(count);
+  try {
+    while (subsets_out.size() < count) {
+      ReadUTXOSubsets(file, subsets_out);
+    }
+  } catch (const std::ios_base::failure &e) {
+    LogPrintf("%s: can't read %s. error: %s\n", __func__,
+              (m_dir_path / FileName(file_id)).string(), e.what());
+    return false;
+  }
+
+  if (subsets_out.size() != count) {
+    LogPrintf("%s: %s has more subsets than expected\n", __func__,
+              (m_dir_path / FileName(file_id)).string());
+    return false;
+  }
+
+  return true;
+}
+
+void Indexer::ReadUTXOSubsets(CAutoFile &file, std::vector<UTXOSubset> &subsets_out) const {
+  if (m_meta.format == SNAPSHOT_FORMAT_COMPRESSED) {
+    ReadCompressedBlock(file, subsets_out);
+    return;
+  }
+
+  subsets_out.emplace_back();
+  file >> subsets_out.back();
+}
+
+uint32_t Indexer::GetFileCount() const {
+  const uint64_t subsets_per_file = m_meta.step * m_meta.steps_per_file;
+  return static_cast<uint32_t>((m_meta.snapshot_header.total_utxo_subsets + subsets_per_file - 1) /
+                               subsets_per_file);
+}
+
+void Indexer::AddFile(const uint32_t file_id, IdxMap &&idx,
+                      const uint32_t subsets) {
+  const uint64_t subsets_per_file = m_meta.step * m_meta.steps_per_file;
+  assert(m_stream.empty() && m_file_idx.empty());
+  assert(m_meta.snapshot_header.total_utxo_subsets == file_id * subsets_per_file);
+  assert(subsets > 0 && subsets <= subsets_per_file);
+
+  m_dir_idx[file_id] = std::move(idx);
+  m_meta.snapshot_header.total_utxo_subsets += subsets;
+}
+
 FILE *Indexer::GetClosestIdx(const uint64_t subset_index, uint32_t &subset_left_out,
                              uint64_t &subset_read_out) {
   auto file_id = static_cast<uint32_t>(subset_index /
@@ -172,6 +313,8 @@ FILE *Indexer::GetClosestIdx(const uint64_t subset_index, uint32_t &subset_left_
 }
 
 bool Indexer::Flush() {
+  FlushBlock();
+
   if (!m_stream.empty()) {
     if (!FlushFile()) {
       return false;
@@ -185,7 +328,46 @@ bool Indexer::Flush() {
   return FlushMeta();
 }
 
-std::string Indexer::FileName(const uint32_t file_id) {
+bool Indexer::WritePartialHash(const SnapshotHash &hash) {
+  CAutoFile file(fsbridge::fopen(m_dir_path / "hash.dat", "wb"), SER_DISK,
+                 CLIENT_VERSION);
+  if (file.IsNull()) {
+    return false;
+  }
+
+  file << m_meta.snapshot_header.total_utxo_subsets;
+  file << hash.GetData();
+  return true;
+}
+
+bool Indexer::ReadPartialHash(SnapshotHash &hash_out) const {
+  CAutoFile file(fsbridge::fopen(m_dir_path / "hash.dat", "rb"), SER_DISK,
+                 CLIENT_VERSION);
+  if (file.IsNull()) {
+    return false;
+  }
+
+  uint64_t total_utxo_subsets = 0;
+  std::vector<uint8_t> data;
+  try {
+    file >> total_utxo_subsets;
+    file >> data;
+  } catch (const std::ios_base::failure &e) {
+    LogPrintf("%s: can't read %s. error: %s\n", __func__,
+              (m_dir_path / "hash.dat").string(), e.what());
+    return false;
+  }
+
+  if (total_utxo_subsets != m_meta.snapshot_header.total_utxo_subsets ||
+      data.size() != sizeof(secp256k1_multiset::d)) {
+    return false;
+  }
+
+  hash_out = SnapshotHash(data);
+  return true;
+}
+
+std::string Indexer::FileName(const uint32_t file_id) const {
   return "utxo" + std::to_string(file_id) + ".dat";
 }
 
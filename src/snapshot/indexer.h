@@ -35,6 +35,9 @@ namespace snapshot {
 //! |      |         |                    | subsets
 //! | 4    | uint32  | steps_per_file     | number of aggregations per
 //! file
+//! | 1    | uint8   | format             | SNAPSHOT_FORMAT_* of utxo???.dat,
+//! |      |         |                    | absent in SNAPSHOT_FORMAT_PLAIN
+//! |      |         |                    | snapshots written before it
 //!
 //! index.dat
 //! | size | type    | field | description
@@ -86,7 +89,10 @@ namespace snapshot {
 //! subset_except_last_file = step * steps_per_file * (number of files - 1)
 //! subset_in_last_index = total_utxo_subsets - subset_except_last_file - last_full_index
 //!
-//! utxo???.dat is the file that stores step * steps_per_file UTXO subsets
+//! utxo???.dat is the file that stores step * steps_per_file UTXO subsets.
+//! In SNAPSHOT_FORMAT_COMPRESSED the subsets of every step are stored in
+//! compressed blocks, see snapshot/compression.h. In SNAPSHOT_FORMAT_PLAIN
+//! they are stored one by one:
 //! UTXOSubset
 //! | size | type    | field        | description
 //! | 32   | uint256 | tx_id        | TX ID that contains UTXOs
@@ -99,6 +105,13 @@ namespace snapshot {
 //! utxo???.dat file has an incremental suffix starting from 0.
 //! File doesn't contain the length of messages/bytes that needs to be read.
 //! This info should be taken from the index
+//!
+//! hash.dat is written only while the snapshot is downloaded. It keeps the
+//! hash of the subsets received so far so the download can be resumed
+//! without hashing the written files again.
+//! | size | type    | field              | description
+//! | 8    | uint64  | total_utxo_subsets | number of hashed UTXO subsets
+//! | N    | vector  | hash               | SnapshotHash::GetData()
 
 constexpr uint32_t DEFAULT_INDEX_STEP = 1000;
 constexpr uint32_t DEFAULT_INDEX_STEP_PER_FILE = 100;
@@ -110,19 +123,30 @@ struct Meta {
   SnapshotHeader snapshot_header;
   uint32_t step = 0;
   uint32_t steps_per_file = 0;
+  uint8_t format = SNAPSHOT_FORMAT_PLAIN;
 
   Meta() = default;
 
   explicit Meta(const SnapshotHeader &_snapshot_header)
       : snapshot_header(_snapshot_header) {}
 
-  ADD_SERIALIZE_METHODS;
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    s << snapshot_header;
+    s << step;
+    s << steps_per_file;
+    s << format;
+  }
 
-  template <typename Stream, typename Operation>
-  inline void SerializationOp(Stream &s, Operation ser_action) {
-    READWRITE(snapshot_header);
-    READWRITE(step);
-    READWRITE(steps_per_file);
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    s >> snapshot_header;
+    s >> step;
+    s >> steps_per_file;
+    format = SNAPSHOT_FORMAT_PLAIN;
+    if (!s.empty()) {
+      s >> format;
+    }
   }
 };
 
@@ -137,12 +161,58 @@ class Indexer {
   static bool Delete(const uint256 &snapshot_hash);
 
   explicit Indexer(const SnapshotHeader &snapshot_header,
-                   uint32_t step, uint32_t steps_per_file);
+                   uint32_t step, uint32_t steps_per_file,
+                   uint8_t format = SNAPSHOT_FORMAT_LATEST);
 
   const SnapshotHeader &GetSnapshotHeader() const { return m_meta.snapshot_header; }
+
+  //! Returns SNAPSHOT_FORMAT_* of the utxo???.dat files
+  uint8_t GetFormat() const { return m_meta.format; }
   bool WriteUTXOSubsets(const std::vector<UTXOSubset> &list);
   bool WriteUTXOSubset(const UTXOSubset &utxo_subset);
 
+  //! \brief WriteFile writes the complete utxo???.dat file with the given ID.
+  //!
+  //! It doesn't change the state of the indexer, so different files can be
+  //! written concurrently. \p subsets must contain step * steps_per_file
+  //! subsets unless it's the last file. Once the file is written, it must be
+  //! registered with AddFile().
+  //!
+  //! \param idx_out the index of the written file
+  bool WriteFile(uint32_t file_id, const std::vector<UTXOSubset> &subsets,
+                 IdxMap &idx_out) const;
+
+  //! \brief ReadFile reads all the subsets of the utxo???.dat file with the given ID.
+  //!
+  //! Like WriteFile(), it doesn't change the state of the indexer, so
+  //! different files can be read concurrently.
+  bool ReadFile(uint32_t file_id, std::vector<UTXOSubset> &subsets_out) const;
+
+  //! Returns the number of utxo???.dat files which hold the written subsets
+  uint32_t GetFileCount() const;
+
+  //! Returns how many subsets every utxo???.dat file but the last one holds
+  uint64_t GetSubsetsPerFile() const { return m_meta.step * m_meta.steps_per_file; }
+
+  fs::path GetFilePath(const uint32_t file_id) const { return m_dir_path / FileName(file_id); }
+
+  //! \brief AddFile registers the file written by WriteFile()
+  //!
+  //! Files must be added in the order of their IDs and can't be mixed with
+  //! WriteUTXOSubset().
+  void AddFile(uint32_t file_id, IdxMap &&idx, uint32_t subsets);
+
+  //! \brief WritePartialHash stores the hash of all the written subsets
+  //!
+  //! Must be invoked after Flush() so the hash matches meta.dat.
+  bool WritePartialHash(const SnapshotHash &hash);
+
+  //! \brief ReadPartialHash restores the hash stored by WritePartialHash()
+  //!
+  //! Returns false if there is no hash or it doesn't cover exactly the
+  //! written subsets.
+  bool ReadPartialHash(SnapshotHash &hash_out) const;
+
   //! \brief GetClosestIdx returns the file which contains the expected
   //! index and adjusts the file cursor as close as possible to the UTXOSubset.
   //!
@@ -158,12 +228,22 @@ class Indexer {
   //!
   //! Can be invoked after each write. It's automatically called when it's time
   //! to switch the file. Must be manually invoked after the last
-  //! WriteUTXOSubset.
+  //! WriteUTXOSubset. In SNAPSHOT_FORMAT_COMPRESSED the subsets of the
+  //! current step which are flushed end up in a separate block.
   bool Flush();
 
+  //! \brief Reads the subsets stored in the snapshot format from the file
+  //!
+  //! Reads at least one subset, in SNAPSHOT_FORMAT_COMPRESSED the whole
+  //! block. Throws std::ios_base::failure if the file can't be read.
+  void ReadUTXOSubsets(CAutoFile &file, std::vector<UTXOSubset> &subsets_out) const;
+
  private:
   Meta m_meta;
-  CDataStream m_stream;  // stores original messages
+  CDataStream m_stream;  // stores serialized messages
+
+  // subsets of the current step which are not compressed yet
+  std::vector<UTXOSubset> m_block;
 
   std::map<uint32_t, IdxMap> m_dir_idx;  // fileID, file index
   IdxMap m_file_idx;                     // current opened file. key=index, value=byte size
@@ -174,8 +254,10 @@ class Indexer {
 
   explicit Indexer(const Meta &meta, std::map<uint32_t, IdxMap> &&dir_idx);
 
-  std::string FileName(uint32_t file_id);
+  std::string FileName(uint32_t file_id) const;
 
+  //! Compresses m_block into m_stream
+  void FlushBlock();
   bool FlushFile();
   bool FlushIndex();
   bool FlushMeta();
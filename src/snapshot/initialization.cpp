@@ -16,6 +16,7 @@
 #include <util.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <atomic>
 
 namespace snapshot {
@@ -31,6 +32,7 @@ bool Initialize(const Params &params) {
   if (!InitSecp256k1Context()) {
     return error("Can't initialize secp256k1_context for the snapshot hash.");
   }
+  SnapshotHash::SetFoldThreads(static_cast<size_t>(std::max(nScriptCheckThreads, 1)));
 
   LoadSnapshotIndex();
 
@@ -4,6 +4,7 @@
 
 #include <snapshot/iterator.h>
 
+#include <cassert>
 #include <map>
 #include <stdexcept>
 
@@ -19,7 +20,8 @@ Iterator::Iterator(std::unique_ptr<Indexer> indexer)
     : m_indexer(std::move(indexer)),
       m_file(nullptr),
       m_read_total(0),
-      m_subset_left(0) {
+      m_subset_left(0),
+      m_block_pos(0) {
   if (m_indexer->GetSnapshotHeader().total_utxo_subsets > 0) {
     Next();
   }
@@ -56,13 +58,20 @@ void Iterator::Next() {
     }
   }
 
-  // CAutoFile is used as a helper to unserialize one utxoSubset record but we
-  // don't want to close the file so we release the ownership right away
-  CAutoFile f(m_file, SER_DISK, PROTOCOL_VERSION);
-  f >> m_utxo_subset;
+  // CAutoFile is used as a helper to unserialize the records but we don't
+  // want to close the file so we release the ownership right away
+  if (m_block_pos == m_block.size()) {
+    m_block.clear();
+    m_block_pos = 0;
+
+    CAutoFile f(m_file, SER_DISK, PROTOCOL_VERSION);
+    m_indexer->ReadUTXOSubsets(f, m_block);
+    f.release();
+  }
+
+  m_utxo_subset = std::move(m_block[m_block_pos++]);
   ++m_read_total;
   --m_subset_left;
-  f.release();
 }
 
 bool Iterator::MoveCursorTo(const uint64_t subset_index) {
@@ -134,17 +143,40 @@ uint256 Iterator::CalculateHash(const uint256 &stake_modifier,
 
   SnapshotHash hash;
   while (Valid()) {
-    UTXOSubset subset = GetUTXOSubset();
-    for (const auto &p : subset.outputs) {
-      const COutPoint out(subset.tx_id, p.first);
-      const Coin coin(p.second, subset.height, subset.tx_type);
-      hash.AddUTXO(UTXO(out, coin));
+    hash.AddUTXOSubset(GetUTXOSubset());
+    Next();
+  }
+
+  return hash.GetHash(stake_modifier, chain_work);
+}
+
+std::vector<std::vector<uint8_t>> Iterator::CalculateChunkHashes(const uint16_t chunk_size) {
+  assert(chunk_size > 0);
+
+  // unwind to the beginning if needed
+  if (m_read_total > 1) {
+    MoveCursorTo(0);
+  }
+
+  std::vector<std::vector<uint8_t>> hashes;
+  SnapshotHash hash;
+  uint16_t subsets = 0;
+  while (Valid()) {
+    hash.AddUTXOSubset(GetUTXOSubset());
+    if (++subsets == chunk_size) {
+      hashes.emplace_back(hash.GetData());
+      hash.Clear();
+      subsets = 0;
     }
 
     Next();
   }
 
-  return hash.GetHash(stake_modifier, chain_work);
+  if (subsets > 0) {
+    hashes.emplace_back(hash.GetData());
+  }
+
+  return hashes;
 }
 
 void Iterator::CloseFile() {
@@ -152,6 +184,9 @@ void Iterator::CloseFile() {
     fclose(m_file);
     m_file = nullptr;
   }
+
+  m_block.clear();
+  m_block_pos = 0;
 }
 
 }  // namespace snapshot
@@ -41,6 +41,10 @@ class Iterator {
   uint256 CalculateHash(const uint256 &stake_modifier,
                         const uint256 &chain_work);
 
+  //! CalculateChunkHashes returns SnapshotHash::GetData() of every chunk of
+  //! chunk_size UTXO subsets. The cursor is left invalid as by CalculateHash.
+  std::vector<std::vector<uint8_t>> CalculateChunkHashes(uint16_t chunk_size);
+
  private:
   std::unique_ptr<Indexer> m_indexer;
 
@@ -50,6 +54,11 @@ class Iterator {
 
   UTXOSubset m_utxo_subset;
 
+  // subsets read from m_file which are not consumed yet, a whole block in
+  // SNAPSHOT_FORMAT_COMPRESSED
+  std::vector<UTXOSubset> m_block;
+  size_t m_block_pos;
+
   void CloseFile();
 };
 }  // namespace snapshot
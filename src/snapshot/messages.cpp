@@ -5,6 +5,8 @@
 #include <snapshot/messages.h>
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include <chain.h>
 #include <coins.h>
@@ -28,6 +30,66 @@ bool InitSecp256k1Context() {
 
 void DestroySecp256k1Context() { secp256k1_context_destroy(context); }
 
+namespace {
+
+std::atomic<size_t> g_fold_threads(1);
+
+std::vector<uint8_t> SerializeUTXO(const UTXO &utxo) {
+  std::vector<uint8_t> data;
+  CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, data, 0);
+  writer << utxo;
+  return data;
+}
+
+//! Drops the UTXOs which are both in added and subtracted as they don't
+//! change the multiset. Leaves both vectors sorted.
+void CancelOut(std::vector<std::vector<uint8_t>> &added,
+               std::vector<std::vector<uint8_t>> &subtracted) {
+  std::sort(added.begin(), added.end());
+  std::sort(subtracted.begin(), subtracted.end());
+
+  auto add_it = added.begin();
+  auto sub_it = subtracted.begin();
+  auto add_out = added.begin();
+  auto sub_out = subtracted.begin();
+  while (add_it != added.end() && sub_it != subtracted.end()) {
+    if (*add_it < *sub_it) {
+      std::swap(*add_out++, *add_it++);
+    } else if (*sub_it < *add_it) {
+      std::swap(*sub_out++, *sub_it++);
+    } else {
+      ++add_it;
+      ++sub_it;
+    }
+  }
+  while (add_it != added.end()) {
+    std::swap(*add_out++, *add_it++);
+  }
+  while (sub_it != subtracted.end()) {
+    std::swap(*sub_out++, *sub_it++);
+  }
+  added.erase(add_out, added.end());
+  subtracted.erase(sub_out, subtracted.end());
+}
+
+//! Applies the pending UTXOs [begin, end) to the multiset. Indexes past the
+//! added UTXOs refer to the subtracted ones.
+void ApplyRange(secp256k1_multiset &multiset,
+                const std::vector<std::vector<uint8_t>> &added,
+                const std::vector<std::vector<uint8_t>> &subtracted,
+                const size_t begin, const size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    if (i < added.size()) {
+      secp256k1_multiset_add(context, &multiset, added[i].data(), added[i].size());
+    } else {
+      const std::vector<uint8_t> &data = subtracted[i - added.size()];
+      secp256k1_multiset_remove(context, &multiset, data.data(), data.size());
+    }
+  }
+}
+
+}  // namespace
+
 SnapshotHash::SnapshotHash() { Clear(); }
 
 SnapshotHash::SnapshotHash(const std::vector<uint8_t> &data) {
@@ -36,25 +98,81 @@ SnapshotHash::SnapshotHash(const std::vector<uint8_t> &data) {
 }
 
 void SnapshotHash::AddUTXO(const UTXO &utxo) {
-  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-  stream << utxo;
-
-  secp256k1_multiset_add(context, &m_multiset,
-                         reinterpret_cast<const uint8_t *>(stream.data()),
-                         stream.size());
+  m_pending_added.emplace_back(SerializeUTXO(utxo));
+  if (m_pending_added.size() + m_pending_subtracted.size() >= MAX_PENDING_UTXOS) {
+    Fold();
+  }
 }
 
 void SnapshotHash::SubtractUTXO(const UTXO &utxo) {
-  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-  stream << utxo;
+  m_pending_subtracted.emplace_back(SerializeUTXO(utxo));
+  if (m_pending_added.size() + m_pending_subtracted.size() >= MAX_PENDING_UTXOS) {
+    Fold();
+  }
+}
+
+void SnapshotHash::AddUTXOSubset(const UTXOSubset &subset) {
+  for (const auto &p : subset.outputs) {
+    const COutPoint out(subset.tx_id, p.first);
+    const Coin coin(p.second, subset.height, subset.tx_type);
+    AddUTXO(UTXO(out, coin));
+  }
+}
 
-  secp256k1_multiset_remove(context, &m_multiset,
-                            reinterpret_cast<const uint8_t *>(stream.data()),
-                            stream.size());
+void SnapshotHash::Combine(const SnapshotHash &other) {
+  Fold();
+  other.Fold();
+  secp256k1_multiset_combine(context, &m_multiset, &other.m_multiset);
+}
+
+void SnapshotHash::Fold() const {
+  if (m_pending_added.empty() && m_pending_subtracted.empty()) {
+    return;
+  }
+
+  CancelOut(m_pending_added, m_pending_subtracted);
+
+  const size_t total = m_pending_added.size() + m_pending_subtracted.size();
+  const size_t threads = std::max<size_t>(1, std::min(g_fold_threads.load(), total / MIN_UTXOS_PER_THREAD));
+
+  if (threads == 1) {
+    ApplyRange(m_multiset, m_pending_added, m_pending_subtracted, 0, total);
+  } else {
+    // Hashing the UTXOs to curve points dominates the cost, every thread
+    // accumulates its share into a separate multiset and the partial results
+    // are combined at the end. The multiset is commutative so the order in
+    // which the UTXOs are applied doesn't change the hash.
+    std::vector<secp256k1_multiset> partial(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 0; i < threads; ++i) {
+      secp256k1_multiset_init(context, &partial[i]);
+      const size_t begin = total * i / threads;
+      const size_t end = total * (i + 1) / threads;
+      if (i + 1 == threads) {
+        ApplyRange(partial[i], m_pending_added, m_pending_subtracted, begin, end);
+      } else {
+        workers.emplace_back([this, &partial, i, begin, end] {
+          ApplyRange(partial[i], m_pending_added, m_pending_subtracted, begin, end);
+        });
+      }
+    }
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+    for (const secp256k1_multiset &multiset : partial) {
+      secp256k1_multiset_combine(context, &m_multiset, &multiset);
+    }
+  }
+
+  m_pending_added.clear();
+  m_pending_subtracted.clear();
 }
 
 uint256 SnapshotHash::GetHash(const uint256 &stake_modifier,
                               const uint256 &chain_work) const {
+  Fold();
+
   CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
   stream << stake_modifier;
   stream << chain_work;
@@ -79,12 +197,21 @@ std::vector<uint8_t> SnapshotHash::GetHashVector(const CBlockIndex &block_index)
   return std::vector<uint8_t>(hash.begin(), hash.end());
 }
 
-void SnapshotHash::Clear() { secp256k1_multiset_init(context, &m_multiset); }
+void SnapshotHash::Clear() {
+  secp256k1_multiset_init(context, &m_multiset);
+  m_pending_added.clear();
+  m_pending_subtracted.clear();
+}
 
 std::vector<uint8_t> SnapshotHash::GetData() const {
+  Fold();
   std::vector<uint8_t> data(sizeof(m_multiset.d));
   std::copy(std::begin(m_multiset.d), std::end(m_multiset.d), data.begin());
   return data;
 }
 
+void SnapshotHash::SetFoldThreads(const size_t threads) {
+  g_fold_threads = std::max<size_t>(threads, 1);
+}
+
 }  // namespace snapshot
@@ -17,6 +17,16 @@ class CBlockIndex;
 
 namespace snapshot {
 
+//! Formats in which the UTXO subsets are stored in utxo???.dat files and
+//! sent to peers. The subsets are serialized one by one as UTXOSubset.
+constexpr uint8_t SNAPSHOT_FORMAT_PLAIN = 0;
+
+//! The subsets are grouped into compressed blocks, see snapshot/compression.h
+constexpr uint8_t SNAPSHOT_FORMAT_COMPRESSED = 1;
+
+//! The format new snapshots are written in and requested from peers
+constexpr uint8_t SNAPSHOT_FORMAT_LATEST = SNAPSHOT_FORMAT_COMPRESSED;
+
 //! UTXOSubset type is used to transfer the snapshot over P2P and to store the
 //! snapshot on disk too. It is used instead of UTXO because it has more compact
 //! form, doesn't repeat TX specific fields for each output.
@@ -97,10 +107,16 @@ struct SnapshotHeader {
 };
 
 //! \brief message to request the snapshot chunk
+//!
+//! format is the latest snapshot format the node understands. Peer replies
+//! with the "cmpsnapshot" message if it supports SNAPSHOT_FORMAT_COMPRESSED
+//! too, otherwise with the "snapshot" one. format is omitted when it's
+//! SNAPSHOT_FORMAT_PLAIN, so nodes which don't know it ignore it.
 struct GetSnapshot {
   uint256 snapshot_hash;
   uint64_t utxo_subset_index = 0;
   uint16_t utxo_subset_count = 0;
+  uint8_t format = SNAPSHOT_FORMAT_PLAIN;
 
   GetSnapshot() = default;
 
@@ -109,13 +125,25 @@ struct GetSnapshot {
         utxo_subset_index(0),
         utxo_subset_count(0) {}
 
-  ADD_SERIALIZE_METHODS;
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    s << snapshot_hash;
+    s << utxo_subset_index;
+    s << utxo_subset_count;
+    if (format != SNAPSHOT_FORMAT_PLAIN) {
+      s << format;
+    }
+  }
 
-  template <typename Stream, typename Operation>
-  inline void SerializationOp(Stream &s, Operation ser_action) {
-    READWRITE(snapshot_hash);
-    READWRITE(utxo_subset_index);
-    READWRITE(utxo_subset_count);
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    s >> snapshot_hash;
+    s >> utxo_subset_index;
+    s >> utxo_subset_count;
+    format = SNAPSHOT_FORMAT_PLAIN;
+    if (!s.empty()) {
+      s >> format;
+    }
   }
 };
 
@@ -143,6 +171,66 @@ struct Snapshot {
   }
 };
 
+//! \brief Snapshot message which is built from the serialized UTXO subsets
+//!
+//! It's serialized exactly as Snapshot or SnapshotCompressor, depending on
+//! the format of utxo_subsets. They point to the subsets of utxo_subset_count
+//! subsets in total which are written to the stream as they are, so they
+//! must stay alive until the message is serialized.
+struct SerializedSnapshot {
+  uint256 snapshot_hash;
+  uint64_t utxo_subset_index = 0;
+  uint64_t utxo_subset_count = 0;
+  std::vector<std::pair<const char *, size_t>> utxo_subsets;
+
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    s << snapshot_hash;
+    s << utxo_subset_index;
+    WriteCompactSize(s, utxo_subset_count);
+    for (const auto &subsets : utxo_subsets) {
+      s.write(subsets.first, subsets.second);
+    }
+  }
+};
+
+//! \brief message to request the hashes of the snapshot chunks
+//!
+//! The snapshot is split into chunks of chunk_size UTXO subsets, the last one
+//! can be shorter. Peer should respond with the ChunkHashes message.
+struct GetChunkHashes {
+  uint256 snapshot_hash;
+  uint16_t chunk_size = 0;
+
+  ADD_SERIALIZE_METHODS;
+
+  template <typename Stream, typename Operation>
+  inline void SerializationOp(Stream &s, Operation ser_action) {
+    READWRITE(snapshot_hash);
+    READWRITE(chunk_size);
+  }
+};
+
+//! \brief message is used to reply to GetChunkHashes P2P request
+//!
+//! Every hash is SnapshotHash::GetData() of the UTXOs of one chunk. Combined
+//! they give the snapshot hash, so the node can check them before any chunk
+//! is downloaded and then check every chunk as soon as it arrives.
+struct ChunkHashes {
+  uint256 snapshot_hash;
+  uint16_t chunk_size = 0;
+  std::vector<std::vector<uint8_t>> hashes;
+
+  ADD_SERIALIZE_METHODS;
+
+  template <typename Stream, typename Operation>
+  inline void SerializationOp(Stream &s, Operation ser_action) {
+    READWRITE(snapshot_hash);
+    READWRITE(chunk_size);
+    READWRITE(hashes);
+  }
+};
+
 //! UTXO is a representation of a single output and used to calculate the
 //! snapshot hash. Coin class (which has the same schema) is not used as it
 //! doesn't follow the P2P serialization convention.
@@ -173,14 +261,38 @@ struct UTXO {
   }
 };
 
+//! SnapshotHash is a multiset hash of the UTXO set.
+//!
+//! Added and subtracted UTXOs are not applied to the multiset right away, they
+//! are collected and folded in one batch when the hash is requested (usually
+//! once per connected block). UTXOs which are added and then spent before the
+//! fold cancel each other out without any EC operation, the remaining ones are
+//! hashed to the curve in parallel. The resulting hash is the same as if every
+//! UTXO was applied one by one.
 class SnapshotHash {
  public:
+  //! Number of pending UTXOs after which AddUTXO/SubtractUTXO fold them
+  //! right away to keep the memory usage bounded.
+  static constexpr size_t MAX_PENDING_UTXOS = 100000;
+
+  //! Batches smaller than this are folded on the calling thread.
+  static constexpr size_t MIN_UTXOS_PER_THREAD = 256;
+
   SnapshotHash();
   explicit SnapshotHash(const std::vector<uint8_t> &data);
 
   void AddUTXO(const UTXO &utxo);
   void SubtractUTXO(const UTXO &utxo);
 
+  //! Adds every output of the subset as a separate UTXO
+  void AddUTXOSubset(const UTXOSubset &subset);
+
+  //! Adds all the UTXOs of other to this hash
+  void Combine(const SnapshotHash &other);
+
+  //! Applies all pending UTXOs to the multiset.
+  void Fold() const;
+
   //! GetHash returns the hash that represents the snapshot
   //!
   //! \param stake_modifier which points to the same height as the snapshot hash
@@ -199,8 +311,16 @@ class SnapshotHash {
   //! GetData returns internals of the hash and used to restore the state.
   std::vector<uint8_t> GetData() const;
 
+  //! Sets how many threads are used to fold a batch of UTXOs. The node uses
+  //! the same number as for the script verification.
+  static void SetFoldThreads(size_t threads);
+
  private:
-  secp256k1_multiset m_multiset;
+  mutable secp256k1_multiset m_multiset;
+
+  //! Serialized UTXOs which are not applied to m_multiset yet
+  mutable std::vector<std::vector<uint8_t>> m_pending_added;
+  mutable std::vector<std::vector<uint8_t>> m_pending_subtracted;
 };
 
 //! InitSecp256k1Context creates secp256k1_context. If creation failed,
@@ -5,6 +5,9 @@
 #include <snapshot/p2p_processing.h>
 
 #include <esperanza/finalizationstate.h>
+#include <net_processing.h>
+#include <snapshot/chunk_reader.h>
+#include <snapshot/compression.h>
 #include <snapshot/iterator.h>
 #include <snapshot/snapshot_index.h>
 #include <snapshot/state.h>
@@ -13,6 +16,8 @@
 #include <util.h>
 #include <validation.h>
 
+#include <thread>
+
 namespace snapshot {
 
 inline const CBlockIndex *LookupFinalizedBlockIndex(const uint256 &hash,
@@ -29,6 +34,59 @@ inline const CBlockIndex *LookupFinalizedBlockIndex(const uint256 &hash,
   return bi;
 }
 
+namespace {
+
+//! Returns the hash which identifies the UTXOs of the chunk
+uint256 ChunkDigest(const SnapshotHash &hash) {
+  return hash.GetHash(uint256(), uint256());
+}
+
+uint256 ChunkDigest(const std::vector<UTXOSubset> &subsets) {
+  SnapshotHash hash;
+  for (const UTXOSubset &subset : subsets) {
+    hash.AddUTXOSubset(subset);
+  }
+  return ChunkDigest(hash);
+}
+
+bool HasSnapshot(const uint256 &snapshot_hash) {
+  for (const Checkpoint &p : GetSnapshotCheckpoints()) {
+    if (p.snapshot_hash == snapshot_hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//! Checks that the chunk hashes add up to the snapshot hash and returns
+//! the digests of the chunks
+bool CheckChunkHashes(const SnapshotHeader &snapshot_header, const ChunkHashes &msg,
+                      std::vector<uint256> &digests_out) {
+  const uint64_t total = snapshot_header.total_utxo_subsets;
+  if (msg.chunk_size == 0 ||
+      msg.hashes.size() != (total + msg.chunk_size - 1) / msg.chunk_size) {
+    return false;
+  }
+
+  digests_out.clear();
+  digests_out.reserve(msg.hashes.size());
+
+  SnapshotHash snapshot_hash;
+  for (const std::vector<uint8_t> &data : msg.hashes) {
+    if (data.size() != sizeof(secp256k1_multiset::d)) {
+      return false;
+    }
+    const SnapshotHash chunk_hash(data);
+    digests_out.emplace_back(ChunkDigest(chunk_hash));
+    snapshot_hash.Combine(chunk_hash);
+  }
+
+  return snapshot_hash.GetHash(snapshot_header.stake_modifier,
+                               snapshot_header.chain_work) == snapshot_header.snapshot_hash;
+}
+
+}  // namespace
+
 P2PState::P2PState(const Params &params) : m_params(params) {
 }
 
@@ -75,36 +133,45 @@ bool P2PState::ProcessGetSnapshot(CNode &node, CDataStream &data,
 
   LOCK(cs_snapshot);
 
-  std::unique_ptr<Indexer> indexer = SnapshotIndex::OpenSnapshot(get.snapshot_hash);
-  if (!indexer) {
-    // todo: send notfound that node can act immediately
-    // instead of waiting for timeout
-    LogPrint(BCLog::SNAPSHOT, "%s: can't find snapshot %s\n",
-             NetMsgType::GETSNAPSHOT,
-             get.snapshot_hash.GetHex());
-    return false;
+  // the files of the snapshot stay mapped while peers download it
+  if (!m_chunk_reader ||
+      m_chunk_reader->GetSnapshotHeader().snapshot_hash != get.snapshot_hash ||
+      !HasSnapshot(get.snapshot_hash)) {
+    m_chunk_reader.reset();
+
+    std::unique_ptr<Indexer> indexer = SnapshotIndex::OpenSnapshot(get.snapshot_hash);
+    if (!indexer) {
+      // todo: send notfound that node can act immediately
+      // instead of waiting for timeout
+      LogPrint(BCLog::SNAPSHOT, "%s: can't find snapshot %s\n",
+               NetMsgType::GETSNAPSHOT,
+               get.snapshot_hash.GetHex());
+      return false;
+    }
+    m_chunk_reader.reset(new ChunkReader(std::move(indexer)));
   }
 
-  Iterator iter(std::move(indexer));
-  Snapshot snapshot;
-  snapshot.snapshot_hash = iter.GetSnapshotHeader().snapshot_hash;
-  snapshot.utxo_subset_index = get.utxo_subset_index;
+  // reply in the latest format both nodes support
+  const uint8_t format = std::min(get.format, SNAPSHOT_FORMAT_LATEST);
+  const char *const command = format == SNAPSHOT_FORMAT_COMPRESSED ? NetMsgType::COMPRESSED_SNAPSHOT
+                                                                   : NetMsgType::SNAPSHOT;
 
-  if (!iter.GetUTXOSubsets(snapshot.utxo_subset_index, get.utxo_subset_count,
-                           snapshot.utxo_subsets)) {
+  SerializedSnapshot snapshot;
+  if (!m_chunk_reader->ReadChunk(get.utxo_subset_index, get.utxo_subset_count, format, snapshot)) {
     LogPrint(BCLog::SNAPSHOT, "%s: requested chunk is invalid index=%i count=%i\n",
              NetMsgType::GETSNAPSHOT,
-             snapshot.utxo_subset_index, get.utxo_subset_count);
+             get.utxo_subset_index, get.utxo_subset_count);
     return false;
   }
 
-  LogPrint(BCLog::SNAPSHOT, "%s: return chunk index=%i count=%i to peer=%i\n",
+  LogPrint(BCLog::SNAPSHOT, "%s: return %s index=%i count=%i to peer=%i\n",
            NetMsgType::GETSNAPSHOT,
+           command,
            snapshot.utxo_subset_index,
-           snapshot.utxo_subsets.size(),
+           snapshot.utxo_subset_count,
            node.GetId());
 
-  g_connman->PushMessage(&node, msg_maker.Make(NetMsgType::SNAPSHOT, snapshot));
+  g_connman->PushMessage(&node, msg_maker.Make(command, snapshot));
   return true;
 }
 
@@ -120,7 +187,8 @@ bool P2PState::SendGetSnapshot(CNode &node, GetSnapshot &msg,
 }
 
 bool P2PState::ProcessSnapshot(CNode &node, CDataStream &data,
-                               const CNetMsgMaker &msg_maker) {
+                               const CNetMsgMaker &msg_maker,
+                               const uint8_t format) {
   if (!IsISDEnabled()) {
     LogPrint(BCLog::SNAPSHOT, "%s: ignore the message. ISD is disabled\n",
              NetMsgType::SNAPSHOT);
@@ -149,7 +217,12 @@ bool P2PState::ProcessSnapshot(CNode &node, CDataStream &data,
   }
 
   Snapshot msg;
-  data >> msg;
+  if (format == SNAPSHOT_FORMAT_COMPRESSED) {
+    SnapshotCompressor compressor(msg);
+    data >> compressor;
+  } else {
+    data >> msg;
+  }
   if (node.m_best_snapshot.IsNull() ||
       msg.snapshot_hash != node.m_best_snapshot.snapshot_hash) {
     g_connman->Ban(node.addr, BanReasonNodeMisbehaving);
@@ -164,65 +237,224 @@ bool P2PState::ProcessSnapshot(CNode &node, CDataStream &data,
 
   LOCK2(cs_main, cs_snapshot);
 
-  std::unique_ptr<Indexer> indexer = Indexer::Open(msg.snapshot_hash);
+  DownloadScheduler &scheduler = GetScheduler();
+  if (!scheduler.IsExpected(node.GetId(), msg.utxo_subset_index, msg.utxo_subsets.size())) {
+    LogPrint(BCLog::SNAPSHOT, "%s: not requested index=%i len=%i from peer=%i\n",
+             NetMsgType::SNAPSHOT,
+             msg.utxo_subset_index, msg.utxo_subsets.size(), node.GetId());
+    RequestChunks(node, msg_maker);
+    return false;
+  }
+
+  LogPrint(BCLog::SNAPSHOT, "%s: received index=%i len=%i from peer=%i\n",
+           NetMsgType::SNAPSHOT,
+           msg.utxo_subset_index, msg.utxo_subsets.size(), node.GetId());
+
+  // check the chunk right away if the peer committed to it
+  const auto chunk_hashes = m_chunk_hashes.find(node.GetId());
+  if (chunk_hashes != m_chunk_hashes.end() &&
+      scheduler.IsChunk(msg.utxo_subset_index, msg.utxo_subsets.size())) {
+    const uint64_t chunk = msg.utxo_subset_index / m_params.snapshot_chunk_size;
+    if (ChunkDigest(msg.utxo_subsets) != chunk_hashes->second[chunk]) {
+      LogPrint(BCLog::SNAPSHOT, "%s: invalid chunk index=%i from peer=%i\n",
+               NetMsgType::SNAPSHOT, msg.utxo_subset_index, node.GetId());
+      RemoveSnapshotPeer(node);
+      Misbehaving(node.GetId(), 100);
+      return false;
+    }
+  }
+
+  node.m_requested_snapshot_at = steady_clock::now();
+  scheduler.Received(node.GetId(), msg.utxo_subset_index, std::move(msg.utxo_subsets));
+
+  std::vector<UTXOSubset> ready;
+  scheduler.TakeReady(ready);
+  if (!ready.empty()) {
+    std::unique_ptr<Indexer> indexer = Indexer::Open(msg.snapshot_hash);
+    if (!indexer) {
+      indexer.reset(new Indexer(node.m_best_snapshot,
+                                DEFAULT_INDEX_STEP, DEFAULT_INDEX_STEP_PER_FILE));
+    }
+
+    // hash the subsets while they are written so the snapshot doesn't have
+    // to be read back from disk once the last chunk arrives
+    std::thread hasher([this, &ready] {
+      for (const UTXOSubset &subset : ready) {
+        m_partial_hash.AddUTXOSubset(subset);
+      }
+      m_partial_hash.Fold();
+    });
+    const bool written = indexer->WriteUTXOSubsets(ready) && indexer->Flush();
+    hasher.join();
+
+    if (!written || !indexer->WritePartialHash(m_partial_hash)) {
+      LogPrint(BCLog::SNAPSHOT, "%s: can't write message\n", NetMsgType::SNAPSHOT);
+
+      // continue from the subsets which are on disk
+      m_scheduler.reset();
+      return false;
+    }
+
+    if (scheduler.IsComplete()) {
+      const uint256 hash = m_partial_hash.GetHash(node.m_best_snapshot.stake_modifier,
+                                                  node.m_best_snapshot.chain_work);
+      if (hash != msg.snapshot_hash) {
+        LogPrint(BCLog::SNAPSHOT, "%s: invalid hash. has=%s got=%s\n",
+                 NetMsgType::SNAPSHOT,
+                 HexStr(hash), HexStr(msg.snapshot_hash));
+
+        // restart the initial download from the beginning
+        Indexer::Delete(msg.snapshot_hash);
+        m_downloading_snapshot.SetNull();
+        node.m_best_snapshot.SetNull();
+        m_scheduler.reset();
+
+        return false;
+      }
+
+      StoreCandidateBlockHash(indexer->GetSnapshotHeader().block_hash);
+      const CBlockIndex *const bi = LookupBlockIndex(node.m_best_snapshot.block_hash);
+      assert(bi);
+      AddSnapshotHash(m_downloading_snapshot.snapshot_hash, bi);
+
+      LogPrint(BCLog::SNAPSHOT, "%s: finished downloading the snapshot\n",
+               NetMsgType::SNAPSHOT);
+      return true;
+    }
+  }
+
+  RequestChunks(node, msg_maker);
+  return true;
+}
+
+bool P2PState::ProcessGetChunkHashes(CNode &node, CDataStream &data,
+                                     const CNetMsgMaker &msg_maker) {
+  GetChunkHashes get;
+  data >> get;
+
+  if (get.chunk_size == 0) {
+    LogPrint(BCLog::SNAPSHOT, "%s: invalid chunk size\n", NetMsgType::GETCHUNKHASHES);
+    return false;
+  }
+
+  LOCK(cs_snapshot);
+
+  std::unique_ptr<Indexer> indexer = SnapshotIndex::OpenSnapshot(get.snapshot_hash);
   if (!indexer) {
-    indexer.reset(new Indexer(node.m_best_snapshot,
-                              DEFAULT_INDEX_STEP, DEFAULT_INDEX_STEP_PER_FILE));
+    LogPrint(BCLog::SNAPSHOT, "%s: can't find snapshot %s\n",
+             NetMsgType::GETCHUNKHASHES,
+             get.snapshot_hash.GetHex());
+    return false;
   }
 
-  if (indexer->GetSnapshotHeader().total_utxo_subsets != msg.utxo_subset_index) {
-    // ask the peer the correct index
-    GetSnapshot get(msg.snapshot_hash);
-    get.utxo_subset_index = indexer->GetSnapshotHeader().total_utxo_subsets;
-    get.utxo_subset_count = MAX_UTXO_SET_COUNT;
-    return SendGetSnapshot(node, get, msg_maker);
+  const uint64_t total = indexer->GetSnapshotHeader().total_utxo_subsets;
+  if ((total + get.chunk_size - 1) / get.chunk_size > MAX_CHUNK_HASHES) {
+    LogPrint(BCLog::SNAPSHOT, "%s: too many chunks of size=%i\n",
+             NetMsgType::GETCHUNKHASHES, get.chunk_size);
+    return false;
   }
 
-  LogPrint(BCLog::SNAPSHOT, "%s: received index=%i len=%i\n",
-           NetMsgType::SNAPSHOT,
-           msg.utxo_subset_index, msg.utxo_subsets.size());
+  if (m_served_chunk_hashes.snapshot_hash != get.snapshot_hash ||
+      m_served_chunk_hashes.chunk_size != get.chunk_size) {
+    Iterator iter(std::move(indexer));
+    m_served_chunk_hashes.snapshot_hash = get.snapshot_hash;
+    m_served_chunk_hashes.chunk_size = get.chunk_size;
+    m_served_chunk_hashes.hashes = iter.CalculateChunkHashes(get.chunk_size);
+  }
+
+  LogPrint(BCLog::SNAPSHOT, "%s: return %i hashes to peer=%i\n",
+           NetMsgType::GETCHUNKHASHES,
+           m_served_chunk_hashes.hashes.size(),
+           node.GetId());
+
+  g_connman->PushMessage(&node, msg_maker.Make(NetMsgType::CHUNKHASHES, m_served_chunk_hashes));
+  return true;
+}
+
+bool P2PState::ProcessChunkHashes(CNode &node, CDataStream &data) {
+  ChunkHashes msg;
+  data >> msg;
 
-  if (!indexer->WriteUTXOSubsets(msg.utxo_subsets)) {
-    LogPrint(BCLog::SNAPSHOT, "%s: can't write message\n", NetMsgType::SNAPSHOT);
+  if (m_downloading_snapshot.IsNull() ||
+      msg.snapshot_hash != m_downloading_snapshot.snapshot_hash ||
+      m_chunk_hashes_requested.count(node.GetId()) == 0) {
+    LogPrint(BCLog::SNAPSHOT, "%s: not requested from peer=%i\n",
+             NetMsgType::CHUNKHASHES, node.GetId());
     return false;
   }
 
-  if (!indexer->Flush()) {
-    LogPrint(BCLog::SNAPSHOT, "%s: can't update indexer\n", NetMsgType::SNAPSHOT);
+  std::vector<uint256> digests;
+  if (msg.chunk_size != m_params.snapshot_chunk_size ||
+      !CheckChunkHashes(m_downloading_snapshot, msg, digests)) {
+    LogPrint(BCLog::SNAPSHOT, "%s: invalid hashes from peer=%i\n",
+             NetMsgType::CHUNKHASHES, node.GetId());
+    LOCK(cs_main);
+    RemoveSnapshotPeer(node);
+    Misbehaving(node.GetId(), 100);
     return false;
   }
 
-  if (indexer->GetSnapshotHeader().total_utxo_subsets == node.m_best_snapshot.total_utxo_subsets) {
-    Iterator iterator(std::move(indexer));
-    uint256 hash = iterator.CalculateHash(node.m_best_snapshot.stake_modifier,
-                                          node.m_best_snapshot.chain_work);
-    if (hash != msg.snapshot_hash) {
-      LogPrint(BCLog::SNAPSHOT, "%s: invalid hash. has=%s got=%s\n",
-               NetMsgType::SNAPSHOT,
-               HexStr(hash), HexStr(msg.snapshot_hash));
+  LogPrint(BCLog::SNAPSHOT, "%s: received %i hashes from peer=%i\n",
+           NetMsgType::CHUNKHASHES, digests.size(), node.GetId());
 
-      // restart the initial download from the beginning
-      Indexer::Delete(msg.snapshot_hash);
-      m_downloading_snapshot.SetNull();
-      node.m_best_snapshot.SetNull();
+  m_chunk_hashes[node.GetId()] = std::move(digests);
+  return true;
+}
 
-      return false;
+DownloadScheduler &P2PState::GetScheduler() {
+  AssertLockHeld(cs_snapshot);
+  assert(!m_downloading_snapshot.IsNull());
+
+  if (!m_scheduler || m_scheduler->GetSnapshotHeader() != m_downloading_snapshot) {
+    // continue from the subsets which were downloaded before the restart
+    uint64_t written = 0;
+    m_partial_hash.Clear();
+    std::unique_ptr<const Indexer> indexer = Indexer::Open(m_downloading_snapshot.snapshot_hash);
+    if (indexer) {
+      if (indexer->ReadPartialHash(m_partial_hash)) {
+        written = indexer->GetSnapshotHeader().total_utxo_subsets;
+      } else {
+        LogPrint(BCLog::SNAPSHOT, "can't resume verification of snapshot %s, download it again\n",
+                 m_downloading_snapshot.snapshot_hash.GetHex());
+        Indexer::Delete(m_downloading_snapshot.snapshot_hash);
+      }
     }
 
-    StoreCandidateBlockHash(iterator.GetSnapshotHeader().block_hash);
-    const CBlockIndex *const bi = LookupBlockIndex(node.m_best_snapshot.block_hash);
-    assert(bi);
-    AddSnapshotHash(m_downloading_snapshot.snapshot_hash, bi);
+    m_scheduler.reset(new DownloadScheduler(m_downloading_snapshot, written,
+                                            m_params.snapshot_chunk_size,
+                                            SNAPSHOT_DOWNLOAD_WINDOW,
+                                            MAX_SNAPSHOT_REQUESTS_PER_PEER));
+    m_chunk_hashes_requested.clear();
+    m_chunk_hashes.clear();
+  }
 
-    LogPrint(BCLog::SNAPSHOT, "%s: finished downloading the snapshot\n",
-             NetMsgType::SNAPSHOT);
-    return true;
+  return *m_scheduler;
+}
+
+void P2PState::RequestChunks(CNode &node, const CNetMsgMaker &msg_maker) {
+  DownloadScheduler &scheduler = GetScheduler();
+
+  if (m_chunk_hashes_requested.insert(node.GetId()).second) {
+    GetChunkHashes get;
+    get.snapshot_hash = m_downloading_snapshot.snapshot_hash;
+    get.chunk_size = m_params.snapshot_chunk_size;
+    LogPrint(BCLog::SNAPSHOT, "send %s: peer=%i\n", NetMsgType::GETCHUNKHASHES, node.GetId());
+    g_connman->PushMessage(&node, msg_maker.Make(NetMsgType::GETCHUNKHASHES, get));
   }
 
-  GetSnapshot get(msg.snapshot_hash);
-  get.utxo_subset_index = msg.utxo_subset_index + msg.utxo_subsets.size();
-  get.utxo_subset_count = MAX_UTXO_SET_COUNT;
-  return SendGetSnapshot(node, get, msg_maker);
+  GetSnapshot get(m_downloading_snapshot.snapshot_hash);
+  get.format = SNAPSHOT_FORMAT_LATEST;
+  while (scheduler.NextRequest(node.GetId(), get.utxo_subset_index, get.utxo_subset_count)) {
+    SendGetSnapshot(node, get, msg_maker);
+  }
+}
+
+void P2PState::RemoveSnapshotPeer(CNode &node) {
+  node.m_best_snapshot.SetNull();
+  m_chunk_hashes.erase(node.GetId());
+  if (m_scheduler) {
+    m_scheduler->RemovePeer(node.GetId());
+  }
 }
 
 void P2PState::StartInitialSnapshotDownload(CNode &node, const size_t node_index, const size_t total_nodes,
@@ -246,7 +478,9 @@ void P2PState::StartInitialSnapshotDownload(CNode &node, const size_t node_index
   if (node_index == 0) {
     m_best_snapshot.SetNull();
     m_in_flight_snapshot_discovery = false;
+    m_connected_peers.clear();
   }
+  m_connected_peers.insert(node.GetId());
 
   if (m_first_discovery_request_at == time_point::min()) {
     m_first_discovery_request_at = steady_clock::now();
@@ -279,26 +513,18 @@ void P2PState::StartInitialSnapshotDownload(CNode &node, const size_t node_index
     SetIfBestSnapshot(node_best_snapshot, last_finalized_checkpoint);
 
     // if the peer has the snapshot that node decided to download
-    // ask for the relevant chunk from it
-    if (node_best_snapshot == m_downloading_snapshot &&
-        node.m_requested_snapshot_at == time_point::min()) {
-      GetSnapshot msg;
-      msg.snapshot_hash = m_downloading_snapshot.snapshot_hash;
-      msg.utxo_subset_index = 0;
-      msg.utxo_subset_count = MAX_UTXO_SET_COUNT;
-
-      {
-        LOCK(cs_snapshot);
-        std::unique_ptr<const Indexer> indexer = Indexer::Open(node.m_best_snapshot.snapshot_hash);
-        if (indexer) {
-          msg.utxo_subset_index = indexer->GetSnapshotHeader().total_utxo_subsets;
-        }
-      }
-
-      SendGetSnapshot(node, msg, msg_maker);
+    // ask for the chunks it has free slots for
+    if (node_best_snapshot == m_downloading_snapshot) {
+      LOCK(cs_snapshot);
+      RequestChunks(node, msg_maker);
     }
   }
 
+  // requests to the disconnected peers go to the others
+  if (node_index + 1 == total_nodes && m_scheduler) {
+    m_scheduler->RetainPeers(m_connected_peers);
+  }
+
   // last peer processed, decide on the best snapshot
   if (node_index + 1 == total_nodes && !m_in_flight_snapshot_discovery) {
     if (m_downloading_snapshot.IsNull()) {
@@ -311,6 +537,7 @@ void P2PState::StartInitialSnapshotDownload(CNode &node, const size_t node_index
       LOCK(cs_snapshot);
       Indexer::Delete(m_downloading_snapshot.snapshot_hash);
       m_downloading_snapshot = m_best_snapshot;
+      m_scheduler.reset();
     }
 
     // if there are no peers that can provide the snapshot switch to IBD
@@ -505,12 +732,17 @@ SnapshotHeader P2PState::NodeBestSnapshot(CNode &node, const CBlockIndex &last_f
     return node.m_best_snapshot;
   }
 
+  // peer that waits for the window to move can't time out
+  if (!m_scheduler || !m_scheduler->HasRequestsInFlight(node.GetId())) {
+    return node.m_best_snapshot;
+  }
+
   // check timeout
   const auto now = steady_clock::now();
   const auto diff = now - node.m_requested_snapshot_at;
   const auto diff_sec = std::chrono::duration_cast<std::chrono::seconds>(diff);
   if (diff_sec.count() > m_params.snapshot_chunk_timeout_sec) {
-    node.m_best_snapshot.SetNull();
+    RemoveSnapshotPeer(node);
     return {};
   }
 
@@ -637,8 +869,17 @@ bool ProcessGetSnapshot(CNode &node, CDataStream &data,
 }
 
 bool ProcessSnapshot(CNode &node, CDataStream &data,
-                     const CNetMsgMaker &msg_maker) {
-  return g_p2p_state.ProcessSnapshot(node, data, msg_maker);
+                     const CNetMsgMaker &msg_maker, const uint8_t format) {
+  return g_p2p_state.ProcessSnapshot(node, data, msg_maker, format);
+}
+
+bool ProcessGetChunkHashes(CNode &node, CDataStream &data,
+                           const CNetMsgMaker &msg_maker) {
+  return g_p2p_state.ProcessGetChunkHashes(node, data, msg_maker);
+}
+
+bool ProcessChunkHashes(CNode &node, CDataStream &data) {
+  return g_p2p_state.ProcessChunkHashes(node, data);
 }
 
 void StartInitialSnapshotDownload(CNode &node, const size_t node_index, const size_t total_nodes,
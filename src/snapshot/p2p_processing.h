@@ -9,12 +9,16 @@
 
 #include <stdint.h>
 #include <chrono>
+#include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
 #include <chain.h>
 #include <net.h>
 #include <netmessagemaker.h>
+#include <snapshot/chunk_reader.h>
+#include <snapshot/download_scheduler.h>
 #include <snapshot/indexer.h>
 #include <snapshot/messages.h>
 #include <streams.h>
@@ -24,6 +28,15 @@ namespace snapshot {
 
 constexpr uint16_t MAX_UTXO_SET_COUNT = 10000;
 
+//! how many chunks ahead of the first missing one can be requested
+constexpr size_t SNAPSHOT_DOWNLOAD_WINDOW = 16;
+
+//! how many chunks can be requested from one peer at once
+constexpr size_t MAX_SNAPSHOT_REQUESTS_PER_PEER = 2;
+
+//! ChunkHashes must fit into one P2P message
+constexpr size_t MAX_CHUNK_HASHES = 40000;
+
 class P2PState {
   using steady_clock = std::chrono::steady_clock;
   using time_point = steady_clock::time_point;
@@ -43,10 +56,21 @@ class P2PState {
                           const CNetMsgMaker &msg_maker);
 
   //! saves the received snapshot chunk.
-  //! if it wasn't the last chunk, request the following one
-  //! if it was the last chunk, finishes snapshot downloading processed
+  //! chunks are requested from all the peers that have the snapshot, the
+  //! ones that arrive out of order are kept until the missing ones arrive.
+  //! if it was the last chunk, finishes snapshot downloading processed.
+  //! format is SNAPSHOT_FORMAT_* of the message
   bool ProcessSnapshot(CNode &node, CDataStream &data,
-                       const CNetMsgMaker &msg_maker);
+                       const CNetMsgMaker &msg_maker,
+                       uint8_t format = SNAPSHOT_FORMAT_PLAIN);
+
+  //! sends to the node the hashes of the snapshot chunks
+  bool ProcessGetChunkHashes(CNode &node, CDataStream &data,
+                             const CNetMsgMaker &msg_maker);
+
+  //! checks the chunk hashes against the snapshot hash and keeps them to
+  //! check the chunks the node sends
+  bool ProcessChunkHashes(CNode &node, CDataStream &data);
 
   //! requests the snapshot from the node if it has the best one
   //! can request the second best snapshot if previous one was detected broken
@@ -77,6 +101,13 @@ class P2PState {
   // and was the best one at a time the decision was made
   SnapshotHeader m_downloading_snapshot;
 
+  //! creates m_scheduler if m_downloading_snapshot has changed
+  DownloadScheduler &GetScheduler();
+
+  //! requests the chunks the node has free slots for. The first time it also
+  //! asks the node for the chunk hashes
+  void RequestChunks(CNode &node, const CNetMsgMaker &msg_maker);
+
  private:
   Params m_params;
 
@@ -87,9 +118,36 @@ class P2PState {
   // the decision of which snapshot to download shouldn't be made in this iteration
   bool m_in_flight_snapshot_discovery = false;
 
+  // decides which chunks of m_downloading_snapshot to request from which peer
+  std::unique_ptr<DownloadScheduler> m_scheduler;
+
+  // hash of the subsets of m_downloading_snapshot which are written to disk.
+  // It's persisted with the subsets, see Indexer::WritePartialHash()
+  SnapshotHash m_partial_hash;
+
+  // peers which were asked for the chunk hashes of m_downloading_snapshot
+  std::set<NodeId> m_chunk_hashes_requested;
+
+  // checked chunk hashes of m_downloading_snapshot per peer. The chunks
+  // are checked against the hashes of the peer that sent them, so one peer
+  // can't make the node reject the chunks of others
+  std::map<NodeId, std::vector<uint256>> m_chunk_hashes;
+
+  // peers processed in the current iteration of StartInitialSnapshotDownload
+  std::set<NodeId> m_connected_peers;
+
+  // the last chunk hashes sent to peers, they are expensive to calculate
+  ChunkHashes m_served_chunk_hashes;
+
+  // serves the chunks of the last requested snapshot
+  std::unique_ptr<ChunkReader> m_chunk_reader;
+
   bool SendGetSnapshot(CNode &node, GetSnapshot &msg,
                        const CNetMsgMaker &msg_maker);
 
+  //! stops requesting chunks from the node
+  void RemoveSnapshotPeer(CNode &node);
+
   //! returns node's best_snapshot if it points to finalized epoch
   //! and downloading process hasn't timed out
   SnapshotHeader NodeBestSnapshot(CNode &node, const CBlockIndex &last_finalized_checkpoint);
@@ -116,7 +174,14 @@ bool ProcessGetSnapshot(CNode &node, CDataStream &data,
 
 // proxy to g_p2p_state.ProcessSnapshot
 bool ProcessSnapshot(CNode &node, CDataStream &data,
-                     const CNetMsgMaker &msg_maker);
+                     const CNetMsgMaker &msg_maker, uint8_t format);
+
+// proxy to g_p2p_state.ProcessGetChunkHashes
+bool ProcessGetChunkHashes(CNode &node, CDataStream &data,
+                           const CNetMsgMaker &msg_maker);
+
+// proxy to g_p2p_state.ProcessChunkHashes
+bool ProcessChunkHashes(CNode &node, CDataStream &data);
 
 // proxy to g_p2p_state.StartInitialSnapshotDownload
 void StartInitialSnapshotDownload(CNode &node, size_t node_index, size_t total_nodes,
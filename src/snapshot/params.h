@@ -17,6 +17,10 @@ struct Params {
   //! this peer is marked as it doesn't have a snapshot
   int64_t snapshot_chunk_timeout_sec = 30;
 
+  //! how many UTXO subsets are requested at once. The snapshot is downloaded
+  //! and verified by chunks of this size
+  uint16_t snapshot_chunk_size = 10000;
+
   //! time during which the node will discover available snapshots from peers.
   //! peers joined after this timeout won't be asked for the snapshot
   int64_t discovery_timeout_sec = 120;
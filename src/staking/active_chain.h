@@ -123,6 +123,10 @@ class ActiveChain : public blockchain::ChainAccess, public blockchain::UTXOView
   //! the active chain. If in between block creation and actually proposing
   //! (invoking this function) a new block arrived it will return false.
   //! Otherwise true.
+  //!
+  //! The block is validated only here. The scripts of its transactions were
+  //! verified when they entered the mempool, so ConnectBlock finds them in
+  //! the script execution cache and doesn't verify them again.
   virtual bool ProposeBlock(
       std::shared_ptr<const CBlock> block  //!< The block to propose on the currently active chain.
       ) = 0;
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <staking/kernel_search.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace staking {
+
+namespace {
+
+//! Below this number of coins per thread it is cheaper to not start threads.
+constexpr std::size_t MIN_COINS_PER_THREAD = 1000;
+
+//! The number of coins a thread claims at once.
+constexpr std::size_t CHUNK_SIZE = 128;
+
+}  // namespace
+
+boost::optional<KernelSearchResult> FindKernel(
+    const CoinSet &coins,
+    const std::function<uint256(const Coin &)> &compute_kernel_hash,
+    const std::function<bool(const Coin &, const uint256 &)> &check_kernel,
+    const std::size_t max_threads) {
+
+  const std::size_t threads = std::max<std::size_t>(1, std::min(max_threads, coins.size() / MIN_COINS_PER_THREAD));
+  if (threads == 1) {
+    for (const Coin &coin : coins) {
+      const uint256 kernel_hash = compute_kernel_hash(coin);
+      if (check_kernel(coin, kernel_hash)) {
+        return KernelSearchResult{&coin, kernel_hash};
+      }
+    }
+    return boost::none;
+  }
+
+  std::vector<const Coin *> coin_list;
+  coin_list.reserve(coins.size());
+  for (const Coin &coin : coins) {
+    coin_list.emplace_back(&coin);
+  }
+  const std::size_t num_coins = coin_list.size();
+
+  std::atomic<std::size_t> next_chunk{0};
+  // The index of the first eligible coin found so far, num_coins if none.
+  // It only ever decreases, so every coin before the final winner is checked.
+  std::atomic<std::size_t> winner{num_coins};
+
+  const auto search = [&] {
+    while (true) {
+      const std::size_t begin = next_chunk.fetch_add(CHUNK_SIZE);
+      if (begin >= winner.load()) {
+        return;
+      }
+      const std::size_t end = std::min(begin + CHUNK_SIZE, num_coins);
+      for (std::size_t i = begin; i < end && i < winner.load(std::memory_order_relaxed); ++i) {
+        if (check_kernel(*coin_list[i], compute_kernel_hash(*coin_list[i]))) {
+          std::size_t current = winner.load();
+          while (i < current && !winner.compare_exchange_weak(current, i)) {
+          }
+          // all the coins in the chunks claimed later come after this one
+          return;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers.emplace_back(search);
+  }
+  search();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  const std::size_t index = winner.load();
+  if (index == num_coins) {
+    return boost::none;
+  }
+  const Coin &coin = *coin_list[index];
+  return KernelSearchResult{&coin, compute_kernel_hash(coin)};
+}
+
+}  // namespace staking
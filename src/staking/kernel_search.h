@@ -0,0 +1,47 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNIT_E_STAKING_KERNEL_SEARCH_H
+#define UNIT_E_STAKING_KERNEL_SEARCH_H
+
+#include <staking/coin.h>
+#include <uint256.h>
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <functional>
+
+namespace staking {
+
+//! \brief A coin which meets the proof-of-stake target and its kernel hash.
+struct KernelSearchResult {
+  //! Points into the searched CoinSet.
+  const Coin *coin;
+  uint256 kernel_hash;
+};
+
+//! \brief Finds the first coin in a set whose kernel meets the target.
+//!
+//! The coins are split into chunks which are evaluated by up to `max_threads`
+//! threads (the calling thread being one of them). The result does not depend
+//! on the number of threads: it is always the first eligible coin in the order
+//! of the CoinSet, exactly as a sequential search would find it. Chunks after
+//! the best eligible coin found so far are skipped.
+//!
+//! \param coins The coins to search, in order of preference.
+//! \param compute_kernel_hash See StakeValidator::GetKernelHasher.
+//! \param check_kernel Whether the kernel hash of a coin meets the target.
+//! \param max_threads The maximum number of threads to use.
+//!
+//! Both functions are invoked concurrently and must be safe to do so.
+boost::optional<KernelSearchResult> FindKernel(
+    const CoinSet &coins,
+    const std::function<uint256(const Coin &)> &compute_kernel_hash,
+    const std::function<bool(const Coin &, const uint256 &)> &check_kernel,
+    std::size_t max_threads);
+
+}  // namespace staking
+
+#endif  //UNIT_E_STAKING_KERNEL_SEARCH_H
@@ -4,6 +4,7 @@
 
 #include <staking/proof_of_stake.h>
 
+#include <crypto/common.h>
 #include <script/script.h>
 #include <script/standard.h>
 #include <streams.h>
@@ -118,6 +119,29 @@ uint256 ComputeKernelHash(const uint256 &previous_block_stake_modifier,
   return Hash(s.begin(), s.end());
 }
 
+KernelHasher::KernelHasher(const uint256 &previous_block_stake_modifier,
+                           const blockchain::Time target_block_time)
+    : m_target_block_time(target_block_time) {
+  m_midstate.Write(previous_block_stake_modifier.begin(), previous_block_stake_modifier.size());
+}
+
+uint256 KernelHasher::operator()(const blockchain::Time stake_block_time,
+                                 const uint256 &stake_txid,
+                                 const std::uint32_t stake_out_index) const {
+  // Same layout as the stream in ComputeKernelHash: all integers are
+  // serialized as little endian.
+  unsigned char buffer[4 + 32 + 4 + 4];
+  WriteLE32(buffer, stake_block_time);
+  std::copy(stake_txid.begin(), stake_txid.end(), buffer + 4);
+  WriteLE32(buffer + 36, stake_out_index);
+  WriteLE32(buffer + 40, m_target_block_time);
+
+  CHash256 hasher = m_midstate;
+  uint256 result;
+  hasher.Write(buffer, sizeof(buffer)).Finalize(result.begin());
+  return result;
+}
+
 uint256 ComputeStakeModifier(const uint256 &stake_transaction_hash,
                              const uint256 &previous_blocks_stake_modifier) {
 
@@ -6,6 +6,7 @@
 #define UNIT_E_STAKING_PROOF_OF_STAKE_H
 
 #include <blockchain/blockchain_types.h>
+#include <hash.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <pubkey.h>
@@ -78,6 +79,26 @@ uint256 ComputeKernelHash(const uint256 &previous_block_stake_modifier,
                           std::uint32_t stake_out_index,
                           blockchain::Time target_block_time);
 
+//! \brief Computes kernel hashes of many stakes for the same previous block and block time.
+//!
+//! Produces the same hashes as ComputeKernelHash. The stake modifier of the
+//! previous block is hashed only once, every stake then only pays for its own
+//! fields. Instances are immutable and can be shared between threads.
+class KernelHasher {
+ public:
+  KernelHasher(const uint256 &previous_block_stake_modifier,
+               blockchain::Time target_block_time);
+
+  uint256 operator()(blockchain::Time stake_block_time,
+                     const uint256 &stake_txid,
+                     std::uint32_t stake_out_index) const;
+
+ private:
+  //! The hasher state after the stake modifier has been written
+  CHash256 m_midstate;
+  blockchain::Time m_target_block_time;
+};
+
 //! \brief Computes the stake modifier which is used to make the next kernel unpredictable.
 //!
 //! The stake modifier relies on the transaction hash of the coin staked and
@@ -178,6 +178,18 @@ class StakeValidatorImpl : public StakeValidator {
         target_block_time);
   }
 
+  std::function<uint256(const staking::Coin &)> GetKernelHasher(
+      const CBlockIndex *previous_block,
+      const blockchain::Time target_block_time) const override {
+    if (!previous_block) {
+      return [](const staking::Coin &) { return uint256::zero; };
+    }
+    const staking::KernelHasher hasher(previous_block->stake_modifier, target_block_time);
+    return [hasher](const staking::Coin &coin) {
+      return hasher(coin.GetBlockTime(), coin.GetTransactionId(), coin.GetOutputIndex());
+    };
+  }
+
   bool CheckKernel(const CAmount stake_amount,
                    const uint256 &kernel_hash,
                    const blockchain::Difficulty target_difficulty) const override {
@@ -17,6 +17,7 @@
 #include <uint256.h>
 #include <validation_flags.h>
 
+#include <functional>
 #include <memory>
 
 namespace staking {
@@ -47,6 +48,16 @@ class StakeValidator {
       blockchain::Time block_time      //!< [in] The time of this block
       ) const = 0;
 
+  //! \brief Returns a function which computes kernel hashes for a fixed previous block and block time.
+  //!
+  //! The returned function yields the same as ComputeKernelHash(block_index, coin, block_time)
+  //! but does the work which is common to all coins only once. It can be invoked
+  //! concurrently and must not outlive block_index.
+  virtual std::function<uint256(const staking::Coin &)> GetKernelHasher(
+      const CBlockIndex *block_index,  //!< [in] The previous block to draw entropy from
+      blockchain::Time block_time      //!< [in] The time of the block to propose
+      ) const = 0;
+
   //! \brief Computes the stake modifier for a block.
   //!
   //! The stake modifier is not stored in a block on chain, but it is used
@@ -5,8 +5,18 @@
 #include <staking/transactionpicker.h>
 
 #include <amount.h>
+#include <consensus/consensus.h>
+#include <finalization/state_repository.h>
 #include <miner.h>
-#include <script/script.h>
+#include <policy/feerate.h>
+#include <staking/active_chain.h>
+#include <txmempool.h>
+#include <util.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <algorithm>
+#include <unordered_set>
 
 namespace staking {
 
@@ -30,53 +40,237 @@ namespace staking {
 //! templates. The proposer can assemble a block itself, which in turn
 //! greatly reduces complexity of the process to create new blocks and
 //! the amount of code needed to do so.
-class BlockAssemblerAdapter final : public TransactionPicker {
+//!
+//! Assembling a template considers the whole mempool. To not do this when
+//! the proposer is eligible to propose, the adapter keeps the transactions
+//! of the last template and follows the changes of the mempool and the
+//! active chain: a transaction which is added to the mempool is appended to
+//! the template if its parents are in the template already, any other change
+//! assembles a new template in the background.
+class BlockAssemblerAdapter final : public TransactionPicker, public CValidationInterface {
 
  public:
+  BlockAssemblerAdapter(Dependency<staking::ActiveChain> active_chain,
+                        Dependency<finalization::StateRepository> state_repository)
+      : m_active_chain(active_chain),
+        m_state_repository(state_repository) {}
+
   ~BlockAssemblerAdapter() override = default;
 
   PickTransactionsResult PickTransactions(
       const PickTransactionsParameters &parameters) override {
 
+    // The transactions are not validated here as the block built from them
+    // is validated once when it is proposed (see ActiveChain::ProposeBlock).
+    PickTransactionsResult result;
+    try {
+      LOCK2(m_active_chain->GetLock(), m_state_repository->GetLock());
+      LOCK(mempool.cs);
+      LOCK(m_cs);
+      if (!m_template || !IsCurrent(*m_template) ||
+          m_template->parameters.max_weight != parameters.max_weight ||
+          m_template->parameters.min_fees != parameters.min_fees) {
+        m_template = AssembleTemplate(parameters);
+      }
+      result.transactions = m_template->transactions;
+      result.fees = m_template->fees;
+    } catch (const std::runtime_error &err) {
+      result.error = err.what();
+    }
+    return result;
+  };
+
+  void Start() override {
+    LOCK(m_cs);
+    if (!m_started) {
+      RegisterValidationInterface(this);
+      m_started = true;
+    }
+  }
+
+  void Stop() override {
+    LOCK(m_cs);
+    if (m_started) {
+      UnregisterValidationInterface(this);
+      m_started = false;
+    }
+  }
+
+ protected:
+  void TransactionAddedToMempool(const CTransactionRef &tx) override {
+    Update(tx);
+  }
+
+  void TransactionRemovedFromMempool(const CTransactionRef &tx) override {
+    Update(nullptr);
+  }
+
+  void BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *index,
+                      const std::vector<CTransactionRef> &conflicted) override {
+    Update(nullptr);
+  }
+
+  void BlockDisconnected(const std::shared_ptr<const CBlock> &block) override {
+    Update(nullptr);
+  }
+
+ private:
+  //! \brief The transactions of a template, without the coinbase slot.
+  struct Template {
+    PickTransactionsParameters parameters;
+    //! The tip the template builds on.
+    uint256 tip;
+    //! The value of CTxMemPool::GetTransactionsUpdated() the template reflects.
+    unsigned int mempool_updates = 0;
+    //! Sorted by txid (LTOR), fees[i] is the fee of transactions[i].
+    std::vector<CTransactionRef> transactions;
+    std::vector<CAmount> fees;
+    std::unordered_set<uint256, SaltedTxidHasher> txids;
+    //! The weight and the sigops cost including the reserve for the coinbase.
+    uint64_t weight = 0;
+    int64_t sigops_cost = 0;
+  };
+
+  Dependency<staking::ActiveChain> m_active_chain;
+  Dependency<finalization::StateRepository> m_state_repository;
+
+  //! Acquired after the active chain lock, the finalization state lock and
+  //! mempool.cs. These are held whenever the template is accessed, so the
+  //! template is consistent with the active chain and the mempool.
+  CCriticalSection m_cs;
+  std::unique_ptr<Template> m_template GUARDED_BY(m_cs);
+  bool m_started GUARDED_BY(m_cs) = false;
+
+  bool IsCurrent(const Template &t) const {
+    return t.tip == m_active_chain->GetTip()->GetBlockHash() &&
+           t.mempool_updates == mempool.GetTransactionsUpdated();
+  }
+
+  std::unique_ptr<Template> AssembleTemplate(const PickTransactionsParameters &parameters) {
+    AssertLockHeld(mempool.cs);
+
     ::BlockAssembler::Options blockAssemblerOptions;
     blockAssemblerOptions.blockMinFeeRate = parameters.min_fees;
     blockAssemblerOptions.nBlockMaxWeight = parameters.max_weight;
 
     ::BlockAssembler blockAssembler(::Params(), blockAssemblerOptions);
+    std::unique_ptr<CBlockTemplate> block_template = blockAssembler.CreateNewTemplate();
 
-    // The block assembler unfortunately also creates a bitcoin-style
-    // coinbase transaction. We do not want to touch that logic to
-    // retain compatibility with bitcoin. The construction of the
-    // coinbase transaction is left to the component using a
-    // TransactionPicker to build a block. Therefore we just pass an
-    // empty script to the blockAssembler.
-    CScript script(1);
-    script.push_back(OP_RETURN);
+    std::unique_ptr<Template> t = MakeUnique<Template>();
+    t->parameters = parameters;
+    t->tip = m_active_chain->GetTip()->GetBlockHash();
+    t->mempool_updates = mempool.GetTransactionsUpdated();
 
-    PickTransactionsResult result;
+    // The block assembler leaves a slot for the coinbase transaction which
+    // is built by the component using a TransactionPicker. Its fees are
+    // not in the order of the sorted transactions, so they are taken from
+    // the mempool entries.
+    std::vector<CTransactionRef> &vtx = block_template->block.vtx;
+    t->transactions.reserve(vtx.size() - 1);
+    t->fees.reserve(vtx.size() - 1);
+    t->weight = COINBASE_RESERVED_WEIGHT;
+    t->sigops_cost = COINBASE_RESERVED_SIGOPS_COST;
+    for (auto tx = vtx.begin() + 1; tx != vtx.end(); ++tx) {
+      const CTxMemPool::txiter it = mempool.mapTx.find((*tx)->GetHash());
+      assert(it != mempool.mapTx.end());
+      t->txids.insert(it->GetTx().GetHash());
+      t->fees.push_back(it->GetFee());
+      t->weight += it->GetTxWeight();
+      t->sigops_cost += it->GetSigOpCost();
+      t->transactions.emplace_back(std::move(*tx));
+    }
+    return t;
+  }
+
+  //! \brief Appends a transaction which was added to the mempool.
+  //!
+  //! Mirrors the checks of BlockAssembler::addPackageTxs for a package
+  //! which consists of the transaction only. Returns false if the template
+  //! has to be assembled again to take the transaction into account, that
+  //! is if not all of its parents are in the template or if it is a
+  //! finalizer commit, which BlockAssembler checks against the
+  //! finalization state.
+  bool Append(Template &t, const CTxMemPool::txiter it) {
+    AssertLockHeld(mempool.cs);
+
+    const CTransaction &tx = it->GetTx();
+    if (tx.IsFinalizerCommit()) {
+      return false;
+    }
+    for (const CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+      if (t.txids.count(parent->GetTx().GetHash()) == 0) {
+        return false;
+      }
+    }
+
+    // Clamped like BlockAssembler does
+    const uint64_t max_weight =
+        std::max<size_t>(COINBASE_RESERVED_WEIGHT,
+                         std::min<size_t>(MAX_BLOCK_WEIGHT - COINBASE_RESERVED_WEIGHT,
+                                          t.parameters.max_weight));
+    const CFeeRate min_fee_rate(t.parameters.min_fees);
+    if (it->GetModifiedFee() < min_fee_rate.GetFee(it->GetTxSize()) ||
+        t.weight + WITNESS_SCALE_FACTOR * it->GetTxSize() >= max_weight ||
+        t.sigops_cost + it->GetSigOpCost() >= MAX_BLOCK_SIGOPS_COST) {
+      // A new template would not include the transaction either
+      return true;
+    }
+
+    const auto pos = std::upper_bound(
+        t.transactions.begin(), t.transactions.end(), tx.GetHash(),
+        [](const uint256 &hash, const CTransactionRef &other) {
+          return hash.CompareAsNumber(other->GetHash()) < 0;
+        });
+    t.fees.insert(t.fees.begin() + (pos - t.transactions.begin()), it->GetFee());
+    t.transactions.insert(pos, it->GetSharedTx());
+    t.txids.insert(tx.GetHash());
+    t.weight += it->GetTxWeight();
+    t.sigops_cost += it->GetSigOpCost();
+    return true;
+  }
+
+  void Update(const CTransactionRef &added) {
     try {
-      std::unique_ptr<CBlockTemplate> block_template =
-          blockAssembler.CreateNewBlock(script);
-
-      // Remove the coinbase generated by CreateNewBlock
-      if (block_template->block.vtx[0]->IsCoinBase()) {
-        std::move(block_template->block.vtx.begin() + 1,
-                  block_template->block.vtx.end(),
-                  std::back_inserter(result.transactions));
-      } else {
-        result.transactions.swap(block_template->block.vtx);
+      LOCK2(m_active_chain->GetLock(), m_state_repository->GetLock());
+      LOCK(mempool.cs);
+      LOCK(m_cs);
+      if (!m_started) {
+        return;
+      }
+      if (m_template && IsCurrent(*m_template)) {
+        return;
+      }
+      const unsigned int mempool_updates = mempool.GetTransactionsUpdated();
+      if (m_template && added &&
+          m_template->tip == m_active_chain->GetTip()->GetBlockHash() &&
+          m_template->mempool_updates + 1 == mempool_updates) {
+        const CTxMemPool::txiter it = mempool.mapTx.find(added->GetHash());
+        if (it != mempool.mapTx.end() && Append(*m_template, it)) {
+          m_template->mempool_updates = mempool_updates;
+          return;
+        }
       }
-      result.fees.swap(block_template->vTxFees);
+      m_template = AssembleTemplate(m_template ? m_template->parameters : PickTransactionsParameters());
     } catch (const std::runtime_error &err) {
-      result.error = err.what();
+      LogPrintf("%s: failed to assemble a block template: %s\n", __func__, err.what());
+      LOCK(m_cs);
+      m_template.reset();
     }
-    return result;
-  };
+  }
+
+  // Reserved for the coinbase transaction, as in BlockAssembler::resetBlock
+  static constexpr uint64_t COINBASE_RESERVED_WEIGHT = 4000;
+  static constexpr int64_t COINBASE_RESERVED_SIGOPS_COST = 400;
 };
 
-std::unique_ptr<TransactionPicker>
-TransactionPicker::New() {
-  return std::unique_ptr<TransactionPicker>(new BlockAssemblerAdapter());
+constexpr uint64_t BlockAssemblerAdapter::COINBASE_RESERVED_WEIGHT;
+constexpr int64_t BlockAssemblerAdapter::COINBASE_RESERVED_SIGOPS_COST;
+
+std::unique_ptr<TransactionPicker> TransactionPicker::New(
+    Dependency<staking::ActiveChain> active_chain,
+    Dependency<finalization::StateRepository> state_repository) {
+  return std::unique_ptr<TransactionPicker>(
+      new BlockAssemblerAdapter(active_chain, state_repository));
 }
 
 }  // namespace staking
@@ -13,8 +13,14 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 
+namespace finalization {
+class StateRepository;
+}
+
 namespace staking {
 
+class ActiveChain;
+
 //! \brief a component for picking transactions for a new block.
 //!
 //! When building a new block to be proposed the proposer has to fill
@@ -31,6 +37,11 @@ namespace staking {
 //! his own micro transaction which would have to be tackled by a
 //! consensus rule anyway and therefore would be reflected in a
 //! TransactionPicker).
+//!
+//! The BlockAssembler based implementation keeps the transactions of the
+//! last template it assembled and maintains them while the mempool and the
+//! active chain change, so that picking does not have to assemble a block
+//! from the whole mempool when the proposer is eligible to propose.
 class TransactionPicker {
 
  public:
@@ -70,10 +81,17 @@ class TransactionPicker {
   virtual PickTransactionsResult PickTransactions(
       const PickTransactionsParameters &) = 0;
 
+  //! \brief starts following the changes of the mempool and the active chain
+  virtual void Start() {}
+
+  //! \brief stops following the changes of the mempool and the active chain
+  virtual void Stop() {}
+
   virtual ~TransactionPicker() = default;
 
   //! \brief Factory method for creating a BlockAssemblerAdapter
-  static std::unique_ptr<TransactionPicker> New();
+  static std::unique_ptr<TransactionPicker> New(Dependency<staking::ActiveChain>,
+                                                Dependency<finalization::StateRepository>);
 };
 
 }  // namespace staking
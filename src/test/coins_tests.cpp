@@ -3,11 +3,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <coins.h>
+#include <arith_uint256.h>
 #include <script/standard.h>
 #include <uint256.h>
 #include <undo.h>
 #include <utilstrencodings.h>
 #include <test/test_unite.h>
+#include <txdb.h>
 #include <validation.h>
 #include <consensus/validation.h>
 
@@ -876,4 +878,74 @@ BOOST_AUTO_TEST_CASE(ccoins_clear) {
   BOOST_CHECK(base.clear_coins_called);
 }
 
+BOOST_FIXTURE_TEST_CASE(ccoins_apply_snapshot, BasicTestingSetup) {
+  SetDataDir("ccoins_apply_snapshot");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+
+  snapshot::SnapshotHash hash;
+  std::vector<snapshot::UTXOSubset> subsets;
+  for (uint32_t i = 0; i < 50; ++i) {
+    snapshot::UTXOSubset subset;
+    subset.tx_id = ArithToUint256(arith_uint256(i + 1));
+    subset.height = i;
+    subset.tx_type = i == 0 ? TxType::COINBASE : TxType::REGULAR;
+    subset.outputs[0] = CTxOut(i, CScript() << i);
+    subset.outputs[2] = CTxOut(i + 1, CScript());
+    hash.AddUTXOSubset(subset);
+    subsets.emplace_back(subset);
+  }
+
+  snapshot::SnapshotHeader header;
+  header.block_hash = uint256S("aa");
+  header.stake_modifier = uint256S("bb");
+  header.chain_work = uint256S("cc");
+  header.snapshot_hash = hash.GetHash(header.stake_modifier, header.chain_work);
+
+  // the subsets are spread over 9 files
+  snapshot::Indexer indexer(header, 2, 3);
+  BOOST_CHECK(indexer.WriteUTXOSubsets(subsets));
+  BOOST_CHECK(indexer.Flush());
+  BOOST_CHECK_EQUAL(indexer.GetFileCount(), 9);
+
+  // without the partial hash it's calculated from the files
+  for (const bool verified : {false, true}) {
+    if (verified) {
+      BOOST_CHECK(indexer.WritePartialHash(hash));
+    }
+
+    CCoinsViewDB db(0, true, true);
+    CCoinsViewCache cache(&db);
+
+    // the coins which aren't in the snapshot are removed
+    const COutPoint stale(uint256S("dd"), 0);
+    cache.AddCoin(stale, Coin(CTxOut(1, CScript()), 1, TxType::REGULAR), false);
+    cache.SetBestBlock(uint256S("ee"));
+    BOOST_CHECK(cache.Flush());
+
+    {
+      LOCK(snapshot::cs_snapshot);
+      BOOST_CHECK(cache.ApplySnapshot(snapshot::Indexer::Open(header.snapshot_hash)));
+    }
+
+    BOOST_CHECK_EQUAL(db.GetBestBlock().GetHex(), header.block_hash.GetHex());
+    BOOST_CHECK(db.GetSnapshotHash().GetData() == hash.GetData());
+    BOOST_CHECK(!db.HaveCoin(stale));
+
+    size_t coins = 0;
+    std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+    for (; cursor->Valid(); cursor->Next()) {
+      ++coins;
+    }
+    BOOST_CHECK_EQUAL(coins, 100);
+
+    for (const snapshot::UTXOSubset &subset : subsets) {
+      for (const auto &p : subset.outputs) {
+        Coin coin;
+        BOOST_CHECK(db.GetCoin(COutPoint(subset.tx_id, p.first), coin));
+        BOOST_CHECK(coin == Coin(p.second, subset.height, subset.tx_type));
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
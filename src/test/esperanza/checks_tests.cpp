@@ -7,6 +7,7 @@
 #include <keystore.h>
 #include <random.h>
 #include <script/script.h>
+#include <script/sigcache.h>
 #include <test/esperanza/finalization_utils.h>
 #include <test/esperanza/finalizationstate_utils.h>
 #include <test/test_unite.h>
@@ -722,6 +723,69 @@ BOOST_AUTO_TEST_CASE(CheckVoteTx_test) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(CheckVoteTx_signature_cache) {
+  CBasicKeyStore keystore;
+  CKey key;
+  InsecureNewKey(key, true);
+  keystore.AddKey(key);
+
+  Vote vote{key.GetPubKey().GetID(), GetRandHash(), 10, 100};
+  std::vector<unsigned char> vote_sig;
+  BOOST_REQUIRE(CreateVoteSignature(&keystore, vote, vote_sig));
+  const CTransaction tx = CreateVoteTx(CTransaction(), key, vote, vote_sig);
+
+  // the signature is verified once
+  const VoteSignatureCacheStats before = GetVoteSignatureCacheStats();
+  for (int i = 0; i < 3; ++i) {
+    CValidationState err_state;
+    BOOST_CHECK(CheckVoteTx(tx, err_state, nullptr, nullptr));
+  }
+  VoteSignatureCacheStats after = GetVoteSignatureCacheStats();
+  BOOST_CHECK_EQUAL(after.misses - before.misses, 1);
+  BOOST_CHECK_EQUAL(after.hits - before.hits, 2);
+
+  // invalid signatures are not cached
+  Vote other_vote = vote;
+  other_vote.m_target_epoch = 101;
+  const CTransaction invalid_tx = CreateVoteTx(CTransaction(), key, other_vote, vote_sig);
+  for (int i = 0; i < 2; ++i) {
+    CValidationState err_state;
+    BOOST_CHECK(!CheckVoteTx(invalid_tx, err_state, nullptr, nullptr));
+    BOOST_CHECK_EQUAL(err_state.GetRejectReason(), "bad-vote-signature");
+  }
+  const VoteSignatureCacheStats invalid = GetVoteSignatureCacheStats();
+  BOOST_CHECK_EQUAL(invalid.misses - after.misses, 2);
+  BOOST_CHECK_EQUAL(invalid.hits, after.hits);
+}
+
+BOOST_AUTO_TEST_CASE(CFinalizerCommitCheck_test) {
+  CBasicKeyStore keystore;
+  CKey key;
+  InsecureNewKey(key, true);
+  keystore.AddKey(key);
+
+  Vote vote{key.GetPubKey().GetID(), GetRandHash(), 10, 100};
+  std::vector<unsigned char> vote_sig;
+  BOOST_REQUIRE(CreateVoteSignature(&keystore, vote, vote_sig));
+  const CTransaction tx = CreateVoteTx(CTransaction(), key, vote, vote_sig);
+
+  const VoteSignatureCacheStats before = GetVoteSignatureCacheStats();
+  BOOST_CHECK(CFinalizerCommitCheck(tx)());
+  CValidationState err_state;
+  BOOST_CHECK(CheckVoteTx(tx, err_state, nullptr, nullptr));
+  const VoteSignatureCacheStats after = GetVoteSignatureCacheStats();
+  BOOST_CHECK_EQUAL(after.misses - before.misses, 1);
+  BOOST_CHECK_EQUAL(after.hits - before.hits, 1);
+
+  Vote other_vote = vote;
+  other_vote.m_target_epoch = 101;
+  BOOST_CHECK(!CFinalizerCommitCheck(CreateVoteTx(CTransaction(), key, other_vote, vote_sig))());
+
+  CMutableTransaction malformed(tx);
+  malformed.vout.clear();
+  BOOST_CHECK(!CFinalizerCommitCheck(CTransaction(malformed))());
+}
+
 BOOST_AUTO_TEST_CASE(ContextualCheckVoteTx_test) {
   uint256 target_hash = GetRandHash();
 
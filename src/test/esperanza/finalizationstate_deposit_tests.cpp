@@ -44,7 +44,7 @@ BOOST_AUTO_TEST_CASE(process_deposit_tx) {
   spy.ProcessDeposit(validatorAddress, depositSize);
   spy.ProcessDeposit(validatorAddress2, depositSize);
 
-  std::map<uint160, Validator> validators = spy.Validators();
+  util::PersistentMap<uint160, Validator> validators = spy.Validators();
   auto it = validators.find(validatorAddress2);
   BOOST_CHECK(it != validators.end());
 
@@ -68,7 +68,7 @@ BOOST_AUTO_TEST_CASE(process_logout_end_dynasty) {
   BOOST_CHECK_EQUAL(spy.ValidateLogout(validatorAddress), +Result::SUCCESS);
   spy.ProcessLogout(validatorAddress);
 
-  std::map<uint160, Validator> validators = spy.Validators();
+  util::PersistentMap<uint160, Validator> validators = spy.Validators();
   Validator validator = validators.find(validatorAddress)->second;
   BOOST_CHECK_EQUAL(8, validator.m_end_dynasty);
 }
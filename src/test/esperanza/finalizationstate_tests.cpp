@@ -2,10 +2,12 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <esperanza/finalizationstate_delta.h>
 #include <injector.h>
 #include <keystore.h>
 #include <test/esperanza/finalization_utils.h>
 #include <test/esperanza/finalizationstate_utils.h>
+#include <streams.h>
 #include <ufp64.h>
 #include <util.h>
 #include <validation.h>
@@ -238,4 +240,84 @@ BOOST_AUTO_TEST_CASE(deposit_amount) {
   BOOST_CHECK_EQUAL(10000, state.GetDepositSize(validatorAddress));
 }
 
+BOOST_AUTO_TEST_CASE(active_finalizers_index) {
+  FinalizationStateSpy spy;
+
+  uint256 target_hash = GetRandHash();
+  CBlockIndex block_index;
+  block_index.phashBlock = &target_hash;
+  spy.SetRecommendedTarget(block_index);
+
+  const auto count_voting = [](FinalizationStateSpy &state) {
+    size_t count = 0;
+    for (const auto &it : state.Validators()) {
+      count += state.IsFinalizerVoting(it.second);
+    }
+    return count;
+  };
+
+  // The index must agree with the scan over all the validators, also after
+  // the state went through serialization or was rebuilt from a delta.
+  const auto check_index = [&spy, &count_voting](const FinalizationStateSpy &parent) {
+    BOOST_CHECK_EQUAL(spy.GetActiveFinalizersCount(), count_voting(spy));
+    size_t visited = 0;
+    spy.ForEachActiveFinalizer([&spy, &visited](const Validator &finalizer) {
+      BOOST_CHECK(spy.IsFinalizerVoting(finalizer));
+      ++visited;
+    });
+    BOOST_CHECK_EQUAL(visited, spy.GetActiveFinalizersCount());
+
+    CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+    stream << spy;
+    FinalizationStateSpy restored;
+    stream >> restored;
+    BOOST_CHECK_EQUAL(restored.GetActiveFinalizersCount(), spy.GetActiveFinalizersCount());
+
+    FinalizationStateSpy applied(parent);
+    FinalizationStateDelta::Compute(parent, spy).Apply(applied);
+    BOOST_CHECK_EQUAL(applied.GetActiveFinalizersCount(), spy.GetActiveFinalizersCount());
+  };
+
+  const uint160 leaving = RandValidatorAddr();
+  const uint160 staying = RandValidatorAddr();
+  const uint160 joining = RandValidatorAddr();
+
+  spy.ProcessDeposit(leaving, spy.MinDepositSize());
+  spy.ProcessDeposit(staying, spy.MinDepositSize());
+  for (uint32_t i = 1; i < 6 * spy.EpochLength() + 1; i += spy.EpochLength()) {
+    BOOST_CHECK_EQUAL(spy.GetActiveFinalizersCount(), 0);
+    BOOST_CHECK_EQUAL(spy.InitializeEpoch(i), +Result::SUCCESS);
+  }
+  BOOST_CHECK_EQUAL(spy.GetCurrentDynasty(), 3);
+  BOOST_CHECK_EQUAL(spy.GetActiveFinalizersCount(), 2);
+
+  for (uint32_t i = spy.GetCurrentEpoch(); i < 22; ++i) {
+    const FinalizationStateSpy parent(spy);
+    if (i == 6) {
+      spy.ProcessLogout(leaving);
+    }
+    if (i == 7) {
+      spy.ProcessDeposit(joining, spy.MinDepositSize());
+    }
+    if (i == 21) {
+      BOOST_CHECK_EQUAL(spy.ValidateWithdraw(leaving, 0), +Result::SUCCESS);
+      spy.ProcessWithdraw(leaving);
+    }
+    for (const uint160 &address : {leaving, staying, joining}) {
+      if (spy.IsFinalizerVoting(address)) {
+        Vote vote{address, target_hash, i - 2, i - 1};
+        BOOST_CHECK_EQUAL(spy.ValidateVote(vote), +Result::SUCCESS);
+        spy.ProcessVote(vote);
+      }
+    }
+    BOOST_CHECK_EQUAL(spy.InitializeEpoch(1 + i * spy.EpochLength()), +Result::SUCCESS);
+    check_index(parent);
+  }
+
+  BOOST_CHECK(!spy.IsFinalizerVoting(leaving));
+  BOOST_CHECK(spy.IsFinalizerVoting(staying));
+  BOOST_CHECK(spy.IsFinalizerVoting(joining));
+  BOOST_CHECK_EQUAL(spy.GetActiveFinalizersCount(), 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -29,9 +29,9 @@ class FinalizationStateSpy : public FinalizationState {
   CAmount *CurDynDeposits() { return &m_cur_dyn_deposits; }
   CAmount *PrevDynDeposits() { return &m_prev_dyn_deposits; }
   uint64_t *RewardFactor() { return &m_reward_factor; }
-  std::map<uint160, Validator> &Validators() { return m_validators; }
-  std::map<uint160, Validator> *pValidators() { return &m_validators; }
-  std::map<uint32_t, Checkpoint> &Checkpoints() { return m_checkpoints; }
+  util::PersistentMap<uint160, Validator> &Validators() { return m_validators; }
+  util::PersistentMap<uint160, Validator> *pValidators() { return &m_validators; }
+  util::PersistentMap<uint32_t, Checkpoint> &Checkpoints() { return m_checkpoints; }
   void SetRecommendedTarget(const CBlockIndex &block_index) {
     m_recommended_target_hash = block_index.GetBlockHash();
     m_recommended_target_epoch = GetEpoch(block_index);
@@ -39,6 +39,9 @@ class FinalizationStateSpy : public FinalizationState {
   void SetExpectedSourceEpoch(uint32_t epoch) {
     m_expected_source_epoch = epoch;
   }
+  void SetCurrentEpoch(uint32_t epoch) {
+    m_current_epoch = epoch;
+  }
   void SetLastFinalizedEpoch(uint32_t epoch) {
     m_checkpoints[epoch].m_is_finalized = true;
     m_last_finalized_epoch = epoch;
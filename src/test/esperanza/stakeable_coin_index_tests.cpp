@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <esperanza/stakeable_coin_index.h>
+
+#include <test/test_unite.h>
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(stakeable_coin_index_tests, ReducedTestingSetup)
+
+namespace {
+
+std::vector<COutPoint> Visit(const esperanza::StakeableCoinIndex &index,
+                             const blockchain::Height max_height) {
+  std::vector<COutPoint> visited;
+  index.ForEachStakeable(
+      [max_height](const blockchain::Height height) { return height <= max_height; },
+      [&visited](const COutPoint &out_point) { visited.emplace_back(out_point); });
+  return visited;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(visits_coins_by_height) {
+  const uint256 tx1 = uint256S("01");
+  const uint256 tx2 = uint256S("02");
+  const uint256 tx3 = uint256S("03");
+
+  esperanza::StakeableCoinIndex index;
+  index.AddStakeable(COutPoint(tx3, 0), 30);
+  index.AddStakeable(COutPoint(tx1, 0), 10);
+  index.AddStakeable(COutPoint(tx1, 1), 10);
+  index.AddStakeable(COutPoint(tx2, 5), 20);
+  index.AddStakeable(COutPoint(tx2, 5), 20);
+  BOOST_CHECK_EQUAL(index.GetStakeableCount(), 4);
+
+  BOOST_CHECK(Visit(index, 5).empty());
+  BOOST_CHECK(Visit(index, 10) == std::vector<COutPoint>({COutPoint(tx1, 0), COutPoint(tx1, 1)}));
+  BOOST_CHECK(Visit(index, 29) == std::vector<COutPoint>({COutPoint(tx1, 0), COutPoint(tx1, 1), COutPoint(tx2, 5)}));
+  BOOST_CHECK_EQUAL(Visit(index, 100).size(), 4);
+
+  index.RemoveTransaction(tx1);
+  BOOST_CHECK_EQUAL(index.GetStakeableCount(), 2);
+  BOOST_CHECK(Visit(index, 29) == std::vector<COutPoint>({COutPoint(tx2, 5)}));
+
+  index.Clear();
+  BOOST_CHECK(Visit(index, 100).empty());
+}
+
+BOOST_AUTO_TEST_CASE(remote_staking_balance) {
+  const uint256 tx1 = uint256S("01");
+  const uint256 tx2 = uint256S("02");
+
+  esperanza::StakeableCoinIndex index;
+  index.AddStakedRemotely(COutPoint(tx1, 0), 100);
+  index.AddStakedRemotely(COutPoint(tx1, 1), 20);
+  index.AddStakedRemotely(COutPoint(tx2, 0), 3);
+  index.AddStakedRemotely(COutPoint(tx2, 0), 3);
+  BOOST_CHECK_EQUAL(index.GetRemoteStakingBalance(), 123);
+
+  index.RemoveTransaction(tx1);
+  BOOST_CHECK_EQUAL(index.GetRemoteStakingBalance(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(dirty_tracking) {
+  const uint256 tx1 = uint256S("01");
+  const uint256 tx2 = uint256S("02");
+
+  esperanza::StakeableCoinIndex index;
+  std::set<uint256> dirty;
+
+  // a new index has to be built from scratch
+  index.MarkDirty(tx1);
+  BOOST_CHECK(index.TakeDirty(dirty));
+  BOOST_CHECK(dirty.empty());
+
+  index.MarkDirty(tx1);
+  index.MarkDirty(tx2);
+  index.MarkDirty(tx1);
+  BOOST_CHECK(!index.TakeDirty(dirty));
+  BOOST_CHECK(dirty == std::set<uint256>({tx1, tx2}));
+
+  dirty.clear();
+  BOOST_CHECK(!index.TakeDirty(dirty));
+  BOOST_CHECK(dirty.empty());
+
+  index.MarkDirty(tx1);
+  index.MarkAllDirty();
+  BOOST_CHECK(index.TakeDirty(dirty));
+  BOOST_CHECK(dirty.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -26,6 +26,14 @@ std::string stringify(const CBlockIndex *const &index) {
 
 BOOST_AUTO_TEST_SUITE(state_db_tests)
 
+namespace {
+uint160 RandAddress() {
+  uint160 address;
+  GetRandBytes(address.begin(), address.size());
+  return address;
+}
+}  // namespace
+
 BOOST_AUTO_TEST_CASE(leveldb_rand) {
   mocks::ActiveChainMock active_chain;
   mocks::BlockIndexMapMock block_index_map;
@@ -191,4 +199,79 @@ BOOST_AUTO_TEST_CASE(load_best_states) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(save_deltas) {
+  ActiveChainTest active_chain;
+  mocks::BlockIndexMapMock block_index_map;
+  Settings settings;
+  finalization::StateDBParams params;
+  params.inmemory = true;
+
+  esperanza::FinalizationParams finalization_params;
+  esperanza::AdminParams admin_params;
+
+  std::unique_ptr<finalization::StateDB> db =
+      finalization::StateDB::NewFromParams(params, &settings, &block_index_map, &active_chain);
+
+  LOCK(block_index_map.GetLock());
+  LOCK(active_chain.GetLock());
+
+  // Every state is derived from the one of its parent with a few changes, as
+  // it happens when blocks are processed. The spies own the parameters the
+  // states refer to, so they must not be reallocated.
+  std::vector<FinalizationStateSpy> spies;
+  spies.reserve(51);
+  spies.emplace_back();
+  spies.back().shuffle();
+  std::map<const CBlockIndex *, esperanza::FinalizationState> original;
+  for (size_t i = 0; i < 50; ++i) {
+    CBlockIndex *index = block_index_map.Insert(GetRandHash());
+    index->pprev = active_chain.tip;
+    index->nHeight = i;
+    active_chain.Add(*index);
+
+    spies.emplace_back(spies.back());
+    FinalizationStateSpy &child = spies.back();
+    child.Validators()[RandAddress()].m_deposit = i;
+    child.Checkpoints()[i % 3].m_vote_set.insert(RandAddress());
+    if (i % 7 == 0) {
+      child.Checkpoints().erase(i % 3);
+      child.Validators().erase(child.Validators().begin()->first);
+    }
+    original.emplace(index, FinalizationState(child, esperanza::FinalizationState::COMPLETED));
+  }
+
+  BOOST_CHECK(db->Save(original));
+
+  auto check_restored = [&] {
+    std::map<const CBlockIndex *, esperanza::FinalizationState> restored;
+    BOOST_CHECK(db->Load(finalization_params, admin_params, &restored));
+    BOOST_CHECK_EQUAL(restored, original);
+    for (const auto &it : restored) {
+      BOOST_CHECK_EQUAL(it.second.GetInitStatus(), esperanza::FinalizationState::COMPLETED);
+    }
+
+    std::map<const CBlockIndex *, esperanza::FinalizationState> single;
+    BOOST_CHECK(db->Load(*active_chain.GetTip(), finalization_params, admin_params, &single));
+    BOOST_CHECK_EQUAL(single.size(), 1);
+    BOOST_CHECK_EQUAL(single.begin()->second, original.at(active_chain.GetTip()));
+  };
+  check_restored();
+
+  // Change a state in the middle of the chain. Its descendants are stored as
+  // deltas against it and must still be restored correctly.
+  const CBlockIndex *middle = active_chain.stub_AtHeight(20);
+  {
+    FinalizationStateSpy &changed = spies[middle->nHeight + 1];
+    changed.Validators()[RandAddress()].m_deposit = 1000;
+    original.erase(middle);
+    original.emplace(middle, FinalizationState(changed, esperanza::FinalizationState::COMPLETED));
+  }
+  BOOST_CHECK(db->Save(original));
+  check_restored();
+
+  // Saving again without changes keeps everything intact.
+  BOOST_CHECK(db->Save(original));
+  check_restored();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -409,4 +409,39 @@ BOOST_AUTO_TEST_CASE(recovering) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(tip_snapshot) {
+  Fixture fixture;
+  const auto &b0 = fixture.CreateBlockIndex();
+  const auto &b1 = fixture.CreateBlockIndex();
+
+  finalization::StateRepository &repo = *fixture.m_repo;
+  BOOST_CHECK(repo.GetTipSnapshot() == nullptr);
+
+  LOCK(repo.GetLock());
+  auto *state1 = repo.FindOrCreate(b1, S::COMPLETED);
+  BOOST_REQUIRE(state1 != nullptr);
+  repo.PublishTipSnapshot();
+
+  const std::shared_ptr<const finalization::FinalizationState> snapshot1 = repo.GetTipSnapshot();
+  BOOST_REQUIRE(snapshot1 != nullptr);
+  BOOST_CHECK_EQUAL(*snapshot1, *state1);
+
+  // the snapshot doesn't follow the changes of the state it was taken from
+  state1->ProcessNewCommits(b1, {});
+  BOOST_CHECK(state1->GetInitStatus() == S::FROM_COMMITS);
+  BOOST_CHECK(snapshot1->GetInitStatus() == S::NEW);
+  BOOST_CHECK(repo.GetTipSnapshot() == snapshot1);
+
+  // moving the tip back publishes the state of the new tip
+  fixture.m_chain.tip = fixture.m_chain.tip->pprev;
+  repo.PublishTipSnapshot();
+  const std::shared_ptr<const finalization::FinalizationState> snapshot0 = repo.GetTipSnapshot();
+  BOOST_REQUIRE(snapshot0 != nullptr);
+  BOOST_CHECK_EQUAL(*snapshot0, *repo.Find(b0));
+  BOOST_CHECK(snapshot1->GetInitStatus() == S::NEW);
+
+  fixture.Reset();
+  BOOST_CHECK(repo.GetTipSnapshot() == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -189,4 +189,70 @@ BOOST_AUTO_TEST_CASE(record_surrounding_vote_outer_passed) {
   UnregisterValidationInterface(&listener);
 }
 
+BOOST_AUTO_TEST_CASE(validator_votes_find_offending_vote) {
+
+  const auto is_offending = [](const esperanza::Vote &a, const esperanza::Vote &b) {
+    return (a.m_target_epoch == b.m_target_epoch && a.m_target_hash != b.m_target_hash) ||
+           (a.m_source_epoch < b.m_source_epoch && a.m_target_epoch > b.m_target_epoch) ||
+           (a.m_source_epoch > b.m_source_epoch && a.m_target_epoch < b.m_target_epoch);
+  };
+
+  const uint160 validatorAddress = RandValidatorAddr();
+  FastRandomContext rng(true);
+  std::map<uint32_t, esperanza::Vote> recorded;
+  ValidatorVotes votes;
+
+  const auto check = [&](const esperanza::Vote &vote) {
+    bool expected = false;
+    for (const auto &entry : recorded) {
+      expected |= is_offending(vote, entry.second);
+    }
+    const VoteRecord *offending = votes.FindOffendingVote(vote);
+    BOOST_CHECK_EQUAL(offending != nullptr, expected);
+    if (offending != nullptr) {
+      BOOST_CHECK(is_offending(vote, offending->vote));
+    }
+  };
+
+  for (int i = 0; i < 2000; ++i) {
+    const uint32_t target = 1 + rng.randrange(100);
+    const uint32_t source = rng.randrange(target);
+    const esperanza::Vote vote{validatorAddress, uint256S(std::to_string(rng.randrange(2))), source, target};
+    check(vote);
+    const bool added = votes.Add(VoteRecord{vote, {}});
+    BOOST_CHECK_EQUAL(added, recorded.emplace(target, vote).second);
+
+    if (i == 1000) {
+      votes.PruneBelow(50);
+      recorded.erase(recorded.begin(), recorded.lower_bound(50));
+      BOOST_CHECK(votes.Get(49) == nullptr);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(prune_votes) {
+
+  FinalizationStateSpy spy;
+  auto recorder = VoteRecorder::GetVoteRecorder();
+
+  uint160 validatorAddress = RandValidatorAddr();
+  spy.ProcessDeposit(validatorAddress, 1000000);
+
+  const uint32_t window = spy.GetWithdrawalEpochDelay();
+
+  esperanza::Vote oldVote{validatorAddress, GetRandHash(), 1, 2};
+  esperanza::Vote recentVote{validatorAddress, GetRandHash(), 3, 4};
+  recorder->RecordVote(oldVote, ToByteVector(GetRandHash()), spy);
+  recorder->RecordVote(recentVote, ToByteVector(GetRandHash()), spy);
+  BOOST_CHECK(recorder->GetVote(validatorAddress, 2));
+
+  spy.SetLastFinalizedEpoch(window + 3);
+  esperanza::Vote vote{validatorAddress, GetRandHash(), window + 3, window + 4};
+  recorder->RecordVote(vote, ToByteVector(GetRandHash()), spy);
+
+  BOOST_CHECK(!recorder->GetVote(validatorAddress, 2));
+  BOOST_CHECK(recorder->GetVote(validatorAddress, 4));
+  BOOST_CHECK(recorder->GetVote(validatorAddress, window + 4));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -33,6 +33,7 @@ public:
 
   using p2p::FinalizerCommitsHandlerImpl::FindMostRecentStart;
   using p2p::FinalizerCommitsHandlerImpl::FindStop;
+  using p2p::FinalizerCommitsHandlerImpl::GetCommits;
   using p2p::FinalizerCommitsHandlerImpl::IsSameFork;
 };
 
@@ -42,6 +43,11 @@ public:
 
   CCriticalSection &GetLock() override { return cs; }
   FinalizationState *GetTipState() override { return &state; }
+  std::shared_ptr<const FinalizationState> GetTipSnapshot() const override {
+    // the tests modify the state in place, so the snapshot refers to it
+    return std::shared_ptr<const FinalizationState>(&state, [](const FinalizationState *) {});
+  }
+  void PublishTipSnapshot() override { }
   FinalizationState *Find(const CBlockIndex &) override { return &state; }
   FinalizationState *FindOrCreate(const CBlockIndex &, FinalizationState::InitStatus) override { return &state; }
   bool Confirm(const CBlockIndex &, FinalizationState &&, FinalizationState **) override { return false; }
@@ -108,6 +114,17 @@ class Fixture {
     return index;
   }
 
+  void AddBlocksWithCommits(const size_t amount, const size_t commit_size) {
+    for (size_t i = 0; i < amount; ++i) {
+      CBlockIndex &index = CreateBlockIndex();
+      CMutableTransaction tx;
+      tx.SetType(TxType::VOTE);
+      const std::vector<uint8_t> script(commit_size, OP_TRUE);
+      tx.vout.emplace_back(index.nHeight, CScript(script.begin(), script.end()));
+      index.commits = std::vector<CTransactionRef>{MakeTransactionRef(tx)};
+    }
+  }
+
   void AddBlocks(const size_t amount) {
     for (size_t i = 0; i < amount; ++i) {
       CreateBlockIndex();
@@ -635,4 +652,73 @@ BOOST_AUTO_TEST_CASE(is_same_fork_test) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(get_commits_splits_long_ranges) {
+  Fixture fixture;
+  fixture.AddBlocks(1);  // add genesis
+  fixture.AddBlocksWithCommits(100, 100000);
+
+  staking::ActiveChain &chain = fixture.active_chain;
+  const p2p::FinalizerCommitsLocator locator{{chain.GetGenesis()->GetBlockHash()}, uint256()};
+
+  const auto responses = fixture.commits.GetCommits(locator, Params().GetConsensus());
+  BOOST_REQUIRE(responses != nullptr);
+  BOOST_REQUIRE(responses->size() > 1);
+
+  blockchain::Height height = 1;
+  for (size_t i = 0; i < responses->size(); ++i) {
+    const p2p::FinalizerCommitsResponse &response = (*responses)[i];
+    BOOST_CHECK(GetSerializeSize(response, SER_NETWORK, PROTOCOL_VERSION) < MAX_PROTOCOL_MESSAGE_LENGTH);
+    const auto expected_status = i + 1 < responses->size()
+                                     ? p2p::FinalizerCommitsResponse::Status::LengthExceeded
+                                     : p2p::FinalizerCommitsResponse::Status::TipReached;
+    BOOST_CHECK(response.status == expected_status);
+    for (const p2p::HeaderAndFinalizerCommits &entry : response.data) {
+      BOOST_REQUIRE_EQUAL(entry.commits.size(), 1);
+      BOOST_CHECK(entry.commits[0] == chain.AtHeight(height)->commits->at(0));
+      ++height;
+    }
+  }
+  // No block is lost in between the messages.
+  BOOST_CHECK_EQUAL(height, 101);
+}
+
+BOOST_AUTO_TEST_CASE(get_commits_caches_finalized_ranges) {
+  Fixture fixture;
+  fixture.AddBlocks(1);  // add genesis
+  fixture.AddBlocksWithCommits(13, 10);
+
+  staking::ActiveChain &chain = fixture.active_chain;
+  FinalizationStateSpy &state = fixture.repo.state;
+  state.SetLastFinalizedEpoch(1);
+  state.SetLastFinalizedEpoch(2);
+
+  const Consensus::Params &params = Params().GetConsensus();
+
+  // Blocks 1..5 are finalized, the response doesn't change anymore.
+  {
+    const p2p::FinalizerCommitsLocator locator{{chain.GetGenesis()->GetBlockHash()}, uint256()};
+    const auto first = fixture.commits.GetCommits(locator, params);
+    BOOST_REQUIRE(first != nullptr);
+    BOOST_REQUIRE_EQUAL(first->size(), 1);
+    BOOST_CHECK_EQUAL(first->front().data.size(), 5);
+    BOOST_CHECK(first->front().status == p2p::FinalizerCommitsResponse::Status::StopOrFinalizationReached);
+
+    const auto second = fixture.commits.GetCommits(locator, params);
+    BOOST_CHECK(second == first);
+  }
+
+  // Blocks 11..13 can still be reverted.
+  {
+    const p2p::FinalizerCommitsLocator locator{{chain.AtHeight(10)->GetBlockHash()}, uint256()};
+    const auto first = fixture.commits.GetCommits(locator, params);
+    BOOST_REQUIRE(first != nullptr);
+    BOOST_REQUIRE_EQUAL(first->size(), 1);
+    BOOST_CHECK_EQUAL(first->front().data.size(), 3);
+    BOOST_CHECK(first->front().status == p2p::FinalizerCommitsResponse::Status::TipReached);
+
+    const auto second = fixture.commits.GetCommits(locator, params);
+    BOOST_CHECK(second != first);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -220,4 +220,53 @@ BOOST_AUTO_TEST_CASE(test_invalid_serialization) {
   BOOST_CHECK(!iblt2.IsValid());
 }
 
+BOOST_AUTO_TEST_CASE(test_zero_size_values) {
+  using KeysIBLT = IBLT<uint64_t, 0>;
+  KeysIBLT sender(50);
+  KeysIBLT receiver = sender.CloneEmpty();
+
+  for (uint64_t i = 1; i <= 1000; i++) {
+    sender.Insert(i, {});
+    if (i > 25) {
+      receiver.Insert(i, {});
+    }
+  }
+  for (uint64_t i = 1001; i <= 1025; i++) {
+    receiver.Insert(i, {});
+  }
+
+  KeysIBLT::TEntriesMap positive;
+  KeysIBLT::TEntriesMap negative;
+  BOOST_CHECK((sender - receiver).ListEntries(positive, negative));
+  BOOST_CHECK_EQUAL(positive.size(), 25);
+  BOOST_CHECK_EQUAL(negative.size(), 25);
+  for (uint64_t i = 1; i <= 25; i++) {
+    BOOST_CHECK(positive.count(i) == 1 && positive[i].empty());
+    BOOST_CHECK(negative.count(1000 + i) == 1 && negative[1000 + i].empty());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_entries_serialization) {
+  DefaultIBLT iblt(5);
+  iblt.Insert(1, PseudoRandomValue(1));
+
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  stream << iblt;
+
+  // Empty entries are sent without a value: 1 byte count, 8 bytes key,
+  // 4 bytes key check, 1 byte value len. Each of the entries the item was
+  // inserted into has additional 4 bytes of value.
+  const size_t entries = DefaultIBLT::ComputeNumberOfEntries(5);
+  const size_t num_hashes = IBLTParams::FindOptimal(5).num_hashes;
+  BOOST_CHECK_EQUAL(stream.size(), 1 + entries * 14 + num_hashes * 4 + 1);
+
+  DefaultIBLT received;
+  stream >> received;
+  std::vector<uint8_t> value;
+  BOOST_CHECK(received.Get(1, value));
+  BOOST_CHECK_EQUAL(HexStr(value), HexStr(PseudoRandomValue(1)));
+  BOOST_CHECK(received.Get(2, value));
+  BOOST_CHECK(value.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
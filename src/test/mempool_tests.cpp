@@ -2,10 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <esperanza/checks.h>
+#include <key.h>
 #include <policy/policy.h>
 #include <txmempool.h>
 #include <util.h>
 
+#include <test/esperanza/finalization_utils.h>
+#include <test/esperanza/finalizationstate_utils.h>
 #include <test/test_unite.h>
 
 #include <boost/test/unit_test.hpp>
@@ -661,4 +665,62 @@ BOOST_AUTO_TEST_CASE(DisconnectionTopologicalOrderTest)
     disconnectpool.clear();
 }
 
+
+BOOST_AUTO_TEST_CASE(MempoolFinalizerCommitIndexTest)
+{
+    CTxMemPool pool;
+    LOCK(pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<CTransactionRef> votes;
+    for (const uint32_t target_epoch : {7, 2, 5, 0, 3}) {
+        const esperanza::Vote vote{key.GetPubKey().GetID(), GetRandHash(), 0, target_epoch};
+        votes.emplace_back(MakeTransactionRef(CreateVoteTx(vote, key)));
+        pool.addUnchecked(votes.back()->GetHash(), entry.FromTx(*votes.back()));
+    }
+
+    CMutableTransaction slash;
+    slash.SetType(TxType::SLASH);
+    slash.vin.resize(1);
+    slash.vin[0].scriptSig = CScript() << OP_11;
+    slash.vout.resize(1);
+    pool.addUnchecked(slash.GetHash(), entry.FromTx(slash));
+
+    CMutableTransaction regular;
+    regular.vin.resize(1);
+    regular.vin[0].scriptSig = CScript() << OP_12;
+    regular.vout.resize(1);
+    pool.addUnchecked(regular.GetHash(), entry.FromTx(regular));
+
+    // the regular transaction, the votes by target epoch, the slash
+    std::vector<uint32_t> target_epochs;
+    std::vector<TxType> types;
+    for (const CTxMemPoolEntry &e : pool.mapTx.get<finalizer_commit>()) {
+        types.emplace_back(e.GetTx().GetType());
+        if (e.GetTx().IsVote()) {
+            target_epochs.emplace_back(e.GetVoteTargetEpoch());
+        }
+    }
+    BOOST_REQUIRE_EQUAL(types.size(), 7U);
+    BOOST_CHECK(types.front() == +TxType::REGULAR);
+    BOOST_CHECK(types.back() == +TxType::SLASH);
+    const std::vector<uint32_t> expected_epochs = {0, 2, 3, 5, 7};
+    BOOST_CHECK(target_epochs == expected_epochs);
+
+    // only the votes which target an epoch before 4 are expired
+    FinalizationStateSpy fin_state;
+    fin_state.SetCurrentEpoch(5);
+    BOOST_CHECK_EQUAL(pool.ExpireVotes(fin_state), 3);
+    BOOST_CHECK_EQUAL(pool.size(), 4U);
+    for (const CTransactionRef &vote : votes) {
+        BOOST_CHECK_EQUAL(pool.exists(vote->GetHash()), !IsVoteExpired(*vote, fin_state));
+    }
+    BOOST_CHECK(pool.exists(votes[0]->GetHash()));
+    BOOST_CHECK(pool.exists(votes[2]->GetHash()));
+    BOOST_CHECK(pool.exists(slash.GetHash()));
+    BOOST_CHECK(pool.exists(regular.GetHash()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -47,6 +47,12 @@ class MempoolMock : public ::TxPool {
     return txs;
   }
 
+  void ForEachTx(const size_t max_workers, const TxVisitor &visitor) const override {
+    for (size_t i = 0; i < txs.size(); ++i) {
+      visitor(i % max_workers, txs[i], txs[i]->GetWitnessHash());
+    }
+  }
+
   std::vector<CTransactionRef> txs;
 };
 
@@ -179,7 +185,7 @@ BOOST_AUTO_TEST_CASE(thousands_of_txs) {
 
   const p2p::GrapheneBlock graphene = maybe_graphene.get();
 
-  p2p::GrapheneBlockReconstructor reconstructor(graphene, receiver_mempool);
+  p2p::GrapheneBlockReconstructor reconstructor(graphene, receiver_mempool, 4);
 
   BOOST_CHECK_EQUAL(reconstructor.GetState(), +p2p::GrapheneDecodeState::NEED_MORE_TXS);
 
@@ -198,6 +204,54 @@ BOOST_AUTO_TEST_CASE(thousands_of_txs) {
   CheckBlocksEqual(block, reconstructed);
 }
 
+BOOST_AUTO_TEST_CASE(encoder_sizes) {
+  FastRandomContext random(true);
+  size_t seed = 0;
+
+  for (const size_t block_txs : {50, 500, 5000}) {
+    CBlock block;
+    block.vtx.emplace_back(CreateCoinbase());
+    for (size_t i = 0; i < block_txs; ++i) {
+      block.vtx.emplace_back(CreateTx(seed++));
+    }
+    ltor::SortTransactions(block.vtx);
+
+    const p2p::GrapheneBlockEncoder encoder(block);
+    BOOST_CHECK_EQUAL(encoder.GetBlockHash(), block.GetHash());
+
+    const CBlockHeaderAndShortTxIDs cmpct_block(block);
+    BOOST_CHECK_EQUAL(encoder.GetCompactBlockSize(),
+                      GetSerializeSize(cmpct_block, SER_NETWORK, PROTOCOL_VERSION));
+
+    for (const size_t receiver_txs : {block_txs / 2, block_txs, block_txs * 10}) {
+      const p2p::GrapheneBlockParams params = encoder.GetParams(block_txs, receiver_txs);
+      const auto maybe_graphene = encoder.Encode(params, random.rand64(), random.rand32());
+      BOOST_REQUIRE(maybe_graphene);
+
+      const size_t size = GetSerializeSize(maybe_graphene.get(), SER_NETWORK, PROTOCOL_VERSION);
+      const size_t estimate = encoder.EstimateGrapheneBlockSize(params);
+      const size_t iblt_entries = p2p::GrapheneIblt::ComputeNumberOfEntries(params.expected_symmetric_difference);
+      BOOST_CHECK_LE(estimate, size + 2 * iblt_entries);
+      BOOST_CHECK_LE(size, estimate + 2 * iblt_entries);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(tx_pool_size_bucket) {
+  BOOST_CHECK_EQUAL(p2p::GetTxPoolSizeBucket(0), 0);
+  BOOST_CHECK_EQUAL(p2p::GetTxPoolSizeBucket(31), 31);
+  BOOST_CHECK_EQUAL(p2p::GetTxPoolSizeBucket(33), 34);
+  BOOST_CHECK_EQUAL(p2p::GetTxPoolSizeBucket(1000), 1024);
+  BOOST_CHECK_EQUAL(p2p::GetTxPoolSizeBucket(1024), 1024);
+
+  for (uint64_t count = 0; count < 100000; count += 7) {
+    const uint64_t bucket = p2p::GetTxPoolSizeBucket(count);
+    BOOST_CHECK_GE(bucket, count);
+    BOOST_CHECK_LE(bucket - count, count / 16);
+    BOOST_CHECK_EQUAL(p2p::GetTxPoolSizeBucket(bucket), bucket);
+  }
+}
+
 size_t RandRange(size_t min_incl, size_t max_incl, FastRandomContext &random) {
   BOOST_REQUIRE(min_incl <= max_incl);
   return random.randrange(max_incl - min_incl + 1) + min_incl;
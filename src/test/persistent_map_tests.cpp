@@ -0,0 +1,187 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/persistent_map.h>
+
+#include <random.h>
+#include <streams.h>
+#include <test/test_unite.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <set>
+
+BOOST_FIXTURE_TEST_SUITE(persistent_map_tests, ReducedTestingSetup)
+
+namespace {
+
+template <typename M1, typename M2>
+void CheckSame(const M1 &expected, const M2 &actual) {
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  auto it = actual.begin();
+  for (const auto &entry : expected) {
+    BOOST_REQUIRE(it != actual.end());
+    BOOST_CHECK_EQUAL(entry.first, it->first);
+    BOOST_CHECK_EQUAL(entry.second, it->second);
+    ++it;
+  }
+  BOOST_CHECK(it == actual.end());
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(behaves_like_std_map) {
+  std::map<uint32_t, uint64_t> expected;
+  util::PersistentMap<uint32_t, uint64_t> actual;
+
+  FastRandomContext rng(true);
+  for (int i = 0; i < 5000; ++i) {
+    const uint32_t key = rng.randrange(500);
+    switch (rng.randrange(4)) {
+      case 0:
+        expected[key] = i;
+        actual[key] = i;
+        break;
+      case 1:
+        BOOST_CHECK_EQUAL(expected.emplace(key, i).second, actual.emplace(key, i).second);
+        break;
+      case 2:
+        BOOST_CHECK_EQUAL(expected.erase(key), actual.erase(key));
+        break;
+      case 3: {
+        const auto it = actual.find(key);
+        BOOST_CHECK_EQUAL(expected.count(key), it != actual.end() ? 1 : 0);
+        const auto lb = actual.lower_bound(key);
+        if (expected.lower_bound(key) == expected.end()) {
+          BOOST_CHECK(lb == actual.end());
+        } else {
+          BOOST_CHECK_EQUAL(expected.lower_bound(key)->first, lb->first);
+        }
+        break;
+      }
+    }
+  }
+  CheckSame(expected, actual);
+}
+
+BOOST_AUTO_TEST_CASE(copies_are_independent) {
+  util::PersistentMap<uint32_t, uint32_t> parent;
+  for (uint32_t i = 0; i < 100; ++i) {
+    parent[i] = i;
+  }
+
+  util::PersistentMap<uint32_t, uint32_t> child = parent;
+  BOOST_CHECK(child.SharesRootWith(parent));
+  BOOST_CHECK(child == parent);
+
+  child[10] = 1000;
+  child.at(20) = 2000;
+  child.erase(30);
+  child[200] = 200;
+  BOOST_CHECK(!child.SharesRootWith(parent));
+  BOOST_CHECK(child != parent);
+
+  // The parent did not change.
+  BOOST_CHECK_EQUAL(parent.size(), 100);
+  for (uint32_t i = 0; i < 100; ++i) {
+    BOOST_CHECK_EQUAL(parent.at(i), i);
+  }
+
+  BOOST_CHECK_EQUAL(child.size(), 100);
+  BOOST_CHECK_EQUAL(child.at(10), 1000);
+  BOOST_CHECK_EQUAL(child.at(20), 2000);
+  BOOST_CHECK_EQUAL(child.count(30), 0);
+  BOOST_CHECK_EQUAL(child.at(200), 200);
+
+  const util::PersistentMap<uint32_t, uint32_t> &const_child = child;
+  BOOST_CHECK_THROW(const_child.at(30), std::out_of_range);
+  BOOST_CHECK_THROW(child.at(30), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_matches_std_map) {
+  std::map<uint32_t, std::string> expected;
+  util::PersistentMap<uint32_t, std::string> actual;
+  for (uint32_t i = 0; i < 1000; i += 3) {
+    expected[i] = std::to_string(i);
+    actual[i] = std::to_string(i);
+  }
+
+  CDataStream expected_stream(SER_DISK, PROTOCOL_VERSION);
+  CDataStream actual_stream(SER_DISK, PROTOCOL_VERSION);
+  expected_stream << expected;
+  actual_stream << actual;
+  BOOST_CHECK(expected_stream.str() == actual_stream.str());
+
+  util::PersistentMap<uint32_t, std::string> restored;
+  expected_stream >> restored;
+  BOOST_CHECK(restored == actual);
+  CheckSame(expected, restored);
+
+  // The restored tree is balanced and can still be modified.
+  restored.erase(0);
+  restored[1] = "1";
+  BOOST_CHECK_EQUAL(restored.size(), actual.size());
+}
+
+BOOST_AUTO_TEST_CASE(for_each_difference) {
+  util::PersistentMap<uint32_t, uint32_t> from;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    from[i] = i;
+  }
+
+  FastRandomContext rng(true);
+  util::PersistentMap<uint32_t, uint32_t> to = from;
+  std::map<uint32_t, std::pair<bool, bool>> expected;
+  for (int i = 0; i < 100; ++i) {
+    const uint32_t key = rng.randrange(1200);
+    if (rng.randbool()) {
+      to[key] = key + 1;
+    } else {
+      to.erase(key);
+    }
+  }
+  for (uint32_t key = 0; key < 1200; ++key) {
+    const bool in_from = from.count(key) != 0;
+    const bool in_to = to.count(key) != 0;
+    if (in_from != in_to || (in_from && from.at(key) != to.at(key))) {
+      expected.emplace(key, std::make_pair(in_to, in_from));
+    }
+  }
+
+  std::map<uint32_t, std::pair<bool, bool>> actual;
+  to.ForEachDifference(from, [&actual](const uint32_t key, const uint32_t *mine, const uint32_t *theirs) {
+    BOOST_CHECK(mine == nullptr || theirs == nullptr || *mine != *theirs);
+    BOOST_CHECK(actual.emplace(key, std::make_pair(mine != nullptr, theirs != nullptr)).second);
+  });
+  BOOST_CHECK(actual == expected);
+
+  size_t calls = 0;
+  from.ForEachDifference(from, [&calls](uint32_t, const uint32_t *, const uint32_t *) { ++calls; });
+  BOOST_CHECK_EQUAL(calls, 0);
+}
+
+BOOST_AUTO_TEST_CASE(persistent_set) {
+  std::set<uint32_t> expected{5, 1, 3};
+  util::PersistentSet<uint32_t> actual{5, 1, 3};
+  util::PersistentSet<uint32_t> copy = actual;
+
+  BOOST_CHECK(actual.emplace(7).second);
+  BOOST_CHECK(!actual.insert(1).second);
+  expected.insert(7);
+
+  BOOST_CHECK(actual.find(3) != actual.end());
+  BOOST_CHECK(actual.find(4) == actual.end());
+  BOOST_CHECK_EQUAL(copy.size(), 3);
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), actual.begin()));
+
+  CDataStream expected_stream(SER_DISK, PROTOCOL_VERSION);
+  CDataStream actual_stream(SER_DISK, PROTOCOL_VERSION);
+  expected_stream << expected;
+  actual_stream << actual;
+  BOOST_CHECK(expected_stream.str() == actual_stream.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
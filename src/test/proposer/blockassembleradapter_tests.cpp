@@ -3,7 +3,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <finalization/state_repository.h>
+#include <injector.h>
+#include <staking/active_chain.h>
 #include <test/test_unite.h>
+#include <txmempool.h>
 #include <validation.h>
 
 #include <string>
@@ -18,6 +22,15 @@ struct RegtestingWalletSetup : public WalletTestingSetup {
   RegtestingWalletSetup() : WalletTestingSetup(CBaseChainParams::REGTEST) {}
 };
 
+namespace {
+
+std::unique_ptr<staking::TransactionPicker> NewTransactionPicker() {
+  return staking::TransactionPicker::New(GetComponent<staking::ActiveChain>(),
+                                         GetComponent<finalization::StateRepository>());
+}
+
+}  // namespace
+
 BOOST_FIXTURE_TEST_SUITE(blockassembleradapter_tests, RegtestingWalletSetup)
 
 BOOST_AUTO_TEST_CASE(block_assembler_adapter_test) {
@@ -26,7 +39,7 @@ BOOST_AUTO_TEST_CASE(block_assembler_adapter_test) {
   // that it does not crash and does yield a value. For a proper test
   // transactions will have to be mocked.
 
-  auto blockAssemblerAdapter = staking::TransactionPicker::New();
+  auto blockAssemblerAdapter = NewTransactionPicker();
   const auto params = staking::TransactionPicker::PickTransactionsParameters();
 
   auto result = blockAssemblerAdapter->PickTransactions(params);
@@ -42,7 +55,7 @@ BOOST_AUTO_TEST_CASE(block_assembler_adapter_test) {
 
 BOOST_AUTO_TEST_CASE(pick_transactions_removes_bitcoin_coinbase) {
 
-  const auto blockAssemblerAdapter = staking::TransactionPicker::New();
+  const auto blockAssemblerAdapter = NewTransactionPicker();
   const auto params = staking::TransactionPicker::PickTransactionsParameters();
 
   const auto result = blockAssemblerAdapter->PickTransactions(params);
@@ -52,4 +65,58 @@ BOOST_AUTO_TEST_CASE(pick_transactions_removes_bitcoin_coinbase) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(pick_transactions_without_stakeable_coins) {
+
+  // the coinbase is built by the proposer, picking the transactions
+  // doesn't need a coin to stake
+  const auto blockAssemblerAdapter = NewTransactionPicker();
+  const auto params = staking::TransactionPicker::PickTransactionsParameters();
+
+  const auto result = blockAssemblerAdapter->PickTransactions(params);
+
+  BOOST_CHECK_MESSAGE(result, result.error);
+  BOOST_CHECK(result.transactions.empty());
+  BOOST_CHECK(result.fees.empty());
+}
+
+BOOST_AUTO_TEST_CASE(pick_transactions_follows_mempool) {
+
+  const auto blockAssemblerAdapter = NewTransactionPicker();
+  const auto params = staking::TransactionPicker::PickTransactionsParameters();
+
+  auto result = blockAssemblerAdapter->PickTransactions(params);
+  BOOST_CHECK(result.transactions.empty());
+
+  TestMemPoolEntryHelper entry;
+  std::vector<CTransactionRef> txs;
+  for (int i = 0; i < 3; ++i) {
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(GetRandHash(), 0);
+    mtx.vout.emplace_back(1000, CScript() << OP_TRUE);
+    txs.emplace_back(MakeTransactionRef(mtx));
+    LOCK(mempool.cs);
+    mempool.addUnchecked(txs.back()->GetHash(), entry.Fee(10000 * (i + 1)).FromTx(*txs.back()));
+  }
+
+  // the template is assembled again as the mempool changed
+  result = blockAssemblerAdapter->PickTransactions(params);
+  BOOST_CHECK_MESSAGE(result, result.error);
+  BOOST_REQUIRE_EQUAL(result.transactions.size(), 3);
+  BOOST_REQUIRE_EQUAL(result.fees.size(), 3);
+  for (size_t i = 0; i < 3; ++i) {
+    const auto it = std::find_if(txs.begin(), txs.end(), [&result, i](const CTransactionRef &tx) {
+      return tx->GetHash() == result.transactions[i]->GetHash();
+    });
+    BOOST_REQUIRE(it != txs.end());
+    BOOST_CHECK_EQUAL(result.fees[i], 10000 * (it - txs.begin() + 1));
+  }
+  for (size_t i = 1; i < 3; ++i) {
+    BOOST_CHECK(result.transactions[i - 1]->GetHash().CompareAsNumber(result.transactions[i]->GetHash()) < 0);
+  }
+
+  mempool.clear();
+  result = blockAssemblerAdapter->PickTransactions(params);
+  BOOST_CHECK(result.transactions.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include <proposer/proposer_logic.h>
 
+#include <settings.h>
 #include <staking/validation_result.h>
 
 #include <test/test_unite.h>
@@ -16,6 +17,7 @@ namespace {
 
 struct Fixture {
 
+  Settings settings;
   blockchain::Parameters parameters = blockchain::Parameters::TestNet();
   std::unique_ptr<blockchain::Behavior> behavior = blockchain::Behavior::NewFromParameters(parameters);
 
@@ -27,7 +29,7 @@ struct Fixture {
   mocks::StakeValidatorMock stake_validator_mock;
 
   std::unique_ptr<proposer::Logic> GetProposerLogic() {
-    return proposer::Logic::New(behavior.get(), &network_mock, &active_chain_mock, &stake_validator_mock);
+    return proposer::Logic::New(&settings, behavior.get(), &network_mock, &active_chain_mock, &stake_validator_mock);
   }
 };
 
@@ -0,0 +1,122 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/chunk_reader.h>
+
+#include <snapshot/compression.h>
+#include <snapshot/iterator.h>
+#include <streams.h>
+#include <test/test_unite.h>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_chunk_reader_tests, BasicTestingSetup)
+
+void CheckReadChunks(const uint8_t file_format) {
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+
+  const uint64_t total = 20;
+  snapshot::SnapshotHeader header;
+  header.snapshot_hash = uint256S("aa");
+  {
+    // 6 subsets per file, the last file has 2
+    snapshot::Indexer indexer(header, 3, 2, file_format);
+    for (uint32_t i = 0; i < total; ++i) {
+      if (i == 13) {
+        // the step is stored in two blocks
+        BOOST_CHECK(indexer.Flush());
+      }
+      snapshot::UTXOSubset subset;
+      subset.tx_id = uint256S(std::to_string(i + 1));
+      subset.height = i;
+      for (uint32_t n = 0; n < i % 4; ++n) {
+        subset.outputs[n * 3] = CTxOut(i * 100 + n, CScript() << std::vector<uint8_t>(i * 10, 1));
+      }
+      BOOST_CHECK(indexer.WriteUTXOSubset(subset));
+    }
+    BOOST_CHECK(indexer.Flush());
+  }
+
+  LOCK(snapshot::cs_snapshot);
+  snapshot::ChunkReader reader(snapshot::Indexer::Open(header.snapshot_hash));
+  snapshot::Iterator iter(snapshot::Indexer::Open(header.snapshot_hash));
+
+  const auto check = [&](const uint64_t index, const uint16_t count) {
+    snapshot::Snapshot expected;
+    expected.snapshot_hash = header.snapshot_hash;
+    expected.utxo_subset_index = index;
+    BOOST_REQUIRE(iter.GetUTXOSubsets(index, count, expected.utxo_subsets));
+    CDataStream expected_stream(SER_NETWORK, PROTOCOL_VERSION);
+    expected_stream << expected;
+
+    snapshot::SerializedSnapshot serialized;
+    BOOST_REQUIRE(reader.ReadChunk(index, count, snapshot::SNAPSHOT_FORMAT_PLAIN, serialized));
+    BOOST_CHECK_EQUAL(serialized.utxo_subset_count, expected.utxo_subsets.size());
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << serialized;
+    BOOST_CHECK_EQUAL(HexStr(stream), HexStr(expected_stream));
+
+    BOOST_REQUIRE(reader.ReadChunk(index, count, snapshot::SNAPSHOT_FORMAT_COMPRESSED, serialized));
+    BOOST_CHECK_EQUAL(serialized.utxo_subset_count, expected.utxo_subsets.size());
+    CDataStream compressed_stream(SER_NETWORK, PROTOCOL_VERSION);
+    compressed_stream << serialized;
+    snapshot::Snapshot received;
+    snapshot::SnapshotCompressor compressor(received);
+    compressed_stream >> compressor;
+    BOOST_CHECK(compressed_stream.empty());
+    stream.clear();
+    stream << received;
+    BOOST_CHECK_EQUAL(HexStr(stream), HexStr(expected_stream));
+  };
+
+  check(0, 1);
+  check(0, 6);
+  check(4, 5);    // two files
+  check(5, 14);   // four files
+  check(12, 3);   // two blocks of one step
+  check(17, 10);  // beyond the end
+  check(19, 1);
+  check(3, 0);
+
+  snapshot::SerializedSnapshot serialized;
+  BOOST_CHECK(!reader.ReadChunk(total, 1, snapshot::SNAPSHOT_FORMAT_PLAIN, serialized));
+}
+
+BOOST_AUTO_TEST_CASE(read_chunks_across_files) {
+  SetDataDir("snapshot_chunk_reader");
+  CheckReadChunks(snapshot::SNAPSHOT_FORMAT_COMPRESSED);
+}
+
+BOOST_AUTO_TEST_CASE(read_chunks_of_plain_snapshot) {
+  SetDataDir("snapshot_chunk_reader_plain");
+  CheckReadChunks(snapshot::SNAPSHOT_FORMAT_PLAIN);
+}
+
+BOOST_AUTO_TEST_CASE(corrupted_file) {
+  SetDataDir("snapshot_chunk_reader_corrupted");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+
+  snapshot::SnapshotHeader header;
+  header.snapshot_hash = uint256S("aa");
+  {
+    snapshot::Indexer indexer(header, 3, 2);
+    for (uint32_t i = 0; i < 12; ++i) {
+      snapshot::UTXOSubset subset;
+      subset.outputs[0] = CTxOut(i, CScript());
+      BOOST_CHECK(indexer.WriteUTXOSubset(subset));
+    }
+    BOOST_CHECK(indexer.Flush());
+  }
+
+  // the second file misses the last subset
+  const fs::path path = GetDataDir() / snapshot::SNAPSHOT_FOLDER / header.snapshot_hash.GetHex() / "utxo1.dat";
+  fs::resize_file(path, fs::file_size(path) - 1);
+
+  LOCK(snapshot::cs_snapshot);
+  snapshot::ChunkReader reader(snapshot::Indexer::Open(header.snapshot_hash));
+  snapshot::SerializedSnapshot serialized;
+  BOOST_CHECK(reader.ReadChunk(0, 6, snapshot::SNAPSHOT_FORMAT_COMPRESSED, serialized));
+  BOOST_CHECK(!reader.ReadChunk(6, 1, snapshot::SNAPSHOT_FORMAT_COMPRESSED, serialized));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
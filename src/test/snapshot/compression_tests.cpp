@@ -0,0 +1,193 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/compression.h>
+
+#include <amount.h>
+#include <pubkey.h>
+#include <random.h>
+#include <streams.h>
+#include <test/test_unite.h>
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+
+namespace {
+
+std::vector<snapshot::UTXOSubset> MockSubsets() {
+  FastRandomContext random(true);
+  const CScript reused = CScript() << OP_0 << random.randbytes(20);
+  const std::vector<CScript> scripts = {
+      reused,
+      CScript() << OP_0 << random.randbytes(20),                             // P2WPKH
+      CScript() << OP_0 << random.randbytes(32),                             // P2WSH
+      CScript() << OP_DUP << OP_HASH160 << random.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG,
+      CScript() << OP_HASH160 << random.randbytes(20) << OP_EQUAL,           // P2SH
+      CScript() << OP_1 << random.randbytes(20) << random.randbytes(32),     // remote staking
+      CScript() << OP_RETURN,
+      CScript(),
+  };
+
+  std::vector<snapshot::UTXOSubset> subsets;
+  for (uint32_t i = 0; i < 50; ++i) {
+    snapshot::UTXOSubset subset;
+    subset.tx_id = random.rand256();
+    subset.height = i * 1000;
+    subset.tx_type = TxType::_from_integral(i % 8);
+    for (uint32_t n = 0; n < i % 5; ++n) {
+      const uint32_t index = n == 3 ? std::numeric_limits<uint32_t>::max() : n * n * 100;
+      subset.outputs[index] = CTxOut(i * n * UNIT + n, scripts[(i + n) % scripts.size()]);
+    }
+    subsets.emplace_back(subset);
+  }
+
+  // amounts which can't be compressed
+  subsets[1].outputs[0].nValue = -1;
+  subsets[2].outputs[0].nValue = MAX_MONEY + 1;
+  return subsets;
+}
+
+std::string Plain(const std::vector<snapshot::UTXOSubset> &subsets) {
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  stream << subsets;
+  return HexStr(stream);
+}
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_compression_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(compressed_block_roundtrip) {
+  const std::vector<snapshot::UTXOSubset> subsets = MockSubsets();
+
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  snapshot::WriteCompressedBlock(subsets.begin(), subsets.begin() + 20, stream);
+  snapshot::WriteCompressedBlock(subsets.begin() + 20, subsets.end(), stream);
+
+  CDataStream skip_stream(stream);
+  BOOST_CHECK_EQUAL(snapshot::SkipCompressedBlock(skip_stream), 20);
+  BOOST_CHECK_EQUAL(snapshot::SkipCompressedBlock(skip_stream), subsets.size() - 20);
+  BOOST_CHECK(skip_stream.empty());
+
+  std::vector<snapshot::UTXOSubset> decoded;
+  snapshot::ReadCompressedBlock(stream, decoded);
+  BOOST_CHECK_EQUAL(decoded.size(), 20);
+  snapshot::ReadCompressedBlock(stream, decoded);
+  BOOST_CHECK(stream.empty());
+  BOOST_CHECK_EQUAL(Plain(decoded), Plain(subsets));
+}
+
+BOOST_AUTO_TEST_CASE(compressed_block_is_smaller) {
+  FastRandomContext random(true);
+  const CScript staking = CScript() << OP_0 << random.randbytes(20);
+
+  std::vector<snapshot::UTXOSubset> subsets;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    snapshot::UTXOSubset subset;
+    subset.tx_id = random.rand256();
+    subset.height = 100000 + i;
+    subset.outputs[0] = CTxOut(10 * UNIT, staking);
+    subset.outputs[1] = CTxOut(i * UNIT / 100, CScript() << OP_0 << random.randbytes(20));
+    subsets.emplace_back(subset);
+  }
+
+  CDataStream compressed(SER_NETWORK, PROTOCOL_VERSION);
+  snapshot::WriteCompressedBlock(subsets.begin(), subsets.end(), compressed);
+  CDataStream plain(SER_NETWORK, PROTOCOL_VERSION);
+  plain << subsets;
+  BOOST_CHECK_LT(compressed.size() * 10, plain.size() * 7);
+}
+
+BOOST_AUTO_TEST_CASE(malformed_block) {
+  const std::vector<snapshot::UTXOSubset> subsets = MockSubsets();
+  CDataStream block(SER_NETWORK, PROTOCOL_VERSION);
+  snapshot::WriteCompressedBlock(subsets.begin(), subsets.end(), block);
+
+  std::vector<snapshot::UTXOSubset> decoded;
+  {
+    // truncated
+    CDataStream stream(block.begin(), block.end() - 1, SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK_THROW(snapshot::ReadCompressedBlock(stream, decoded), std::ios_base::failure);
+  }
+  {
+    // claims more subsets than it has
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(stream, subsets.size() + 1);
+    stream.write(block.data() + 1, block.size() - 1);
+    BOOST_CHECK_THROW(snapshot::ReadCompressedBlock(stream, decoded), std::ios_base::failure);
+  }
+  {
+    // empty
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(stream, 0);
+    WriteCompactSize(stream, 0);
+    BOOST_CHECK_THROW(snapshot::ReadCompressedBlock(stream, decoded), std::ios_base::failure);
+  }
+  {
+    // references a missing dictionary entry
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    CDataStream body(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(body, 0);  // dictionary
+    body << uint256() << VARINT(0) << uint8_t(0);
+    WriteCompactSize(body, 1);  // outputs
+    body << VARINT(0) << VARINT(1) << VARINT(3);
+    WriteCompactSize(stream, 1);
+    WriteCompactSize(stream, body.size());
+    stream << body;
+    BOOST_CHECK_THROW(snapshot::ReadCompressedBlock(stream, decoded), std::ios_base::failure);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_snapshot_message) {
+  snapshot::Snapshot msg;
+  msg.snapshot_hash = uint256S("aa");
+  msg.utxo_subset_index = 7;
+  const std::vector<snapshot::UTXOSubset> subsets = MockSubsets();
+  while (msg.utxo_subsets.size() <= snapshot::SUBSETS_PER_COMPRESSED_BLOCK) {
+    msg.utxo_subsets.insert(msg.utxo_subsets.end(), subsets.begin(), subsets.end());
+  }
+
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  stream << snapshot::SnapshotCompressor(msg);
+
+  snapshot::Snapshot received;
+  snapshot::SnapshotCompressor compressor(received);
+  stream >> compressor;
+  BOOST_CHECK(stream.empty());
+  BOOST_CHECK_EQUAL(received.snapshot_hash, msg.snapshot_hash);
+  BOOST_CHECK_EQUAL(received.utxo_subset_index, msg.utxo_subset_index);
+  BOOST_CHECK_EQUAL(Plain(received.utxo_subsets), Plain(msg.utxo_subsets));
+
+  // empty chunk
+  msg.utxo_subsets.clear();
+  stream << snapshot::SnapshotCompressor(msg);
+  stream >> compressor;
+  BOOST_CHECK(stream.empty());
+  BOOST_CHECK(received.utxo_subsets.empty());
+}
+
+BOOST_AUTO_TEST_CASE(get_snapshot_format) {
+  snapshot::GetSnapshot get(uint256S("aa"));
+  get.utxo_subset_index = 5;
+  get.utxo_subset_count = 10;
+
+  // nodes which don't know the format don't send it
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  stream << get;
+  BOOST_CHECK_EQUAL(stream.size(), 32 + 8 + 2);
+  get.format = snapshot::SNAPSHOT_FORMAT_LATEST;
+  stream >> get;
+  BOOST_CHECK_EQUAL(get.format, snapshot::SNAPSHOT_FORMAT_PLAIN);
+
+  get.format = snapshot::SNAPSHOT_FORMAT_COMPRESSED;
+  stream << get;
+  BOOST_CHECK_EQUAL(stream.size(), 32 + 8 + 2 + 1);
+  snapshot::GetSnapshot received;
+  stream >> received;
+  BOOST_CHECK_EQUAL(received.format, snapshot::SNAPSHOT_FORMAT_COMPRESSED);
+  BOOST_CHECK_EQUAL(received.utxo_subset_index, 5);
+  BOOST_CHECK_EQUAL(received.utxo_subset_count, 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 #include <snapshot/creator.h>
 
 #include <algorithm>
+#include <iterator>
 
 #include <snapshot/indexer.h>
 #include <snapshot/iterator.h>
@@ -197,4 +198,230 @@ BOOST_AUTO_TEST_CASE(snapshot_creator_concurrent_read) {
   UnloadBlockIndex();
 }
 
+std::string ReadFile(const fs::path &path) {
+  fs::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_creator_workers) {
+  SetDataDir("snapshot_creator_workers");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+  assert(snapshot::GetSnapshotCheckpoints().empty());
+
+  uint256 bestBlock = uint256S("aa");
+  auto bi = new CBlockIndex();
+  bi->nTime = 1269211443;
+  bi->nBits = 246;
+  bi->phashBlock = &mapBlockIndex.emplace(bestBlock, bi).first->first;
+
+  auto viewDB = MakeUnique<CCoinsViewDB>(0, false, true);
+  auto viewCache = MakeUnique<CCoinsViewCache>(viewDB.get());
+  viewCache->SetBestBlock(bestBlock);
+
+  const uint32_t totalTX = 100;
+  const uint32_t coinsPerTX = 3;
+
+  {
+    // generate Coins in chainstate
+    for (uint32_t i = 0; i < totalTX * coinsPerTX; ++i) {
+      COutPoint point;
+      point.n = i;
+      CDataStream s(SER_DISK, PROTOCOL_VERSION);
+      s << i / coinsPerTX;
+      point.hash.SetHex(HexStr(s));
+
+      Coin coin(CTxOut(i, CScript() << i), i, TxType::REGULAR);
+      viewCache->AddCoin(point, std::move(coin), false);
+    }
+    BOOST_CHECK(viewCache->Flush());
+  }
+
+  // write the reference snapshot one subset at a time
+  snapshot::SnapshotHeader header;
+  header.snapshot_hash = uint256S("bb");
+  {
+    snapshot::ChainstateIterator iter(viewDB.get());
+    snapshot::Indexer indexer(header, 3, 4);
+    while (iter.Valid()) {
+      BOOST_CHECK(indexer.WriteUTXOSubset(iter.GetUTXOSubset()));
+      iter.Next();
+    }
+    BOOST_CHECK(indexer.Flush());
+  }
+  const fs::path reference_dir = GetDataDir() / snapshot::SNAPSHOT_FOLDER / header.snapshot_hash.GetHex();
+
+  for (const size_t workers : {1, 2, 5}) {
+    // update stake modifier to trigger different snapshot hash
+    mapBlockIndex[bestBlock]->stake_modifier.SetHex("a" + std::to_string(workers));
+
+    snapshot::Creator creator(viewDB.get());
+    creator.m_step = 3;
+    creator.m_steps_per_file = 4;
+    creator.m_workers = workers;
+    snapshot::CreationInfo info = creator.Create();
+    BOOST_CHECK_EQUAL(info.status, +snapshot::Status::OK);
+    BOOST_CHECK_EQUAL(info.snapshot_header.total_utxo_subsets, totalTX);
+    BOOST_CHECK_EQUAL(info.total_outputs, static_cast<int>(totalTX * coinsPerTX));
+
+    const fs::path dir = GetDataDir() / snapshot::SNAPSHOT_FOLDER / info.snapshot_header.snapshot_hash.GetHex();
+    BOOST_CHECK_EQUAL(ReadFile(dir / "index.dat"), ReadFile(reference_dir / "index.dat"));
+    for (uint32_t file_id = 0; file_id < 9; ++file_id) {
+      const std::string name = "utxo" + std::to_string(file_id) + ".dat";
+      BOOST_CHECK(fs::exists(dir / name));
+      BOOST_CHECK(ReadFile(dir / name) == ReadFile(reference_dir / name));
+    }
+    BOOST_CHECK(!fs::exists(dir / "utxo9.dat"));
+
+    LOCK(snapshot::cs_snapshot);
+    std::unique_ptr<snapshot::Indexer> indexer = snapshot::Indexer::Open(info.snapshot_header.snapshot_hash);
+    BOOST_REQUIRE(indexer);
+    BOOST_CHECK_EQUAL(indexer->GetSnapshotHeader().total_utxo_subsets, totalTX);
+  }
+
+  // cleanup as this test has side effects
+  UnloadBlockIndex();
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_creator_from_delta) {
+  SetDataDir("snapshot_creator_from_delta");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+  assert(snapshot::GetSnapshotCheckpoints().empty());
+
+  const uint256 base_block = uint256S("aa");
+  const uint256 best_block = uint256S("bb");
+  for (const uint256 &hash : {base_block, best_block}) {
+    auto bi = new CBlockIndex();
+    bi->nTime = 1269211443;
+    bi->nBits = 246;
+    bi->nHeight = mapBlockIndex.size();
+    bi->phashBlock = &mapBlockIndex.emplace(hash, bi).first->first;
+  }
+
+  auto viewDB = MakeUnique<CCoinsViewDB>(0, false, true);
+  auto viewCache = MakeUnique<CCoinsViewCache>(viewDB.get());
+  viewCache->SetBestBlock(base_block);
+
+  const auto out_point = [](const uint32_t tx, const uint32_t n) {
+    CDataStream s(SER_DISK, PROTOCOL_VERSION);
+    s << tx;
+    return COutPoint(uint256S(HexStr(s)), n);
+  };
+  for (uint32_t tx = 0; tx < 100; ++tx) {
+    for (uint32_t n = 0; n < 3; ++n) {
+      viewCache->AddCoin(out_point(tx, n), Coin(CTxOut(n, CScript() << tx), tx, TxType::REGULAR), false);
+    }
+  }
+  BOOST_CHECK(viewCache->Flush());
+  BOOST_CHECK(viewDB->TakeDelta() == nullptr);
+
+  snapshot::Creator base_creator(viewDB.get());
+  base_creator.m_step = 3;
+  base_creator.m_steps_per_file = 4;
+  const snapshot::CreationInfo base_info = base_creator.Create();
+  BOOST_CHECK_EQUAL(base_info.status, +snapshot::Status::OK);
+
+  // spend some outputs, all the outputs of some TXs and create new TXs
+  for (uint32_t tx = 0; tx < 100; tx += 7) {
+    viewCache->SpendCoin(out_point(tx, tx % 3));
+  }
+  for (uint32_t tx = 5; tx < 100; tx += 10) {
+    for (uint32_t n = 0; n < 3; ++n) {
+      viewCache->SpendCoin(out_point(tx, n));
+    }
+  }
+  for (uint32_t tx = 100; tx < 130; ++tx) {
+    viewCache->AddCoin(out_point(tx, 1), Coin(CTxOut(tx, CScript()), tx, TxType::COINBASE), false);
+  }
+  viewCache->SetBestBlock(best_block);
+  BOOST_CHECK(viewCache->Flush());
+
+  const auto read_files = [](const uint256 &snapshot_hash) {
+    const fs::path dir = GetDataDir() / snapshot::SNAPSHOT_FOLDER / snapshot_hash.GetHex();
+    std::string content = ReadFile(dir / "index.dat");
+    for (uint32_t file_id = 0; fs::exists(dir / ("utxo" + std::to_string(file_id) + ".dat")); ++file_id) {
+      content += ReadFile(dir / ("utxo" + std::to_string(file_id) + ".dat"));
+    }
+    return content;
+  };
+
+  // the reference snapshot is read from the chainstate
+  mapBlockIndex[best_block]->stake_modifier.SetHex("a1");
+  snapshot::Creator full_creator(viewDB.get());
+  full_creator.m_step = 3;
+  full_creator.m_steps_per_file = 4;
+  const snapshot::CreationInfo full_info = full_creator.Create();
+  BOOST_CHECK_EQUAL(full_info.status, +snapshot::Status::OK);
+  BOOST_CHECK_EQUAL(full_info.snapshot_header.total_utxo_subsets, 100 - 10 + 30);
+  const std::string full_files = read_files(full_info.snapshot_header.snapshot_hash);
+
+  std::unique_ptr<snapshot::UTXODelta> delta = viewDB->TakeDelta();
+  BOOST_REQUIRE(delta);
+  BOOST_CHECK_EQUAL(delta->GetBaseBlockHash(), base_block);
+
+  for (const size_t workers : {1, 3}) {
+    mapBlockIndex[best_block]->stake_modifier.SetHex("b" + std::to_string(workers));
+
+    snapshot::Creator creator(viewDB.get());
+    creator.m_step = 3;
+    creator.m_steps_per_file = 4;
+    creator.m_workers = workers;
+    creator.m_delta = MakeUnique<snapshot::UTXODelta>(*delta);
+    const snapshot::CreationInfo info = creator.Create();
+    BOOST_CHECK_EQUAL(info.status, +snapshot::Status::OK);
+    BOOST_CHECK_EQUAL(info.snapshot_header.total_utxo_subsets, full_info.snapshot_header.total_utxo_subsets);
+    BOOST_CHECK_EQUAL(info.total_outputs, full_info.total_outputs);
+    BOOST_CHECK(read_files(info.snapshot_header.snapshot_hash) == full_files);
+  }
+
+  {
+    // the delta is applied to the base snapshot, not to the chainstate, so
+    // it's replaced by the snapshot of the first 50 subsets
+    LOCK(snapshot::cs_snapshot);
+    std::vector<snapshot::UTXOSubset> subsets;
+    {
+      snapshot::Iterator iter(snapshot::Indexer::Open(base_info.snapshot_header.snapshot_hash));
+      BOOST_CHECK(iter.GetUTXOSubsets(0, 50, subsets));
+    }
+    BOOST_CHECK(snapshot::Indexer::Delete(base_info.snapshot_header.snapshot_hash));
+    {
+      snapshot::SnapshotHeader header = base_info.snapshot_header;
+      header.total_utxo_subsets = 0;
+      snapshot::Indexer indexer(header, 3, 4);
+      for (const snapshot::UTXOSubset &subset : subsets) {
+        BOOST_CHECK(indexer.WriteUTXOSubset(subset));
+      }
+      BOOST_CHECK(indexer.Flush());
+    }
+
+    mapBlockIndex[best_block]->stake_modifier.SetHex("c1");
+    snapshot::Creator creator(viewDB.get());
+    creator.m_step = 3;
+    creator.m_steps_per_file = 4;
+    creator.m_workers = 1;
+    creator.m_delta = MakeUnique<snapshot::UTXODelta>(*delta);
+    const snapshot::CreationInfo info = creator.Create();
+    BOOST_CHECK_EQUAL(info.status, +snapshot::Status::OK);
+    BOOST_CHECK(info.snapshot_header.total_utxo_subsets < full_info.snapshot_header.total_utxo_subsets);
+  }
+
+  {
+    // the base snapshot can't be read, the chainstate is read instead
+    const fs::path dir = GetDataDir() / snapshot::SNAPSHOT_FOLDER;
+    fs::remove(dir / base_info.snapshot_header.snapshot_hash.GetHex() / "utxo2.dat");
+
+    mapBlockIndex[best_block]->stake_modifier.SetHex("c2");
+    snapshot::Creator creator(viewDB.get());
+    creator.m_step = 3;
+    creator.m_steps_per_file = 4;
+    creator.m_workers = 1;
+    creator.m_delta = MakeUnique<snapshot::UTXODelta>(*delta);
+    const snapshot::CreationInfo info = creator.Create();
+    BOOST_CHECK_EQUAL(info.status, +snapshot::Status::OK);
+    BOOST_CHECK_EQUAL(info.snapshot_header.total_utxo_subsets, full_info.snapshot_header.total_utxo_subsets);
+  }
+
+  // cleanup as this test has side effects
+  UnloadBlockIndex();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
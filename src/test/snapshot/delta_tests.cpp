@@ -0,0 +1,174 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/delta.h>
+
+#include <test/test_unite.h>
+#include <txdb.h>
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+uint256 TxId(const uint32_t i) {
+  return uint256S(std::to_string(i));
+}
+
+snapshot::UTXOSubset Subset(const uint32_t tx, const std::vector<uint32_t> &outputs) {
+  snapshot::UTXOSubset subset;
+  subset.tx_id = TxId(tx);
+  subset.height = tx;
+  for (const uint32_t n : outputs) {
+    subset.outputs[n] = CTxOut(tx * 100 + n, CScript() << n);
+  }
+  return subset;
+}
+
+Coin Unspent(const uint32_t tx, const uint32_t n) {
+  return Coin(CTxOut(tx * 100 + n, CScript() << n), tx, TxType::REGULAR);
+}
+
+std::string Subsets(const std::vector<snapshot::UTXOSubset> &subsets) {
+  CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+  stream << subsets;
+  return HexStr(stream);
+}
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_delta_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(utxo_delta) {
+  snapshot::UTXODelta delta(uint256S("aa"));
+  BOOST_CHECK_EQUAL(delta.GetBaseBlockHash(), uint256S("aa"));
+  BOOST_CHECK(delta.IsValid());
+
+  Coin spent;
+  spent.Clear();
+  delta.Add(COutPoint(TxId(1), 0), Unspent(1, 0));
+  delta.Add(COutPoint(TxId(2), 0), Unspent(2, 0));
+  delta.Add(COutPoint(TxId(1), 0), spent);
+  BOOST_CHECK_EQUAL(delta.GetCoins().size(), 2);
+  BOOST_CHECK(delta.GetCoins().at(COutPoint(TxId(1), 0)).IsSpent());
+  BOOST_CHECK(!delta.GetCoins().at(COutPoint(TxId(2), 0)).IsSpent());
+
+  delta.Invalidate();
+  BOOST_CHECK(!delta.IsValid());
+  BOOST_CHECK(delta.GetCoins().empty());
+  delta.Add(COutPoint(TxId(3), 0), Unspent(3, 0));
+  BOOST_CHECK(delta.GetCoins().empty());
+}
+
+BOOST_AUTO_TEST_CASE(delta_iterator) {
+  SetDataDir("snapshot_delta_iterator");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+
+  // base snapshot has the TXs 2, 4, ..., 20
+  snapshot::SnapshotHeader header;
+  header.snapshot_hash = uint256S("bb");
+  {
+    snapshot::Indexer indexer(header, 3, 2);
+    for (uint32_t tx = 2; tx <= 20; tx += 2) {
+      BOOST_CHECK(indexer.WriteUTXOSubset(Subset(tx, {0, 1})));
+    }
+    BOOST_CHECK(indexer.Flush());
+  }
+
+  Coin spent;
+  spent.Clear();
+  snapshot::UTXODelta delta(uint256S("aa"));
+  delta.Add(COutPoint(TxId(1), 0), Unspent(1, 0));   // new TX before the base
+  delta.Add(COutPoint(TxId(4), 0), spent);           // TX is spent
+  delta.Add(COutPoint(TxId(4), 1), spent);
+  delta.Add(COutPoint(TxId(6), 1), spent);           // output is spent
+  delta.Add(COutPoint(TxId(8), 5), Unspent(8, 5));   // output is added
+  delta.Add(COutPoint(TxId(11), 3), Unspent(11, 3));  // new TX in between
+  delta.Add(COutPoint(TxId(13), 0), spent);          // new TX which is spent
+  delta.Add(COutPoint(TxId(25), 0), Unspent(25, 0));  // new TX after the base
+  delta.Add(COutPoint(TxId(25), 2), Unspent(25, 2));
+
+  std::vector<snapshot::UTXOSubset> subsets;
+  {
+    LOCK(snapshot::cs_snapshot);
+    snapshot::DeltaIterator iter(snapshot::Indexer::Open(header.snapshot_hash), delta);
+    while (iter.Valid()) {
+      subsets.emplace_back(iter.GetUTXOSubset());
+      iter.Next();
+    }
+    BOOST_CHECK(iter.IsBaseRead());
+  }
+
+  const std::vector<snapshot::UTXOSubset> expected = {
+      Subset(1, {0}),
+      Subset(2, {0, 1}),
+      Subset(6, {0}),
+      Subset(8, {0, 1, 5}),
+      Subset(10, {0, 1}),
+      Subset(11, {3}),
+      Subset(12, {0, 1}),
+      Subset(14, {0, 1}),
+      Subset(16, {0, 1}),
+      Subset(18, {0, 1}),
+      Subset(20, {0, 1}),
+      Subset(25, {0, 2}),
+  };
+  BOOST_CHECK_EQUAL(Subsets(subsets), Subsets(expected));
+
+  {
+    // the base snapshot can't be read
+    LOCK(snapshot::cs_snapshot);
+    std::unique_ptr<snapshot::Indexer> indexer = snapshot::Indexer::Open(header.snapshot_hash);
+    BOOST_REQUIRE(indexer);
+    fs::remove(GetDataDir() / snapshot::SNAPSHOT_FOLDER / header.snapshot_hash.GetHex() / "utxo1.dat");
+
+    snapshot::DeltaIterator iter(std::move(indexer), delta);
+    while (iter.Valid()) {
+      iter.Next();
+    }
+    BOOST_CHECK(!iter.IsBaseRead());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(chainstate_records_delta) {
+  CCoinsViewDB view(0, true, true);
+  const uint256 block_hash = uint256S("aa");
+
+  const auto write = [&view, &block_hash](const COutPoint &out_point, const Coin &coin) {
+    CCoinsMap coins;
+    CCoinsCacheEntry &entry = coins[out_point];
+    entry.coin = coin;
+    entry.flags = CCoinsCacheEntry::DIRTY;
+    BOOST_CHECK(view.BatchWrite(coins, block_hash, snapshot::SnapshotHash()));
+  };
+
+  // nothing is recorded until the first delta is taken
+  write(COutPoint(TxId(1), 0), Unspent(1, 0));
+  BOOST_CHECK(view.TakeDelta() == nullptr);
+
+  Coin spent;
+  spent.Clear();
+  write(COutPoint(TxId(1), 0), spent);
+  write(COutPoint(TxId(2), 0), Unspent(2, 0));
+
+  std::unique_ptr<snapshot::UTXODelta> delta = view.TakeDelta();
+  BOOST_REQUIRE(delta);
+  BOOST_CHECK_EQUAL(delta->GetBaseBlockHash(), block_hash);
+  BOOST_CHECK(delta->IsValid());
+  BOOST_CHECK_EQUAL(delta->GetCoins().size(), 2);
+  BOOST_CHECK(delta->GetCoins().at(COutPoint(TxId(1), 0)).IsSpent());
+  BOOST_CHECK(!delta->GetCoins().at(COutPoint(TxId(2), 0)).IsSpent());
+
+  // the chainstate is replaced
+  write(COutPoint(TxId(3), 0), Unspent(3, 0));
+  BOOST_CHECK(view.ImportCoins({{COutPoint(TxId(4), 0), Unspent(4, 0)}}));
+  delta = view.TakeDelta();
+  BOOST_REQUIRE(delta);
+  BOOST_CHECK(!delta->IsValid());
+
+  delta = view.TakeDelta();
+  BOOST_REQUIRE(delta);
+  BOOST_CHECK(delta->IsValid());
+  BOOST_CHECK(delta->GetCoins().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot/download_scheduler.h>
+
+#include <test/test_unite.h>
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+snapshot::SnapshotHeader Header(const uint64_t total_utxo_subsets) {
+  snapshot::SnapshotHeader header;
+  header.snapshot_hash = uint256S("aa");
+  header.total_utxo_subsets = total_utxo_subsets;
+  return header;
+}
+
+std::vector<snapshot::UTXOSubset> Subsets(const uint64_t index, const size_t count) {
+  std::vector<snapshot::UTXOSubset> subsets(count);
+  for (size_t i = 0; i < count; ++i) {
+    subsets[i].height = static_cast<uint32_t>(index + i);
+  }
+  return subsets;
+}
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_SUITE(download_scheduler_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(requests_chunks_from_many_peers) {
+  snapshot::DownloadScheduler scheduler(Header(25), 0, 5, 4, 2);
+
+  uint64_t index = 0;
+  uint16_t count = 0;
+
+  // every peer gets two chunks
+  BOOST_CHECK(scheduler.NextRequest(1, index, count));
+  BOOST_CHECK_EQUAL(index, 0);
+  BOOST_CHECK_EQUAL(count, 5);
+  BOOST_CHECK(scheduler.NextRequest(1, index, count));
+  BOOST_CHECK_EQUAL(index, 5);
+  BOOST_CHECK(!scheduler.NextRequest(1, index, count));
+  BOOST_CHECK(scheduler.NextRequest(2, index, count));
+  BOOST_CHECK_EQUAL(index, 10);
+  BOOST_CHECK(scheduler.NextRequest(2, index, count));
+  BOOST_CHECK_EQUAL(index, 15);
+
+  // the window is full
+  BOOST_CHECK(!scheduler.NextRequest(3, index, count));
+  BOOST_CHECK(scheduler.HasRequestsInFlight(1));
+  BOOST_CHECK(!scheduler.HasRequestsInFlight(3));
+
+  // chunks which arrive out of order wait for the missing ones
+  std::vector<snapshot::UTXOSubset> ready;
+  BOOST_CHECK(scheduler.Received(2, 10, Subsets(10, 5)));
+  scheduler.TakeReady(ready);
+  BOOST_CHECK(ready.empty());
+  BOOST_CHECK(scheduler.Received(1, 0, Subsets(0, 5)));
+  scheduler.TakeReady(ready);
+  BOOST_CHECK_EQUAL(ready.size(), 5);
+  BOOST_CHECK_EQUAL(scheduler.GetWritten(), 5);
+
+  // the window moved
+  BOOST_CHECK(scheduler.NextRequest(3, index, count));
+  BOOST_CHECK_EQUAL(index, 20);
+  BOOST_CHECK_EQUAL(count, 5);
+  BOOST_CHECK(!scheduler.NextRequest(3, index, count));
+
+  BOOST_CHECK(scheduler.Received(1, 5, Subsets(5, 5)));
+  BOOST_CHECK(scheduler.Received(2, 15, Subsets(15, 5)));
+  BOOST_CHECK(scheduler.Received(3, 20, Subsets(20, 5)));
+  scheduler.TakeReady(ready);
+  BOOST_REQUIRE_EQUAL(ready.size(), 20);
+  for (size_t i = 0; i < ready.size(); ++i) {
+    BOOST_CHECK_EQUAL(ready[i].height, i + 5);
+  }
+  BOOST_CHECK(scheduler.IsComplete());
+  BOOST_CHECK(!scheduler.NextRequest(1, index, count));
+}
+
+BOOST_AUTO_TEST_CASE(rejects_unexpected_subsets) {
+  snapshot::DownloadScheduler scheduler(Header(10), 0, 5, 4, 2);
+
+  uint64_t index = 0;
+  uint16_t count = 0;
+  BOOST_CHECK(scheduler.NextRequest(1, index, count));
+
+  BOOST_CHECK(!scheduler.IsExpected(2, 0, 5));
+  BOOST_CHECK(!scheduler.Received(2, 0, Subsets(0, 5)));  // another peer
+  BOOST_CHECK(!scheduler.Received(1, 5, Subsets(5, 5)));  // not requested
+  BOOST_CHECK(!scheduler.Received(1, 0, Subsets(0, 6)));  // too many
+  BOOST_CHECK(!scheduler.Received(1, 0, {}));             // empty
+  BOOST_CHECK(scheduler.IsExpected(1, 0, 5));
+  BOOST_CHECK(scheduler.Received(1, 0, Subsets(0, 5)));
+  BOOST_CHECK(!scheduler.Received(1, 0, Subsets(0, 5)));  // duplicate
+}
+
+BOOST_AUTO_TEST_CASE(requests_the_rest_again) {
+  snapshot::DownloadScheduler scheduler(Header(12), 2, 5, 4, 1);
+
+  uint64_t index = 0;
+  uint16_t count = 0;
+
+  // starts where the download stopped and aligns to the chunks
+  BOOST_CHECK(scheduler.NextRequest(1, index, count));
+  BOOST_CHECK_EQUAL(index, 2);
+  BOOST_CHECK_EQUAL(count, 3);
+  BOOST_CHECK(scheduler.NextRequest(2, index, count));
+  BOOST_CHECK_EQUAL(index, 5);
+  BOOST_CHECK_EQUAL(count, 5);
+  BOOST_CHECK(scheduler.NextRequest(3, index, count));
+  BOOST_CHECK_EQUAL(index, 10);
+  BOOST_CHECK_EQUAL(count, 2);
+  BOOST_CHECK(!scheduler.IsChunk(2, 3));
+  BOOST_CHECK(scheduler.IsChunk(5, 5));
+  BOOST_CHECK(scheduler.IsChunk(10, 2));
+  BOOST_CHECK(!scheduler.IsChunk(5, 4));
+
+  // the peer replied with a part of the chunk
+  BOOST_CHECK(scheduler.Received(2, 5, Subsets(5, 2)));
+  BOOST_CHECK(scheduler.NextRequest(2, index, count));
+  BOOST_CHECK_EQUAL(index, 7);
+  BOOST_CHECK_EQUAL(count, 3);
+
+  // requests of the lost peer go to others
+  scheduler.RemovePeer(1);
+  BOOST_CHECK(!scheduler.HasRequestsInFlight(1));
+  BOOST_CHECK(!scheduler.Received(1, 2, Subsets(2, 3)));
+  BOOST_CHECK(scheduler.NextRequest(4, index, count));
+  BOOST_CHECK_EQUAL(index, 2);
+  BOOST_CHECK_EQUAL(count, 3);
+
+  std::vector<snapshot::UTXOSubset> ready;
+  BOOST_CHECK(scheduler.Received(4, 2, Subsets(2, 3)));
+  BOOST_CHECK(scheduler.Received(2, 7, Subsets(7, 3)));
+  BOOST_CHECK(scheduler.Received(3, 10, Subsets(10, 2)));
+  scheduler.TakeReady(ready);
+  BOOST_CHECK_EQUAL(ready.size(), 10);
+  BOOST_CHECK(scheduler.IsComplete());
+}
+
+BOOST_AUTO_TEST_CASE(forgets_disconnected_peers) {
+  snapshot::DownloadScheduler scheduler(Header(10), 0, 5, 4, 1);
+
+  uint64_t index = 0;
+  uint16_t count = 0;
+  BOOST_CHECK(scheduler.NextRequest(1, index, count));
+  BOOST_CHECK(scheduler.NextRequest(2, index, count));
+  BOOST_CHECK(!scheduler.NextRequest(3, index, count));
+
+  scheduler.RetainPeers({2, 3});
+  BOOST_CHECK(!scheduler.HasRequestsInFlight(1));
+  BOOST_CHECK(scheduler.HasRequestsInFlight(2));
+  BOOST_CHECK(scheduler.NextRequest(3, index, count));
+  BOOST_CHECK_EQUAL(index, 0);
+  BOOST_CHECK_EQUAL(count, 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
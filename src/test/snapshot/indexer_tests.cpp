@@ -169,4 +169,42 @@ BOOST_AUTO_TEST_CASE(snapshot_indexer_open) {
   BOOST_CHECK_EQUAL(opened_idx->GetSnapshotHeader().total_utxo_subsets, total_msgs);
 }
 
+BOOST_AUTO_TEST_CASE(snapshot_indexer_partial_hash) {
+  SetDataDir("snapshot_indexer_partial_hash");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+
+  snapshot::SnapshotHeader snapshot_header;
+  snapshot_header.snapshot_hash = uint256S("aa");
+  snapshot::Indexer indexer(snapshot_header, 3, 2);
+
+  snapshot::UTXOSubset subset;
+  subset.tx_id = uint256S("bb");
+  subset.outputs[0] = CTxOut();
+  snapshot::SnapshotHash hash;
+  hash.AddUTXOSubset(subset);
+
+  BOOST_CHECK(indexer.WriteUTXOSubset(subset));
+  BOOST_CHECK(indexer.Flush());
+  BOOST_CHECK(indexer.WritePartialHash(hash));
+
+  LOCK(snapshot::cs_snapshot);
+  {
+    auto opened_idx = snapshot::Indexer::Open(snapshot_header.snapshot_hash);
+    BOOST_REQUIRE(opened_idx);
+    snapshot::SnapshotHash opened_hash;
+    BOOST_CHECK(opened_idx->ReadPartialHash(opened_hash));
+    BOOST_CHECK(opened_hash.GetData() == hash.GetData());
+  }
+
+  // the hash doesn't cover the subset which was written after it
+  BOOST_CHECK(indexer.WriteUTXOSubset(snapshot::UTXOSubset()));
+  BOOST_CHECK(indexer.Flush());
+  {
+    auto opened_idx = snapshot::Indexer::Open(snapshot_header.snapshot_hash);
+    BOOST_REQUIRE(opened_idx);
+    snapshot::SnapshotHash opened_hash;
+    BOOST_CHECK(!opened_idx->ReadPartialHash(opened_hash));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,8 @@
 
 #include <snapshot/messages.h>
 
+#include <random.h>
+#include <script/script.h>
 #include <test/test_unite.h>
 #include <utilstrencodings.h>
 #include <boost/test/unit_test.hpp>
@@ -406,4 +408,59 @@ BOOST_AUTO_TEST_CASE(snapshot_hash) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(snapshot_hash_batch_fold) {
+  std::vector<snapshot::UTXO> utxos;
+  for (uint32_t i = 0; i < 3000; ++i) {
+    snapshot::UTXO utxo;
+    utxo.out_point = COutPoint(GetRandHash(), i % 7);
+    utxo.height = i;
+    utxo.tx_out = CTxOut(i, CScript() << i);
+    utxos.emplace_back(std::move(utxo));
+  }
+
+  const uint256 stake_modifier = uint256S("aa");
+  const uint256 chain_work = uint256S("bb");
+
+  // applies every UTXO to the multiset right away
+  snapshot::SnapshotHash one_by_one;
+  for (size_t i = 0; i < utxos.size(); ++i) {
+    one_by_one.AddUTXO(utxos[i]);
+    one_by_one.Fold();
+    if (i % 3 == 0) {
+      one_by_one.SubtractUTXO(utxos[i]);
+      one_by_one.Fold();
+    }
+  }
+  for (size_t i = 1; i < utxos.size(); i += 5) {
+    one_by_one.SubtractUTXO(utxos[i]);
+    one_by_one.Fold();
+  }
+
+  for (const size_t threads : {1, 4}) {
+    snapshot::SnapshotHash::SetFoldThreads(threads);
+    snapshot::SnapshotHash batched;
+    for (size_t i = 0; i < utxos.size(); ++i) {
+      batched.AddUTXO(utxos[i]);
+      if (i % 3 == 0) {
+        batched.SubtractUTXO(utxos[i]);
+      }
+    }
+    for (size_t i = 1; i < utxos.size(); i += 5) {
+      batched.SubtractUTXO(utxos[i]);
+    }
+
+    // the copy folds its own pending UTXOs
+    const snapshot::SnapshotHash copy = batched;
+    BOOST_CHECK_EQUAL(copy.GetHash(stake_modifier, chain_work),
+                      one_by_one.GetHash(stake_modifier, chain_work));
+    BOOST_CHECK_EQUAL(batched.GetHash(stake_modifier, chain_work),
+                      one_by_one.GetHash(stake_modifier, chain_work));
+
+    const snapshot::SnapshotHash restored(batched.GetData());
+    BOOST_CHECK_EQUAL(restored.GetHash(stake_modifier, chain_work),
+                      one_by_one.GetHash(stake_modifier, chain_work));
+  }
+  snapshot::SnapshotHash::SetFoldThreads(1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
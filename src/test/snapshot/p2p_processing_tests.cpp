@@ -43,15 +43,20 @@ class MockP2PState : public snapshot::P2PState {
   void MockFirstDiscoveryRequestAt(const std::chrono::steady_clock::time_point &time) {
     m_first_discovery_request_at = time;
   }
+
+  void MockRequestChunks(CNode &node, const CNetMsgMaker &msg_maker) {
+    LOCK(snapshot::cs_snapshot);
+    RequestChunks(node, msg_maker);
+  }
 };
 
-std::unique_ptr<CNode> MockNode() {
+std::unique_ptr<CNode> MockNode(const NodeId id = 0) {
   uint32_t ip = 0xa0b0c001;
   in_addr s{ip};
   CService service(CNetAddr(s), 7182);
   CAddress addr(service, NODE_NONE);
 
-  auto node = MakeUnique<CNode>(0, ServiceFlags(NODE_NETWORK | NODE_WITNESS), 0,
+  auto node = MakeUnique<CNode>(id, ServiceFlags(NODE_NETWORK | NODE_WITNESS), 0,
                                 INVALID_SOCKET, addr, 0, 0, CAddress(),
                                 "", /*fInboundIn=*/
                                 false);
@@ -72,12 +77,73 @@ uint256 uint256FromUint64(uint64_t n) {
   return nn;
 }
 
+//! Returns the commands of the sent messages and the bodies of the
+//! getsnapshot ones
+std::vector<std::string> SentCommands(CNode &node, std::vector<snapshot::GetSnapshot> &get_out) {
+  std::vector<std::string> commands;
+  get_out.clear();
+  BOOST_REQUIRE(node.vSendMsg.size() % 2 == 0);  // header + body
+  for (size_t i = 0; i < node.vSendMsg.size(); i += 2) {
+    CMessageHeader header(Params().MessageStart());
+    CDataStream(node.vSendMsg[i], SER_NETWORK, PROTOCOL_VERSION) >> header;
+    commands.emplace_back(header.GetCommand());
+    if (commands.back() == "getsnapshot") {
+      snapshot::GetSnapshot get;
+      CDataStream(node.vSendMsg[i + 1], SER_NETWORK, PROTOCOL_VERSION) >> get;
+      get_out.emplace_back(get);
+    }
+  }
+  node.vSendMsg.clear();
+  return commands;
+}
+
+std::vector<snapshot::Snapshot> MockChunks(const snapshot::SnapshotHeader &best_snapshot,
+                                           const uint64_t chunk_size) {
+  std::vector<snapshot::Snapshot> chunks;
+  for (uint64_t i = 0; i < best_snapshot.total_utxo_subsets; ++i) {
+    if (i % chunk_size == 0) {
+      chunks.emplace_back();
+      chunks.back().snapshot_hash = best_snapshot.snapshot_hash;
+      chunks.back().utxo_subset_index = i;
+    }
+    snapshot::UTXOSubset subset;
+    subset.tx_id = uint256FromUint64(i);
+    subset.outputs[0] = CTxOut();
+    chunks.back().utxo_subsets.emplace_back(subset);
+  }
+  return chunks;
+}
+
+snapshot::ChunkHashes MockChunkHashes(const std::vector<snapshot::Snapshot> &chunks,
+                                      const uint16_t chunk_size) {
+  snapshot::ChunkHashes msg;
+  msg.snapshot_hash = chunks.front().snapshot_hash;
+  msg.chunk_size = chunk_size;
+  for (const snapshot::Snapshot &chunk : chunks) {
+    snapshot::SnapshotHash hash;
+    for (const snapshot::UTXOSubset &subset : chunk.utxo_subsets) {
+      hash.AddUTXOSubset(subset);
+    }
+    msg.hashes.emplace_back(hash.GetData());
+  }
+  return msg;
+}
+
+template <typename T>
+CDataStream Serialize(const T &msg) {
+  CDataStream body(SER_NETWORK, PROTOCOL_VERSION);
+  body << msg;
+  return body;
+}
+
 BOOST_AUTO_TEST_CASE(process_snapshot) {
   SetDataDir("snapshot_process_p2p");
   fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
   snapshot::StoreCandidateBlockHash(uint256());
   snapshot::EnableISDMode();
-  MockP2PState p2p_state;
+  snapshot::Params params;
+  params.snapshot_chunk_size = 2;
+  MockP2PState p2p_state(params);
 
   CNetMsgMaker msg_maker(1);
   std::unique_ptr<CNode> node(MockNode());
@@ -97,43 +163,61 @@ BOOST_AUTO_TEST_CASE(process_snapshot) {
   bi->stake_modifier = best_snapshot.stake_modifier;
   bi->phashBlock = &mapBlockIndex.emplace(best_snapshot.block_hash, bi).first->first;
 
-  for (uint64_t i = 0; i < best_snapshot.total_utxo_subsets / 2; ++i) {
-    // simulate receiving the snapshot response
-    snapshot::Snapshot snap;
-    snapshot::UTXOSubset subset1;
-    snapshot::UTXOSubset subset2;
-    subset1.tx_id = uint256FromUint64(i * 2);
-    subset2.tx_id = uint256FromUint64(i * 2 + 1);
-    subset1.outputs[0] = CTxOut();
-    subset2.outputs[0] = CTxOut();
-    snap.utxo_subsets.emplace_back(subset1);
-    snap.utxo_subsets.emplace_back(subset2);
-    snap.snapshot_hash = best_snapshot.snapshot_hash;
-    snap.utxo_subset_index = i * 2;
-
-    CDataStream body(SER_NETWORK, PROTOCOL_VERSION);
-    body << snap;
-    BOOST_CHECK_MESSAGE(p2p_state.ProcessSnapshot(*node, body, msg_maker),
-                        "failed to process snapshot message on m_step="
-                            << i << ". probably snapshot hash is incorrect");
+  const std::vector<snapshot::Snapshot> chunks = MockChunks(best_snapshot, 2);
+  BOOST_REQUIRE_EQUAL(chunks.size(), 3);
+
+  // the peer is asked for the chunk hashes and two chunks
+  std::vector<snapshot::GetSnapshot> gets;
+  p2p_state.MockRequestChunks(*node, msg_maker);
+  BOOST_CHECK(SentCommands(*node, gets) ==
+              std::vector<std::string>({"getchunkhash", "getsnapshot", "getsnapshot"}));
+  BOOST_REQUIRE_EQUAL(gets.size(), 2);
+  BOOST_CHECK_EQUAL(gets[0].snapshot_hash.GetHex(), best_snapshot.snapshot_hash.GetHex());
+  BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 0);
+  BOOST_CHECK_EQUAL(gets[0].utxo_subset_count, 2);
+  BOOST_CHECK_EQUAL(gets[1].utxo_subset_index, 2);
+  BOOST_CHECK_EQUAL(gets[1].utxo_subset_count, 2);
 
-    if (i < (best_snapshot.total_utxo_subsets / 2 - 1)) {  // ask the peer for more messages
-      BOOST_CHECK_EQUAL(node->vSendMsg.size(), 2);         // header + body
-      CMessageHeader header(Params().MessageStart());
-      CDataStream(node->vSendMsg[0], SER_NETWORK, PROTOCOL_VERSION) >> header;
-      BOOST_CHECK_EQUAL(header.GetCommand(), "getsnapshot");
+  {
+    CDataStream body = Serialize(MockChunkHashes(chunks, 2));
+    BOOST_CHECK(p2p_state.ProcessChunkHashes(*node, body));
+  }
 
-      snapshot::GetSnapshot get;
-      CDataStream(node->vSendMsg[1], SER_NETWORK, PROTOCOL_VERSION) >> get;
-      BOOST_CHECK_EQUAL(get.snapshot_hash.GetHex(), best_snapshot.snapshot_hash.GetHex());
-
-      uint64_t expSize = snap.utxo_subsets.size() + (i * 2);
-      BOOST_CHECK_EQUAL(get.utxo_subset_index, expSize);
-      BOOST_CHECK(get.utxo_subset_count == snapshot::MAX_UTXO_SET_COUNT);
-      node->vSendMsg.clear();
-    } else {  // finish snapshot downloading
-      BOOST_CHECK(node->vSendMsg.empty());
-    }
+  // the chunk which wasn't requested is rejected
+  {
+    CDataStream body = Serialize(chunks[2]);
+    BOOST_CHECK(!p2p_state.ProcessSnapshot(*node, body, msg_maker));
+    BOOST_CHECK(node->vSendMsg.empty());
+  }
+
+  // the second chunk arrives first, it's kept until the first one arrives
+  // and the peer is asked for the last chunk
+  {
+    CDataStream body = Serialize(chunks[1]);
+    BOOST_CHECK(p2p_state.ProcessSnapshot(*node, body, msg_maker));
+    BOOST_CHECK(SentCommands(*node, gets) == std::vector<std::string>({"getsnapshot"}));
+    BOOST_REQUIRE_EQUAL(gets.size(), 1);
+    BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 4);
+    LOCK(snapshot::cs_snapshot);
+    BOOST_CHECK(!snapshot::Indexer::Open(best_snapshot.snapshot_hash));
+  }
+
+  {
+    CDataStream body = Serialize(chunks[0]);
+    BOOST_CHECK(p2p_state.ProcessSnapshot(*node, body, msg_maker));
+    BOOST_CHECK(node->vSendMsg.empty());
+    LOCK(snapshot::cs_snapshot);
+    std::unique_ptr<snapshot::Indexer> idx(snapshot::Indexer::Open(best_snapshot.snapshot_hash));
+    BOOST_REQUIRE(idx);
+    BOOST_CHECK_EQUAL(idx->GetSnapshotHeader().total_utxo_subsets, 4);
+  }
+
+  // finish snapshot downloading
+  {
+    CDataStream body = Serialize(chunks[2]);
+    BOOST_CHECK_MESSAGE(p2p_state.ProcessSnapshot(*node, body, msg_maker),
+                        "probably snapshot hash is incorrect");
+    BOOST_CHECK(node->vSendMsg.empty());
   }
 
   // test that snapshot was created
@@ -157,6 +241,143 @@ BOOST_AUTO_TEST_CASE(process_snapshot) {
   BOOST_CHECK_EQUAL(best_snapshot.total_utxo_subsets, total);
 }
 
+BOOST_AUTO_TEST_CASE(process_snapshot_from_invalid_peers) {
+  SetDataDir("snapshot_process_p2p_invalid_peers");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+  snapshot::StoreCandidateBlockHash(uint256());
+  snapshot::EnableISDMode();
+  snapshot::Params params;
+  params.snapshot_chunk_size = 2;
+  MockP2PState p2p_state(params);
+
+  snapshot::SnapshotHeader best_snapshot;
+  best_snapshot.snapshot_hash = uint256S("294f4fba05bc2f19764960989b4a364466522b3009808ff99e89cfde56bf43e7");
+  best_snapshot.block_hash = uint256S("aa");
+  best_snapshot.stake_modifier = uint256S("bb");
+  best_snapshot.chain_work = uint256S("cc");
+  best_snapshot.total_utxo_subsets = 6;
+  p2p_state.MockBestSnapshot(best_snapshot);
+
+  const std::vector<snapshot::Snapshot> chunks = MockChunks(best_snapshot, 2);
+
+  CNetMsgMaker msg_maker(1);
+  std::unique_ptr<CNode> node1(MockNode(1));
+  std::unique_ptr<CNode> node2(MockNode(2));
+  std::unique_ptr<CNode> node3(MockNode(3));
+  for (CNode *node : {node1.get(), node2.get(), node3.get()}) {
+    node->m_best_snapshot = best_snapshot;
+  }
+
+  // chunks are spread across the peers
+  std::vector<snapshot::GetSnapshot> gets;
+  p2p_state.MockRequestChunks(*node1, msg_maker);
+  BOOST_CHECK(SentCommands(*node1, gets) ==
+              std::vector<std::string>({"getchunkhash", "getsnapshot", "getsnapshot"}));
+  p2p_state.MockRequestChunks(*node2, msg_maker);
+  BOOST_CHECK(SentCommands(*node2, gets) ==
+              std::vector<std::string>({"getchunkhash", "getsnapshot"}));
+  BOOST_REQUIRE_EQUAL(gets.size(), 1);
+  BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 4);
+
+  // hashes which don't add up to the snapshot hash are rejected
+  {
+    snapshot::ChunkHashes hashes = MockChunkHashes(chunks, 2);
+    hashes.hashes[0] = hashes.hashes[1];
+    CDataStream body = Serialize(hashes);
+    BOOST_CHECK(!p2p_state.ProcessChunkHashes(*node2, body));
+    BOOST_CHECK(node2->m_best_snapshot.IsNull());
+  }
+
+  {
+    CDataStream body = Serialize(MockChunkHashes(chunks, 2));
+    BOOST_CHECK(p2p_state.ProcessChunkHashes(*node1, body));
+  }
+
+  // the chunk which doesn't match the hash is detected right away
+  {
+    snapshot::Snapshot chunk = chunks[0];
+    chunk.utxo_subsets[0].outputs[0].nValue = 1;
+    CDataStream body = Serialize(chunk);
+    BOOST_CHECK(!p2p_state.ProcessSnapshot(*node1, body, msg_maker));
+    BOOST_CHECK(node1->m_best_snapshot.IsNull());
+    BOOST_CHECK(node1->vSendMsg.empty());
+  }
+
+  // chunks of the invalid peers are requested from others
+  p2p_state.MockRequestChunks(*node3, msg_maker);
+  BOOST_CHECK(SentCommands(*node3, gets) ==
+              std::vector<std::string>({"getchunkhash", "getsnapshot", "getsnapshot"}));
+  BOOST_REQUIRE_EQUAL(gets.size(), 2);
+  BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 0);
+  BOOST_CHECK_EQUAL(gets[1].utxo_subset_index, 2);
+}
+
+BOOST_AUTO_TEST_CASE(resume_snapshot_download) {
+  SetDataDir("snapshot_process_p2p_resume");
+  fs::remove_all(GetDataDir() / snapshot::SNAPSHOT_FOLDER);
+  snapshot::StoreCandidateBlockHash(uint256());
+  snapshot::EnableISDMode();
+  snapshot::Params params;
+  params.snapshot_chunk_size = 2;
+
+  snapshot::SnapshotHeader best_snapshot;
+  best_snapshot.snapshot_hash = uint256S("294f4fba05bc2f19764960989b4a364466522b3009808ff99e89cfde56bf43e7");
+  best_snapshot.block_hash = uint256S("aa");
+  best_snapshot.stake_modifier = uint256S("bb");
+  best_snapshot.chain_work = uint256S("cc");
+  best_snapshot.total_utxo_subsets = 6;
+
+  auto bi = new CBlockIndex;
+  bi->stake_modifier = best_snapshot.stake_modifier;
+  bi->phashBlock = &mapBlockIndex.emplace(best_snapshot.block_hash, bi).first->first;
+
+  const std::vector<snapshot::Snapshot> chunks = MockChunks(best_snapshot, 2);
+  const fs::path dir = GetDataDir() / snapshot::SNAPSHOT_FOLDER / best_snapshot.snapshot_hash.GetHex();
+
+  CNetMsgMaker msg_maker(1);
+  std::unique_ptr<CNode> node(MockNode());
+  node->m_best_snapshot = best_snapshot;
+  std::vector<snapshot::GetSnapshot> gets;
+
+  // every new state simulates the restart of the node
+  const auto download_first_chunk = [&] {
+    MockP2PState p2p_state(params);
+    p2p_state.MockBestSnapshot(best_snapshot);
+    p2p_state.MockRequestChunks(*node, msg_maker);
+    SentCommands(*node, gets);
+    BOOST_REQUIRE(!gets.empty());
+    BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 0);
+
+    CDataStream body = Serialize(chunks[0]);
+    BOOST_CHECK(p2p_state.ProcessSnapshot(*node, body, msg_maker));
+    node->vSendMsg.clear();
+    BOOST_CHECK(fs::exists(dir / "hash.dat"));
+  };
+
+  // the subsets which were written without the hash are downloaded again
+  download_first_chunk();
+  fs::remove(dir / "hash.dat");
+  download_first_chunk();
+
+  MockP2PState p2p_state(params);
+  p2p_state.MockBestSnapshot(best_snapshot);
+  p2p_state.MockRequestChunks(*node, msg_maker);
+  SentCommands(*node, gets);
+  BOOST_REQUIRE_EQUAL(gets.size(), 2);
+  BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 2);
+  BOOST_CHECK_EQUAL(gets[1].utxo_subset_index, 4);
+
+  // the first chunk isn't read back from disk, the persisted hash covers it
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    CDataStream body = Serialize(chunks[i]);
+    BOOST_CHECK(p2p_state.ProcessSnapshot(*node, body, msg_maker));
+  }
+
+  LOCK(snapshot::cs_snapshot);
+  BOOST_CHECK(HasSnapshotHash(best_snapshot.snapshot_hash));
+  BOOST_CHECK_EQUAL(snapshot::LoadCandidateBlockHash().GetHex(), best_snapshot.block_hash.GetHex());
+}
+
 BOOST_AUTO_TEST_CASE(start_initial_snapshot_download) {
   snapshot::InitP2P(Params().GetSnapshotParams());
   snapshot::EnableISDMode();
@@ -174,15 +395,17 @@ BOOST_AUTO_TEST_CASE(start_initial_snapshot_download) {
   snapshot::SnapshotHeader best;
   best.snapshot_hash = uint256S("a2");
   best.block_hash = b2->GetBlockHash();
+  best.total_utxo_subsets = 5 * snapshot::MAX_UTXO_SET_COUNT;
 
   snapshot::SnapshotHeader second_best;
   second_best.snapshot_hash = uint256S("a1");
   second_best.block_hash = b1->GetBlockHash();
+  second_best.total_utxo_subsets = 5 * snapshot::MAX_UTXO_SET_COUNT;
 
-  std::unique_ptr<CNode> node1(MockNode());  // no snapshot
-  std::unique_ptr<CNode> node2(MockNode());  // second best
-  std::unique_ptr<CNode> node3(MockNode());  // best
-  std::unique_ptr<CNode> node4(MockNode());  // best
+  std::unique_ptr<CNode> node1(MockNode(1));  // no snapshot
+  std::unique_ptr<CNode> node2(MockNode(2));  // second best
+  std::unique_ptr<CNode> node3(MockNode(3));  // best
+  std::unique_ptr<CNode> node4(MockNode(4));  // best
   std::vector<CNode *> nodes{node1.get(), node2.get(), node3.get(), node4.get()};
 
   // test that discovery message was sent
@@ -237,19 +460,20 @@ BOOST_AUTO_TEST_CASE(start_initial_snapshot_download) {
     BOOST_CHECK(nodes[0]->vSendMsg.empty());
     BOOST_CHECK(nodes[1]->vSendMsg.empty());
 
+    // every peer gets its own chunks
     std::vector<CNode *> best_nodes{nodes[2], nodes[3]};
-    for (CNode *node : best_nodes) {
+    for (size_t i = 0; i < best_nodes.size(); ++i) {
+      CNode *node = best_nodes[i];
       BOOST_CHECK(node->m_requested_snapshot_at >= now);
-      BOOST_CHECK_EQUAL(node->vSendMsg.size(), 2);
-      CDataStream(node->vSendMsg[0], SER_NETWORK, PROTOCOL_VERSION) >> header;
-      BOOST_CHECK(header.GetCommand() == "getsnapshot");
-      snapshot::GetSnapshot get;
-      CDataStream(node->vSendMsg[1], SER_NETWORK, PROTOCOL_VERSION) >> get;
-      BOOST_CHECK_EQUAL(get.snapshot_hash.GetHex(), best.snapshot_hash.GetHex());
-      BOOST_CHECK_EQUAL(get.utxo_subset_index, 0);
-      BOOST_CHECK_EQUAL(get.utxo_subset_count, 10000);
-
-      node->vSendMsg.clear();
+      std::vector<snapshot::GetSnapshot> gets;
+      BOOST_CHECK(SentCommands(*node, gets) ==
+                  std::vector<std::string>({"getchunkhash", "getsnapshot", "getsnapshot"}));
+      BOOST_REQUIRE_EQUAL(gets.size(), 2);
+      for (size_t j = 0; j < gets.size(); ++j) {
+        BOOST_CHECK_EQUAL(gets[j].snapshot_hash.GetHex(), best.snapshot_hash.GetHex());
+        BOOST_CHECK_EQUAL(gets[j].utxo_subset_index, (i * 2 + j) * snapshot::MAX_UTXO_SET_COUNT);
+        BOOST_CHECK_EQUAL(gets[j].utxo_subset_count, snapshot::MAX_UTXO_SET_COUNT);
+      }
     }
   }
 
@@ -277,17 +501,15 @@ BOOST_AUTO_TEST_CASE(start_initial_snapshot_download) {
     BOOST_CHECK(nodes[2]->vSendMsg.empty());
     BOOST_CHECK(nodes[3]->vSendMsg.empty());
 
-    BOOST_CHECK_EQUAL(nodes[1]->vSendMsg.size(), 2);
-    CDataStream(nodes[1]->vSendMsg[0], SER_NETWORK, PROTOCOL_VERSION) >> header;
-    BOOST_CHECK(header.GetCommand() == "getsnapshot");
-    snapshot::GetSnapshot get;
-    CDataStream(nodes[1]->vSendMsg[1], SER_NETWORK, PROTOCOL_VERSION) >> get;
-    BOOST_CHECK_EQUAL(get.snapshot_hash.GetHex(), second_best.snapshot_hash.GetHex());
-    BOOST_CHECK_EQUAL(get.utxo_subset_index, 0);
-    BOOST_CHECK_EQUAL(get.utxo_subset_count, 10000);
+    std::vector<snapshot::GetSnapshot> gets;
+    BOOST_CHECK(SentCommands(*nodes[1], gets) ==
+                std::vector<std::string>({"getchunkhash", "getsnapshot", "getsnapshot"}));
+    BOOST_REQUIRE_EQUAL(gets.size(), 2);
+    BOOST_CHECK_EQUAL(gets[0].snapshot_hash.GetHex(), second_best.snapshot_hash.GetHex());
+    BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 0);
+    BOOST_CHECK_EQUAL(gets[0].utxo_subset_count, snapshot::MAX_UTXO_SET_COUNT);
 
     // restore state
-    nodes[1]->vSendMsg.clear();
     nodes[1]->m_requested_snapshot_at = std::chrono::steady_clock::time_point::min();
     nodes[2]->m_requested_snapshot_at = std::chrono::steady_clock::now();
     nodes[3]->m_requested_snapshot_at = std::chrono::steady_clock::now();
@@ -304,9 +526,11 @@ BOOST_AUTO_TEST_CASE(start_initial_snapshot_download) {
       for (size_t i = 0; i < total; ++i) {  // disconnect one by one
         CNode &node = *nodes[i];
         p2p_state.StartInitialSnapshotDownload(node, i, total, msg_maker, *b2);
-        BOOST_CHECK(node.vSendMsg.empty());
       }
     }
+    BOOST_CHECK(nodes[0]->vSendMsg.empty());
+    BOOST_CHECK(nodes[1]->vSendMsg.empty());
+    nodes[2]->vSendMsg.clear();  // the remaining peer with the best snapshot
 
     // second best is requested
     for (size_t i = 0; i < nodes.size(); ++i) {
@@ -318,17 +542,15 @@ BOOST_AUTO_TEST_CASE(start_initial_snapshot_download) {
     BOOST_CHECK(nodes[2]->vSendMsg.empty());
     BOOST_CHECK(nodes[3]->vSendMsg.empty());
 
-    BOOST_CHECK_EQUAL(nodes[1]->vSendMsg.size(), 2);
-    CDataStream(nodes[1]->vSendMsg[0], SER_NETWORK, PROTOCOL_VERSION) >> header;
-    BOOST_CHECK(header.GetCommand() == "getsnapshot");
-    snapshot::GetSnapshot get;
-    CDataStream(nodes[1]->vSendMsg[1], SER_NETWORK, PROTOCOL_VERSION) >> get;
-    BOOST_CHECK_EQUAL(get.snapshot_hash.GetHex(), second_best.snapshot_hash.GetHex());
-    BOOST_CHECK_EQUAL(get.utxo_subset_index, 0);
-    BOOST_CHECK_EQUAL(get.utxo_subset_count, 10000);
+    std::vector<snapshot::GetSnapshot> gets;
+    BOOST_CHECK(SentCommands(*nodes[1], gets) ==
+                std::vector<std::string>({"getchunkhash", "getsnapshot", "getsnapshot"}));
+    BOOST_REQUIRE_EQUAL(gets.size(), 2);
+    BOOST_CHECK_EQUAL(gets[0].snapshot_hash.GetHex(), second_best.snapshot_hash.GetHex());
+    BOOST_CHECK_EQUAL(gets[0].utxo_subset_index, 0);
+    BOOST_CHECK_EQUAL(gets[0].utxo_subset_count, snapshot::MAX_UTXO_SET_COUNT);
 
     // restore state
-    nodes[1]->vSendMsg.clear();
     nodes[1]->m_requested_snapshot_at = std::chrono::steady_clock::time_point::min();
     nodes[2]->m_requested_snapshot_at = std::chrono::steady_clock::now();
     nodes[3]->m_requested_snapshot_at = std::chrono::steady_clock::now();
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <staking/kernel_search.h>
+
+#include <test/test_unite.h>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <set>
+
+BOOST_AUTO_TEST_SUITE(kernel_search_tests)
+
+namespace {
+
+struct Fixture {
+  const CBlockIndex block = [] {
+    CBlockIndex index;
+    index.nHeight = 1000;
+    return index;
+  }();
+
+  //! Coins with distinct amounts, the CoinSet orders them from the biggest.
+  const staking::CoinSet coins = [this] {
+    staking::CoinSet coins;
+    for (std::uint32_t i = 0; i < 20000; ++i) {
+      uint256 txid;
+      *txid.begin() = static_cast<unsigned char>(i);
+      *(txid.begin() + 1) = static_cast<unsigned char>(i >> 8);
+      coins.emplace(&block, COutPoint(txid, i), CTxOut(1 + i, CScript()));
+    }
+    return coins;
+  }();
+
+  static uint256 KernelHash(const staking::Coin &coin) {
+    uint256 kernel_hash = coin.GetTransactionId();
+    *(kernel_hash.begin() + 2) = 0xaa;
+    return kernel_hash;
+  }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(finds_first_eligible_coin) {
+  Fixture f;
+  // amounts of the eligible coins, the biggest one comes first in the set
+  const std::set<CAmount> eligible{17, 3000, 15000, 15001};
+  // Boost.Test assertions are not thread safe, the checks count instead
+  std::atomic<std::size_t> checked{0};
+  std::atomic<std::size_t> wrong_kernel_hashes{0};
+  const auto check = [&](const staking::Coin &coin, const uint256 &kernel_hash) {
+    if (kernel_hash != Fixture::KernelHash(coin)) {
+      ++wrong_kernel_hashes;
+    }
+    ++checked;
+    return eligible.count(coin.GetAmount()) > 0;
+  };
+  for (const std::size_t threads : {1, 2, 4, 8}) {
+    checked = 0;
+    const auto result = staking::FindKernel(f.coins, Fixture::KernelHash, check, threads);
+    BOOST_REQUIRE(static_cast<bool>(result));
+    BOOST_CHECK_EQUAL(result->coin->GetAmount(), 15001);
+    BOOST_CHECK(result->kernel_hash == Fixture::KernelHash(*result->coin));
+    // the search stops early, 5000 coins come after the winner
+    BOOST_CHECK(checked < f.coins.size());
+  }
+  BOOST_CHECK_EQUAL(wrong_kernel_hashes.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(no_eligible_coin) {
+  Fixture f;
+  std::atomic<std::size_t> checked{0};
+  const auto check = [&](const staking::Coin &, const uint256 &) {
+    ++checked;
+    return false;
+  };
+  for (const std::size_t threads : {1, 4}) {
+    checked = 0;
+    BOOST_CHECK(!staking::FindKernel(f.coins, Fixture::KernelHash, check, threads));
+    BOOST_CHECK_EQUAL(checked.load(), f.coins.size());
+  }
+  BOOST_CHECK(!staking::FindKernel(staking::CoinSet(), Fixture::KernelHash, check, 4));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,7 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <pubkey.h>
+#include <random.h>
 #include <script/ismine.h>
 #include <util.h>
 
@@ -261,4 +262,16 @@ BOOST_AUTO_TEST_CASE(extract_block_signing_key_p2wsh_witness_script_malformed_mi
   });
 }
 
+BOOST_AUTO_TEST_CASE(kernel_hasher_matches_compute_kernel_hash) {
+  const uint256 stake_modifier = GetRandHash();
+  const blockchain::Time target_time = 1550000000;
+  const staking::KernelHasher hasher(stake_modifier, target_time);
+  for (std::uint32_t i = 0; i < 20; ++i) {
+    const uint256 txid = GetRandHash();
+    const blockchain::Time stake_time = 1540000000 + i;
+    BOOST_CHECK_EQUAL(hasher(stake_time, txid, i),
+                      staking::ComputeKernelHash(stake_modifier, stake_time, txid, i, target_time));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -266,6 +266,9 @@ class StakeValidatorMock : public staking::StakeValidator {
   uint256 ComputeKernelHash(const CBlockIndex *blockindex, const staking::Coin &coin, blockchain::Time time) const override {
     return computekernelfunc(blockindex, coin, time);
   }
+  std::function<uint256(const staking::Coin &)> GetKernelHasher(const CBlockIndex *blockindex, blockchain::Time time) const override {
+    return [this, blockindex, time](const staking::Coin &coin) { return computekernelfunc(blockindex, coin, time); };
+  }
   uint256 ComputeStakeModifier(const CBlockIndex *, const staking::Coin &) const override { return uint256(); }
   bool IsPieceOfStakeKnown(const COutPoint &) const override { return false; }
   void RememberPieceOfStake(const COutPoint &) override {}
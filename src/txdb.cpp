@@ -109,6 +109,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, con
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
+    std::lock_guard<std::mutex> delta_lock(m_delta_mutex);
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
@@ -116,6 +117,8 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, con
                 batch.Erase(entry);
             else
                 batch.Write(entry, it->second.coin);
+            if (m_delta)
+                m_delta->Add(it->first, it->second.coin);
             changed++;
         }
         count++;
@@ -448,7 +451,20 @@ bool CCoinsViewDB::GetSnapshotIndex(snapshot::SnapshotIndex &snapshotIndexOut) {
     return db.Read(DB_SNAPSHOT_INDEX, snapshotIndexOut);
 }
 
+std::unique_ptr<snapshot::UTXODelta> CCoinsViewDB::TakeDelta() {
+    std::lock_guard<std::mutex> lock(m_delta_mutex);
+    std::unique_ptr<snapshot::UTXODelta> delta = std::move(m_delta);
+    m_delta = MakeUnique<snapshot::UTXODelta>(GetBestBlock());
+    return delta;
+}
+
 void CCoinsViewDB::ClearCoins() {
+    {
+        std::lock_guard<std::mutex> lock(m_delta_mutex);
+        if (m_delta)
+            m_delta->Invalidate();
+    }
+
     size_t total = 0;
     std::unique_ptr<CCoinsViewCursor> cursor(Cursor());
     while (cursor->Valid()) {
@@ -466,3 +482,24 @@ void CCoinsViewDB::ClearCoins() {
 
     LogPrint(BCLog::COINDB, "%s: deleted %i keys in the DB\n", __func__, total);
 }
+
+bool CCoinsViewDB::ImportCoins(const std::vector<std::pair<COutPoint, Coin>> &coins) {
+    {
+        std::lock_guard<std::mutex> lock(m_delta_mutex);
+        if (m_delta)
+            m_delta->Invalidate();
+    }
+
+    CDBBatch batch(db);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    for (const std::pair<COutPoint, Coin> &p : coins) {
+        batch.Write(CoinEntry(&p.first), p.second);
+        if (batch.SizeEstimate() > batch_size) {
+            if (!db.WriteBatch(batch)) {
+                return false;
+            }
+            batch.Clear();
+        }
+    }
+    return db.WriteBatch(batch);
+}
@@ -9,10 +9,12 @@
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
+#include <snapshot/delta.h>
 #include <snapshot/snapshot_index.h>
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -81,6 +83,7 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const snapshot::SnapshotHash &snapshotHash) override;
     CCoinsViewCursor *Cursor() const override;
     void ClearCoins() override;
+    bool ImportCoins(const std::vector<std::pair<COutPoint, Coin>> &coins) override;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -88,6 +91,15 @@ public:
 
     bool SetSnapshotIndex(const snapshot::SnapshotIndex &snapshotIndex);
     bool GetSnapshotIndex(snapshot::SnapshotIndex &snapshotIndexOut);
+
+    //! Starts recording the coins changed by BatchWrite into a new delta and
+    //! returns the one recorded since the previous call, nullptr on the first
+    //! call. It's used to create the next snapshot from the previous one.
+    std::unique_ptr<snapshot::UTXODelta> TakeDelta();
+
+private:
+    std::mutex m_delta_mutex;
+    std::unique_ptr<snapshot::UTXODelta> m_delta;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -8,8 +8,8 @@
 #include <consensus/consensus.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
-#include <esperanza/checks.h>
-#include <injector.h>
+#include <esperanza/finalizationstate.h>
+#include <esperanza/vote.h>
 #include <validation.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
@@ -39,6 +39,15 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nSizeWithAncestors = GetTxSize();
     nModFeesWithAncestors = nFee;
     nSigOpCostWithAncestors = sigOpCost;
+
+    voteTargetEpoch = 0;
+    if (tx->IsVote()) {
+        esperanza::Vote vote;
+        std::vector<unsigned char> voteSig;
+        if (CScript::ExtractVoteFromVoteSignature(tx->vin[0].scriptSig, vote, voteSig)) {
+            voteTargetEpoch = vote.m_target_epoch;
+        }
+    }
 }
 
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
@@ -612,6 +621,7 @@ void CTxMemPool::_clear()
 {
     mapLinks.clear();
     mapTx.clear();
+    vTxHashes.clear();
     mapNextTx.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
@@ -926,8 +936,8 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -938,29 +948,19 @@ void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPool
     }
 }
 
-int CTxMemPool::ExpireVotes() {
+int CTxMemPool::ExpireVotes(const esperanza::FinalizationState &fin_state) {
   LOCK(cs);
-  auto it = mempool.mapTx.get<ancestor_score>().begin();
-
-  AssertLockHeld(GetComponent<finalization::StateRepository>()->GetLock());
 
-  const finalization::FinalizationState *fin_state =
-      GetComponent<finalization::StateRepository>()->GetTipState();
-  assert(fin_state != nullptr);
+  // The votes are sorted by their target epoch, the expired ones (see
+  // esperanza::IsVoteExpired) come first.
+  const auto &commits = mapTx.get<finalizer_commit>();
+  const uint16_t vote = (+TxType::VOTE)._to_integral();
+  const auto begin = commits.lower_bound(std::make_pair(vote, uint32_t(0)));
+  const auto end = commits.lower_bound(std::make_pair(vote, fin_state.GetCurrentEpoch() - 1));
 
-  setEntries toremove;
-  while (it != mapTx.get<ancestor_score>().end()) {
-
-    if (it->GetTx().IsVote()) {
-      if (esperanza::IsVoteExpired(it->GetTx(), *fin_state)) {
-          toremove.insert(mapTx.project<0>(it));
-      }
-    }
-    ++it;
-  }
   setEntries stage;
-  for (txiter removeit : toremove) {
-      CalculateDescendants(removeit, stage);
+  for (auto it = begin; it != end; ++it) {
+    CalculateDescendants(mapTx.project<0>(it), stage);
   }
 
   if (stage.size() > 0) {
@@ -29,6 +29,10 @@
 
 class CBlockIndex;
 
+namespace esperanza {
+class FinalizationState;
+}
+
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
@@ -74,6 +78,7 @@ private:
     int64_t sigOpCost;         //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
+    uint32_t voteTargetEpoch;  //!< Target epoch if the transaction is a vote, 0 otherwise
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -105,6 +110,7 @@ public:
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
+    uint32_t GetVoteTargetEpoch() const { return voteTargetEpoch; }
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -197,6 +203,16 @@ struct mempoolentry_txid
     }
 };
 
+// extracts the transaction type and the target epoch of a vote from CTxMemPoolEntry
+struct mempoolentry_finalizer_commit
+{
+    typedef std::pair<uint16_t, uint32_t> result_type;
+    result_type operator() (const CTxMemPoolEntry &entry) const
+    {
+        return {entry.GetTx().GetType()._to_integral(), entry.GetVoteTargetEpoch()};
+    }
+};
+
 /** \class CompareTxMemPoolEntryByDescendantScore
  *
  *  Sort an entry by max(score/size of entry's tx, score/size with all descendants).
@@ -314,6 +330,7 @@ public:
 struct descendant_score {};
 struct entry_time {};
 struct ancestor_score {};
+struct finalizer_commit {};
 
 class CBlockPolicyEstimator;
 
@@ -485,6 +502,11 @@ public:
                 boost::multi_index::tag<ancestor_score>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFee
+            >,
+            // sorted by transaction type and the target epoch of votes
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<finalizer_commit>,
+                mempoolentry_finalizer_commit
             >
         >
     > indexed_transaction_set;
@@ -626,10 +648,12 @@ public:
     int Expire(int64_t time);
 
     /** Expire all the votes (and their dependencies) in the mempol wich are referring to
-     *  an epoch before the last finalized one.
+     *  an epoch before the last finalized one. It's called with the state of the tip when
+     *  a block is connected as only then the epoch can advance. The expired votes are a
+     *  range of the finalizer_commit index, so it doesn't visit the other transactions.
      *  @return the number of removed elements.
      */
-    int ExpireVotes();
+    int ExpireVotes(const esperanza::FinalizationState &fin_state);
 
     /** Returns false if the transaction is in the mempool and not within the chain limit specified. */
     bool TransactionWithinChainLimit(const uint256& txid, size_t chainLimit) const;
@@ -7,6 +7,15 @@
 #include <txpool.h>
 #include <validation.h>
 
+#include <thread>
+
+namespace {
+
+//! Don't start a thread for less transactions than this
+constexpr size_t MIN_TXS_PER_WORKER = 5000;
+
+}  // namespace
+
 class TxPoolEnumeratorImpl : public TxPool {
  public:
   size_t GetTxCount() const override {
@@ -36,6 +45,38 @@ class TxPoolEnumeratorImpl : public TxPool {
 
     return result;
   }
+
+  void ForEachTx(const size_t max_workers, const TxVisitor &visitor) const override {
+    LOCK2(g_cs_orphans, mempool.cs);
+
+    // vTxHashes stores the witness hashes of the mempool transactions, so
+    // that they don't have to be computed again.
+    const auto &hashes = mempool.vTxHashes;
+    const auto visit_range = [&hashes, &visitor](const size_t worker, const size_t begin, const size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        visitor(worker, hashes[i].second->GetSharedTx(), hashes[i].first);
+      }
+    };
+
+    const size_t workers = std::max<size_t>(1, std::min(max_workers, hashes.size() / MIN_TXS_PER_WORKER));
+    const size_t per_worker = (hashes.size() + workers - 1) / workers;
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker) {
+      const size_t begin = std::min(hashes.size(), worker * per_worker);
+      const size_t end = std::min(hashes.size(), begin + per_worker);
+      threads.emplace_back(visit_range, worker, begin, end);
+    }
+    visit_range(0, 0, std::min(hashes.size(), per_worker));
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    for (const auto &entry : mapOrphanTransactions) {
+      visitor(0, entry.second.tx, entry.second.tx->GetWitnessHash());
+    }
+  }
 };
 
 std::unique_ptr<TxPool> TxPool::New() {
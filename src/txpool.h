@@ -7,11 +7,26 @@
 
 #include <primitives/transaction.h>
 
+#include <functional>
+
 //! \brief Interface that wraps access to both mempool and orphanpool
 class TxPool {
  public:
+  //! \brief The callback of ForEachTx.
+  //!
+  //! worker is the index of the thread calling it, in [0, max_workers).
+  using TxVisitor = std::function<void(size_t worker, const CTransactionRef &tx, const uint256 &witness_hash)>;
+
   virtual size_t GetTxCount() const = 0;
   virtual std::vector<CTransactionRef> GetTxs() const = 0;
+
+  //! \brief Visits every transaction along with its witness hash.
+  //!
+  //! Unlike GetTxs() the pool is not copied. Large pools are split between up
+  //! to max_workers threads, so visitor must be safe to call concurrently for
+  //! different workers. The pool is locked until all transactions are visited.
+  virtual void ForEachTx(size_t max_workers, const TxVisitor &visitor) const = 0;
+
   virtual ~TxPool() = default;
 
   static std::unique_ptr<TxPool> New();
@@ -0,0 +1,615 @@
+// Copyright (c) 2019 The Unit-e developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef UNITE_UTIL_PERSISTENT_MAP_H
+#define UNITE_UTIL_PERSISTENT_MAP_H
+
+#include <serialize.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+//! \brief An ordered map with structural sharing between copies.
+//!
+//! The map is an AVL tree whose nodes are reference counted. Copying a map
+//! is O(1): both copies point to the same root. A mutation copies only the
+//! nodes on the path from the root to the affected key (and only those that
+//! are still shared with another map), so a copy that diverges in k keys
+//! costs O(k log n) time and memory instead of O(n).
+//!
+//! The interface is the subset of std::map that is used throughout the code
+//! base. Iteration is read-only; values are mutated through at() and
+//! operator[], which detach the path to the key before returning a
+//! reference. Such a reference is valid until the next mutation of, or copy
+//! from, this map.
+//!
+//! The serialized form is identical to the one of std::map<K, V>.
+//!
+//! Not thread safe: concurrent access to one instance (including copying it)
+//! must be synchronized by the owner. Distinct instances sharing nodes can be
+//! used from different threads as shared nodes are never mutated.
+template <typename K, typename V, typename Compare = std::less<K>>
+class PersistentMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using size_type = std::size_t;
+
+ private:
+  struct Node {
+    value_type value;
+    std::shared_ptr<Node> left;
+    std::shared_ptr<Node> right;
+    int height = 1;
+
+    explicit Node(const value_type &v) : value(v) {}
+    Node(K key, V v) : value(std::move(key), std::move(v)) {}
+    Node(const Node &other) = default;
+  };
+  using NodePtr = std::shared_ptr<Node>;
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename PersistentMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+    const_iterator() = default;
+
+    reference operator*() const { return m_path.back()->value; }
+    pointer operator->() const { return &m_path.back()->value; }
+
+    const_iterator &operator++() {
+      const Node *node = m_path.back();
+      if (node->right) {
+        PushLeftmost(node->right.get());
+        return *this;
+      }
+      // Climb up until we come from a left subtree.
+      m_path.pop_back();
+      while (!m_path.empty() && m_path.back()->right.get() == node) {
+        node = m_path.back();
+        m_path.pop_back();
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const const_iterator &other) const {
+      if (m_path.empty() || other.m_path.empty()) {
+        return m_path.empty() == other.m_path.empty();
+      }
+      return m_path.back() == other.m_path.back();
+    }
+    bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+   private:
+    friend class PersistentMap;
+
+    void PushLeftmost(const Node *node) {
+      while (node) {
+        m_path.push_back(node);
+        node = node->left.get();
+      }
+    }
+
+    // Path from the root to the current node, empty for end().
+    std::vector<const Node *> m_path;
+  };
+  using iterator = const_iterator;
+
+  PersistentMap() = default;
+  PersistentMap(const PersistentMap &) = default;
+  PersistentMap(PersistentMap &&other) noexcept
+      : m_root(std::move(other.m_root)), m_size(other.m_size) {
+    other.m_size = 0;
+  }
+  PersistentMap(std::initializer_list<value_type> init) {
+    for (const value_type &v : init) {
+      insert(v);
+    }
+  }
+  PersistentMap &operator=(const PersistentMap &) = default;
+  PersistentMap &operator=(PersistentMap &&other) noexcept {
+    m_root = std::move(other.m_root);
+    m_size = other.m_size;
+    other.m_size = 0;
+    return *this;
+  }
+
+  size_type size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  void clear() {
+    m_root.reset();
+    m_size = 0;
+  }
+
+  const_iterator begin() const {
+    const_iterator it;
+    it.PushLeftmost(m_root.get());
+    return it;
+  }
+  const_iterator end() const { return const_iterator(); }
+
+  const_iterator find(const K &key) const {
+    const_iterator it;
+    const Node *node = m_root.get();
+    while (node) {
+      it.m_path.push_back(node);
+      if (m_compare(key, node->value.first)) {
+        node = node->left.get();
+      } else if (m_compare(node->value.first, key)) {
+        node = node->right.get();
+      } else {
+        return it;
+      }
+    }
+    return end();
+  }
+
+  //! \brief Returns an iterator to the first element not less than key.
+  const_iterator lower_bound(const K &key) const {
+    const_iterator it;
+    std::size_t keep = 0;
+    const Node *node = m_root.get();
+    while (node) {
+      it.m_path.push_back(node);
+      if (m_compare(node->value.first, key)) {
+        node = node->right.get();
+      } else {
+        keep = it.m_path.size();
+        node = node->left.get();
+      }
+    }
+    it.m_path.resize(keep);
+    return it;
+  }
+
+  size_type count(const K &key) const { return find(key) != end() ? 1 : 0; }
+
+  //! \brief Returns the value for key, throws std::out_of_range if missing.
+  const V &at(const K &key) const {
+    const Node *node = Lookup(key);
+    if (!node) {
+      throw std::out_of_range("PersistentMap::at");
+    }
+    return node->value.second;
+  }
+
+  //! \brief Returns a mutable reference to the value of key, detaching the
+  //! path to it. Throws std::out_of_range if missing.
+  V &at(const K &key) {
+    if (!Lookup(key)) {
+      throw std::out_of_range("PersistentMap::at");
+    }
+    return Mutable(m_root, key);
+  }
+
+  V &operator[](const K &key) {
+    bool inserted = false;
+    Node *node = Upsert(m_root, key, inserted, [&key] { return std::make_shared<Node>(key, V()); });
+    if (inserted) {
+      ++m_size;
+    }
+    return node->value.second;
+  }
+
+  template <typename... Args>
+  std::pair<const_iterator, bool> emplace(Args &&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  std::pair<const_iterator, bool> insert(const value_type &value) {
+    if (Lookup(value.first)) {
+      return {find(value.first), false};
+    }
+    bool inserted = false;
+    Upsert(m_root, value.first, inserted, [&value] { return std::make_shared<Node>(value); });
+    assert(inserted);
+    ++m_size;
+    return {find(value.first), true};
+  }
+
+  size_type erase(const K &key) {
+    if (!Lookup(key)) {
+      return 0;
+    }
+    // The key may refer to the node being removed.
+    const K copy = key;
+    Remove(m_root, copy);
+    --m_size;
+    return 1;
+  }
+
+  bool operator==(const PersistentMap &other) const {
+    if (m_size != other.m_size) {
+      return false;
+    }
+    if (m_root == other.m_root) {
+      return true;
+    }
+    return std::equal(begin(), end(), other.begin());
+  }
+  bool operator!=(const PersistentMap &other) const { return !(*this == other); }
+
+  //! \brief Calls f(key, value, other_value) for every key whose value
+  //! differs between this map and other. A value missing from one of the maps
+  //! is passed as nullptr. Keys are reported in ascending order.
+  //!
+  //! Subtrees shared by both maps are skipped, so comparing a map with a
+  //! recent copy of itself costs roughly O(changes * log n).
+  template <typename F>
+  void ForEachDifference(const PersistentMap &other, F f) const {
+    Diff(m_root.get(), other.m_root.get(), f);
+  }
+
+  //! \brief Returns true if both maps share their whole tree. This is a
+  //! cheap sufficient (but not necessary) condition for equality.
+  bool SharesRootWith(const PersistentMap &other) const { return m_root == other.m_root; }
+
+  template <typename Stream>
+  void Serialize(Stream &s) const {
+    WriteCompactSize(s, m_size);
+    for (const value_type &v : *this) {
+      ::Serialize(s, v.first);
+      ::Serialize(s, v.second);
+    }
+  }
+
+  template <typename Stream>
+  void Unserialize(Stream &s) {
+    clear();
+    const size_type size = ReadCompactSize(s);
+    std::vector<NodePtr> nodes;
+    nodes.reserve(size);
+    bool ascending = true;
+    for (size_type i = 0; i < size; ++i) {
+      K key;
+      ::Unserialize(s, key);
+      nodes.emplace_back(std::make_shared<Node>(std::move(key), V()));
+      ::Unserialize(s, nodes.back()->value.second);
+      ascending = ascending && (i == 0 || m_compare(nodes[i - 1]->value.first, nodes[i]->value.first));
+    }
+    if (ascending) {
+      // This is what Serialize produces, build the tree in linear time.
+      m_root = BuildBalanced(nodes, 0, nodes.size());
+      m_size = nodes.size();
+      return;
+    }
+    // std::map semantics: the first occurrence of a key wins.
+    for (const NodePtr &node : nodes) {
+      insert(node->value);
+    }
+  }
+
+ private:
+  NodePtr m_root;
+  size_type m_size = 0;
+  Compare m_compare;
+
+  static int Height(const NodePtr &node) { return node ? node->height : 0; }
+
+  static void UpdateHeight(Node &node) {
+    node.height = 1 + std::max(Height(node.left), Height(node.right));
+  }
+
+  //! Makes sure that the node pointed by ptr is owned exclusively by the
+  //! tree it is reached from, so that it can be modified in place.
+  static void Detach(NodePtr &ptr) {
+    if (ptr && ptr.use_count() > 1) {
+      ptr = std::make_shared<Node>(*ptr);
+    }
+  }
+
+  static void RotateRight(NodePtr &ptr) {
+    Detach(ptr->left);
+    NodePtr left = std::move(ptr->left);
+    ptr->left = std::move(left->right);
+    UpdateHeight(*ptr);
+    left->right = std::move(ptr);
+    UpdateHeight(*left);
+    ptr = std::move(left);
+  }
+
+  static void RotateLeft(NodePtr &ptr) {
+    Detach(ptr->right);
+    NodePtr right = std::move(ptr->right);
+    ptr->right = std::move(right->left);
+    UpdateHeight(*ptr);
+    right->left = std::move(ptr);
+    UpdateHeight(*right);
+    ptr = std::move(right);
+  }
+
+  //! Restores the AVL invariant at ptr, which must be detached.
+  static void Rebalance(NodePtr &ptr) {
+    UpdateHeight(*ptr);
+    const int balance = Height(ptr->left) - Height(ptr->right);
+    if (balance > 1) {
+      if (Height(ptr->left->left) < Height(ptr->left->right)) {
+        Detach(ptr->left);
+        RotateLeft(ptr->left);
+      }
+      RotateRight(ptr);
+    } else if (balance < -1) {
+      if (Height(ptr->right->right) < Height(ptr->right->left)) {
+        Detach(ptr->right);
+        RotateRight(ptr->right);
+      }
+      RotateLeft(ptr);
+    }
+  }
+
+  const Node *Lookup(const K &key) const {
+    const Node *node = m_root.get();
+    while (node) {
+      if (m_compare(key, node->value.first)) {
+        node = node->left.get();
+      } else if (m_compare(node->value.first, key)) {
+        node = node->right.get();
+      } else {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  //! Detaches the path to an existing key and returns its value.
+  V &Mutable(NodePtr &ptr, const K &key) {
+    NodePtr *cur = &ptr;
+    while (true) {
+      Detach(*cur);
+      Node &node = **cur;
+      if (m_compare(key, node.value.first)) {
+        cur = &node.left;
+      } else if (m_compare(node.value.first, key)) {
+        cur = &node.right;
+      } else {
+        return node.value.second;
+      }
+    }
+  }
+
+  //! Finds key in the subtree, creating it with make_node if missing. Nodes
+  //! are only moved around by rotations, so the returned pointer stays valid.
+  template <typename MakeNode>
+  Node *Upsert(NodePtr &ptr, const K &key, bool &inserted, const MakeNode &make_node) {
+    if (!ptr) {
+      ptr = make_node();
+      inserted = true;
+      return ptr.get();
+    }
+    Detach(ptr);
+    Node *result;
+    if (m_compare(key, ptr->value.first)) {
+      result = Upsert(ptr->left, key, inserted, make_node);
+    } else if (m_compare(ptr->value.first, key)) {
+      result = Upsert(ptr->right, key, inserted, make_node);
+    } else {
+      return ptr.get();
+    }
+    if (inserted) {
+      Rebalance(ptr);
+    }
+    return result;
+  }
+
+  //! Unlinks the minimum of the subtree and returns it detached.
+  static NodePtr RemoveMin(NodePtr &ptr) {
+    Detach(ptr);
+    if (!ptr->left) {
+      NodePtr min = std::move(ptr);
+      ptr = std::move(min->right);
+      return min;
+    }
+    NodePtr min = RemoveMin(ptr->left);
+    Rebalance(ptr);
+    return min;
+  }
+
+  void Remove(NodePtr &ptr, const K &key) {
+    assert(ptr);
+    Detach(ptr);
+    if (m_compare(key, ptr->value.first)) {
+      Remove(ptr->left, key);
+    } else if (m_compare(ptr->value.first, key)) {
+      Remove(ptr->right, key);
+    } else {
+      if (!ptr->left || !ptr->right) {
+        NodePtr child = ptr->left ? std::move(ptr->left) : std::move(ptr->right);
+        ptr = std::move(child);
+        return;
+      }
+      NodePtr right = std::move(ptr->right);
+      NodePtr min = RemoveMin(right);
+      min->left = std::move(ptr->left);
+      min->right = std::move(right);
+      ptr = std::move(min);
+    }
+    Rebalance(ptr);
+  }
+
+  template <typename F>
+  void Diff(const Node *a, const Node *b, F &f) const {
+    if (a == b) {
+      return;
+    }
+    if (a != nullptr && b != nullptr &&
+        !m_compare(a->value.first, b->value.first) &&
+        !m_compare(b->value.first, a->value.first)) {
+      // Same key at the same position: both subtrees split the key space
+      // identically, so they can be compared independently.
+      Diff(a->left.get(), b->left.get(), f);
+      if (!(a->value.second == b->value.second)) {
+        f(a->value.first, &a->value.second, &b->value.second);
+      }
+      Diff(a->right.get(), b->right.get(), f);
+      return;
+    }
+    // The shape differs (e.g. after a rotation), merge both subtrees.
+    std::vector<const Node *> left, right;
+    Flatten(a, left);
+    Flatten(b, right);
+    auto l = left.begin();
+    auto r = right.begin();
+    while (l != left.end() || r != right.end()) {
+      if (r == right.end() || (l != left.end() && m_compare((*l)->value.first, (*r)->value.first))) {
+        f((*l)->value.first, &(*l)->value.second, nullptr);
+        ++l;
+      } else if (l == left.end() || m_compare((*r)->value.first, (*l)->value.first)) {
+        f((*r)->value.first, nullptr, &(*r)->value.second);
+        ++r;
+      } else {
+        if (*l != *r && !((*l)->value.second == (*r)->value.second)) {
+          f((*l)->value.first, &(*l)->value.second, &(*r)->value.second);
+        }
+        ++l;
+        ++r;
+      }
+    }
+  }
+
+  static void Flatten(const Node *node, std::vector<const Node *> &out) {
+    if (node == nullptr) {
+      return;
+    }
+    Flatten(node->left.get(), out);
+    out.push_back(node);
+    Flatten(node->right.get(), out);
+  }
+
+  static NodePtr BuildBalanced(std::vector<NodePtr> &nodes, std::size_t from, std::size_t to) {
+    if (from >= to) {
+      return nullptr;
+    }
+    const std::size_t mid = from + (to - from) / 2;
+    NodePtr node = std::move(nodes[mid]);
+    node->left = BuildBalanced(nodes, from, mid);
+    node->right = BuildBalanced(nodes, mid + 1, to);
+    UpdateHeight(*node);
+    nodes[mid] = node;
+    return node;
+  }
+};
+
+//! \brief An ordered set with structural sharing between copies.
+//!
+//! See PersistentMap. Serializes like std::set<K>.
+template <typename K, typename Compare = std::less<K>>
+class PersistentSet {
+  struct Empty {
+    bool operator==(const Empty &) const { return true; }
+    template <typename Stream>
+    void Serialize(Stream &) const {}
+    template <typename Stream>
+    void Unserialize(Stream &) {}
+  };
+  using Map = PersistentMap<K, Empty, Compare>;
+
+ public:
+  using key_type = K;
+  using value_type = K;
+  using size_type = typename Map::size_type;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = K;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const K *;
+    using reference = const K &;
+
+    const_iterator() = default;
+
+    reference operator*() const { return m_it->first; }
+    pointer operator->() const { return &m_it->first; }
+    const_iterator &operator++() {
+      ++m_it;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator copy = *this;
+      ++m_it;
+      return copy;
+    }
+    bool operator==(const const_iterator &other) const { return m_it == other.m_it; }
+    bool operator!=(const const_iterator &other) const { return m_it != other.m_it; }
+
+   private:
+    friend class PersistentSet;
+    explicit const_iterator(typename Map::const_iterator it) : m_it(std::move(it)) {}
+    typename Map::const_iterator m_it;
+  };
+  using iterator = const_iterator;
+
+  PersistentSet() = default;
+  PersistentSet(std::initializer_list<K> init) {
+    for (const K &k : init) {
+      insert(k);
+    }
+  }
+
+  size_type size() const { return m_map.size(); }
+  bool empty() const { return m_map.empty(); }
+  void clear() { m_map.clear(); }
+
+  const_iterator begin() const { return const_iterator(m_map.begin()); }
+  const_iterator end() const { return const_iterator(m_map.end()); }
+  const_iterator find(const K &key) const { return const_iterator(m_map.find(key)); }
+  size_type count(const K &key) const { return m_map.count(key); }
+
+  std::pair<const_iterator, bool> insert(const K &key) {
+    const auto res = m_map.emplace(key, Empty());
+    return {const_iterator(res.first), res.second};
+  }
+  template <typename... Args>
+  std::pair<const_iterator, bool> emplace(Args &&... args) {
+    return insert(K(std::forward<Args>(args)...));
+  }
+  size_type erase(const K &key) { return m_map.erase(key); }
+
+  //! \brief Calls f(key, in_this) for every key present in exactly one of
+  //! this set and other. See PersistentMap::ForEachDifference.
+  template <typename F>
+  void ForEachDifference(const PersistentSet &other, F f) const {
+    m_map.ForEachDifference(other.m_map, [&f](const K &key, const Empty *mine, const Empty *) {
+      f(key, mine != nullptr);
+    });
+  }
+
+  bool operator==(const PersistentSet &other) const { return m_map == other.m_map; }
+  bool operator!=(const PersistentSet &other) const { return m_map != other.m_map; }
+
+  template <typename Stream>
+  void Serialize(Stream &s) const { m_map.Serialize(s); }
+  template <typename Stream>
+  void Unserialize(Stream &s) { m_map.Unserialize(s); }
+
+ private:
+  Map m_map;
+};
+
+}  // namespace util
+
+#endif  // UNITE_UTIL_PERSISTENT_MAP_H
@@ -452,9 +452,6 @@ static void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age)
         LogPrint(BCLog::MEMPOOL, "Expired %i transactions from the memory pool.\n", expired);
     }
 
-    LOCK(GetComponent<finalization::StateRepository>()->GetLock());
-    pool.ExpireVotes();
-
     std::vector<COutPoint> vNoSpendsRemaining;
     pool.TrimToSize(limit, &vNoSpendsRemaining);
     for (const COutPoint &removed : vNoSpendsRemaining) {
@@ -635,10 +632,6 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
     LOCK(GetComponent<finalization::StateRepository>()->GetLock());
     LOCK(pool.cs); // mempool "read lock" (held through GetMainSignals().TransactionAddedToMempool())
 
-    // If there is an expired vote in the mempool and a new vote (or other
-    // esperanza transaction) is coming - it might create a mempool conflict
-    pool.ExpireVotes();
-
     if (tx.IsVote() || tx.IsSlash()){
         bypass_limits = true;
     }
@@ -1841,6 +1834,18 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CFinalizerCommitCheck> commitcheckqueue(128);
+
+void ThreadFinalizerCommitCheck() {
+    RenameThread("unite-commitch");
+    commitcheckqueue.Thread();
+}
+
+bool CFinalizerCommitCheck::operator()() {
+    CValidationState state;
+    return esperanza::CheckFinalizerCommit(*ptx, state);
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2067,6 +2072,23 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
     }
 
+    // UNIT-E: The stateless checks of the finalizer commits, most notably the vote signatures,
+    // run on the check queue workers. Their results are not used: valid vote signatures are
+    // cached, so the checks below don't verify them again, and an invalid commit fails again
+    // below with the proper reject reason. The control is released before the checks below
+    // take mempool.cs, which keeps the lock order described below.
+    if (!isGenesisBlock && has_finalization_tx && nScriptCheckThreads) {
+        CCheckQueueControl<CFinalizerCommitCheck> commit_control(&commitcheckqueue);
+        std::vector<CFinalizerCommitCheck> commit_checks;
+        for (const auto &tx : block.vtx) {
+            if (tx->IsFinalizerCommit()) {
+                commit_checks.emplace_back(*tx);
+            }
+        }
+        commit_control.Add(commit_checks);
+        commit_control.Wait();
+    }
+
     {
         auto repo = GetComponent<finalization::StateRepository>();
         LOCK(repo->GetLock());
@@ -2464,6 +2486,11 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     chainActive.SetTip(pindexDelete->pprev);
 
     UpdateTip(pindexDelete->pprev, chainparams);
+    {
+        auto repo = GetComponent<finalization::StateRepository>();
+        LOCK(repo->GetLock());
+        repo->PublishTipSnapshot();
+    }
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     GetMainSignals().BlockDisconnected(pblock);
@@ -2600,6 +2627,16 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     // Update chainActive & related variables.
     chainActive.SetTip(pindexNew);
     UpdateTip(pindexNew, chainparams);
+    {
+        // The votes can only expire when the tip advances an epoch. Expiring
+        // them here keeps them from conflicting with the votes which come next.
+        auto repo = GetComponent<finalization::StateRepository>();
+        LOCK(repo->GetLock());
+        const finalization::FinalizationState *fin_state = repo->GetTipState();
+        assert(fin_state != nullptr);
+        mempool.ExpireVotes(*fin_state);
+        repo->PublishTipSnapshot();
+    }
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
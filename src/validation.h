@@ -274,6 +274,8 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the finalizer commit checking thread */
+void ThreadFinalizerCommitCheck();
 /** Check the current status of the initial block download (what state are we in exactly) */
 SyncStatus GetInitialBlockDownloadStatus();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -394,6 +396,28 @@ public:
     std::string ToString() const;
 };
 
+/**
+ * Closure representing the stateless checks of a finalizer commit: its format,
+ * the validator pubkey and, for votes, the vote signature. Valid vote
+ * signatures are stored in the vote signature cache, so the checks which
+ * depend on the finalization state don't verify them again.
+ */
+class CFinalizerCommitCheck
+{
+private:
+    const CTransaction *ptx;
+
+public:
+    CFinalizerCommitCheck(): ptx(nullptr) {}
+    explicit CFinalizerCommitCheck(const CTransaction& txIn) : ptx(&txIn) {}
+
+    bool operator()();
+
+    void swap(CFinalizerCommitCheck &check) {
+        std::swap(ptx, check.ptx);
+    }
+};
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
@@ -97,7 +97,7 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.m_internals->TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1));
     g_signals.m_internals->UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3));
     g_signals.m_internals->NewPoWValidBlock.disconnect(boost::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, _1, _2));
-    g_signals.m_internals->SlashingConditionDetected.connect(boost::bind(&CValidationInterface::SlashingConditionDetected, pwalletIn, _1, _2));
+    g_signals.m_internals->SlashingConditionDetected.disconnect(boost::bind(&CValidationInterface::SlashingConditionDetected, pwalletIn, _1, _2));
 }
 
 void UnregisterAllValidationInterfaces() {
@@ -65,9 +65,8 @@ UniValue deposit(const JSONRPCRequest &request)
   }
 
   {
-    LOCK(GetComponent<finalization::StateRepository>()->GetLock());
-    const finalization::FinalizationState *fin_state =
-      GetComponent<finalization::StateRepository>()->GetTipState();
+    const std::shared_ptr<const finalization::FinalizationState> fin_state =
+      GetComponent<finalization::StateRepository>()->GetTipSnapshot();
     assert(fin_state != nullptr);
 
     if (!fin_state->ValidateDepositAmount(amount)) {
@@ -123,10 +122,8 @@ UniValue withdraw(const JSONRPCRequest &request)
 
   uint256 last_tx_hash;
   {
-    auto state_repo = GetComponent<finalization::StateRepository>();
-    LOCK(state_repo->GetLock());
-
-    finalization::FinalizationState *state = state_repo->GetTipState();
+    const std::shared_ptr<const finalization::FinalizationState> state =
+      GetComponent<finalization::StateRepository>()->GetTipSnapshot();
     assert(state);
 
     const esperanza::Validator *validator = state->GetValidator(extWallet.validatorState->m_validator_address);
@@ -180,10 +177,8 @@ UniValue logout(const JSONRPCRequest& request) {
   assert(extWallet.validatorState);
 
   {
-    auto state_repo = GetComponent<finalization::StateRepository>();
-    LOCK(state_repo->GetLock());
-
-    finalization::FinalizationState *state = state_repo->GetTipState();
+    const std::shared_ptr<const finalization::FinalizationState> state =
+      GetComponent<finalization::StateRepository>()->GetTipSnapshot();
     assert(state);
 
     const esperanza::Validator *validator = state->GetValidator(extWallet.validatorState->m_validator_address);
@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Unit-e developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test downloading the snapshot from many peers at once.
+
+test_download_scales_with_peers checks:
+1. the node requests different chunks of the snapshot from every peer
+2. the snapshot is downloaded faster when there are more peers
+
+test_invalid_chunk checks:
+1. the node checks the chunk against the chunk hashes as soon as it arrives
+2. the node disconnects the peer that sent the invalid chunk
+3. the node downloads the rest of the snapshot from other peers
+"""
+
+import copy
+import threading
+import time
+
+from test_framework.test_framework import UnitETestFramework
+from test_framework.mininode import (
+    P2PInterface,
+    mininode_lock,
+    network_thread_start,
+    network_thread_join,
+    NODE_NETWORK,
+    NODE_WITNESS,
+    NODE_SNAPSHOT,
+)
+from test_framework.messages import (
+    msg_commits,
+    msg_getchunkhash,
+    msg_headers,
+    msg_snaphead,
+    msg_snapshot,
+    msg_witness_block,
+    CBlock,
+    CBlockHeader,
+    FromHex,
+    HeaderAndCommits,
+    Snapshot,
+    SnapshotHeader,
+    uint256_from_str,
+)
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    hex_str_to_bytes,
+    wait_until,
+)
+
+SERVICE_FLAGS_WITH_SNAPSHOT = NODE_NETWORK | NODE_WITNESS | NODE_SNAPSHOT
+
+# every reply of the serving peers is delayed to simulate the network latency
+LATENCY_SEC = 0.2
+
+
+def uint256_from_rev_hex(v):
+    return uint256_from_str(hex_str_to_bytes(v)[::-1])
+
+
+def has_valid_snapshot(node, height):
+    res = node.getblocksnapshot(node.getblockhash(height))
+    return res.get('valid', False)
+
+
+class ChunkHashesNode(P2PInterface):
+    """Retrieves the chunk hashes of the snapshot from the full node."""
+
+    def __init__(self):
+        super().__init__()
+        self.chunk_hashes = None
+
+    def on_chunkhashes(self, message):
+        self.chunk_hashes = message
+
+
+class ServingNode(P2PInterface):
+    """Serves the snapshot, its headers and parent block. Every chunk is sent
+    with LATENCY_SEC delay. When broken is set, every chunk it sends has
+    modified outputs."""
+
+    def __init__(self, chunk_hashes, broken=False):
+        super().__init__()
+        self.chunk_hashes = chunk_hashes
+        self.broken = broken
+        self.served_subsets = 0
+        self.first_request_at = None
+        self.snapshot_header = SnapshotHeader()
+        self.snapshot_data = []
+        self.headers = []
+        self.parent_blocks = dict()
+
+    def update_snapshot_from(self, node):
+        res = next(s for s in reversed(node.listsnapshots()) if s['snapshot_finalized'])
+        self.snapshot_header = SnapshotHeader(
+            snapshot_hash=uint256_from_rev_hex(res['snapshot_hash']),
+            block_hash=uint256_from_rev_hex(res['block_hash']),
+            stake_modifier=uint256_from_rev_hex(res['stake_modifier']),
+            chain_work=uint256_from_rev_hex(res['chain_work']),
+            total_utxo_subsets=res['total_utxo_subsets'],
+        )
+        snapshot = FromHex(Snapshot(), node.getrawsnapshot(res['snapshot_hash']))
+        self.snapshot_data = snapshot.utxo_subsets
+
+    def update_headers_and_blocks_from(self, node):
+        prev_block_hash = self.snapshot_header.block_hash
+        for i in range(1, node.getblockcount() + 1):
+            header = FromHex(CBlockHeader(), node.getblockheader(node.getblockhash(i), False))
+            header.calc_sha256()
+            self.headers.append(header)
+            if prev_block_hash == header.hashPrevBlock:
+                block = FromHex(CBlock(), node.getblock(node.getblockhash(i), False))
+                block.calc_sha256()
+                self.parent_blocks[header.sha256] = block
+                prev_block_hash = header.sha256
+
+    def on_getheaders(self, message):
+        msg = msg_headers()
+        msg.headers = self.headers
+        self.send_message(msg)
+
+    def on_getcommits(self, message):
+        msg = msg_commits()
+        msg.status = 1  # TipReached
+        msg.data = [HeaderAndCommits(h) for h in self.headers]
+        self.send_message(msg)
+
+    def on_getsnaphead(self, message):
+        self.send_message(msg_snaphead(self.snapshot_header))
+
+    def on_getdata(self, message):
+        for i in message.inv:
+            if i.hash in self.parent_blocks:
+                self.send_message(msg_witness_block(self.parent_blocks[i.hash]))
+
+    def on_getchunkhash(self, message):
+        assert_equal(message.snapshot_hash, self.snapshot_header.snapshot_hash)
+        assert_equal(message.chunk_size, self.chunk_hashes.chunk_size)
+        self.send_message(self.chunk_hashes)
+
+    def on_getsnapshot(self, message):
+        assert_equal(message.getsnapshot.snapshot_hash, self.snapshot_header.snapshot_hash)
+        if self.first_request_at is None:
+            self.first_request_at = time.time()
+
+        start = message.getsnapshot.utxo_subset_index
+        stop = start + message.getsnapshot.utxo_subset_count
+        subsets = self.snapshot_data[start:stop]
+        if self.broken:
+            subsets = copy.deepcopy(subsets)
+            for subset in subsets:
+                for n in subset.outputs:
+                    subset.outputs[n].nValue += 1
+
+        snapshot = Snapshot(
+            snapshot_hash=self.snapshot_header.snapshot_hash,
+            utxo_subset_index=start,
+            utxo_subsets=subsets,
+        )
+        threading.Timer(LATENCY_SEC, self.send_chunk, args=[snapshot]).start()
+
+    def send_chunk(self, snapshot):
+        with mininode_lock:
+            if self.state != "connected":
+                return
+            self.served_subsets += len(snapshot.utxo_subsets)
+            self.send_message(msg_snapshot(snapshot))
+
+
+class P2PSnapshotParallelDownloadTest(UnitETestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 4
+
+        syncing_node_args = [
+            '-prune=1',
+            '-isd=1',
+            '-snapshotchunksize=1',
+            '-snapshotchunktimeout=60',
+            '-snapshotdiscoverytimeout=60',
+        ]
+        self.extra_args = [
+            [],  # snap_node
+            syncing_node_args,  # test_download_scales_with_peers, one peer
+            syncing_node_args,  # test_download_scales_with_peers, many peers
+            syncing_node_args,  # test_invalid_chunk
+        ]
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def create_snapshot(self, snap_node):
+        self.setup_stake_coins(snap_node)
+
+        snap_node.generatetoaddress(1, snap_node.getnewaddress('', 'bech32'))
+
+        # every transaction is a separate UTXO subset
+        for _ in range(20):
+            snap_node.sendtoaddress(snap_node.getnewaddress('', 'bech32'), 1)
+
+        # generate 3 epochs + 1 block to finalize the snapshot which
+        # includes the transactions
+        snap_node.generatetoaddress(15, snap_node.getnewaddress('', 'bech32'))
+        assert_equal(snap_node.getblockcount(), 16)
+        wait_until(lambda: has_valid_snapshot(snap_node, 9), timeout=10)
+
+        # take the chunk hashes the snap_node calculates for chunks of one subset
+        helper_p2p = snap_node.add_p2p_connection(ChunkHashesNode())
+        network_thread_start()
+        helper_p2p.wait_for_verack()
+
+        reference_p2p = ServingNode(None)
+        reference_p2p.update_snapshot_from(snap_node)
+        snapshot_hash = reference_p2p.snapshot_header.snapshot_hash
+        helper_p2p.send_message(msg_getchunkhash(snapshot_hash, 1))
+        wait_until(lambda: helper_p2p.chunk_hashes is not None, timeout=10, lock=mininode_lock)
+        chunk_hashes = helper_p2p.chunk_hashes
+        assert_equal(len(chunk_hashes.hashes), reference_p2p.snapshot_header.total_utxo_subsets)
+
+        snap_node.disconnect_p2ps()
+        network_thread_join()
+        return chunk_hashes
+
+    def serving_peers(self, node, snap_node, chunk_hashes, total, broken=0):
+        peers = []
+        for i in range(total):
+            p2p = ServingNode(chunk_hashes, broken=i < broken)
+            p2p.update_snapshot_from(snap_node)
+            p2p.update_headers_and_blocks_from(snap_node)
+            peers.append(node.add_p2p_connection(p2p, services=SERVICE_FLAGS_WITH_SNAPSHOT))
+        return peers
+
+    def download(self, node, peers):
+        """Returns how long it took the peers to serve the whole snapshot
+        since the first chunk was requested"""
+        total_utxo_subsets = peers[0].snapshot_header.total_utxo_subsets
+
+        network_thread_start()
+        for p2p in peers:
+            p2p.wait_for_verack()
+
+        served = lambda: sum(p2p.served_subsets for p2p in peers if not p2p.broken)
+        wait_until(lambda: served() >= total_utxo_subsets, timeout=60, lock=mininode_lock)
+        with mininode_lock:
+            start = min(p2p.first_request_at for p2p in peers if p2p.first_request_at is not None)
+        return time.time() - start
+
+    def finish_fast_sync(self, node, snap_node):
+        wait_until(lambda: node.getblockcount() == snap_node.getblockcount(), timeout=20)
+        node.disconnect_p2ps()
+        network_thread_join()
+        assert_equal(snap_node.gettxoutsetinfo(), node.gettxoutsetinfo())
+
+    def test_download_scales_with_peers(self, snap_node, chunk_hashes):
+        one_peer_node = self.nodes[1]
+        many_peers_node = self.nodes[2]
+        self.start_node(one_peer_node.index)
+        self.start_node(many_peers_node.index)
+
+        peers = self.serving_peers(one_peer_node, snap_node, chunk_hashes, 1)
+        one_peer_time = self.download(one_peer_node, peers)
+        self.finish_fast_sync(one_peer_node, snap_node)
+
+        peers = self.serving_peers(many_peers_node, snap_node, chunk_hashes, 4)
+        many_peers_time = self.download(many_peers_node, peers)
+        self.finish_fast_sync(many_peers_node, snap_node)
+
+        for p2p in peers:
+            assert_greater_than(p2p.served_subsets, 0)
+
+        self.log.info('Downloaded with 1 peer in %.2fs, with 4 peers in %.2fs' %
+                      (one_peer_time, many_peers_time))
+        assert_greater_than(one_peer_time, many_peers_time * 2)
+
+        self.stop_node(one_peer_node.index)
+        self.stop_node(many_peers_node.index)
+        self.log.info('test_download_scales_with_peers passed')
+
+    def test_invalid_chunk(self, snap_node, chunk_hashes):
+        node = self.nodes[3]
+        self.start_node(node.index)
+
+        peers = self.serving_peers(node, snap_node, chunk_hashes, 3, broken=1)
+        broken_p2p = peers[0]
+        self.download(node, peers)
+
+        # the node gave up on the peer after the first chunk it sent
+        wait_until(lambda: broken_p2p.state != "connected", timeout=10, lock=mininode_lock)
+        assert broken_p2p.served_subsets <= 2
+        self.finish_fast_sync(node, snap_node)
+
+        self.stop_node(node.index)
+        self.log.info('test_invalid_chunk passed')
+
+    def run_test(self):
+        self.stop_nodes()
+
+        snap_node = self.nodes[0]
+        self.start_node(snap_node.index)
+        chunk_hashes = self.create_snapshot(snap_node)
+
+        self.test_download_scales_with_peers(snap_node, chunk_hashes)
+        self.test_invalid_chunk(snap_node, chunk_hashes)
+
+
+if __name__ == '__main__':
+    P2PSnapshotParallelDownloadTest().main()
@@ -1570,27 +1570,38 @@ class msg_getsnapshot:
         return "msg_getsnapshot(%s)" % (repr(self.getsnapshot))
 
 
+# the UTXO subsets are sent one by one in the "snapshot" message
+SNAPSHOT_FORMAT_PLAIN = 0
+# the UTXO subsets are sent in compressed blocks in the "cmpsnapshot" message
+SNAPSHOT_FORMAT_COMPRESSED = 1
+
+
 class GetSnapshot:
-    def __init__(self, snapshot_hash=0, index=0, count=0):
+    def __init__(self, snapshot_hash=0, index=0, count=0, format=SNAPSHOT_FORMAT_PLAIN):
         self.snapshot_hash = snapshot_hash
         self.utxo_subset_index = index
         self.utxo_subset_count = count
+        self.format = format
 
     def deserialize(self, f):
         self.snapshot_hash = deser_uint256(f)
         self.utxo_subset_index = struct.unpack('<Q', f.read(8))[0]
         self.utxo_subset_count = struct.unpack('<H', f.read(2))[0]
+        format = f.read(1)
+        self.format = struct.unpack('<B', format)[0] if format else SNAPSHOT_FORMAT_PLAIN
 
     def serialize(self):
         r = b""
         r += ser_uint256(self.snapshot_hash)
         r += struct.pack('<Q', self.utxo_subset_index)
         r += struct.pack('<H', self.utxo_subset_count)
+        if self.format != SNAPSHOT_FORMAT_PLAIN:
+            r += struct.pack('<B', self.format)
         return r
 
     def __repr__(self):
-        return "GetSnapshot(snapshot_hash=%064x utxo_subset_index=%i utxo_subset_count=%i)" \
-                % (self.snapshot_hash, self.utxo_subset_index, self.utxo_subset_count)
+        return "GetSnapshot(snapshot_hash=%064x utxo_subset_index=%i utxo_subset_count=%i format=%i)" \
+                % (self.snapshot_hash, self.utxo_subset_index, self.utxo_subset_count, self.format)
 
 
 class msg_snapshot:
@@ -1632,6 +1643,52 @@ class Snapshot:
                 % (self.snapshot_hash, self.utxo_subset_index, repr(self.utxo_subsets))
 
 
+class msg_getchunkhash:
+    command = b"getchunkhash"
+
+    def __init__(self, snapshot_hash=0, chunk_size=0):
+        self.snapshot_hash = snapshot_hash
+        self.chunk_size = chunk_size
+
+    def serialize(self):
+        r = b""
+        r += ser_uint256(self.snapshot_hash)
+        r += struct.pack('<H', self.chunk_size)
+        return r
+
+    def deserialize(self, f):
+        self.snapshot_hash = deser_uint256(f)
+        self.chunk_size = struct.unpack('<H', f.read(2))[0]
+
+    def __repr__(self):
+        return "msg_getchunkhash(snapshot_hash=%064x chunk_size=%i)" % (self.snapshot_hash, self.chunk_size)
+
+
+class msg_chunkhashes:
+    command = b"chunkhashes"
+
+    def __init__(self, snapshot_hash=0, chunk_size=0, hashes=None):
+        self.snapshot_hash = snapshot_hash
+        self.chunk_size = chunk_size
+        self.hashes = [] if hashes is None else hashes
+
+    def serialize(self):
+        r = b""
+        r += ser_uint256(self.snapshot_hash)
+        r += struct.pack('<H', self.chunk_size)
+        r += ser_string_vector(self.hashes)
+        return r
+
+    def deserialize(self, f):
+        self.snapshot_hash = deser_uint256(f)
+        self.chunk_size = struct.unpack('<H', f.read(2))[0]
+        self.hashes = deser_string_vector(f)
+
+    def __repr__(self):
+        return "msg_chunkhashes(snapshot_hash=%064x chunk_size=%i hashes=%i)" \
+                % (self.snapshot_hash, self.chunk_size, len(self.hashes))
+
+
 class UTXOSubset:
     def __init__(self):
         self.tx_id = 0
@@ -51,6 +51,8 @@ MESSAGEMAP = {
     b"snaphead": msg_snaphead,
     b"getsnapshot": msg_getsnapshot,
     b"snapshot": msg_snapshot,
+    b"getchunkhash": msg_getchunkhash,
+    b"chunkhashes": msg_chunkhashes,
     b"notfound": msg_notfound,
     b"getcommits": msg_getcommits,
     b"commits": msg_commits,
@@ -343,6 +345,8 @@ class P2PInterface(P2PConnection):
     def on_snaphead(self, message): pass
     def on_getsnapshot(self, message): pass
     def on_snapshot(self, message): pass
+    def on_getchunkhash(self, message): pass
+    def on_chunkhashes(self, message): pass
     def on_getcommits(self, message): pass
     def on_commits(self, message): pass
     def on_graphenblock(self, message): pass
@@ -96,6 +96,7 @@ BASE_SCRIPTS= [
     'esperanza_withdraw.py',
     'feature_fork_choice_forked_finalize_epoch.py',
     'p2p_snapshot.py',
+    'p2p_snapshot_parallel_download.py',
     'proposer_settings.py',
     'p2p_sendheaders.py',
     'wallet_bumpfee.py',